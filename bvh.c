@@ -0,0 +1,381 @@
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bvh.h"
+#include "jobs.h"
+
+#define BVH_BINS 16
+#define BVH_LEAF_MIN 2
+#define BVH_LEAF_MAX 16
+#define BVH_PARALLEL_THRESHOLD 4096
+#define BVH_STACK_SIZE 64
+/* traversal pushes both children of every interior node on the way down, so the stack holds at most
+ * depth + 2 entries. Deeper than BVH_BALANCED_DEPTH nodes split at the median instead of by SAH, which
+ * halves them and reaches leaves of BVH_LEAF_MIN objects within 31 more levels (count < 2^31) */
+#define BVH_MAX_DEPTH (BVH_STACK_SIZE - 2)
+#define BVH_BALANCED_DEPTH (BVH_MAX_DEPTH - 32)
+
+struct build_node {
+	struct aabb bounds;
+	u32 children[2];
+	u32 start;
+	u32 count; /* 0 for interior nodes */
+	u16 axis;
+};
+
+struct build_ctx {
+	const struct aabb* bounds;
+	isize count;
+	struct vec3* centroids;
+	u32* indices;
+	struct build_node* nodes;
+	atomic_uint node_count;
+};
+
+struct build_task {
+	struct build_ctx* ctx;
+	u32 node;
+	u32 start;
+	u32 end;
+	u32 depth;
+};
+
+static void build_range(struct build_ctx* ctx, u32 node_index, u32 start, u32 end, u32 depth);
+
+static void
+build_task_job(void* data, isize index) {
+	struct build_task* task = &((struct build_task*)data)[index];
+	build_range(task->ctx, task->node, task->start, task->end, task->depth);
+}
+
+static void
+make_leaf(struct build_node* node, u32 start, u32 count) {
+	node->start = start;
+	node->count = count;
+}
+
+static void
+build_range(struct build_ctx* ctx, u32 node_index, u32 start, u32 end, u32 depth) {
+	struct build_node* node = &ctx->nodes[node_index];
+	u32 count = end - start;
+
+	struct aabb bounds = aabb_empty();
+	struct aabb centroid_bounds = aabb_empty();
+	for (u32 i = start; i < end; i++) {
+		u32 id = ctx->indices[i];
+		bounds = aabb_union(bounds, ctx->bounds[id]);
+		centroid_bounds = aabb_grow(centroid_bounds, ctx->centroids[id]);
+	}
+	node->bounds = bounds;
+
+	if (count <= BVH_LEAF_MIN) {
+		make_leaf(node, start, count);
+		return;
+	}
+
+	/* binned SAH over all three axes */
+	float best_cost = (float)count;
+	int best_axis = -1;
+	int best_split = 0;
+	/* degenerate inputs can make SAH peel off a few objects per level, deep enough to overflow the
+	 * traversal stacks; past BVH_BALANCED_DEPTH the tree only halves */
+	for (int axis = 0; axis < 3 && depth < BVH_BALANCED_DEPTH; axis++) {
+		float lo = vec3_axis(centroid_bounds.min, axis);
+		float extent = vec3_axis(centroid_bounds.max, axis) - lo;
+		if (extent <= 0.0f) {
+			continue;
+		}
+		struct aabb bin_bounds[BVH_BINS];
+		u32 bin_counts[BVH_BINS] = {0};
+		for (int b = 0; b < BVH_BINS; b++) {
+			bin_bounds[b] = aabb_empty();
+		}
+		float scale = BVH_BINS / extent;
+		for (u32 i = start; i < end; i++) {
+			u32 id = ctx->indices[i];
+			int b = (int)((vec3_axis(ctx->centroids[id], axis) - lo) * scale);
+			b = b < BVH_BINS ? b : BVH_BINS - 1;
+			bin_counts[b]++;
+			bin_bounds[b] = aabb_union(bin_bounds[b], ctx->bounds[id]);
+		}
+
+		/* sweep from the right to get suffix areas, then from the left evaluating each plane */
+		float right_area[BVH_BINS];
+		u32 right_count[BVH_BINS];
+		struct aabb acc = aabb_empty();
+		u32 n = 0;
+		for (int b = BVH_BINS - 1; b > 0; b--) {
+			acc = aabb_union(acc, bin_bounds[b]);
+			n += bin_counts[b];
+			right_area[b] = aabb_surface_area(acc);
+			right_count[b] = n;
+		}
+		float inv_area = 1.0f / fmaxf(aabb_surface_area(bounds), FLT_MIN);
+		acc = aabb_empty();
+		n = 0;
+		for (int b = 1; b < BVH_BINS; b++) {
+			acc = aabb_union(acc, bin_bounds[b - 1]);
+			n += bin_counts[b - 1];
+			if (n == 0 || right_count[b] == 0) {
+				continue;
+			}
+			/* traversal cost 1/8 relative to one object bounds test */
+			float cost = 0.125f + (aabb_surface_area(acc) * n + right_area[b] * right_count[b]) * inv_area;
+			if (cost < best_cost) {
+				best_cost = cost;
+				best_axis = axis;
+				best_split = b;
+			}
+		}
+	}
+
+	u32 mid;
+	if (best_axis < 0) {
+		if (count <= BVH_LEAF_MAX) {
+			make_leaf(node, start, count);
+			return;
+		}
+		/* all centroids coincide or splitting never pays off, but the leaf would be too big */
+		mid = start + count / 2;
+		best_axis = 0;
+	} else {
+		float lo = vec3_axis(centroid_bounds.min, best_axis);
+		float scale = BVH_BINS / (vec3_axis(centroid_bounds.max, best_axis) - lo);
+		u32 i = start;
+		u32 j = end;
+		while (i < j) {
+			int b = (int)((vec3_axis(ctx->centroids[ctx->indices[i]], best_axis) - lo) * scale);
+			b = b < BVH_BINS ? b : BVH_BINS - 1;
+			if (b < best_split) {
+				i++;
+			} else {
+				u32 tmp = ctx->indices[i];
+				ctx->indices[i] = ctx->indices[--j];
+				ctx->indices[j] = tmp;
+			}
+		}
+		mid = i;
+	}
+
+	u32 first = atomic_fetch_add_explicit(&ctx->node_count, 2, memory_order_relaxed);
+	node->children[0] = first;
+	node->children[1] = first + 1;
+	node->count = 0;
+	node->axis = (u16)best_axis;
+
+	if (count > BVH_PARALLEL_THRESHOLD) {
+		struct build_task tasks[2] = {
+		    {ctx, first, start, mid, depth + 1},
+		    {ctx, first + 1, mid, end, depth + 1},
+		};
+		jobs_parallel_for(build_task_job, tasks, 2);
+	} else {
+		build_range(ctx, first, start, mid, depth + 1);
+		build_range(ctx, first + 1, mid, end, depth + 1);
+	}
+}
+
+static u32
+flatten(struct bvh* bvh, const struct build_node* build_nodes, u32 build_index, u32 parent, u32* next) {
+	const struct build_node* src = &build_nodes[build_index];
+	u32 index = (*next)++;
+	struct bvh_node* dst = &bvh->nodes[index];
+	bvh->parents[index] = parent;
+	dst->bounds = src->bounds;
+	dst->axis = src->axis;
+	if (src->count > 0) {
+		dst->offset = src->start;
+		dst->count = (u16)src->count;
+		for (u32 i = src->start; i < src->start + src->count; i++) {
+			bvh->object_leaf[bvh->indices[i]] = index;
+		}
+		return index;
+	}
+	dst->count = 0;
+	flatten(bvh, build_nodes, src->children[0], index, next);
+	u32 second = flatten(bvh, build_nodes, src->children[1], index, next);
+	/* dst may not be reused across the recursion, the array is preallocated */
+	bvh->nodes[index].offset = second;
+	return index;
+}
+
+static void
+compute_centroids_job(void* data, isize index) {
+	struct build_ctx* ctx = data;
+	isize begin = index * BVH_PARALLEL_THRESHOLD;
+	isize end = begin + BVH_PARALLEL_THRESHOLD < ctx->count ? begin + BVH_PARALLEL_THRESHOLD : ctx->count;
+	for (isize i = begin; i < end; i++) {
+		ctx->indices[i] = (u32)i;
+		ctx->centroids[i] = aabb_center(ctx->bounds[i]);
+	}
+}
+
+void
+bvh_build(struct bvh* bvh, const struct aabb* bounds, isize count) {
+	assert(count >= 0 && count < UINT32_MAX / 2);
+	memset(bvh, 0, sizeof(*bvh));
+	bvh->object_count = count;
+	if (count == 0) {
+		return;
+	}
+
+	struct build_ctx ctx = {.bounds = bounds, .count = count};
+	ctx.indices = malloc(sizeof(u32) * count);
+	ctx.centroids = malloc(sizeof(struct vec3) * count);
+	ctx.nodes = malloc(sizeof(struct build_node) * (2 * count - 1));
+	jobs_parallel_for(compute_centroids_job, &ctx, (count + BVH_PARALLEL_THRESHOLD - 1) / BVH_PARALLEL_THRESHOLD);
+
+	atomic_init(&ctx.node_count, 1);
+	build_range(&ctx, 0, 0, (u32)count, 0);
+
+	bvh->node_count = atomic_load(&ctx.node_count);
+	bvh->nodes = aligned_alloc(32, ((sizeof(struct bvh_node) * bvh->node_count + 31) / 32) * 32);
+	bvh->parents = malloc(sizeof(u32) * bvh->node_count);
+	bvh->object_leaf = malloc(sizeof(u32) * count);
+	bvh->indices = ctx.indices;
+	bvh->leaf_bounds = malloc(sizeof(struct aabb) * count);
+	for (isize i = 0; i < count; i++) {
+		bvh->leaf_bounds[i] = bounds[bvh->indices[i]];
+	}
+	u32 next = 0;
+	flatten(bvh, ctx.nodes, 0, UINT32_MAX, &next);
+	assert((isize)next == bvh->node_count);
+
+	free(ctx.centroids);
+	free(ctx.nodes);
+	gl_log("bvh: %i objects, %i nodes\n", (int)count, (int)bvh->node_count);
+}
+
+void
+bvh_free(struct bvh* bvh) {
+	free(bvh->nodes);
+	free(bvh->indices);
+	free(bvh->leaf_bounds);
+	free(bvh->parents);
+	free(bvh->object_leaf);
+	memset(bvh, 0, sizeof(*bvh));
+}
+
+isize
+bvh_query_frustum(const struct bvh* bvh, const struct frustum* frustum, u32* out, isize out_cap) {
+	if (bvh->node_count == 0) {
+		return 0;
+	}
+	isize written = 0;
+	/* high bit marks subtrees already known to be fully inside */
+	u32 stack[BVH_STACK_SIZE];
+	isize top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		u32 entry = stack[--top];
+		u32 index = entry & 0x7fffffffu;
+		b32 inside = (entry & 0x80000000u) != 0;
+		const struct bvh_node* node = &bvh->nodes[index];
+		if (!inside) {
+			int result = frustum_test_aabb(frustum, node->bounds);
+			if (result == FRUSTUM_OUTSIDE) {
+				continue;
+			}
+			inside = result == FRUSTUM_INSIDE;
+		}
+		if (node->count > 0) {
+			for (u32 i = 0; i < node->count && written < out_cap; i++) {
+				u32 slot = node->offset + i;
+				if (inside || frustum_test_aabb(frustum, bvh->leaf_bounds[slot]) != FRUSTUM_OUTSIDE) {
+					out[written++] = bvh->indices[slot];
+				}
+			}
+			continue;
+		}
+		u32 flag = inside ? 0x80000000u : 0;
+		/* holds by BVH_MAX_DEPTH */
+		assert(top + 2 <= BVH_STACK_SIZE);
+		stack[top++] = node->offset | flag;
+		stack[top++] = (index + 1) | flag;
+	}
+	return written;
+}
+
+b32
+bvh_raycast(const struct bvh* bvh, struct ray ray, float t_max, bvh_ray_fn fn, void* user, u32* hit_object,
+            float* hit_t) {
+	if (bvh->node_count == 0) {
+		return 0;
+	}
+	struct vec3 inv_dir = {1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z};
+	int dir_neg[3] = {ray.dir.x < 0.0f, ray.dir.y < 0.0f, ray.dir.z < 0.0f};
+	b32 hit = 0;
+	u32 stack[BVH_STACK_SIZE];
+	isize top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		u32 index = stack[--top];
+		const struct bvh_node* node = &bvh->nodes[index];
+		if (ray_aabb(ray.origin, inv_dir, node->bounds, t_max) < 0.0f) {
+			continue;
+		}
+		if (node->count > 0) {
+			for (u32 i = 0; i < node->count; i++) {
+				u32 slot = node->offset + i;
+				u32 id = bvh->indices[slot];
+				float t = ray_aabb(ray.origin, inv_dir, bvh->leaf_bounds[slot], t_max);
+				if (t >= 0.0f && fn) {
+					t = fn(user, id, ray, t_max);
+				}
+				if (t >= 0.0f && t < t_max) {
+					t_max = t;
+					hit = 1;
+					*hit_object = id;
+				}
+			}
+			continue;
+		}
+		/* holds by BVH_MAX_DEPTH */
+		assert(top + 2 <= BVH_STACK_SIZE);
+		/* push the far child first so the near one is popped next */
+		if (dir_neg[node->axis]) {
+			stack[top++] = index + 1;
+			stack[top++] = node->offset;
+		} else {
+			stack[top++] = node->offset;
+			stack[top++] = index + 1;
+		}
+	}
+	if (hit) {
+		*hit_t = t_max;
+	}
+	return hit;
+}
+
+void
+bvh_refit(struct bvh* bvh, const struct aabb* bounds, const u32* moved, isize moved_count) {
+	for (isize m = 0; m < moved_count; m++) {
+		u32 index = bvh->object_leaf[moved[m]];
+		const struct bvh_node* leaf = &bvh->nodes[index];
+		for (u32 i = 0; i < leaf->count; i++) {
+			if (bvh->indices[leaf->offset + i] == moved[m]) {
+				bvh->leaf_bounds[leaf->offset + i] = bounds[moved[m]];
+			}
+		}
+		while (index != UINT32_MAX) {
+			struct bvh_node* node = &bvh->nodes[index];
+			struct aabb updated;
+			if (node->count > 0) {
+				updated = aabb_empty();
+				for (u32 i = 0; i < node->count; i++) {
+					updated = aabb_union(updated, bvh->leaf_bounds[node->offset + i]);
+				}
+			} else {
+				updated = aabb_union(bvh->nodes[index + 1].bounds, bvh->nodes[node->offset].bounds);
+			}
+			/* ancestors were computed from these bounds, if they did not change neither do they */
+			if (aabb_equal(updated, node->bounds)) {
+				break;
+			}
+			node->bounds = updated;
+			index = bvh->parents[index];
+		}
+	}
+}
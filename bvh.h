@@ -0,0 +1,45 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "common.h"
+#include "math3d.h"
+
+/* Bounding volume hierarchy over scene object bounds.
+ * Built top-down with binned SAH (subtrees above a size threshold are built on the job system),
+ * then flattened depth-first: the first child of an interior node is always the next node in the
+ * array, the second child sits at `offset`. Leaves reference a contiguous range of `indices`. */
+
+struct bvh_node {
+	struct aabb bounds;
+	u32 offset; /* leaf: first slot in indices, interior: second child */
+	u16 count;  /* objects in leaf, 0 for interior nodes */
+	u16 axis;   /* split axis, lets ray casts visit the nearer child first */
+};
+
+struct bvh {
+	struct bvh_node* nodes;
+	isize node_count;
+	u32* indices;              /* object ids in leaf order */
+	struct aabb* leaf_bounds; /* object bounds in leaf order, tested after a leaf is reached */
+	isize object_count;
+	u32* parents;     /* parent of each node, UINT32_MAX for the root */
+	u32* object_leaf; /* leaf node holding each object, used by refit */
+};
+
+/* returns hit distance along the ray or a negative value on miss */
+typedef float (*bvh_ray_fn)(void* user, u32 object, struct ray ray, float t_max);
+
+void bvh_build(struct bvh* bvh, const struct aabb* bounds, isize count);
+void bvh_free(struct bvh* bvh);
+
+/* writes ids of objects whose bounds touch the frustum, returns how many were written */
+isize bvh_query_frustum(const struct bvh* bvh, const struct frustum* frustum, u32* out, isize out_cap);
+
+/* nearest hit; with a NULL callback object bounds are treated as the hit geometry */
+b32 bvh_raycast(const struct bvh* bvh, struct ray ray, float t_max, bvh_ray_fn fn, void* user, u32* hit_object,
+                float* hit_t);
+
+/* bounds is the full per-object array, moved lists the objects whose entry changed */
+void bvh_refit(struct bvh* bvh, const struct aabb* bounds, const u32* moved, isize moved_count);
+
+#endif
@@ -0,0 +1,178 @@
+#include <string.h>
+
+#include "gl_loader.h"
+#include <GLFW/glfw3.h>
+
+#include "camera.h"
+#include "gpu_memory.h"
+
+/* std140: a mat4 is four vec4 columns, so the C layout matches without padding */
+struct camera_block {
+	struct mat4 view;
+	struct mat4 projection;
+	struct mat4 view_projection;
+	float position[4];
+	float viewport[4]; /* width, height, 1 / width, 1 / height */
+};
+
+static struct {
+	GLuint ubo;
+	b32 clip_control;
+	int fb_width;
+	int fb_height;
+	b32 resized;
+
+	b32 valid; /* matrices hold a previous camera */
+	struct camera last; /* that the matrices were computed from */
+	struct camera_matrices matrices;
+
+	i64 updates;
+	i64 uploads;
+} cam;
+
+void
+camera_system_init(int fb_width, int fb_height) {
+	memset(&cam, 0, sizeof(cam));
+	cam.fb_width = fb_width;
+	cam.fb_height = fb_height;
+
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	cam.clip_control = (major > 4 || (major == 4 && minor >= 5) || glfwExtensionSupported("GL_ARB_clip_control")) &&
+	                   glClipControl != NULL;
+	if (cam.clip_control) {
+		glClipControl(GL_LOWER_LEFT, GL_ZERO_TO_ONE);
+	} else {
+		gl_log_err("WARNING: camera: no ARB_clip_control, reversed depth keeps half its precision\n");
+	}
+
+	GPU_MEM_OWNER("camera");
+	glGenBuffers(1, &cam.ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, cam.ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(struct camera_block), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_UBO_BINDING, cam.ubo);
+}
+
+void
+camera_system_shutdown(void) {
+	if (cam.ubo) {
+		glDeleteBuffers(1, &cam.ubo);
+		cam.ubo = 0;
+	}
+}
+
+void
+camera_resize(int fb_width, int fb_height) {
+	/* a minimized window reports 0x0, keep the last aspect */
+	if (fb_width > 0 && fb_height > 0) {
+		cam.fb_width = fb_width;
+		cam.fb_height = fb_height;
+		cam.resized = 1;
+	}
+}
+
+static struct mat4
+view_matrix(struct vec3 p, struct vec3 right, struct vec3 up, struct vec3 forward) {
+	return (struct mat4){{
+	    right.x, up.x, -forward.x, 0.0f, /* */
+	    right.y, up.y, -forward.y, 0.0f, /* */
+	    right.z, up.z, -forward.z, 0.0f, /* */
+	    -vec3_dot(right, p), -vec3_dot(up, p), vec3_dot(forward, p), 1.0f,
+	}};
+}
+
+/* infinite far plane: z_ndc = near / -z_view, 1 at the near plane and 0 at infinity */
+static struct mat4
+perspective_reversed(float fov_y, float aspect, float near) {
+	float f = 1.0f / tanf(fov_y * 0.5f);
+	return (struct mat4){{
+	    f / aspect, 0.0f, 0.0f, 0.0f, /* */
+	    0.0f, f, 0.0f, 0.0f,          /* */
+	    0.0f, 0.0f, 0.0f, -1.0f,      /* */
+	    0.0f, 0.0f, near, 0.0f,
+	}};
+}
+
+/* z_ndc = (z_view + far) / (far - near), 1 at the near plane and 0 at the far plane */
+static struct mat4
+orthographic_reversed(float height, float aspect, float near, float far) {
+	float depth = far - near;
+	return (struct mat4){{
+	    2.0f / (height * aspect), 0.0f, 0.0f, 0.0f, /* */
+	    0.0f, 2.0f / height, 0.0f, 0.0f,            /* */
+	    0.0f, 0.0f, 1.0f / depth, 0.0f,             /* */
+	    0.0f, 0.0f, far / depth, 1.0f,
+	}};
+}
+
+static void
+upload(const struct camera* camera) {
+	const struct camera_matrices* m = &cam.matrices;
+	struct camera_block block = {
+	    .view = m->view,
+	    .projection = m->projection,
+	    .view_projection = m->view_projection,
+	    .position = {camera->position.x, camera->position.y, camera->position.z, 1.0f},
+	    .viewport = {(float)cam.fb_width, (float)cam.fb_height, 1.0f / (float)cam.fb_width,
+	                 1.0f / (float)cam.fb_height},
+	};
+	glBindBuffer(GL_UNIFORM_BUFFER, cam.ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+	cam.uploads++;
+}
+
+const struct camera_matrices*
+camera_update(const struct camera* camera) {
+	cam.updates++;
+	if (cam.valid && !cam.resized && memcmp(camera, &cam.last, sizeof(*camera)) == 0) {
+		return &cam.matrices;
+	}
+	cam.valid = 1;
+	cam.resized = 0;
+	cam.last = *camera;
+
+	struct camera_matrices* m = &cam.matrices;
+	float cos_pitch = cosf(camera->pitch);
+	m->forward = vec3_make(sinf(camera->yaw) * cos_pitch, sinf(camera->pitch), -cosf(camera->yaw) * cos_pitch);
+	m->right = vec3_make(cosf(camera->yaw), 0.0f, sinf(camera->yaw));
+	m->up = vec3_cross(m->right, m->forward);
+	m->aspect = (float)cam.fb_width / (float)cam.fb_height;
+
+	m->view = view_matrix(camera->position, m->right, m->up, m->forward);
+	m->projection = camera->projection == CAMERA_PERSPECTIVE
+	                    ? perspective_reversed(camera->fov_y, m->aspect, camera->near)
+	                    : orthographic_reversed(camera->height, m->aspect, camera->near, camera->far);
+	m->view_projection = mat4_mul(m->projection, m->view);
+
+	/* z' = w - 2z takes reversed [0, 1] depth to [-1, 1] with the near plane at -1 */
+	m->cull_view_projection = m->view_projection;
+	for (int c = 0; c < 4; c++) {
+		float* column = &m->cull_view_projection.m[c * 4];
+		column[2] = column[3] - 2.0f * column[2];
+	}
+
+	upload(camera);
+	return m;
+}
+
+struct ray
+camera_ray(const struct camera* camera, float x_ndc, float y_ndc) {
+	const struct camera_matrices* m = &cam.matrices;
+	if (camera->projection == CAMERA_ORTHOGRAPHIC) {
+		float half_height = camera->height * 0.5f;
+		struct vec3 offset = vec3_add(vec3_scale(m->right, x_ndc * half_height * m->aspect),
+		                              vec3_scale(m->up, y_ndc * half_height));
+		return (struct ray){.origin = vec3_add(camera->position, offset), .dir = m->forward};
+	}
+	float tan_half = tanf(camera->fov_y * 0.5f);
+	struct vec3 dir = vec3_add(m->forward, vec3_add(vec3_scale(m->right, x_ndc * tan_half * m->aspect),
+	                                                vec3_scale(m->up, y_ndc * tan_half)));
+	return (struct ray){.origin = camera->position, .dir = vec3_normalize(dir)};
+}
+
+void
+camera_log(void) {
+	gl_log("camera: %li uploads in %li frames, clip control %s\n", (long)cam.uploads, (long)cam.updates,
+	       cam.clip_control ? "on" : "off");
+}
@@ -0,0 +1,8 @@
+// the camera uniform block, camera.c uploads it once per frame when it changed
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 camera_position;
+    vec4 viewport; // width, height, 1 / width, 1 / height
+};
@@ -0,0 +1,65 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "common.h"
+#include "math3d.h"
+
+/* Camera and projection.
+ * Depth is reversed: the near plane maps to 1 and the far plane (at infinity for perspective) to 0,
+ * tested with GL_GREATER against a depth cleared to 0. Float depth is densest near 0, which is where
+ * the 1/z distribution of perspective depth is sparsest, so the two roughly cancel out. With
+ * ARB_clip_control (core in GL 4.5) clip space depth is [0, 1] and nothing is lost in the
+ * [-1, 1] -> [0, 1] remap; without it the same matrices still work at half the precision.
+ *
+ * camera_update() computes the matrices once per frame and uploads them to the uniform buffer every
+ * program reads through the std140 "Camera" block at CAMERA_UBO_BINDING, but only when the camera or
+ * the framebuffer size changed since the last upload. */
+
+#define CAMERA_UBO_BINDING 0
+#define CAMERA_UBO_NAME "Camera"
+/* for the pipelines (pipeline.h) and clears of anything drawn with the camera */
+#define CAMERA_DEPTH_FUNC GL_GREATER
+#define CAMERA_CLEAR_DEPTH 0.0f
+
+enum camera_projection {
+	CAMERA_PERSPECTIVE,
+	CAMERA_ORTHOGRAPHIC,
+};
+
+struct camera {
+	enum camera_projection projection;
+	struct vec3 position;
+	float yaw;    /* radians about +y, 0 looks down -z */
+	float pitch;  /* radians, positive looks up */
+	float fov_y;  /* perspective, radians */
+	float height; /* orthographic, world units from the bottom to the top of the viewport */
+	float near;
+	float far; /* orthographic only, perspective projects to infinity */
+};
+
+struct camera_matrices {
+	struct mat4 view;
+	struct mat4 projection;
+	struct mat4 view_projection;
+	/* view_projection with the depth of the GL_LESS convention, -1 near and 1 far, for
+	 * frustum_from_mat4() and the occlusion buffer */
+	struct mat4 cull_view_projection;
+	struct vec3 forward;
+	struct vec3 right;
+	struct vec3 up;
+	float aspect;
+};
+
+/* the GL context must be current; sets up the clip space depth range and creates the uniform buffer */
+void camera_system_init(int fb_width, int fb_height);
+void camera_system_shutdown(void);
+/* from the framebuffer resize callback, no GL calls */
+void camera_resize(int fb_width, int fb_height);
+
+/* once per frame, before anything draws with the camera */
+const struct camera_matrices* camera_update(const struct camera* camera);
+/* through normalized device coordinates x, y in [-1, 1] of the last camera_update() */
+struct ray camera_ray(const struct camera* camera, float x_ndc, float y_ndc);
+void camera_log(void);
+
+#endif
@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capture.h"
+#include "cpu_trace.h"
+#include "gpu_memory.h"
+#include "image.h"
+#include "readback.h"
+
+#define CAPTURE_QUEUE_SIZE 16
+
+struct capture_item {
+	char* path;
+	u8* pixels; /* top row first */
+	int width;
+	int height;
+};
+
+static struct {
+	struct readback readback;
+	char* requested_path;
+
+	pthread_t thread;
+	b32 thread_started; /* without the worker, captures are encoded on the GL thread */
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct capture_item queue[CAPTURE_QUEUE_SIZE];
+	isize head;
+	isize len;
+	b32 quit;
+} capture = {.mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static void
+encode(struct capture_item item) {
+	TRACE_ZONE("capture encode");
+	if (image_write(item.path, item.pixels, item.width, item.height)) {
+		gl_log("captured %ix%i frame to %s\n", item.width, item.height, item.path);
+	}
+	free(item.path);
+	free(item.pixels);
+}
+
+static void*
+capture_worker(void* arg) {
+	(void)arg;
+	TRACE_THREAD_NAME("capture encoder");
+	pthread_mutex_lock(&capture.mutex);
+	for (;;) {
+		while (!capture.quit && capture.len == 0) {
+			pthread_cond_wait(&capture.cond, &capture.mutex);
+		}
+		if (capture.len == 0) {
+			break;
+		}
+		struct capture_item item = capture.queue[capture.head];
+		capture.head = (capture.head + 1) % CAPTURE_QUEUE_SIZE;
+		capture.len--;
+		pthread_cond_broadcast(&capture.cond);
+		pthread_mutex_unlock(&capture.mutex);
+		encode(item);
+		pthread_mutex_lock(&capture.mutex);
+	}
+	pthread_mutex_unlock(&capture.mutex);
+	return NULL;
+}
+
+void
+capture_init(void) {
+	GPU_MEM_OWNER("capture");
+	readback_init(&capture.readback);
+	capture.quit = 0;
+	if (pthread_create(&capture.thread, NULL, capture_worker, NULL) != 0) {
+		gl_log_err("WARNING: could not start capture worker, encoding on the GL thread\n");
+	} else {
+		capture.thread_started = 1;
+	}
+}
+
+/* runs on the GL thread while the pack buffer is mapped: copy out, flip, queue */
+static void
+capture_deliver(void* user, void* tag, const u8* rgba, int width, int height) {
+	(void)user;
+	if (!rgba) {
+		gl_log_err("ERROR: capture readback failed, %s not written\n", (const char*)tag);
+		free(tag);
+		return;
+	}
+	isize stride = (isize)width * 4;
+	u8* pixels = malloc(stride * height);
+	for (int y = 0; y < height; y++) {
+		memcpy(pixels + y * stride, rgba + (isize)(height - 1 - y) * stride, stride);
+	}
+	struct capture_item item = {.path = tag, .pixels = pixels, .width = width, .height = height};
+	if (!capture.thread_started) {
+		encode(item);
+		return;
+	}
+	pthread_mutex_lock(&capture.mutex);
+	/* the worker drains quickly; only a burst of captures can fill the queue */
+	while (capture.len == CAPTURE_QUEUE_SIZE) {
+		pthread_cond_wait(&capture.cond, &capture.mutex);
+	}
+	capture.queue[(capture.head + capture.len) % CAPTURE_QUEUE_SIZE] = item;
+	capture.len++;
+	pthread_cond_broadcast(&capture.cond);
+	pthread_mutex_unlock(&capture.mutex);
+}
+
+void
+capture_shutdown(void) {
+	readback_poll(&capture.readback, capture_deliver, NULL, 1);
+	readback_shutdown(&capture.readback);
+	free(capture.requested_path);
+	capture.requested_path = NULL;
+
+	if (!capture.thread_started) {
+		return;
+	}
+	pthread_mutex_lock(&capture.mutex);
+	capture.quit = 1;
+	pthread_cond_broadcast(&capture.cond);
+	pthread_mutex_unlock(&capture.mutex);
+	pthread_join(capture.thread, NULL);
+	capture.thread_started = 0;
+}
+
+void
+capture_request(const char* path) {
+	free(capture.requested_path);
+	capture.requested_path = strdup(path);
+}
+
+void
+capture_end_frame(int fb_width, int fb_height) {
+	TRACE_ZONE("capture_end_frame");
+	if (capture.requested_path) {
+		if (readback_request(&capture.readback, 0, 0, fb_width, fb_height, capture.requested_path)) {
+			capture.requested_path = NULL;
+		} else {
+			gl_log_err("WARNING: capture readback ring full, retrying next frame\n");
+		}
+	}
+	readback_poll(&capture.readback, capture_deliver, NULL, 0);
+}
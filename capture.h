@@ -0,0 +1,19 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "common.h"
+
+/* Screenshots without pipeline stalls: the back buffer is read through the readback ring and the
+ * pixels are flipped and encoded (PNG, or PPM for a .ppm path) on a dedicated worker thread, or on
+ * the GL thread when the worker could not be started. */
+
+void capture_init(void);
+/* finishes outstanding readbacks and encodes, so nothing requested is lost */
+void capture_shutdown(void);
+
+/* capture the frame rendered before the next capture_end_frame(); path is copied */
+void capture_request(const char* path);
+/* call after the frame is drawn and before the buffer swap */
+void capture_end_frame(int fb_width, int fb_height);
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef COMMON_H
+#define COMMON_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int32_t b32;
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t i32;
+typedef int64_t i64;
+typedef ptrdiff_t isize;
+// typedef size_t usize;
+
+#define ARRAY_SIZE(arr) (isize)(sizeof(arr) / sizeof((arr)[0]))
+
+/* gl.log helpers, defined in log.c */
+b32 restart_gl_log(void);
+b32 gl_log(const char* message, ...);
+b32 gl_log_err(const char* message, ...);
+/* CLOCK_MONOTONIC in nanoseconds, also in log.c */
+u64 clock_ns(void);
+
+#endif
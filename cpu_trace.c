@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define TRACE_USE_RDTSC 1
+#endif
+
+#include "cpu_trace.h"
+
+#define TRACE_BUFFER_EVENTS (1 << 16)
+
+struct trace_event {
+	const char* name;
+	u64 begin;
+	u64 end;
+};
+
+struct trace_buffer {
+	struct trace_buffer* next;
+	const char* thread_name;
+	u32 thread_id;
+	atomic_size_t head; /* total events written, the ring keeps the last TRACE_BUFFER_EVENTS */
+	struct trace_event events[TRACE_BUFFER_EVENTS];
+};
+
+static struct {
+	_Atomic(struct trace_buffer*) buffers;
+	atomic_uint next_thread_id;
+	u64 start_ticks;
+	u64 start_ns;
+} trace;
+
+static _Thread_local struct trace_buffer* trace_local;
+
+static inline u64
+ticks(void) {
+#ifdef TRACE_USE_RDTSC
+	return __rdtsc();
+#else
+	return clock_ns();
+#endif
+}
+
+void
+trace_init(void) {
+	trace.start_ticks = ticks();
+	trace.start_ns = clock_ns();
+}
+
+void
+trace_shutdown(void) {
+	struct trace_buffer* buffer = atomic_exchange(&trace.buffers, NULL);
+	while (buffer) {
+		struct trace_buffer* next = buffer->next;
+		free(buffer);
+		buffer = next;
+	}
+	trace_local = NULL;
+}
+
+static struct trace_buffer*
+local_buffer(void) {
+	if (trace_local) {
+		return trace_local;
+	}
+	struct trace_buffer* buffer = calloc(1, sizeof(*buffer));
+	if (!buffer) {
+		return NULL;
+	}
+	buffer->thread_id = atomic_fetch_add(&trace.next_thread_id, 1) + 1;
+	/* push onto the global list; buffers are only removed by trace_shutdown(), so a plain CAS loop
+	 * is ABA-safe */
+	struct trace_buffer* head = atomic_load_explicit(&trace.buffers, memory_order_relaxed);
+	do {
+		buffer->next = head;
+	} while (!atomic_compare_exchange_weak_explicit(&trace.buffers, &head, buffer, memory_order_release,
+	                                                memory_order_relaxed));
+	trace_local = buffer;
+	return buffer;
+}
+
+void
+trace_thread_name(const char* name) {
+	struct trace_buffer* buffer = local_buffer();
+	if (buffer) {
+		buffer->thread_name = name;
+	}
+}
+
+struct trace_zone
+trace_zone_begin(const char* name) {
+	return (struct trace_zone){name, ticks()};
+}
+
+void
+trace_zone_end(struct trace_zone* zone) {
+	u64 end = ticks();
+	struct trace_buffer* buffer = local_buffer();
+	if (!buffer) {
+		return;
+	}
+	size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+	buffer->events[head % TRACE_BUFFER_EVENTS] = (struct trace_event){zone->name, zone->begin, end};
+	atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+b32
+trace_export(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		gl_log_err("ERROR: could not open trace file %s for writing\n", path);
+		return 0;
+	}
+	/* calibrate ticks against the monotonic clock over the whole capture */
+	u64 end_ticks = ticks();
+	u64 end_ns = clock_ns();
+	double ns_per_tick = 1.0;
+	if (end_ticks > trace.start_ticks) {
+		ns_per_tick = (double)(end_ns - trace.start_ns) / (double)(end_ticks - trace.start_ticks);
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	b32 first = 1;
+	isize total = 0;
+	for (struct trace_buffer* buffer = atomic_load_explicit(&trace.buffers, memory_order_acquire); buffer;
+	     buffer = buffer->next) {
+		if (buffer->thread_name) {
+			fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+			        first ? "" : ",\n", buffer->thread_id, buffer->thread_name);
+			first = 0;
+		}
+		size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+		size_t begin = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+		for (size_t i = begin; i < head; i++) {
+			struct trace_event* e = &buffer->events[i % TRACE_BUFFER_EVENTS];
+			double ts_us = (double)(i64)(e->begin - trace.start_ticks) * ns_per_tick / 1000.0;
+			double dur_us = (double)(e->end - e->begin) * ns_per_tick / 1000.0;
+			fprintf(file, "%s{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+			        first ? "" : ",\n", e->name, buffer->thread_id, ts_us, dur_us);
+			first = 0;
+			total++;
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+	gl_log("cpu trace: wrote %i events to %s\n", (int)total, path);
+	return 1;
+}
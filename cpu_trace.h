@@ -0,0 +1,44 @@
+#ifndef CPU_TRACE_H
+#define CPU_TRACE_H
+
+#include "common.h"
+
+/* Scoped CPU zones exported as Chrome trace JSON (about:tracing, ui.perfetto.dev).
+ * Build with `make TRACE=1` to compile the zone macros in; otherwise they expand to nothing.
+ * Each thread appends completed zones to its own ring buffer, registered once in a lock-free
+ * list, so recording takes no locks. Timestamps come from rdtsc on x86-64 (calibrated against
+ * CLOCK_MONOTONIC) and from clock_gettime elsewhere. */
+
+struct trace_zone {
+	const char* name;
+	u64 begin;
+};
+
+void trace_init(void);
+/* frees every thread's ring; the threads that recorded must have exited, except the caller */
+void trace_shutdown(void);
+/* name must be a string literal or otherwise outlive the trace */
+void trace_thread_name(const char* name);
+struct trace_zone trace_zone_begin(const char* name);
+void trace_zone_end(struct trace_zone* zone);
+/* call when other threads are idle, e.g. at shutdown: rings are read without synchronisation */
+b32 trace_export(const char* path);
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+
+#ifdef ENABLE_TRACE
+#define TRACE_ZONE(name)                                                                          \
+	struct trace_zone TRACE_CONCAT(trace_zone_, __LINE__) __attribute__((cleanup(trace_zone_end))) = \
+	    trace_zone_begin(name)
+#define TRACE_THREAD_NAME(name) trace_thread_name(name)
+#else
+#define TRACE_ZONE(name) \
+	do {                 \
+	} while (0)
+#define TRACE_THREAD_NAME(name) \
+	do {                        \
+	} while (0)
+#endif
+
+#endif
@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "gl_loader.h"
+#include <GLFW/glfw3.h>
+
+#include "frame_pacing.h"
+#include "gpu_memory.h"
+
+#define SPIN_MIN_NS 500000ll  /* sleeps return at least this long before the deadline */
+#define SPIN_MAX_NS 4000000ll /* and at most this long */
+#define FENCE_TIMEOUT_NS 100000000ull
+
+static struct {
+	struct frame_pacing_config config;
+	i64 period_ns; /* of max_fps, 0 without a limiter */
+	i64 deadline_ns;
+	i64 spin_ns;
+	GLsync fence; /* after the last swap, low-latency mode only */
+
+	i64 last_present_ns;
+	double intervals_ms[FRAME_PACING_HISTORY];
+	isize intervals_len;
+	isize intervals_head;
+	double wait_ms[FRAME_PACING_HISTORY]; /* per frame, indexed like intervals_ms */
+	i64 frame_start_ns;
+	double frame_wait_ms;
+
+	i64 frames;
+	i64 late_wakeups; /* sleeps that overshot the deadline */
+	i64 missed_deadlines;
+} pacing;
+
+static void
+sleep_until(i64 ns) {
+	struct timespec ts = {.tv_sec = ns / 1000000000ll, .tv_nsec = ns % 1000000000ll};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+		/* interrupted by a signal, sleep the rest */
+	}
+}
+
+const char*
+vsync_mode_name(enum vsync_mode mode) {
+	switch (mode) {
+		case VSYNC_OFF:
+			return "off";
+		case VSYNC_ON:
+			return "on";
+		case VSYNC_ADAPTIVE:
+			return "adaptive";
+	}
+	return "?";
+}
+
+void
+frame_pacing_init(struct frame_pacing_config config) {
+	memset(&pacing, 0, sizeof(pacing));
+	if (config.vsync == VSYNC_ADAPTIVE && !glfwExtensionSupported("GLX_EXT_swap_control_tear") &&
+	    !glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+		gl_log_err("WARNING: adaptive vsync needs EXT_swap_control_tear, using vsync on\n");
+		config.vsync = VSYNC_ON;
+	}
+	pacing.config = config;
+	glfwSwapInterval(config.vsync == VSYNC_ADAPTIVE ? -1 : config.vsync == VSYNC_ON ? 1 : 0);
+	pacing.period_ns = config.max_fps > 0.0 ? (i64)(1e9 / config.max_fps) : 0;
+	pacing.spin_ns = SPIN_MIN_NS * 2;
+	gl_log("frame pacing: vsync %s, limit %.1f fps (0: none), low latency %s\n", vsync_mode_name(config.vsync),
+	       config.max_fps, config.low_latency ? "on" : "off");
+}
+
+void
+frame_pacing_shutdown(void) {
+	if (pacing.fence) {
+		glDeleteSync(pacing.fence);
+		pacing.fence = 0;
+	}
+}
+
+static void
+limit(void) {
+	i64 now = (i64)clock_ns();
+	pacing.deadline_ns += pacing.period_ns;
+	if (pacing.deadline_ns < now) {
+		/* a whole period late (or the first frame): start the cadence over instead of rushing to catch up */
+		if (pacing.deadline_ns + pacing.period_ns < now) {
+			pacing.missed_deadlines += pacing.frames > 0;
+		}
+		pacing.deadline_ns = now;
+		return;
+	}
+	if (pacing.deadline_ns - now > pacing.spin_ns) {
+		sleep_until(pacing.deadline_ns - pacing.spin_ns);
+		i64 overshoot = (i64)clock_ns() - pacing.deadline_ns;
+		if (overshoot > 0) {
+			pacing.late_wakeups++;
+			pacing.spin_ns += overshoot + SPIN_MIN_NS;
+		} else {
+			/* creep back towards sleeping more once wakeups have been on time for a while */
+			pacing.spin_ns -= pacing.spin_ns / 64;
+		}
+		pacing.spin_ns = pacing.spin_ns < SPIN_MIN_NS ? SPIN_MIN_NS : pacing.spin_ns;
+		pacing.spin_ns = pacing.spin_ns > SPIN_MAX_NS ? SPIN_MAX_NS : pacing.spin_ns;
+	}
+	while ((i64)clock_ns() < pacing.deadline_ns) {
+	}
+}
+
+void
+frame_pacing_begin_frame(void) {
+	i64 start = (i64)clock_ns();
+	if (pacing.period_ns) {
+		limit();
+	}
+	if (pacing.fence) {
+		/* the GPU has finished the previous frame once this returns */
+		glClientWaitSync(pacing.fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+		glDeleteSync(pacing.fence);
+		pacing.fence = 0;
+	}
+	pacing.frame_start_ns = (i64)clock_ns();
+	pacing.frame_wait_ms = (double)(pacing.frame_start_ns - start) * 1e-6;
+}
+
+void
+frame_pacing_end_frame(void) {
+	i64 now = (i64)clock_ns();
+	if (pacing.last_present_ns) {
+		pacing.intervals_ms[pacing.intervals_head] = (double)(now - pacing.last_present_ns) * 1e-6;
+		pacing.wait_ms[pacing.intervals_head] = pacing.frame_wait_ms;
+		pacing.intervals_head = (pacing.intervals_head + 1) % FRAME_PACING_HISTORY;
+		if (pacing.intervals_len < FRAME_PACING_HISTORY) {
+			pacing.intervals_len++;
+		}
+	}
+	pacing.last_present_ns = now;
+	pacing.frames++;
+
+	if (pacing.config.low_latency) {
+		GPU_MEM_OWNER("frame pacing");
+		pacing.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
+
+void
+frame_pacing_summarize(struct frame_pacing_summary* summary) {
+	*summary = (struct frame_pacing_summary){.intervals = pacing.intervals_len};
+	if (!pacing.intervals_len) {
+		return;
+	}
+	double sum = 0.0;
+	double wait = 0.0;
+	summary->min_ms = pacing.intervals_ms[0];
+	for (isize i = 0; i < pacing.intervals_len; i++) {
+		double ms = pacing.intervals_ms[i];
+		sum += ms;
+		wait += pacing.wait_ms[i];
+		summary->min_ms = ms < summary->min_ms ? ms : summary->min_ms;
+		summary->max_ms = ms > summary->max_ms ? ms : summary->max_ms;
+	}
+	summary->mean_ms = sum / (double)pacing.intervals_len;
+	summary->wait_ms = wait / (double)pacing.intervals_len;
+	double variance = 0.0;
+	for (isize i = 0; i < pacing.intervals_len; i++) {
+		double d = pacing.intervals_ms[i] - summary->mean_ms;
+		variance += d * d;
+	}
+	summary->stddev_ms = sqrt(variance / (double)pacing.intervals_len);
+}
+
+void
+frame_pacing_log(void) {
+	struct frame_pacing_summary summary;
+	frame_pacing_summarize(&summary);
+	gl_log("frame pacing: last %li presents %.3f ms mean, %.3f ms jitter (stddev), %.3f..%.3f ms, %.3f ms waited\n",
+	       (long)summary.intervals, summary.mean_ms, summary.stddev_ms, summary.min_ms, summary.max_ms,
+	       summary.wait_ms);
+	if (pacing.period_ns) {
+		gl_log("frame pacing: limiter %li late wakeups, %li missed deadlines, spin margin %.2f ms\n",
+		       (long)pacing.late_wakeups, (long)pacing.missed_deadlines, (double)pacing.spin_ns * 1e-6);
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+#include "common.h"
+
+/* Frame pacing: swap interval, frame limiter and present timing.
+ * The swap interval is always set explicitly instead of being left to the driver. With max_fps set,
+ * frame_pacing_begin_frame() holds each frame until its deadline: it sleeps until shortly before it
+ * and spins the rest, and the spin margin grows whenever a sleep overshoots. In low-latency mode a
+ * fence is inserted after every swap and waited on before the next frame samples input, so the CPU
+ * never queues a frame behind the GPU and input is read as late as possible.
+ *
+ * Present-to-present intervals are timed after each swap; their spread is the jitter
+ * frame_pacing_summarize() and the log report. */
+
+#define FRAME_PACING_HISTORY 240
+
+enum vsync_mode {
+	VSYNC_OFF,
+	VSYNC_ON,
+	VSYNC_ADAPTIVE, /* tears instead of waiting a whole interval when a frame is late */
+};
+
+struct frame_pacing_config {
+	enum vsync_mode vsync;
+	double max_fps; /* 0 leaves the rate to vsync */
+	b32 low_latency;
+};
+
+struct frame_pacing_summary {
+	isize intervals; /* in the window, at most FRAME_PACING_HISTORY */
+	double mean_ms;
+	double stddev_ms; /* the jitter */
+	double min_ms;
+	double max_ms;
+	double wait_ms; /* mean spent in frame_pacing_begin_frame(), limiter and fence */
+};
+
+/* the GL context must be current; adaptive vsync falls back to on without the tear extension */
+void frame_pacing_init(struct frame_pacing_config config);
+void frame_pacing_shutdown(void);
+
+/* at the top of the frame, before input is sampled */
+void frame_pacing_begin_frame(void);
+/* right after the buffer swap */
+void frame_pacing_end_frame(void);
+
+void frame_pacing_summarize(struct frame_pacing_summary* summary);
+const char* vsync_mode_name(enum vsync_mode mode);
+void frame_pacing_log(void);
+
+#endif
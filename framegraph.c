@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "framegraph.h"
+#include "gpu_profiler.h"
+
+void
+fg_reset(struct framegraph* fg) {
+	memset(fg, 0, sizeof(*fg));
+}
+
+static i32
+add_resource(struct framegraph* fg, const char* name) {
+	if (fg->resources_len == FG_MAX_RESOURCES) {
+		gl_log_err("ERROR: frame graph resource limit reached at %s\n", name);
+		return -1;
+	}
+	struct fg_resource* resource = &fg->resources[fg->resources_len];
+	memset(resource, 0, sizeof(*resource));
+	resource->name = name;
+	resource->target = -1;
+	resource->first_use = resource->last_use = -1;
+	return fg->resources_len++;
+}
+
+i32
+fg_create_texture(struct framegraph* fg, const char* name, struct rt_desc desc) {
+	i32 index = add_resource(fg, name);
+	if (index >= 0) {
+		fg->resources[index].desc = desc;
+	}
+	return index;
+}
+
+i32
+fg_import_backbuffer(struct framegraph* fg, const char* name) {
+	return fg_import_texture(fg, name, 0);
+}
+
+i32
+fg_import_texture(struct framegraph* fg, const char* name, GLuint texture) {
+	i32 index = add_resource(fg, name);
+	if (index >= 0) {
+		fg->resources[index].imported = 1;
+		fg->resources[index].texture = texture;
+	}
+	return index;
+}
+
+i32
+fg_add_pass(struct framegraph* fg, const char* name, fg_pass_fn fn, void* user, b32 side_effect) {
+	if (fg->passes_len == FG_MAX_PASSES) {
+		gl_log_err("ERROR: frame graph pass limit reached at %s\n", name);
+		return -1;
+	}
+	struct fg_pass* pass = &fg->passes[fg->passes_len];
+	memset(pass, 0, sizeof(*pass));
+	pass->name = name;
+	pass->fn = fn;
+	pass->user = user;
+	pass->side_effect = side_effect;
+	return fg->passes_len++;
+}
+
+static void
+add_access(struct framegraph* fg, i32 pass, i32 resource, u32 usage, b32 write) {
+	if (pass < 0 || resource < 0) {
+		return;
+	}
+	struct fg_pass* p = &fg->passes[pass];
+	if (p->accesses_len == FG_MAX_ACCESSES) {
+		gl_log_err("ERROR: frame graph pass %s declares too many resources\n", p->name);
+		return;
+	}
+	p->accesses[p->accesses_len++] = (struct fg_access){resource, usage, write};
+}
+
+void
+fg_read(struct framegraph* fg, i32 pass, i32 resource, u32 usage) {
+	add_access(fg, pass, resource, usage, 0);
+}
+
+void
+fg_write(struct framegraph* fg, i32 pass, i32 resource, u32 usage) {
+	add_access(fg, pass, resource, usage, 1);
+}
+
+static b32
+pass_writes(const struct fg_pass* pass, i32 resource) {
+	for (int i = 0; i < pass->accesses_len; i++) {
+		if (pass->accesses[i].resource == resource && pass->accesses[i].write) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* a and b touch a common resource and at least one of them writes it */
+static b32
+passes_conflict(const struct fg_pass* a, const struct fg_pass* b) {
+	for (int i = 0; i < a->accesses_len; i++) {
+		for (int j = 0; j < b->accesses_len; j++) {
+			if (a->accesses[i].resource == b->accesses[j].resource && (a->accesses[i].write || b->accesses[j].write)) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+/* attachments written by the pass in declaration order, returns the count */
+static int
+pass_attachments(const struct fg_pass* pass, i32* attachments) {
+	int count = 0;
+	for (int i = 0; i < pass->accesses_len; i++) {
+		if (pass->accesses[i].write && (pass->accesses[i].usage & FG_ATTACHMENT)) {
+			attachments[count++] = pass->accesses[i].resource;
+		}
+	}
+	return count;
+}
+
+static b32
+same_attachments(const struct fg_pass* a, const struct fg_pass* b) {
+	i32 a_attachments[FG_MAX_ACCESSES], b_attachments[FG_MAX_ACCESSES];
+	int a_len = pass_attachments(a, a_attachments);
+	int b_len = pass_attachments(b, b_attachments);
+	return a_len > 0 && a_len == b_len && memcmp(a_attachments, b_attachments, a_len * sizeof(i32)) == 0;
+}
+
+static void
+cull_passes(struct framegraph* fg) {
+	for (int p = 0; p < fg->passes_len; p++) {
+		struct fg_pass* pass = &fg->passes[p];
+		pass->culled = !pass->side_effect;
+		for (int i = 0; i < pass->accesses_len; i++) {
+			if (pass->accesses[i].write && fg->resources[pass->accesses[i].resource].imported) {
+				pass->culled = 0;
+			}
+		}
+	}
+	/* a live pass keeps alive every earlier pass writing something it reads */
+	b32 changed = 1;
+	while (changed) {
+		changed = 0;
+		for (int p = 0; p < fg->passes_len; p++) {
+			struct fg_pass* pass = &fg->passes[p];
+			for (int i = 0; !pass->culled && i < pass->accesses_len; i++) {
+				if (pass->accesses[i].write) {
+					continue;
+				}
+				for (int q = 0; q < p; q++) {
+					if (fg->passes[q].culled && pass_writes(&fg->passes[q], pass->accesses[i].resource)) {
+						fg->passes[q].culled = 0;
+						changed = 1;
+					}
+				}
+			}
+		}
+	}
+}
+
+/* Kahn's algorithm over the conflicts, declaration order breaks ties except that a ready pass on
+ * the attachments just bound goes first */
+static void
+order_passes(struct framegraph* fg) {
+	int in_degree[FG_MAX_PASSES] = {0};
+	for (int b = 0; b < fg->passes_len; b++) {
+		for (int a = 0; a < b; a++) {
+			if (!fg->passes[a].culled && !fg->passes[b].culled && passes_conflict(&fg->passes[a], &fg->passes[b])) {
+				in_degree[b]++;
+			}
+		}
+	}
+	b32 done[FG_MAX_PASSES] = {0};
+	fg->order_len = 0;
+	for (;;) {
+		int pick = -1;
+		for (int p = 0; p < fg->passes_len; p++) {
+			if (fg->passes[p].culled || done[p] || in_degree[p] > 0) {
+				continue;
+			}
+			if (pick < 0) {
+				pick = p;
+			}
+			if (fg->order_len > 0 && same_attachments(&fg->passes[fg->order[fg->order_len - 1]], &fg->passes[p])) {
+				pick = p;
+				break;
+			}
+		}
+		if (pick < 0) {
+			break;
+		}
+		done[pick] = 1;
+		fg->order[fg->order_len++] = pick;
+		for (int b = pick + 1; b < fg->passes_len; b++) {
+			if (!fg->passes[b].culled && passes_conflict(&fg->passes[pick], &fg->passes[b])) {
+				in_degree[b]--;
+			}
+		}
+	}
+}
+
+b32
+fg_compile(struct framegraph* fg) {
+	cull_passes(fg);
+	order_passes(fg);
+
+	b32 ok = 1;
+	b32 image_written[FG_MAX_RESOURCES] = {0}; /* written by image stores, no barrier since */
+	i32 previous[FG_MAX_ACCESSES];
+	int previous_len = 0;
+	fg->framebuffer_switches = 0;
+	fg->barrier_count = 0;
+	for (int i = 0; i < fg->order_len; i++) {
+		struct fg_pass* pass = &fg->passes[fg->order[i]];
+		pass->barriers = 0;
+		for (int a = 0; a < pass->accesses_len; a++) {
+			struct fg_access* access = &pass->accesses[a];
+			struct fg_resource* resource = &fg->resources[access->resource];
+			resource->first_use = resource->first_use < 0 ? i : resource->first_use;
+			resource->last_use = i;
+			if (image_written[access->resource]) {
+				pass->barriers |= (access->usage & FG_SAMPLED) ? GL_TEXTURE_FETCH_BARRIER_BIT : 0;
+				pass->barriers |= (access->usage & FG_IMAGE) ? GL_SHADER_IMAGE_ACCESS_BARRIER_BIT : 0;
+				pass->barriers |= (access->usage & FG_ATTACHMENT) ? GL_FRAMEBUFFER_BARRIER_BIT : 0;
+				image_written[access->resource] = 0;
+			}
+		}
+		for (int a = 0; a < pass->accesses_len; a++) {
+			if (pass->accesses[a].write && (pass->accesses[a].usage & FG_IMAGE)) {
+				image_written[pass->accesses[a].resource] = 1;
+			}
+		}
+		fg->barrier_count += pass->barriers != 0;
+
+		i32 attachments[FG_MAX_ACCESSES];
+		int attachments_len = pass_attachments(pass, attachments);
+		b32 backbuffer = 0, offscreen = 0;
+		for (int a = 0; a < attachments_len; a++) {
+			const struct fg_resource* resource = &fg->resources[attachments[a]];
+			if (resource->imported && resource->texture) {
+				gl_log_err("ERROR: frame graph pass %s renders to imported texture %s\n", pass->name, resource->name);
+				ok = 0;
+			}
+			backbuffer |= resource->imported;
+			offscreen |= !resource->imported;
+		}
+		if (backbuffer && offscreen) {
+			gl_log_err("ERROR: frame graph pass %s mixes the backbuffer with offscreen attachments\n", pass->name);
+			ok = 0;
+		}
+		if (attachments_len > 0 && (attachments_len != previous_len ||
+		                            memcmp(attachments, previous, attachments_len * sizeof(i32)) != 0)) {
+			fg->framebuffer_switches++;
+			memcpy(previous, attachments, attachments_len * sizeof(i32));
+			previous_len = attachments_len;
+		}
+	}
+	return ok;
+}
+
+void
+fg_execute(struct framegraph* fg, int fb_width, int fb_height) {
+	i32 bound[FG_MAX_ACCESSES];
+	int bound_len = 0;
+	for (int i = 0; i < fg->order_len; i++) {
+		struct fg_pass* pass = &fg->passes[fg->order[i]];
+		for (int r = 0; r < fg->resources_len; r++) {
+			struct fg_resource* resource = &fg->resources[r];
+			if (!resource->imported && resource->first_use == i) {
+				resource->target = rt_acquire(resource->desc);
+				resource->texture = rt_texture(resource->target);
+			}
+		}
+		if (pass->barriers && glMemoryBarrier) {
+			glMemoryBarrier(pass->barriers);
+		}
+
+		i32 attachments[FG_MAX_ACCESSES];
+		int attachments_len = pass_attachments(pass, attachments);
+		if (attachments_len > 0 &&
+		    (attachments_len != bound_len || memcmp(attachments, bound, attachments_len * sizeof(i32)) != 0)) {
+			i32 colors[RT_MAX_COLOR_ATTACHMENTS];
+			int colors_len = 0;
+			i32 depth = -1;
+			b32 backbuffer = 0;
+			for (int a = 0; a < attachments_len; a++) {
+				struct fg_resource* resource = &fg->resources[attachments[a]];
+				if (resource->imported) {
+					backbuffer = 1;
+				} else if (rt_is_depth_format(resource->desc.format)) {
+					depth = resource->target;
+				} else if (colors_len < RT_MAX_COLOR_ATTACHMENTS) {
+					colors[colors_len++] = resource->target;
+				}
+			}
+			if (backbuffer) {
+				glBindFramebuffer(GL_FRAMEBUFFER, 0);
+				glViewport(0, 0, fb_width, fb_height);
+			} else {
+				rt_bind(colors, colors_len, depth);
+			}
+			memcpy(bound, attachments, attachments_len * sizeof(i32));
+			bound_len = attachments_len;
+		}
+
+		gpu_zone_begin(pass->name);
+		pass->fn(fg, pass->user);
+		gpu_zone_end();
+
+		for (int r = 0; r < fg->resources_len; r++) {
+			struct fg_resource* resource = &fg->resources[r];
+			if (!resource->imported && resource->last_use == i) {
+				rt_release(resource->target);
+			}
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, fb_width, fb_height);
+}
+
+GLuint
+fg_texture(struct framegraph* fg, i32 resource) {
+	return resource >= 0 && resource < fg->resources_len ? fg->resources[resource].texture : 0;
+}
+
+b32
+fg_dump(struct framegraph* fg, const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		gl_log_err("ERROR: could not open %s for writing\n", path);
+		return 0;
+	}
+	fprintf(file, "// %i passes, %i culled, %i framebuffer switches, %i barriers\n", fg->passes_len,
+	        fg->passes_len - fg->order_len, fg->framebuffer_switches, fg->barrier_count);
+	fprintf(file, "digraph framegraph {\n\trankdir=LR;\n\tnode [fontname=\"monospace\", fontsize=10];\n");
+	int position[FG_MAX_PASSES];
+	for (int p = 0; p < fg->passes_len; p++) {
+		position[p] = -1;
+	}
+	for (int i = 0; i < fg->order_len; i++) {
+		position[fg->order[i]] = i;
+	}
+	for (int p = 0; p < fg->passes_len; p++) {
+		const struct fg_pass* pass = &fg->passes[p];
+		if (pass->culled) {
+			fprintf(file, "\tp%i [shape=box, style=dashed, color=gray, label=\"%s\\nculled\"];\n", p, pass->name);
+		} else {
+			fprintf(file, "\tp%i [shape=box, style=filled, fillcolor=lightblue, label=\"%s\\n#%i%s\"];\n", p,
+			        pass->name, position[p], pass->side_effect ? " side effect" : "");
+		}
+		if (pass->barriers) {
+			fprintf(file, "\tp%i [xlabel=\"barrier 0x%x\"];\n", p, pass->barriers);
+		}
+	}
+	for (int r = 0; r < fg->resources_len; r++) {
+		const struct fg_resource* resource = &fg->resources[r];
+		if (resource->imported) {
+			fprintf(file, "\tr%i [shape=ellipse, style=filled, fillcolor=orange, label=\"%s\\nimported\"];\n", r,
+			        resource->name);
+		} else {
+			char size[32];
+			if (resource->desc.width > 0) {
+				snprintf(size, sizeof(size), "%ix%i", resource->desc.width, resource->desc.height);
+			} else {
+				snprintf(size, sizeof(size), "%.2gx window", resource->desc.scale > 0 ? resource->desc.scale : 1.0);
+			}
+			if (resource->first_use < 0) {
+				fprintf(file, "\tr%i [shape=ellipse, style=dashed, color=gray, label=\"%s\\n0x%x %s\\nunused\"];\n", r,
+				        resource->name, resource->desc.format, size);
+			} else {
+				fprintf(file, "\tr%i [shape=ellipse, label=\"%s\\n0x%x %s\\nlives #%i-#%i, pool slot %i\"];\n", r,
+				        resource->name, resource->desc.format, size, resource->first_use, resource->last_use,
+				        resource->target);
+			}
+		}
+	}
+	for (int p = 0; p < fg->passes_len; p++) {
+		const struct fg_pass* pass = &fg->passes[p];
+		for (int a = 0; a < pass->accesses_len; a++) {
+			const struct fg_access* access = &pass->accesses[a];
+			const char* usage = (access->usage & FG_ATTACHMENT) ? "attachment"
+			                    : (access->usage & FG_IMAGE)    ? "image"
+			                                                    : "sampled";
+			if (access->write) {
+				fprintf(file, "\tp%i -> r%i [label=\"%s\", color=red];\n", p, access->resource, usage);
+			} else {
+				fprintf(file, "\tr%i -> p%i [label=\"%s\"];\n", access->resource, p, usage);
+			}
+		}
+	}
+	fprintf(file, "}\n");
+	fclose(file);
+	return 1;
+}
@@ -0,0 +1,95 @@
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+#include "render_target.h"
+
+/* Frame graph.
+ * Every frame the renderer declares its passes and the resources each one reads and writes, then
+ * fg_compile() works out what actually has to run:
+ *  - passes that contribute neither to an imported resource nor to a side effect are culled,
+ *  - the rest are ordered topologically, preferring to keep passes on the same attachments
+ *    together so fewer framebuffer switches happen,
+ *  - every transient texture gets a lifetime, and fg_execute() acquires it from the render target
+ *    pool before its first use and releases it after its last, so the pool aliases targets whose
+ *    lifetimes do not overlap,
+ *  - glMemoryBarrier is issued only where a pass reads what an earlier pass wrote through image
+ *    stores (attachment writes are coherent in GL), and only if the entry point is available.
+ * fg_dump() writes the compiled graph as Graphviz. */
+
+#define FG_MAX_PASSES 32
+#define FG_MAX_RESOURCES 64
+#define FG_MAX_ACCESSES 8 /* reads plus writes per pass */
+
+enum {
+	FG_SAMPLED = 1 << 0,    /* texture fetch */
+	FG_IMAGE = 1 << 1,      /* image load/store */
+	FG_ATTACHMENT = 1 << 2, /* render target */
+};
+
+struct framegraph;
+typedef void (*fg_pass_fn)(struct framegraph* fg, void* user);
+
+struct fg_access {
+	i32 resource;
+	u32 usage;
+	b32 write;
+};
+
+struct fg_pass {
+	const char* name;
+	fg_pass_fn fn;
+	void* user;
+	b32 side_effect; /* e.g. readback or presentation: never culled */
+	struct fg_access accesses[FG_MAX_ACCESSES];
+	int accesses_len;
+	b32 culled;
+	GLbitfield barriers; /* issued before the pass */
+};
+
+struct fg_resource {
+	const char* name;
+	struct rt_desc desc;
+	b32 imported; /* the default framebuffer or an external texture: kept alive, never pooled */
+	GLuint texture;
+	i32 target; /* pooled render target while alive, -1 otherwise */
+	int first_use; /* positions in the execution order, -1 when unused */
+	int last_use;
+};
+
+struct framegraph {
+	struct fg_pass passes[FG_MAX_PASSES];
+	int passes_len;
+	struct fg_resource resources[FG_MAX_RESOURCES];
+	int resources_len;
+	int order[FG_MAX_PASSES];
+	int order_len;
+	int framebuffer_switches;
+	int barrier_count;
+};
+
+/* starts a new frame's graph */
+void fg_reset(struct framegraph* fg);
+
+i32 fg_create_texture(struct framegraph* fg, const char* name, struct rt_desc desc);
+/* the window's framebuffer */
+i32 fg_import_backbuffer(struct framegraph* fg, const char* name);
+/* sampled or image access only, passes cannot render to it */
+i32 fg_import_texture(struct framegraph* fg, const char* name, GLuint texture);
+
+i32 fg_add_pass(struct framegraph* fg, const char* name, fg_pass_fn fn, void* user, b32 side_effect);
+void fg_read(struct framegraph* fg, i32 pass, i32 resource, u32 usage);
+void fg_write(struct framegraph* fg, i32 pass, i32 resource, u32 usage);
+
+b32 fg_compile(struct framegraph* fg);
+/* binds each pass's attachments (window framebuffer viewport fb_width x fb_height) and runs it */
+void fg_execute(struct framegraph* fg, int fb_width, int fb_height);
+/* texture of a resource, valid inside the passes that declared it */
+GLuint fg_texture(struct framegraph* fg, i32 resource);
+
+/* after fg_execute() the labels include the pool slots the transients used */
+b32 fg_dump(struct framegraph* fg, const char* path);
+
+#endif
@@ -0,0 +1,57 @@
+#include <string.h>
+
+#include "game_loop.h"
+
+void
+game_loop_init(struct game_loop* loop, double tick_hz, int max_ticks) {
+	memset(loop, 0, sizeof(*loop));
+	loop->tick_ns = (i64)(1e9 / tick_hz + 0.5);
+	loop->tick_seconds = (double)loop->tick_ns * 1e-9;
+	loop->max_ticks = max_ticks > 0 ? max_ticks : 1;
+}
+
+int
+game_loop_begin_frame(struct game_loop* loop) {
+	u64 now = clock_ns();
+	i64 elapsed = loop->fixed_frame_ns;
+	if (elapsed <= 0) {
+		/* the first frame only starts the clock */
+		elapsed = loop->last_ns ? (i64)(now - loop->last_ns) : 0;
+	}
+	loop->last_ns = now;
+	loop->frames++;
+
+	loop->accumulator_ns += elapsed;
+	i64 ticks = loop->accumulator_ns / loop->tick_ns;
+	if (ticks > loop->max_ticks) {
+		i64 dropped = (ticks - loop->max_ticks) * loop->tick_ns;
+		loop->accumulator_ns -= dropped;
+		loop->dropped_ns += dropped;
+		loop->capped_frames++;
+		ticks = loop->max_ticks;
+	}
+	loop->accumulator_ns -= ticks * loop->tick_ns;
+	loop->alpha = (double)loop->accumulator_ns / (double)loop->tick_ns;
+	loop->ticks += ticks;
+	if (ticks > loop->max_frame_ticks) {
+		loop->max_frame_ticks = (int)ticks;
+	}
+	return (int)ticks;
+}
+
+double
+game_loop_time(const struct game_loop* loop) {
+	return (double)loop->ticks * loop->tick_seconds;
+}
+
+void
+game_loop_log(const struct game_loop* loop) {
+	gl_log("game loop: %li ticks at %.1f Hz in %li frames (%.2f per frame, at most %i), %.3f s simulated\n",
+	       (long)loop->ticks, 1.0 / loop->tick_seconds, (long)loop->frames,
+	       loop->frames ? (double)loop->ticks / (double)loop->frames : 0.0, loop->max_frame_ticks,
+	       game_loop_time(loop));
+	if (loop->capped_frames) {
+		gl_log("game loop: %li frames hit the %i tick cap, %.3f s of simulation dropped\n", (long)loop->capped_frames,
+		       loop->max_ticks, (double)loop->dropped_ns * 1e-9);
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef GAME_LOOP_H
+#define GAME_LOOP_H
+
+#include "common.h"
+
+/* Fixed-timestep simulation clock.
+ * Frame time is accumulated and spent in ticks of exactly tick_seconds, so the simulation runs at the
+ * same rate and with the same step whatever the frame rate. Rendering interpolates between the state
+ * before and after the last tick by alpha. A frame runs at most max_ticks: the backlog beyond that is
+ * dropped, so a slow frame slows the simulation down for a moment instead of making the next frame
+ * slower still. */
+
+#define GAME_LOOP_MAX_TICKS 8
+
+struct game_loop {
+	double tick_seconds; /* the simulation step, tick_ns in seconds */
+	i64 tick_ns;
+	int max_ticks;
+	i64 fixed_frame_ns; /* when > 0 each frame advances by this instead of the clock */
+
+	u64 last_ns; /* 0 before the first frame */
+	i64 accumulator_ns;
+	double alpha; /* [0, 1) of a tick past the last simulated state */
+
+	i64 ticks; /* simulated so far */
+	i64 frames;
+	int max_frame_ticks;
+	i64 capped_frames;
+	i64 dropped_ns;
+};
+
+void game_loop_init(struct game_loop* loop, double tick_hz, int max_ticks);
+/* measures the time since the previous frame; returns how many ticks to simulate before drawing */
+int game_loop_begin_frame(struct game_loop* loop);
+/* simulated time at the last tick */
+double game_loop_time(const struct game_loop* loop);
+void game_loop_log(const struct game_loop* loop);
+
+#endif
@@ -0,0 +1,673 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "gl_trace.h"
+
+#define TRACE_BUFFER_SIZE (1 << 20)
+#define TRACE_MAX_MAPS 8
+
+/* what a pointer parameter points at */
+enum payload {
+	PAYLOAD_RAW,          /* nothing: a buffer offset, NULL or not understood */
+	PAYLOAD_OUTPUT,       /* written by GL, replayed into scratch memory */
+	PAYLOAD_BYTES,        /* argument args[0] bytes */
+	PAYLOAD_ELEMENTS,     /* argument args[0] elements of args[1] bytes */
+	PAYLOAD_STRING,       /* NUL-terminated */
+	PAYLOAD_SOURCES,      /* glShaderSource strings, count and lengths in arguments args[0] and args[1], joined */
+	PAYLOAD_UNPACK_BYTES, /* argument args[0] bytes, an offset while a pixel unpack buffer is bound */
+	PAYLOAD_UNPACK_IMAGE, /* width, height, format and type in arguments args[0..3], same */
+	PAYLOAD_PACK_IMAGE,   /* output sized like PAYLOAD_UNPACK_IMAGE, an offset while a pixel pack buffer is bound */
+};
+
+struct payload_rule {
+	const char* name;
+	u8 param;
+	u8 payload;
+	u8 args[4]; /* argument indices or sizes, see enum payload */
+};
+
+/* pointer parameters of the entry points the renderer uses; glUniform*v and glUniformMatrix*fv are
+ * derived from the name, glGet* outputs are the default and anything else is recorded as a value */
+static const struct payload_rule payload_rules[] = {
+    {"glBufferData", 2, PAYLOAD_BYTES, {1}},
+    {"glBufferSubData", 3, PAYLOAD_BYTES, {2}},
+    {"glCompressedTexImage2D", 7, PAYLOAD_UNPACK_BYTES, {6}},
+    {"glCompressedTexSubImage2D", 8, PAYLOAD_UNPACK_BYTES, {7}},
+    {"glTexImage2D", 8, PAYLOAD_UNPACK_IMAGE, {3, 4, 6, 7}},
+    {"glTexSubImage2D", 8, PAYLOAD_UNPACK_IMAGE, {4, 5, 6, 7}},
+    {"glReadPixels", 6, PAYLOAD_PACK_IMAGE, {2, 3, 4, 5}},
+    {"glDrawBuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glDeleteBuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glDeleteFramebuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glDeleteQueries", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glDeleteRenderbuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glDeleteTextures", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glDeleteVertexArrays", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    /* recorded after the call, so these hold the names GL returned and the replay can compare */
+    {"glGenBuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glGenFramebuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glGenQueries", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glGenRenderbuffers", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glGenTextures", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glGenVertexArrays", 1, PAYLOAD_ELEMENTS, {0, 4}},
+    {"glShaderSource", 2, PAYLOAD_SOURCES, {1, 3}},
+    {"glShaderSource", 3, PAYLOAD_RAW, {0}},
+    {"glGetUniformLocation", 1, PAYLOAD_STRING, {0}},
+    {"glGetAttribLocation", 1, PAYLOAD_STRING, {0}},
+    {"glBindAttribLocation", 2, PAYLOAD_STRING, {0}},
+    {"glVertexAttribPointer", 5, PAYLOAD_RAW, {0}},
+    {"glVertexAttribIPointer", 4, PAYLOAD_RAW, {0}},
+    {"glDrawElements", 3, PAYLOAD_RAW, {0}},
+    {"glDrawElementsInstanced", 3, PAYLOAD_RAW, {0}},
+    {"glDrawElementsBaseVertex", 3, PAYLOAD_RAW, {0}},
+};
+
+struct mapping {
+	GLenum target; /* 0 when free */
+	u8* pointer;
+	u64 length;
+	u64 access;
+};
+
+static struct {
+	FILE* file;
+	u8* buffer;
+	isize buffer_len;
+	long last_frame;
+	int functions_len;
+	struct payload_rule* rules; /* functions_len * GL_TRACE_MAX_PARAMS */
+
+	int fn_bind_buffer;
+	int fn_pixel_store;
+	int fn_map_buffer_range;
+	int fn_flush_mapped_buffer_range;
+	int fn_unmap_buffer;
+
+	u64 unpack_buffer;
+	u64 pack_buffer;
+	int unpack_alignment;
+	int unpack_row_length;
+	int pack_alignment;
+	int pack_row_length;
+	struct mapping maps[TRACE_MAX_MAPS];
+
+	isize calls;
+	isize bytes;
+} trace;
+
+//////////////////////////////////////
+// writing
+static void
+flush_buffer(void) {
+	if (trace.buffer_len && fwrite(trace.buffer, 1, trace.buffer_len, trace.file) != (size_t)trace.buffer_len) {
+		gl_log_err("ERROR: gl trace: write failed\n");
+	}
+	trace.buffer_len = 0;
+}
+
+static void
+put_bytes(const void* data, isize len) {
+	trace.bytes += len;
+	if (trace.buffer_len + len > TRACE_BUFFER_SIZE) {
+		flush_buffer();
+	}
+	if (len > TRACE_BUFFER_SIZE) {
+		fwrite(data, 1, len, trace.file);
+		return;
+	}
+	memcpy(trace.buffer + trace.buffer_len, data, len);
+	trace.buffer_len += len;
+}
+
+static void
+put_varint(u64 value) {
+	u8 bytes[10];
+	int len = 0;
+	do {
+		bytes[len++] = (u8)((value & 0x7f) | (value >= 0x80 ? 0x80 : 0));
+		value >>= 7;
+	} while (value);
+	put_bytes(bytes, len);
+}
+
+static void
+put_u32(u32 value) {
+	put_bytes(&value, 4);
+}
+
+static void
+put_input(const void* pointer, u64 size) {
+	if (!pointer) {
+		put_varint(GL_TRACE_RAW);
+		return;
+	}
+	put_varint(GL_TRACE_INPUT);
+	put_varint(size);
+	put_bytes(pointer, (isize)size);
+}
+
+u64
+gl_trace_image_bytes(u64 width, u64 height, u64 format, u64 type, int alignment, int row_length) {
+	int components;
+	switch (format) {
+		case GL_RED:
+		case GL_RED_INTEGER:
+		case GL_ALPHA:
+		case GL_DEPTH_COMPONENT:
+		case GL_STENCIL_INDEX:
+			components = 1;
+			break;
+		case GL_RG:
+		case GL_RG_INTEGER:
+		case GL_DEPTH_STENCIL:
+			components = 2;
+			break;
+		case GL_RGB:
+		case GL_BGR:
+		case GL_RGB_INTEGER:
+			components = 3;
+			break;
+		default:
+			components = 4;
+			break;
+	}
+	u64 pixel;
+	switch (type) {
+		case GL_UNSIGNED_BYTE:
+		case GL_BYTE:
+			pixel = components;
+			break;
+		case GL_UNSIGNED_SHORT:
+		case GL_SHORT:
+		case GL_HALF_FLOAT:
+			pixel = 2 * components;
+			break;
+		case GL_UNSIGNED_SHORT_5_6_5:
+		case GL_UNSIGNED_SHORT_4_4_4_4:
+		case GL_UNSIGNED_SHORT_5_5_5_1:
+			pixel = 2;
+			break;
+		case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+			pixel = 8;
+			break;
+		case GL_UNSIGNED_INT_8_8_8_8_REV:
+		case GL_UNSIGNED_INT_2_10_10_10_REV:
+		case GL_UNSIGNED_INT_24_8:
+		case GL_UNSIGNED_INT_10F_11F_11F_REV:
+		case GL_UNSIGNED_INT_5_9_9_9_REV:
+			pixel = 4;
+			break;
+		default: /* 32-bit components */
+			pixel = 4 * components;
+			break;
+	}
+	if (width == 0 || height == 0 || width > (1u << 16) || height > (1u << 16)) {
+		return 0;
+	}
+	u64 row = (row_length > 0 ? (u64)row_length : width) * pixel;
+	row = (row + alignment - 1) / alignment * alignment;
+	return (height - 1) * row + width * pixel;
+}
+
+static void
+put_payload(int fn, int param, const u64* args) {
+	const struct payload_rule* rule = &trace.rules[fn * GL_TRACE_MAX_PARAMS + param];
+	const void* pointer = (const void*)(uintptr_t)args[param];
+	switch (rule->payload) {
+		case PAYLOAD_OUTPUT:
+			put_varint(GL_TRACE_OUTPUT);
+			put_varint(0);
+			break;
+		case PAYLOAD_BYTES:
+			put_input(pointer, (i64)args[rule->args[0]] > 0 ? args[rule->args[0]] : 0);
+			break;
+		case PAYLOAD_ELEMENTS:
+			put_input(pointer, (i32)args[rule->args[0]] > 0 ? (u64)(i32)args[rule->args[0]] * rule->args[1] : 0);
+			break;
+		case PAYLOAD_STRING:
+			put_input(pointer, pointer ? strlen(pointer) + 1 : 0);
+			break;
+		case PAYLOAD_SOURCES: {
+			const GLchar* const* strings = pointer;
+			const GLint* lengths = (const GLint*)(uintptr_t)args[rule->args[1]];
+			int count = (i32)args[rule->args[0]];
+			u64 size = 1;
+			for (int i = 0; i < count; i++) {
+				size += lengths && lengths[i] >= 0 ? (u64)lengths[i] : strlen(strings[i]);
+			}
+			put_varint(GL_TRACE_INPUT);
+			put_varint(size);
+			for (int i = 0; i < count; i++) {
+				put_bytes(strings[i], lengths && lengths[i] >= 0 ? lengths[i] : (isize)strlen(strings[i]));
+			}
+			put_bytes("", 1);
+			break;
+		}
+		case PAYLOAD_UNPACK_BYTES:
+			if (trace.unpack_buffer) {
+				put_varint(GL_TRACE_RAW);
+			} else {
+				put_input(pointer, (i32)args[rule->args[0]] > 0 ? args[rule->args[0]] : 0);
+			}
+			break;
+		case PAYLOAD_UNPACK_IMAGE:
+			if (trace.unpack_buffer) {
+				put_varint(GL_TRACE_RAW);
+			} else {
+				put_input(pointer, gl_trace_image_bytes(args[rule->args[0]], args[rule->args[1]], args[rule->args[2]],
+				                                        args[rule->args[3]], trace.unpack_alignment,
+				                                        trace.unpack_row_length));
+			}
+			break;
+		case PAYLOAD_PACK_IMAGE:
+			if (trace.pack_buffer) {
+				put_varint(GL_TRACE_RAW);
+			} else {
+				put_varint(GL_TRACE_OUTPUT);
+				put_varint(gl_trace_image_bytes(args[rule->args[0]], args[rule->args[1]], args[rule->args[2]],
+				                                args[rule->args[3]], trace.pack_alignment, trace.pack_row_length));
+			}
+			break;
+		default:
+			put_varint(GL_TRACE_RAW);
+			break;
+	}
+}
+
+static struct mapping*
+find_mapping(GLenum target) {
+	for (int i = 0; i < TRACE_MAX_MAPS; i++) {
+		if (trace.maps[i].target == target) {
+			return &trace.maps[i];
+		}
+	}
+	return NULL;
+}
+
+static void
+put_mapped_write(GLenum target, u64 offset, u64 size, const u8* data) {
+	put_varint(GL_TRACE_MAP_WRITE(trace.functions_len));
+	put_varint(target);
+	put_varint(offset);
+	put_varint(size);
+	put_bytes(data, (isize)size);
+}
+
+/* what the application wrote into a mapped buffer is only visible before the unmap */
+static void
+trace_before(int fn, const u64* args, u64 ret) {
+	(void)ret;
+	if (fn == trace.fn_unmap_buffer) {
+		struct mapping* map = find_mapping((GLenum)args[0]);
+		if (map) {
+			if ((map->access & GL_MAP_WRITE_BIT) && !(map->access & GL_MAP_FLUSH_EXPLICIT_BIT)) {
+				put_mapped_write(map->target, 0, map->length, map->pointer);
+			}
+			map->target = 0;
+		}
+	} else if (fn == trace.fn_flush_mapped_buffer_range) {
+		struct mapping* map = find_mapping((GLenum)args[0]);
+		if (map && args[1] + args[2] <= map->length) {
+			put_mapped_write(map->target, args[1], args[2], map->pointer + args[1]);
+		}
+	}
+}
+
+static void
+trace_after(int fn, const u64* args, u64 ret) {
+	const struct gl_loader_signature* signature = &gl_loader_signatures[fn];
+	put_varint(fn);
+	int params = (int)strlen(signature->params);
+	for (int i = 0; i < params; i++) {
+		put_varint(args[i]);
+	}
+	if (signature->ret != 'v') {
+		put_varint(ret);
+	}
+	for (int i = 0; i < params; i++) {
+		if (signature->params[i] == 'p') {
+			put_payload(fn, i, args);
+		}
+	}
+	trace.calls++;
+
+	/* state later payload sizes depend on */
+	if (fn == trace.fn_bind_buffer) {
+		if (args[0] == GL_PIXEL_UNPACK_BUFFER) {
+			trace.unpack_buffer = args[1];
+		} else if (args[0] == GL_PIXEL_PACK_BUFFER) {
+			trace.pack_buffer = args[1];
+		}
+	} else if (fn == trace.fn_pixel_store) {
+		int value = (i32)args[1];
+		switch (args[0]) {
+			case GL_UNPACK_ALIGNMENT:
+				trace.unpack_alignment = value;
+				break;
+			case GL_UNPACK_ROW_LENGTH:
+				trace.unpack_row_length = value;
+				break;
+			case GL_PACK_ALIGNMENT:
+				trace.pack_alignment = value;
+				break;
+			case GL_PACK_ROW_LENGTH:
+				trace.pack_row_length = value;
+				break;
+		}
+	} else if (fn == trace.fn_map_buffer_range && ret) {
+		struct mapping* map = find_mapping((GLenum)args[0]);
+		map = map ? map : find_mapping(0);
+		if (map) {
+			*map = (struct mapping){(GLenum)args[0], (u8*)(uintptr_t)ret, args[2], args[3]};
+		} else {
+			gl_log_err("ERROR: gl trace: too many mapped buffers, writes through %x are lost\n", (u32)args[0]);
+		}
+	}
+}
+
+static int
+find_function(const char* name) {
+	for (int i = 0; i < trace.functions_len; i++) {
+		if (strcmp(gl_loader_signatures[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void
+resolve_rules(void) {
+	for (int fn = 0; fn < trace.functions_len; fn++) {
+		const char* name = gl_loader_signatures[fn].name;
+		const char* params = gl_loader_signatures[fn].params;
+		b32 getter = strncmp(name, "glGet", 5) == 0;
+		int n = 0, m = 0, end = 0, elements = 0;
+		if (sscanf(name, "glUniformMatrix%dx%dfv%n", &n, &m, &end) == 2 && end && !name[end]) {
+			elements = n * m;
+		} else if ((end = 0, sscanf(name, "glUniformMatrix%dfv%n", &n, &end) == 1) && end && !name[end]) {
+			elements = n * n;
+		} else if ((end = 0, sscanf(name, "glUniform%d%*[fiu]v%n", &n, &end) == 1) && end && !name[end]) {
+			elements = n;
+		}
+		for (int p = 0; params[p]; p++) {
+			struct payload_rule* rule = &trace.rules[fn * GL_TRACE_MAX_PARAMS + p];
+			/* no name marks the defaults */
+			*rule = (struct payload_rule){NULL, (u8)p, getter ? PAYLOAD_OUTPUT : PAYLOAD_RAW, {0}};
+			if (elements && params[p] == 'p') {
+				*rule = (struct payload_rule){name, (u8)p, PAYLOAD_ELEMENTS, {1, (u8)(elements * 4)}};
+			}
+		}
+	}
+	for (isize i = 0; i < ARRAY_SIZE(payload_rules); i++) {
+		int fn = find_function(payload_rules[i].name);
+		if (fn >= 0) {
+			trace.rules[fn * GL_TRACE_MAX_PARAMS + payload_rules[i].param] = payload_rules[i];
+		}
+	}
+	for (int fn = 0; fn < trace.functions_len; fn++) {
+		const char* params = gl_loader_signatures[fn].params;
+		for (int p = 0; params[p]; p++) {
+			const struct payload_rule* rule = &trace.rules[fn * GL_TRACE_MAX_PARAMS + p];
+			if (params[p] == 'p' && !rule->name && rule->payload == PAYLOAD_RAW) {
+				gl_log("gl trace: %s pointer argument %i is recorded as a value\n", gl_loader_signatures[fn].name, p);
+			}
+		}
+	}
+}
+
+b32
+gl_trace_begin(const char* path, long first_frame, long last_frame, int fb_width, int fb_height) {
+	int functions_len = gl_loader_count;
+	if (functions_len > GL_TRACE_MAX_FUNCTIONS) {
+		gl_log_err("ERROR: gl trace: %i entry points, at most %i supported\n", functions_len, GL_TRACE_MAX_FUNCTIONS);
+		return 0;
+	}
+	memset(&trace, 0, sizeof(trace));
+	trace.file = fopen(path, "wb");
+	if (!trace.file) {
+		gl_log_err("ERROR: gl trace: could not open %s for writing\n", path);
+		return 0;
+	}
+	trace.buffer = malloc(TRACE_BUFFER_SIZE);
+	trace.functions_len = functions_len;
+	trace.rules = calloc((size_t)functions_len * GL_TRACE_MAX_PARAMS, sizeof(*trace.rules));
+	trace.last_frame = last_frame;
+	trace.unpack_alignment = 4;
+	trace.pack_alignment = 4;
+	trace.fn_bind_buffer = find_function("glBindBuffer");
+	trace.fn_pixel_store = find_function("glPixelStorei");
+	trace.fn_map_buffer_range = find_function("glMapBufferRange");
+	trace.fn_flush_mapped_buffer_range = find_function("glFlushMappedBufferRange");
+	trace.fn_unmap_buffer = find_function("glUnmapBuffer");
+	resolve_rules();
+
+	put_bytes("GLTR", 4);
+	put_u32(GL_TRACE_VERSION);
+	put_u32((u32)fb_width);
+	put_u32((u32)fb_height);
+	put_u32((u32)first_frame);
+	put_u32((u32)last_frame);
+	put_u32((u32)functions_len);
+	for (int fn = 0; fn < functions_len; fn++) {
+		const struct gl_loader_signature* signature = &gl_loader_signatures[fn];
+		u8 name_len = (u8)strlen(signature->name);
+		u8 params_len = (u8)strlen(signature->params);
+		put_bytes(&name_len, 1);
+		put_bytes(signature->name, name_len);
+		put_bytes(&params_len, 1);
+		put_bytes(signature->params, params_len);
+		put_bytes(&signature->ret, 1);
+	}
+	if (!gl_loader_add_hooks(trace_before, trace_after)) {
+		gl_log_err("ERROR: gl trace: no free loader hook\n");
+		fclose(trace.file);
+		free(trace.buffer);
+		free(trace.rules);
+		memset(&trace, 0, sizeof(trace));
+		return 0;
+	}
+	gl_log("gl trace: recording to %s until frame %li\n", path, last_frame);
+	return 1;
+}
+
+void
+gl_trace_end_frame(long frame) {
+	if (!trace.file) {
+		return;
+	}
+	put_varint(GL_TRACE_FRAME(trace.functions_len));
+	put_varint((u64)frame);
+	if (frame >= trace.last_frame) {
+		gl_trace_end();
+	}
+}
+
+void
+gl_trace_end(void) {
+	if (!trace.file) {
+		return;
+	}
+	gl_loader_remove_hooks(trace_before, trace_after);
+	flush_buffer();
+	if (fclose(trace.file) != 0) {
+		gl_log_err("ERROR: gl trace: write failed\n");
+	}
+	gl_log("gl trace: %li calls, %.1f MB\n", (long)trace.calls, trace.bytes / (1024.0 * 1024.0));
+	free(trace.buffer);
+	free(trace.rules);
+	memset(&trace, 0, sizeof(trace));
+}
+
+//////////////////////////////////////
+// reading
+static b32
+get_varint(struct gl_trace_reader* reader, u64* value) {
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (reader->cursor >= reader->map_size) {
+			return 0;
+		}
+		u8 byte = reader->map[reader->cursor++];
+		*value |= (u64)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static b32
+get_bytes(struct gl_trace_reader* reader, u64 size, const u8** data) {
+	if (size > (u64)(reader->map_size - reader->cursor)) {
+		return 0;
+	}
+	*data = reader->map + reader->cursor;
+	reader->cursor += (isize)size;
+	return 1;
+}
+
+static u32
+read_u32(const u8* data) {
+	u32 value;
+	memcpy(&value, data, 4);
+	return value;
+}
+
+b32
+gl_trace_open(struct gl_trace_reader* reader, const char* path) {
+	memset(reader, 0, sizeof(*reader));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		gl_log_err("ERROR: gl trace: could not open %s\n", path);
+		return 0;
+	}
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map != MAP_FAILED) {
+			reader->map = map;
+			reader->map_size = st.st_size;
+		}
+	}
+	close(fd);
+	if (!reader->map || reader->map_size < 28 || memcmp(reader->map, "GLTR", 4) != 0 ||
+	    read_u32(reader->map + 4) != GL_TRACE_VERSION) {
+		gl_log_err("ERROR: gl trace: %s is not a version %i trace\n", path, GL_TRACE_VERSION);
+		gl_trace_close(reader);
+		return 0;
+	}
+	reader->fb_width = (int)read_u32(reader->map + 8);
+	reader->fb_height = (int)read_u32(reader->map + 12);
+	reader->first_frame = (i32)read_u32(reader->map + 16);
+	reader->last_frame = (i32)read_u32(reader->map + 20);
+	reader->functions_len = (int)read_u32(reader->map + 24);
+	reader->cursor = 28;
+	if (reader->functions_len > GL_TRACE_MAX_FUNCTIONS) {
+		gl_trace_close(reader);
+		return 0;
+	}
+	reader->functions = calloc(reader->functions_len, sizeof(*reader->functions));
+	for (int fn = 0; fn < reader->functions_len; fn++) {
+		struct gl_trace_function* function = &reader->functions[fn];
+		const u8 *len, *name, *params, *ret;
+		if (!get_bytes(reader, 1, &len) || *len >= sizeof(function->name) || !get_bytes(reader, *len, &name)) {
+			break;
+		}
+		memcpy(function->name, name, *len);
+		if (!get_bytes(reader, 1, &len) || *len > GL_TRACE_MAX_PARAMS || !get_bytes(reader, *len, &params) ||
+		    !get_bytes(reader, 1, &ret)) {
+			break;
+		}
+		memcpy(function->params, params, *len);
+		function->ret = (char)*ret;
+		if (fn == reader->functions_len - 1) {
+			return 1;
+		}
+	}
+	gl_log_err("ERROR: gl trace: %s has a corrupt entry point table\n", path);
+	gl_trace_close(reader);
+	return 0;
+}
+
+void
+gl_trace_close(struct gl_trace_reader* reader) {
+	if (reader->map) {
+		munmap(reader->map, reader->map_size);
+	}
+	free(reader->functions);
+	memset(reader, 0, sizeof(*reader));
+}
+
+int
+gl_trace_next(struct gl_trace_reader* reader, struct gl_trace_record* record) {
+	if (reader->cursor == reader->map_size) {
+		record->kind = GL_TRACE_EOF;
+		return record->kind;
+	}
+	u64 code, value;
+	record->kind = GL_TRACE_ERROR;
+	if (!get_varint(reader, &code)) {
+		return record->kind;
+	}
+	if (code == (u64)GL_TRACE_FRAME(reader->functions_len)) {
+		if (get_varint(reader, &value)) {
+			record->frame = (long)value;
+			record->kind = GL_TRACE_FRAME_END;
+		}
+		return record->kind;
+	}
+	if (code == (u64)GL_TRACE_MAP_WRITE(reader->functions_len)) {
+		u64 target;
+		if (get_varint(reader, &target) && get_varint(reader, &record->offset) && get_varint(reader, &record->size) &&
+		    get_bytes(reader, record->size, &record->data)) {
+			record->target = (GLenum)target;
+			record->kind = GL_TRACE_MAPPED_WRITE;
+		}
+		return record->kind;
+	}
+	if (code >= (u64)reader->functions_len) {
+		return record->kind;
+	}
+
+	const struct gl_trace_function* function = &reader->functions[code];
+	record->function = (int)code;
+	int params = (int)strlen(function->params);
+	for (int i = 0; i < params; i++) {
+		if (!get_varint(reader, &record->args[i])) {
+			return record->kind;
+		}
+	}
+	record->ret = 0;
+	if (function->ret != 'v' && !get_varint(reader, &record->ret)) {
+		return record->kind;
+	}
+	for (int i = 0; i < params; i++) {
+		record->payload_kind[i] = GL_TRACE_RAW;
+		if (function->params[i] != 'p') {
+			continue;
+		}
+		if (!get_varint(reader, &value)) {
+			return record->kind;
+		}
+		record->payload_kind[i] = (u8)value;
+		record->payload[i] = NULL;
+		record->payload_size[i] = 0;
+		if (value == GL_TRACE_OUTPUT) {
+			if (!get_varint(reader, &record->payload_size[i])) {
+				return record->kind;
+			}
+		} else if (value == GL_TRACE_INPUT) {
+			if (!get_varint(reader, &record->payload_size[i]) ||
+			    !get_bytes(reader, record->payload_size[i], &record->payload[i])) {
+				return record->kind;
+			}
+		}
+	}
+	record->kind = GL_TRACE_CALL;
+	return record->kind;
+}
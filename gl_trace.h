@@ -0,0 +1,94 @@
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* GL call capture for deterministic replay (tools/gl_replay.c).
+ * Recording appends every call the application makes to a binary trace: arguments as varints, plus
+ * the client memory a call reads (buffer and texture data, shader sources, uniform arrays) and what
+ * the application wrote into mapped buffers before unmapping them. Pointers that are buffer offsets stay plain values.
+ *
+ * A trace starts at gl_trace_begin(), normally right after the loader, so the objects the recorded
+ * frames use are created inside it; frames before first_frame are replayed as setup and not timed.
+ * Recording stops after last_frame.
+ *
+ * File layout: "GLTR", version, framebuffer size, first and last frame, then the entry point table
+ * (name, parameter kinds and return kind as in gl_loader_signatures), then records. A record starts
+ * with a varint code: an index into the table for a call, GL_TRACE_FRAME(table) for the end of a
+ * frame or GL_TRACE_MAP_WRITE(table) for mapped buffer contents. */
+
+#define GL_TRACE_VERSION 1
+#define GL_TRACE_MAX_PARAMS 16
+#define GL_TRACE_MAX_FUNCTIONS 1024
+#define GL_TRACE_FRAME(functions_len) (functions_len)
+#define GL_TRACE_MAP_WRITE(functions_len) ((functions_len) + 1)
+
+/* how a pointer parameter was recorded */
+enum {
+	GL_TRACE_RAW = 0,    /* the value itself: a buffer offset or NULL */
+	GL_TRACE_OUTPUT = 1, /* memory GL writes, size only */
+	GL_TRACE_INPUT = 2,  /* the bytes the call read */
+};
+
+b32 gl_trace_begin(const char* path, long first_frame, long last_frame, int fb_width, int fb_height);
+/* call once per frame before the buffer swap */
+void gl_trace_end_frame(long frame);
+/* stops recording early, also safe when not recording */
+void gl_trace_end(void);
+
+/* client memory a pixel transfer of width x height reads or writes under the given pixel store state */
+u64 gl_trace_image_bytes(u64 width, u64 height, u64 format, u64 type, int alignment, int row_length);
+
+/* reading */
+
+enum {
+	GL_TRACE_CALL,
+	GL_TRACE_FRAME_END,
+	GL_TRACE_MAPPED_WRITE,
+	GL_TRACE_EOF,
+	GL_TRACE_ERROR,
+};
+
+struct gl_trace_function {
+	char name[64];
+	char params[GL_TRACE_MAX_PARAMS + 1];
+	char ret;
+};
+
+struct gl_trace_record {
+	int kind;
+	/* GL_TRACE_CALL */
+	int function;
+	u64 args[GL_TRACE_MAX_PARAMS];
+	u64 ret;
+	u8 payload_kind[GL_TRACE_MAX_PARAMS];
+	const u8* payload[GL_TRACE_MAX_PARAMS]; /* GL_TRACE_INPUT: points into the mapped trace */
+	u64 payload_size[GL_TRACE_MAX_PARAMS];
+	/* GL_TRACE_FRAME_END */
+	long frame;
+	/* GL_TRACE_MAPPED_WRITE: bytes the application wrote at offset into the mapping of target */
+	GLenum target;
+	u64 offset;
+	u64 size;
+	const u8* data;
+};
+
+struct gl_trace_reader {
+	u8* map;
+	isize map_size;
+	isize cursor;
+	int fb_width;
+	int fb_height;
+	long first_frame;
+	long last_frame;
+	struct gl_trace_function* functions;
+	int functions_len;
+};
+
+b32 gl_trace_open(struct gl_trace_reader* reader, const char* path);
+void gl_trace_close(struct gl_trace_reader* reader);
+int gl_trace_next(struct gl_trace_reader* reader, struct gl_trace_record* record);
+
+#endif
@@ -0,0 +1,469 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gpu_heap.h"
+#include "gpu_memory.h"
+
+#define ALIGNMENT_LOG2 4
+#define FL_SHIFT (GPU_HEAP_SL_LOG2 + ALIGNMENT_LOG2)
+#define SMALL_BLOCK (1u << FL_SHIFT) /* below this the first level is linear, one class per granule */
+#define MAX_BLOCK (1u << 31)
+
+_Static_assert((1 << ALIGNMENT_LOG2) == GPU_HEAP_ALIGNMENT, "ALIGNMENT_LOG2 out of sync");
+_Static_assert(31 - FL_SHIFT + 2 == GPU_HEAP_FL_COUNT, "GPU_HEAP_FL_COUNT out of sync");
+
+struct gpu_heap_block {
+	u32 offset;
+	u32 size;
+	i32 buffer;
+	i32 prev_phys; /* neighbours in address order, -1 at the ends of the buffer */
+	i32 next_phys;
+	i32 prev_free; /* size class list while free; next_free chains unused records */
+	i32 next_free;
+	i32 allocation; /* -1 when free */
+};
+
+struct gpu_heap_allocation {
+	i32 block; /* -1 when the handle is unused */
+	i32 next_unused;
+	u32 offset; /* block offset rounded up to alignment */
+	u32 size;
+	u32 alignment;
+};
+
+static u32
+round_up(u32 value, u32 alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+static int
+floor_log2(u32 value) {
+	return 31 - __builtin_clz(value);
+}
+
+/* the class a free block of this size is filed under */
+static void
+mapping(u32 size, int* fl, int* sl) {
+	if (size < SMALL_BLOCK) {
+		*fl = 0;
+		*sl = (int)(size / (SMALL_BLOCK / GPU_HEAP_SL_COUNT));
+	} else {
+		int log2 = floor_log2(size);
+		*sl = (int)((size >> (log2 - GPU_HEAP_SL_LOG2)) ^ GPU_HEAP_SL_COUNT);
+		*fl = log2 - FL_SHIFT + 1;
+	}
+}
+
+/* the first class whose every block fits size */
+static void
+mapping_search(u32 size, int* fl, int* sl) {
+	if (size >= SMALL_BLOCK) {
+		size += (1u << (floor_log2(size) - GPU_HEAP_SL_LOG2)) - 1;
+	}
+	mapping(size, fl, sl);
+}
+
+static i32
+new_block(struct gpu_heap* heap) {
+	if (heap->unused_blocks >= 0) {
+		i32 index = heap->unused_blocks;
+		heap->unused_blocks = heap->blocks[index].next_free;
+		return index;
+	}
+	if (heap->blocks_len == heap->blocks_cap) {
+		heap->blocks_cap = heap->blocks_cap ? heap->blocks_cap * 2 : 256;
+		heap->blocks = realloc(heap->blocks, sizeof(*heap->blocks) * heap->blocks_cap);
+	}
+	return (i32)heap->blocks_len++;
+}
+
+static void
+release_block(struct gpu_heap* heap, i32 index) {
+	heap->blocks[index].next_free = heap->unused_blocks;
+	heap->unused_blocks = index;
+}
+
+static void
+insert_free(struct gpu_heap* heap, i32 index) {
+	struct gpu_heap_block* block = &heap->blocks[index];
+	struct gpu_heap_buffer* buffer = &heap->buffers[block->buffer];
+	int fl, sl;
+	mapping(block->size, &fl, &sl);
+	i32 head = buffer->free_lists[fl][sl];
+	block->allocation = -1;
+	block->prev_free = -1;
+	block->next_free = head;
+	if (head >= 0) {
+		heap->blocks[head].prev_free = index;
+	}
+	buffer->free_lists[fl][sl] = index;
+	buffer->fl_bitmap |= 1u << fl;
+	buffer->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void
+remove_free(struct gpu_heap* heap, i32 index) {
+	struct gpu_heap_block* block = &heap->blocks[index];
+	struct gpu_heap_buffer* buffer = &heap->buffers[block->buffer];
+	int fl, sl;
+	mapping(block->size, &fl, &sl);
+	if (block->next_free >= 0) {
+		heap->blocks[block->next_free].prev_free = block->prev_free;
+	}
+	if (block->prev_free >= 0) {
+		heap->blocks[block->prev_free].next_free = block->next_free;
+	} else {
+		buffer->free_lists[fl][sl] = block->next_free;
+		if (block->next_free < 0) {
+			buffer->sl_bitmap[fl] &= ~(1u << sl);
+			if (!buffer->sl_bitmap[fl]) {
+				buffer->fl_bitmap &= ~(1u << fl);
+			}
+		}
+	}
+}
+
+static i32
+find_free(const struct gpu_heap_buffer* buffer, u32 size) {
+	int fl, sl;
+	mapping_search(size, &fl, &sl);
+	u32 sl_map = buffer->sl_bitmap[fl] & (~0u << sl);
+	if (!sl_map) {
+		u32 fl_map = buffer->fl_bitmap & (~0u << (fl + 1));
+		if (!fl_map) {
+			return -1;
+		}
+		fl = __builtin_ctz(fl_map);
+		sl_map = buffer->sl_bitmap[fl];
+	}
+	return buffer->free_lists[fl][__builtin_ctz(sl_map)];
+}
+
+/* absorbs the free neighbours of a block that is not on a free list, then files the result */
+static void
+merge_free(struct gpu_heap* heap, i32 index) {
+	struct gpu_heap_block* block = &heap->blocks[index];
+	if (block->prev_phys >= 0 && heap->blocks[block->prev_phys].allocation < 0) {
+		i32 prev_index = block->prev_phys;
+		struct gpu_heap_block* prev = &heap->blocks[prev_index];
+		remove_free(heap, prev_index);
+		prev->size += block->size;
+		prev->next_phys = block->next_phys;
+		if (block->next_phys >= 0) {
+			heap->blocks[block->next_phys].prev_phys = prev_index;
+		}
+		release_block(heap, index);
+		index = prev_index;
+		block = prev;
+	}
+	if (block->next_phys >= 0 && heap->blocks[block->next_phys].allocation < 0) {
+		i32 next_index = block->next_phys;
+		struct gpu_heap_block* next = &heap->blocks[next_index];
+		remove_free(heap, next_index);
+		block->size += next->size;
+		block->next_phys = next->next_phys;
+		if (next->next_phys >= 0) {
+			heap->blocks[next->next_phys].prev_phys = index;
+		}
+		release_block(heap, next_index);
+	}
+	insert_free(heap, index);
+}
+
+/* the free block becomes size bytes long, the rest goes back on a free list */
+static void
+split(struct gpu_heap* heap, i32 index, u32 size) {
+	if (heap->blocks[index].size == size) {
+		return;
+	}
+	i32 rest_index = new_block(heap);
+	struct gpu_heap_block* block = &heap->blocks[index];
+	struct gpu_heap_block* rest = &heap->blocks[rest_index];
+	*rest = (struct gpu_heap_block){
+	    .offset = block->offset + size,
+	    .size = block->size - size,
+	    .buffer = block->buffer,
+	    .prev_phys = index,
+	    .next_phys = block->next_phys,
+	};
+	if (block->next_phys >= 0) {
+		heap->blocks[block->next_phys].prev_phys = rest_index;
+	}
+	block->next_phys = rest_index;
+	block->size = size;
+	insert_free(heap, rest_index);
+}
+
+static isize
+add_buffer(struct gpu_heap* heap, u32 min_size) {
+	if (heap->buffers_len == GPU_HEAP_MAX_BUFFERS) {
+		return -1;
+	}
+	isize buffer_index = heap->buffers_len++;
+	struct gpu_heap_buffer* buffer = &heap->buffers[buffer_index];
+	memset(buffer, 0, sizeof(*buffer));
+	memset(buffer->free_lists, 0xff, sizeof(buffer->free_lists));
+	buffer->size = heap->buffer_size > min_size ? heap->buffer_size : min_size;
+	{
+		GPU_MEM_OWNER(heap->name);
+		glGenBuffers(1, &buffer->buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer->buffer);
+		glBufferData(GL_COPY_WRITE_BUFFER, buffer->size, NULL, GL_STATIC_DRAW);
+	}
+
+	i32 index = new_block(heap);
+	heap->blocks[index] = (struct gpu_heap_block){
+	    .size = buffer->size,
+	    .buffer = (i32)buffer_index,
+	    .prev_phys = -1,
+	    .next_phys = -1,
+	};
+	buffer->first_block = index;
+	insert_free(heap, index);
+	return buffer_index;
+}
+
+void
+gpu_heap_init(struct gpu_heap* heap, const char* name, isize buffer_size) {
+	assert(buffer_size > 0 && buffer_size <= MAX_BLOCK);
+	memset(heap, 0, sizeof(*heap));
+	heap->name = name;
+	heap->buffer_size = round_up((u32)buffer_size, GPU_HEAP_ALIGNMENT);
+	heap->unused_blocks = -1;
+	heap->unused_allocations = -1;
+	add_buffer(heap, 0);
+}
+
+void
+gpu_heap_shutdown(struct gpu_heap* heap) {
+	if (heap->live) {
+		gl_log_err("WARNING: gpu heap %s: %li allocations still live at shutdown\n", heap->name, (long)heap->live);
+	}
+	for (isize i = 0; i < heap->buffers_len; i++) {
+		glDeleteBuffers(1, &heap->buffers[i].buffer);
+	}
+	if (heap->scratch) {
+		glDeleteBuffers(1, &heap->scratch);
+	}
+	free(heap->blocks);
+	free(heap->allocations);
+	memset(heap, 0, sizeof(*heap));
+}
+
+i32
+gpu_heap_alloc(struct gpu_heap* heap, isize size, isize alignment) {
+	assert(size > 0 && alignment > 0);
+	/* block offsets are multiples of GPU_HEAP_ALIGNMENT, so rounding one up to alignment skips at most
+	 * alignment - gcd(alignment, GPU_HEAP_ALIGNMENT) bytes */
+	isize a = alignment, b = GPU_HEAP_ALIGNMENT;
+	while (b) {
+		isize t = a % b;
+		a = b;
+		b = t;
+	}
+	isize padded = size + alignment - a;
+	if (padded > MAX_BLOCK - GPU_HEAP_ALIGNMENT) {
+		gl_log_err("ERROR: gpu heap %s: allocation of %li bytes is too large\n", heap->name, (long)size);
+		return -1;
+	}
+	u32 block_size = round_up((u32)padded, GPU_HEAP_ALIGNMENT);
+
+	i32 index = -1;
+	for (isize i = 0; i < heap->buffers_len && index < 0; i++) {
+		index = find_free(&heap->buffers[i], block_size);
+	}
+	if (index < 0) {
+		isize buffer_index = add_buffer(heap, block_size);
+		if (buffer_index < 0) {
+			gl_log_err("ERROR: gpu heap %s: out of memory for %li bytes, all %i buffers are full\n", heap->name,
+			           (long)size, GPU_HEAP_MAX_BUFFERS);
+			return -1;
+		}
+		/* find_free rounds up to the next class, which the new buffer's one block may fall short of */
+		index = heap->buffers[buffer_index].first_block;
+	}
+	assert(index >= 0 && heap->blocks[index].size >= block_size);
+	remove_free(heap, index);
+	split(heap, index, block_size);
+
+	i32 handle;
+	if (heap->unused_allocations >= 0) {
+		handle = heap->unused_allocations;
+		heap->unused_allocations = heap->allocations[handle].next_unused;
+	} else {
+		if (heap->allocations_len == heap->allocations_cap) {
+			heap->allocations_cap = heap->allocations_cap ? heap->allocations_cap * 2 : 256;
+			heap->allocations = realloc(heap->allocations, sizeof(*heap->allocations) * heap->allocations_cap);
+		}
+		handle = (i32)heap->allocations_len++;
+	}
+	struct gpu_heap_block* block = &heap->blocks[index];
+	block->allocation = handle;
+	heap->allocations[handle] = (struct gpu_heap_allocation){
+	    .block = index,
+	    .offset = round_up(block->offset, (u32)alignment),
+	    .size = (u32)size,
+	    .alignment = (u32)alignment,
+	};
+
+	heap->buffers[block->buffer].used += block->size;
+	heap->used += block->size;
+	if (heap->used > heap->peak_used) {
+		heap->peak_used = heap->used;
+	}
+	heap->live++;
+	return handle;
+}
+
+void
+gpu_heap_free(struct gpu_heap* heap, i32 allocation) {
+	assert(allocation >= 0 && allocation < heap->allocations_len);
+	struct gpu_heap_allocation* a = &heap->allocations[allocation];
+	assert(a->block >= 0);
+	struct gpu_heap_block* block = &heap->blocks[a->block];
+	heap->buffers[block->buffer].used -= block->size;
+	heap->used -= block->size;
+	heap->live--;
+	merge_free(heap, a->block);
+	a->block = -1;
+	a->next_unused = heap->unused_allocations;
+	heap->unused_allocations = allocation;
+}
+
+void
+gpu_heap_upload(struct gpu_heap* heap, i32 allocation, isize offset, isize size, const void* data) {
+	const struct gpu_heap_allocation* a = &heap->allocations[allocation];
+	assert(a->block >= 0 && offset >= 0 && offset + size <= a->size);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, heap->buffers[heap->blocks[a->block].buffer].buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, a->offset + offset, size, data);
+}
+
+struct gpu_heap_range
+gpu_heap_range(const struct gpu_heap* heap, i32 allocation) {
+	const struct gpu_heap_allocation* a = &heap->allocations[allocation];
+	assert(a->block >= 0);
+	i32 buffer_index = heap->blocks[a->block].buffer;
+	return (struct gpu_heap_range){
+	    .buffer_index = buffer_index,
+	    .buffer = heap->buffers[buffer_index].buffer,
+	    .offset = a->offset,
+	    .size = a->size,
+	};
+}
+
+GLint
+gpu_heap_base_vertex(const struct gpu_heap* heap, i32 allocation, isize stride) {
+	const struct gpu_heap_allocation* a = &heap->allocations[allocation];
+	assert(a->block >= 0 && a->offset % stride == 0);
+	return (GLint)(a->offset / stride);
+}
+
+static void
+copy_range(struct gpu_heap* heap, GLuint buffer, u32 from, u32 to, u32 size) {
+	if (to + size <= from) {
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, to, size);
+		return;
+	}
+	/* copies within one buffer may not overlap */
+	if (heap->scratch_size < size) {
+		GPU_MEM_OWNER(heap->name);
+		if (!heap->scratch) {
+			glGenBuffers(1, &heap->scratch);
+		}
+		heap->scratch_size = size;
+		glBindBuffer(GL_COPY_WRITE_BUFFER, heap->scratch);
+		glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_COPY);
+	}
+	glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, heap->scratch);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, 0, size);
+	glBindBuffer(GL_COPY_READ_BUFFER, heap->scratch);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to, size);
+}
+
+/* swaps a free block with the allocated block after it; returns the bytes copied */
+static u32
+move_down(struct gpu_heap* heap, i32 hole_index, i32 block_index) {
+	struct gpu_heap_block* hole = &heap->blocks[hole_index];
+	struct gpu_heap_block* block = &heap->blocks[block_index];
+	struct gpu_heap_buffer* buffer = &heap->buffers[block->buffer];
+	struct gpu_heap_allocation* a = &heap->allocations[block->allocation];
+
+	/* the padding reserved at allocation covers any new offset, the block keeps its size */
+	u32 offset = round_up(hole->offset, a->alignment);
+	u32 copied = 0;
+	if (offset != a->offset) {
+		copy_range(heap, buffer->buffer, a->offset, offset, a->size);
+		copied = a->size;
+	}
+	a->offset = offset;
+
+	remove_free(heap, hole_index);
+	i32 prev = hole->prev_phys;
+	i32 next = block->next_phys;
+	block->offset = hole->offset;
+	hole->offset = block->offset + block->size;
+	block->prev_phys = prev;
+	block->next_phys = hole_index;
+	hole->prev_phys = block_index;
+	hole->next_phys = next;
+	if (prev >= 0) {
+		heap->blocks[prev].next_phys = block_index;
+	} else {
+		buffer->first_block = block_index;
+	}
+	if (next >= 0) {
+		heap->blocks[next].prev_phys = hole_index;
+	}
+	merge_free(heap, hole_index);
+	return copied;
+}
+
+isize
+gpu_heap_defragment(struct gpu_heap* heap, isize max_bytes) {
+	isize moved = 0;
+	for (isize i = 0; i < heap->buffers_len && moved < max_bytes; i++) {
+		i32 index = heap->buffers[i].first_block;
+		while (index >= 0 && moved < max_bytes) {
+			const struct gpu_heap_block* block = &heap->blocks[index];
+			/* free blocks never neighbour each other, so a free block with a successor is a hole */
+			if (block->allocation >= 0 || block->next_phys < 0) {
+				index = block->next_phys;
+				continue;
+			}
+			/* the hole now follows the moved block, merged with any free space after it */
+			moved += move_down(heap, index, block->next_phys);
+		}
+	}
+	heap->moved_bytes += moved;
+	return moved;
+}
+
+void
+gpu_heap_log(const struct gpu_heap* heap) {
+	const double mb = 1024.0 * 1024.0;
+	isize size = 0;
+	for (isize i = 0; i < heap->buffers_len; i++) {
+		size += heap->buffers[i].size;
+	}
+	gl_log("gpu heap %s: %li allocations, %.2f of %.2f MB used (peak %.2f MB), %.2f MB moved by defragmentation\n",
+	       heap->name, (long)heap->live, heap->used / mb, size / mb, heap->peak_used / mb, heap->moved_bytes / mb);
+	for (isize i = 0; i < heap->buffers_len; i++) {
+		const struct gpu_heap_buffer* buffer = &heap->buffers[i];
+		isize free_ranges = 0;
+		u32 largest = 0;
+		for (i32 index = buffer->first_block; index >= 0; index = heap->blocks[index].next_phys) {
+			const struct gpu_heap_block* block = &heap->blocks[index];
+			if (block->allocation < 0) {
+				free_ranges++;
+				largest = block->size > largest ? block->size : largest;
+			}
+		}
+		gl_log("  buffer %li: %.2f MB, %.2f MB used, %li free ranges, largest %.2f MB\n", (long)i, buffer->size / mb,
+		       buffer->used / mb, (long)free_ranges, largest / mb);
+	}
+}
@@ -0,0 +1,89 @@
+#ifndef GPU_HEAP_H
+#define GPU_HEAP_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Suballocator for vertex and index data.
+ * A heap reserves a few large buffer objects and hands out ranges of them, so thousands of meshes
+ * share a handful of buffers (and vertex arrays) instead of owning one each. Free ranges are kept
+ * by a two-level segregated fit allocator (TLSF): size classes are powers of two split into
+ * GPU_HEAP_SL_COUNT linear steps, and two bitmaps find a free range of a fitting class in constant
+ * time. Freed ranges merge with their free neighbours immediately.
+ *
+ * Allocations are handles, their ranges may move: gpu_heap_defragment() slides live ranges towards
+ * the start of their buffer with glCopyBufferSubData. The buffer objects themselves never change,
+ * so vertex arrays stay valid; read offsets with gpu_heap_range() when drawing. Aligning an
+ * allocation to the vertex stride keeps its offset usable as a base vertex (gpu_heap_base_vertex). */
+
+#define GPU_HEAP_MAX_BUFFERS 8
+#define GPU_HEAP_ALIGNMENT 16 /* granularity of every range */
+#define GPU_HEAP_SL_LOG2 4
+#define GPU_HEAP_SL_COUNT (1 << GPU_HEAP_SL_LOG2)
+#define GPU_HEAP_FL_COUNT 25 /* size classes up to 2 GB */
+
+struct gpu_heap_block;
+struct gpu_heap_allocation;
+
+struct gpu_heap_buffer {
+	GLuint buffer;
+	u32 size;
+	u32 used;        /* bytes in allocated blocks, alignment padding included */
+	i32 first_block; /* at offset 0, the blocks are chained in address order from it */
+	u32 fl_bitmap;   /* first-level classes with a non-empty free list */
+	u32 sl_bitmap[GPU_HEAP_FL_COUNT];
+	i32 free_lists[GPU_HEAP_FL_COUNT][GPU_HEAP_SL_COUNT]; /* block indices, -1 when empty */
+};
+
+struct gpu_heap {
+	const char* name;
+	u32 buffer_size;
+	struct gpu_heap_buffer buffers[GPU_HEAP_MAX_BUFFERS];
+	isize buffers_len;
+
+	struct gpu_heap_block* blocks; /* of every buffer; unused records are chained */
+	isize blocks_len;
+	isize blocks_cap;
+	i32 unused_blocks;
+	struct gpu_heap_allocation* allocations;
+	isize allocations_len;
+	isize allocations_cap;
+	i32 unused_allocations;
+
+	GLuint scratch; /* staging for moves whose source and destination overlap */
+	isize scratch_size;
+
+	isize live;
+	isize used; /* bytes in allocated blocks over all buffers */
+	isize peak_used;
+	isize moved_bytes;
+};
+
+struct gpu_heap_range {
+	isize buffer_index;
+	GLuint buffer;
+	isize offset; /* bytes from the start of buffer */
+	isize size;
+};
+
+/* buffer_size is the size of each buffer object; requests larger than it get a buffer of their own */
+void gpu_heap_init(struct gpu_heap* heap, const char* name, isize buffer_size);
+void gpu_heap_shutdown(struct gpu_heap* heap);
+
+/* alignment need not be a power of two, pass the vertex stride for base-vertex draws; -1 when full */
+i32 gpu_heap_alloc(struct gpu_heap* heap, isize size, isize alignment);
+void gpu_heap_free(struct gpu_heap* heap, i32 allocation);
+/* glBufferSubData into the range, through GL_COPY_WRITE_BUFFER so no vertex array state changes */
+void gpu_heap_upload(struct gpu_heap* heap, i32 allocation, isize offset, isize size, const void* data);
+
+struct gpu_heap_range gpu_heap_range(const struct gpu_heap* heap, i32 allocation);
+/* offset / stride, for glDrawElementsBaseVertex with attributes starting at offset 0 of the buffer */
+GLint gpu_heap_base_vertex(const struct gpu_heap* heap, i32 allocation, isize stride);
+
+/* moves live ranges down over the free space before them until max_bytes have been copied; returns
+ * the bytes copied, 0 once every buffer is compact */
+isize gpu_heap_defragment(struct gpu_heap* heap, isize max_bytes);
+void gpu_heap_log(const struct gpu_heap* heap);
+
+#endif
@@ -0,0 +1,684 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "gpu_memory.h"
+#include "ktx.h"
+
+#define GPU_MEM_MAX_LEVELS 16
+#define GPU_MEM_MAX_OWNERS 32
+#define GPU_MEM_TEXTURE_UNITS 32
+#define GPU_MEM_LEAKS_LOGGED 64
+
+enum {
+	SLOT_EMPTY,
+	SLOT_LIVE,
+	SLOT_DELETED, /* tombstone, keeps probe chains intact */
+};
+
+/* texture targets that have their own binding per unit, GL_TEXTURE_CUBE_MAP faces map to the cube */
+enum {
+	TEXTURE_TARGET_2D,
+	TEXTURE_TARGET_2D_ARRAY,
+	TEXTURE_TARGET_3D,
+	TEXTURE_TARGET_CUBE,
+	TEXTURE_TARGET_CUBE_ARRAY,
+	TEXTURE_TARGET_2D_MULTISAMPLE,
+	TEXTURE_TARGET_RECTANGLE,
+	TEXTURE_TARGETS,
+};
+
+/* binding points followed for glBufferData; GL_ELEMENT_ARRAY_BUFFER is vertex array state */
+static const GLenum buffer_targets[] = {
+    GL_ARRAY_BUFFER,
+    GL_ELEMENT_ARRAY_BUFFER,
+    GL_PIXEL_PACK_BUFFER,
+    GL_PIXEL_UNPACK_BUFFER,
+    GL_UNIFORM_BUFFER,
+    GL_COPY_READ_BUFFER,
+    GL_COPY_WRITE_BUFFER,
+    GL_TEXTURE_BUFFER,
+    GL_TRANSFORM_FEEDBACK_BUFFER,
+    GL_DRAW_INDIRECT_BUFFER,
+    GL_SHADER_STORAGE_BUFFER,
+    GL_DISPATCH_INDIRECT_BUFFER,
+    GL_ATOMIC_COUNTER_BUFFER,
+    GL_QUERY_BUFFER,
+};
+
+/* what a call does to the registry; argument positions are fixed per kind */
+enum rule_kind {
+	RULE_BIND_BUFFER,             /* (target, buffer) */
+	RULE_BIND_BUFFER_INDEXED,     /* (target, index, buffer, ...) */
+	RULE_BIND_TEXTURE,            /* (target, texture) */
+	RULE_ACTIVE_TEXTURE,          /* (unit) */
+	RULE_BIND_RENDERBUFFER,       /* (target, renderbuffer) */
+	RULE_BIND_VERTEX_ARRAY,       /* (array) */
+	RULE_BUFFER_DATA,             /* (target, size, ...) */
+	RULE_TEX_IMAGE_2D,            /* (target, level, internalformat, width, height, ...) */
+	RULE_TEX_IMAGE_3D,            /* (target, level, internalformat, width, height, depth, ...) */
+	RULE_COMPRESSED_IMAGE_2D,     /* (target, level, internalformat, width, height, border, size, data) */
+	RULE_TEX_STORAGE_2D,          /* (target, levels, internalformat, width, height) */
+	RULE_TEX_STORAGE_3D,          /* (target, levels, internalformat, width, height, depth) */
+	RULE_TEX_STORAGE_2D_MS,       /* (target, samples, internalformat, width, height, ...) */
+	RULE_RENDERBUFFER_STORAGE,    /* (target, internalformat, width, height) */
+	RULE_RENDERBUFFER_STORAGE_MS, /* (target, samples, internalformat, width, height) */
+};
+
+struct gpu_mem_rule {
+	const char* name;
+	u8 kind;
+};
+
+static const struct gpu_mem_object_call object_calls[] = {
+    {"glGenBuffers", GPU_MEM_GEN, GPU_MEM_BUFFER},
+    {"glGenTextures", GPU_MEM_GEN, GPU_MEM_TEXTURE},
+    {"glGenRenderbuffers", GPU_MEM_GEN, GPU_MEM_RENDERBUFFER},
+    {"glGenVertexArrays", GPU_MEM_GEN, GPU_MEM_VERTEX_ARRAY},
+    {"glGenFramebuffers", GPU_MEM_GEN, GPU_MEM_FRAMEBUFFER},
+    {"glGenQueries", GPU_MEM_GEN, GPU_MEM_QUERY},
+    {"glDeleteBuffers", GPU_MEM_DELETE, GPU_MEM_BUFFER},
+    {"glDeleteTextures", GPU_MEM_DELETE, GPU_MEM_TEXTURE},
+    {"glDeleteRenderbuffers", GPU_MEM_DELETE, GPU_MEM_RENDERBUFFER},
+    {"glDeleteVertexArrays", GPU_MEM_DELETE, GPU_MEM_VERTEX_ARRAY},
+    {"glDeleteFramebuffers", GPU_MEM_DELETE, GPU_MEM_FRAMEBUFFER},
+    {"glDeleteQueries", GPU_MEM_DELETE, GPU_MEM_QUERY},
+    {"glCreateShader", GPU_MEM_CREATE, GPU_MEM_SHADER},
+    {"glCreateProgram", GPU_MEM_CREATE, GPU_MEM_PROGRAM},
+    {"glFenceSync", GPU_MEM_CREATE, GPU_MEM_SYNC},
+    {"glDeleteShader", GPU_MEM_DELETE_ONE, GPU_MEM_SHADER},
+    {"glDeleteProgram", GPU_MEM_DELETE_ONE, GPU_MEM_PROGRAM},
+    {"glDeleteSync", GPU_MEM_DELETE_ONE, GPU_MEM_SYNC},
+};
+
+static const struct gpu_mem_rule gpu_mem_rules[] = {
+    {"glBindBuffer", RULE_BIND_BUFFER},
+    {"glBindBufferBase", RULE_BIND_BUFFER_INDEXED},
+    {"glBindBufferRange", RULE_BIND_BUFFER_INDEXED},
+    {"glBindTexture", RULE_BIND_TEXTURE},
+    {"glActiveTexture", RULE_ACTIVE_TEXTURE},
+    {"glBindRenderbuffer", RULE_BIND_RENDERBUFFER},
+    {"glBindVertexArray", RULE_BIND_VERTEX_ARRAY},
+
+    {"glBufferData", RULE_BUFFER_DATA},
+    {"glBufferStorage", RULE_BUFFER_DATA},
+    {"glTexImage2D", RULE_TEX_IMAGE_2D},
+    {"glTexImage3D", RULE_TEX_IMAGE_3D},
+    {"glCompressedTexImage2D", RULE_COMPRESSED_IMAGE_2D},
+    {"glTexStorage2D", RULE_TEX_STORAGE_2D},
+    {"glTexStorage3D", RULE_TEX_STORAGE_3D},
+    {"glTexStorage2DMultisample", RULE_TEX_STORAGE_2D_MS},
+    {"glRenderbufferStorage", RULE_RENDERBUFFER_STORAGE},
+    {"glRenderbufferStorageMultisample", RULE_RENDERBUFFER_STORAGE_MS},
+};
+
+static const char* kind_names[GPU_MEM_KINDS] = {
+    [GPU_MEM_BUFFER] = "buffer",
+    [GPU_MEM_TEXTURE] = "texture",
+    [GPU_MEM_RENDERBUFFER] = "renderbuffer",
+    [GPU_MEM_VERTEX_ARRAY] = "vertex array",
+    [GPU_MEM_FRAMEBUFFER] = "framebuffer",
+    [GPU_MEM_SHADER] = "shader",
+    [GPU_MEM_PROGRAM] = "program",
+    [GPU_MEM_QUERY] = "query",
+    [GPU_MEM_SYNC] = "sync",
+};
+
+struct gpu_object {
+	u64 name; /* GLsync handles are pointers */
+	u8 kind;
+	u8 slot;
+	const char* owner;
+	long frame;
+	i64 bytes;
+	GLuint element_buffer;               /* vertex arrays */
+	i64 level_bytes[GPU_MEM_MAX_LEVELS]; /* textures, all faces and layers */
+};
+
+struct gpu_mem_owner {
+	const char* name;
+	isize count;
+	i64 bytes;
+	i64 peak_bytes;
+};
+
+static struct {
+	b32 ok;
+	const struct gpu_mem_rule** rules;               /* per entry point */
+	const struct gpu_mem_object_call** object_calls; /* per entry point */
+	const char* owner;
+	long frame;
+
+	struct gpu_object* objects; /* open addressing, power of two */
+	isize capacity;
+	isize used; /* live and deleted slots */
+
+	struct gpu_mem_category categories[GPU_MEM_KINDS];
+	struct gpu_mem_owner owners[GPU_MEM_MAX_OWNERS];
+	isize owners_len;
+	i64 bytes;
+	i64 peak_bytes;
+
+	GLuint buffers[ARRAY_SIZE(buffer_targets)];
+	int texture_unit;
+	GLuint textures[GPU_MEM_TEXTURE_UNITS][TEXTURE_TARGETS];
+	GLuint renderbuffer;
+	GLuint vertex_array;
+} mem = {.owner = "untagged"};
+
+//////////////////////////////////////
+// formats
+isize
+gpu_mem_texel_bytes(GLenum internal_format) {
+	switch (internal_format) {
+		case GL_RED:
+		case GL_R8:
+		case GL_R8I:
+		case GL_R8UI:
+		case GL_R8_SNORM:
+		case GL_STENCIL_INDEX8:
+			return 1;
+		case GL_RG:
+		case GL_RG8:
+		case GL_RG8I:
+		case GL_RG8UI:
+		case GL_R16:
+		case GL_R16F:
+		case GL_R16I:
+		case GL_R16UI:
+		case GL_DEPTH_COMPONENT16:
+			return 2;
+		case GL_RGB:
+		case GL_RGB8:
+		case GL_SRGB8:
+		case GL_RGB8I:
+		case GL_RGB8UI:
+			return 3;
+		case GL_RGB16F:
+		case GL_RGB16I:
+		case GL_RGB16UI:
+			return 6;
+		case GL_RGBA16:
+		case GL_RGBA16F:
+		case GL_RGBA16I:
+		case GL_RGBA16UI:
+		case GL_RG32F:
+		case GL_RG32I:
+		case GL_RG32UI:
+		case GL_DEPTH32F_STENCIL8:
+			return 8;
+		case GL_RGB32F:
+		case GL_RGB32I:
+		case GL_RGB32UI:
+			return 12;
+		case GL_RGBA32F:
+		case GL_RGBA32I:
+		case GL_RGBA32UI:
+			return 16;
+		default:
+			return ktx_format_block_bytes(internal_format) ? 0 : 4;
+	}
+}
+
+i64
+gpu_mem_image_bytes(GLenum internal_format, int width, int height) {
+	isize block_bytes = ktx_format_block_bytes(internal_format);
+	if (block_bytes) {
+		return (i64)((width + 3) / 4) * ((height + 3) / 4) * block_bytes;
+	}
+	return (i64)width * height * gpu_mem_texel_bytes(internal_format);
+}
+
+static int
+texture_target_index(GLenum target) {
+	switch (target) {
+		case GL_TEXTURE_2D:
+			return TEXTURE_TARGET_2D;
+		case GL_TEXTURE_2D_ARRAY:
+			return TEXTURE_TARGET_2D_ARRAY;
+		case GL_TEXTURE_3D:
+			return TEXTURE_TARGET_3D;
+		case GL_TEXTURE_CUBE_MAP:
+		case GL_TEXTURE_CUBE_MAP_POSITIVE_X:
+		case GL_TEXTURE_CUBE_MAP_NEGATIVE_X:
+		case GL_TEXTURE_CUBE_MAP_POSITIVE_Y:
+		case GL_TEXTURE_CUBE_MAP_NEGATIVE_Y:
+		case GL_TEXTURE_CUBE_MAP_POSITIVE_Z:
+		case GL_TEXTURE_CUBE_MAP_NEGATIVE_Z:
+			return TEXTURE_TARGET_CUBE;
+		case GL_TEXTURE_CUBE_MAP_ARRAY:
+			return TEXTURE_TARGET_CUBE_ARRAY;
+		case GL_TEXTURE_2D_MULTISAMPLE:
+			return TEXTURE_TARGET_2D_MULTISAMPLE;
+		case GL_TEXTURE_RECTANGLE:
+			return TEXTURE_TARGET_RECTANGLE;
+		default:
+			return -1; /* proxies and targets the renderer does not use */
+	}
+}
+
+static int
+buffer_target_index(GLenum target) {
+	for (isize i = 0; i < ARRAY_SIZE(buffer_targets); i++) {
+		if (buffer_targets[i] == target) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+//////////////////////////////////////
+// objects
+static u64
+object_hash(u8 kind, u64 name) {
+	u64 h = (name ^ ((u64)kind << 56)) * 0x9e3779b97f4a7c15ull;
+	return h ^ (h >> 29);
+}
+
+static struct gpu_object*
+find_object(u8 kind, u64 name) {
+	if (!mem.capacity || !name) {
+		return NULL;
+	}
+	for (isize i = object_hash(kind, name) & (mem.capacity - 1);; i = (i + 1) & (mem.capacity - 1)) {
+		struct gpu_object* object = &mem.objects[i];
+		if (object->slot == SLOT_EMPTY) {
+			return NULL;
+		}
+		if (object->slot == SLOT_LIVE && object->kind == kind && object->name == name) {
+			return object;
+		}
+	}
+}
+
+static void
+insert_slot(struct gpu_object* objects, isize capacity, const struct gpu_object* object) {
+	for (isize i = object_hash(object->kind, object->name) & (capacity - 1);; i = (i + 1) & (capacity - 1)) {
+		if (objects[i].slot != SLOT_LIVE) {
+			objects[i] = *object;
+			return;
+		}
+	}
+}
+
+/* rehashes when live and deleted slots pass 3/4, growing only if live objects alone pass 3/8 */
+static void
+reserve_slot(void) {
+	if ((mem.used + 1) * 4 < mem.capacity * 3) {
+		return;
+	}
+	isize live = 0;
+	for (int k = 0; k < GPU_MEM_KINDS; k++) {
+		live += mem.categories[k].count;
+	}
+	isize capacity = mem.capacity ? mem.capacity : 1024;
+	while ((live + 1) * 8 >= capacity * 3) {
+		capacity *= 2;
+	}
+	struct gpu_object* objects = calloc(capacity, sizeof(*objects));
+	for (isize i = 0; i < mem.capacity; i++) {
+		if (mem.objects[i].slot == SLOT_LIVE) {
+			insert_slot(objects, capacity, &mem.objects[i]);
+		}
+	}
+	free(mem.objects);
+	mem.objects = objects;
+	mem.capacity = capacity;
+	mem.used = live;
+}
+
+static struct gpu_mem_owner*
+find_owner(const char* name) {
+	for (isize i = 0; i < mem.owners_len; i++) {
+		if (mem.owners[i].name == name || strcmp(mem.owners[i].name, name) == 0) {
+			return &mem.owners[i];
+		}
+	}
+	if (mem.owners_len == GPU_MEM_MAX_OWNERS) {
+		return &mem.owners[GPU_MEM_MAX_OWNERS - 1]; /* lumped in with the last one */
+	}
+	mem.owners[mem.owners_len].name = name;
+	return &mem.owners[mem.owners_len++];
+}
+
+static void
+add_bytes(struct gpu_object* object, i64 delta) {
+	object->bytes += delta;
+	struct gpu_mem_category* category = &mem.categories[object->kind];
+	category->bytes += delta;
+	category->peak_bytes = category->bytes > category->peak_bytes ? category->bytes : category->peak_bytes;
+	struct gpu_mem_owner* owner = find_owner(object->owner);
+	owner->bytes += delta;
+	owner->peak_bytes = owner->bytes > owner->peak_bytes ? owner->bytes : owner->peak_bytes;
+	mem.bytes += delta;
+	mem.peak_bytes = mem.bytes > mem.peak_bytes ? mem.bytes : mem.peak_bytes;
+}
+
+static void
+add_object(u8 kind, u64 name) {
+	if (!name || find_object(kind, name)) {
+		return;
+	}
+	reserve_slot();
+	struct gpu_object object = {.name = name, .kind = kind, .slot = SLOT_LIVE, .owner = mem.owner, .frame = mem.frame};
+	insert_slot(mem.objects, mem.capacity, &object);
+	mem.used++;
+	struct gpu_mem_category* category = &mem.categories[kind];
+	category->count++;
+	category->created++;
+	category->peak_count = category->count > category->peak_count ? category->count : category->peak_count;
+	find_owner(mem.owner)->count++;
+}
+
+static void
+remove_object(u8 kind, u64 name) {
+	struct gpu_object* object = find_object(kind, name);
+	if (!object) {
+		return;
+	}
+	add_bytes(object, -object->bytes);
+	mem.categories[kind].count--;
+	find_owner(object->owner)->count--;
+	object->slot = SLOT_DELETED;
+
+	/* deleting a bound object unbinds it */
+	if (kind == GPU_MEM_BUFFER) {
+		for (isize i = 0; i < ARRAY_SIZE(mem.buffers); i++) {
+			mem.buffers[i] = mem.buffers[i] == name ? 0 : mem.buffers[i];
+		}
+	} else if (kind == GPU_MEM_TEXTURE) {
+		for (int unit = 0; unit < GPU_MEM_TEXTURE_UNITS; unit++) {
+			for (int t = 0; t < TEXTURE_TARGETS; t++) {
+				mem.textures[unit][t] = mem.textures[unit][t] == name ? 0 : mem.textures[unit][t];
+			}
+		}
+	} else if (kind == GPU_MEM_RENDERBUFFER && mem.renderbuffer == name) {
+		mem.renderbuffer = 0;
+	} else if (kind == GPU_MEM_VERTEX_ARRAY && mem.vertex_array == name) {
+		mem.vertex_array = 0;
+	}
+}
+
+static struct gpu_object*
+bound_buffer(GLenum target) {
+	int index = buffer_target_index(target);
+	return index < 0 ? NULL : find_object(GPU_MEM_BUFFER, mem.buffers[index]);
+}
+
+static struct gpu_object*
+bound_texture(GLenum target) {
+	int index = texture_target_index(target);
+	return index < 0 ? NULL : find_object(GPU_MEM_TEXTURE, mem.textures[mem.texture_unit][index]);
+}
+
+static void
+set_level_bytes(struct gpu_object* texture, int level, i64 bytes) {
+	if (!texture || level < 0 || level >= GPU_MEM_MAX_LEVELS) {
+		return;
+	}
+	add_bytes(texture, bytes - texture->level_bytes[level]);
+	texture->level_bytes[level] = bytes;
+}
+
+/* immutable storage replaces every level */
+static void
+set_storage(struct gpu_object* texture, int levels, GLenum internal_format, int width, int height, int layers) {
+	if (!texture) {
+		return;
+	}
+	for (int level = 0; level < GPU_MEM_MAX_LEVELS; level++) {
+		i64 bytes = 0;
+		if (level < levels) {
+			int w = width >> level > 0 ? width >> level : 1;
+			int h = height >> level > 0 ? height >> level : 1;
+			bytes = gpu_mem_image_bytes(internal_format, w, h) * layers;
+		}
+		set_level_bytes(texture, level, bytes);
+	}
+}
+
+static void
+object_call(const struct gpu_mem_object_call* call, const u64* args, u64 ret) {
+	switch (call->op) {
+		case GPU_MEM_GEN: {
+			const GLuint* names = (const GLuint*)(uintptr_t)args[1];
+			for (i32 i = 0; names && i < (i32)args[0]; i++) {
+				add_object(call->kind, names[i]);
+			}
+			break;
+		}
+		case GPU_MEM_DELETE: {
+			const GLuint* names = (const GLuint*)(uintptr_t)args[1];
+			for (i32 i = 0; names && i < (i32)args[0]; i++) {
+				remove_object(call->kind, names[i]);
+			}
+			break;
+		}
+		case GPU_MEM_CREATE:
+			add_object(call->kind, ret);
+			break;
+		case GPU_MEM_DELETE_ONE:
+			remove_object(call->kind, args[0]);
+			break;
+	}
+}
+
+static void
+gpu_mem_after(int fn, const u64* args, u64 ret) {
+	if (mem.object_calls[fn]) {
+		object_call(mem.object_calls[fn], args, ret);
+		return;
+	}
+	const struct gpu_mem_rule* rule = mem.rules[fn];
+	if (!rule) {
+		return;
+	}
+	switch (rule->kind) {
+		case RULE_BIND_BUFFER:
+		case RULE_BIND_BUFFER_INDEXED: {
+			int index = buffer_target_index((GLenum)args[0]);
+			GLuint buffer = (GLuint)args[rule->kind == RULE_BIND_BUFFER ? 1 : 2];
+			if (index >= 0) {
+				mem.buffers[index] = buffer;
+			}
+			struct gpu_object* vertex_array = find_object(GPU_MEM_VERTEX_ARRAY, mem.vertex_array);
+			if (args[0] == GL_ELEMENT_ARRAY_BUFFER && vertex_array) {
+				vertex_array->element_buffer = buffer;
+			}
+			break;
+		}
+		case RULE_BIND_TEXTURE: {
+			int index = texture_target_index((GLenum)args[0]);
+			if (index >= 0) {
+				mem.textures[mem.texture_unit][index] = (GLuint)args[1];
+			}
+			break;
+		}
+		case RULE_ACTIVE_TEXTURE: {
+			int unit = (int)(args[0] - GL_TEXTURE0);
+			mem.texture_unit = unit >= 0 && unit < GPU_MEM_TEXTURE_UNITS ? unit : 0;
+			break;
+		}
+		case RULE_BIND_RENDERBUFFER:
+			mem.renderbuffer = (GLuint)args[1];
+			break;
+		case RULE_BIND_VERTEX_ARRAY: {
+			mem.vertex_array = (GLuint)args[0];
+			struct gpu_object* vertex_array = find_object(GPU_MEM_VERTEX_ARRAY, mem.vertex_array);
+			mem.buffers[buffer_target_index(GL_ELEMENT_ARRAY_BUFFER)] = vertex_array ? vertex_array->element_buffer : 0;
+			break;
+		}
+		case RULE_BUFFER_DATA: {
+			struct gpu_object* buffer = bound_buffer((GLenum)args[0]);
+			if (buffer) {
+				add_bytes(buffer, (i64)args[1] - buffer->bytes);
+			}
+			break;
+		}
+		case RULE_TEX_IMAGE_2D:
+		case RULE_TEX_IMAGE_3D:
+		case RULE_COMPRESSED_IMAGE_2D: {
+			GLenum target = (GLenum)args[0];
+			i64 bytes = rule->kind == RULE_COMPRESSED_IMAGE_2D
+			                ? (i32)args[6]
+			                : gpu_mem_image_bytes((GLenum)args[2], (i32)args[3], (i32)args[4]) *
+			                      (rule->kind == RULE_TEX_IMAGE_3D ? (i32)args[5] : 1);
+			b32 face = texture_target_index(target) == TEXTURE_TARGET_CUBE && target != GL_TEXTURE_CUBE_MAP;
+			set_level_bytes(bound_texture(target), (i32)args[1], face ? bytes * 6 : bytes);
+			break;
+		}
+		case RULE_TEX_STORAGE_2D:
+		case RULE_TEX_STORAGE_3D: {
+			GLenum target = (GLenum)args[0];
+			int layers = rule->kind == RULE_TEX_STORAGE_3D ? (i32)args[5] : target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+			set_storage(bound_texture(target), (i32)args[1], (GLenum)args[2], (i32)args[3], (i32)args[4], layers);
+			break;
+		}
+		case RULE_TEX_STORAGE_2D_MS:
+			set_storage(bound_texture((GLenum)args[0]), 1, (GLenum)args[2], (i32)args[3], (i32)args[4], (i32)args[1]);
+			break;
+		case RULE_RENDERBUFFER_STORAGE:
+		case RULE_RENDERBUFFER_STORAGE_MS: {
+			struct gpu_object* renderbuffer = find_object(GPU_MEM_RENDERBUFFER, mem.renderbuffer);
+			const u64* a = rule->kind == RULE_RENDERBUFFER_STORAGE ? args + 1 : args + 2;
+			int samples = rule->kind == RULE_RENDERBUFFER_STORAGE_MS && (i32)args[1] > 1 ? (i32)args[1] : 1;
+			if (renderbuffer) {
+				add_bytes(renderbuffer,
+				          gpu_mem_image_bytes((GLenum)a[0], (i32)a[1], (i32)a[2]) * samples - renderbuffer->bytes);
+			}
+			break;
+		}
+	}
+}
+
+//////////////////////////////////////
+// interface
+const struct gpu_mem_object_call*
+gpu_mem_find_object_call(const char* name) {
+	for (isize i = 0; i < ARRAY_SIZE(object_calls); i++) {
+		if (strcmp(name, object_calls[i].name) == 0) {
+			return &object_calls[i];
+		}
+	}
+	return NULL;
+}
+
+void
+gpu_mem_init(void) {
+	memset(&mem, 0, sizeof(mem));
+	mem.owner = "untagged";
+	mem.rules = calloc(gl_loader_count, sizeof(*mem.rules));
+	mem.object_calls = calloc(gl_loader_count, sizeof(*mem.object_calls));
+	for (int fn = 0; fn < gl_loader_count; fn++) {
+		mem.object_calls[fn] = gpu_mem_find_object_call(gl_loader_signatures[fn].name);
+		for (isize r = 0; r < ARRAY_SIZE(gpu_mem_rules); r++) {
+			if (strcmp(gl_loader_signatures[fn].name, gpu_mem_rules[r].name) == 0) {
+				mem.rules[fn] = &gpu_mem_rules[r];
+			}
+		}
+	}
+	if (!gl_loader_add_hooks(NULL, gpu_mem_after)) {
+		gl_log_err("ERROR: gpu memory: no free loader hook, GL objects are not tracked\n");
+		free(mem.rules);
+		free(mem.object_calls);
+		return;
+	}
+	mem.ok = 1;
+}
+
+void
+gpu_mem_shutdown(void) {
+	if (!mem.ok) {
+		return;
+	}
+	gl_loader_remove_hooks(NULL, gpu_mem_after);
+	free(mem.rules);
+	free(mem.object_calls);
+	free(mem.objects);
+	memset(&mem, 0, sizeof(mem));
+	mem.owner = "untagged";
+}
+
+void
+gpu_mem_set_frame(long frame) {
+	mem.frame = frame;
+}
+
+const char*
+gpu_mem_set_owner(const char* owner) {
+	const char* previous = mem.owner;
+	mem.owner = owner ? owner : "untagged";
+	return previous;
+}
+
+const char*
+gpu_mem_owner(void) {
+	return mem.owner;
+}
+
+const char*
+gpu_mem_kind_name(enum gpu_mem_kind kind) {
+	return kind_names[kind];
+}
+
+const struct gpu_mem_category*
+gpu_mem_category(enum gpu_mem_kind kind) {
+	return &mem.categories[kind];
+}
+
+i64
+gpu_mem_total_bytes(void) {
+	return mem.bytes;
+}
+
+void
+gpu_mem_log(void) {
+	if (!mem.ok) {
+		return;
+	}
+	const double mb = 1024.0 * 1024.0;
+	gl_log("GPU memory: %.2f MB now, %.2f MB peak\n", mem.bytes / mb, mem.peak_bytes / mb);
+	gl_log("  %-16s %8s %8s %8s %10s %10s\n", "kind", "live", "peak", "created", "MB", "peak MB");
+	for (int k = 0; k < GPU_MEM_KINDS; k++) {
+		const struct gpu_mem_category* c = &mem.categories[k];
+		if (c->created == 0) {
+			continue;
+		}
+		gl_log("  %-16s %8li %8li %8li %10.2f %10.2f\n", kind_names[k], (long)c->count, (long)c->peak_count,
+		       (long)c->created, c->bytes / mb, c->peak_bytes / mb);
+	}
+	gl_log("  %-16s %8s %10s %10s\n", "owner", "live", "MB", "peak MB");
+	for (isize i = 0; i < mem.owners_len; i++) {
+		const struct gpu_mem_owner* o = &mem.owners[i];
+		gl_log("  %-16s %8li %10.2f %10.2f\n", o->name, (long)o->count, o->bytes / mb, o->peak_bytes / mb);
+	}
+	gl_log("-----------------------------\n");
+}
+
+isize
+gpu_mem_report_leaks(void) {
+	if (!mem.ok) {
+		return 0;
+	}
+	isize leaks = 0;
+	for (isize i = 0; i < mem.capacity; i++) {
+		const struct gpu_object* object = &mem.objects[i];
+		if (object->slot != SLOT_LIVE) {
+			continue;
+		}
+		if (leaks < GPU_MEM_LEAKS_LOGGED) {
+			gl_log_err("WARNING: leaked %s %lu owned by %s, %li bytes, created in frame %li\n",
+			           kind_names[object->kind], (unsigned long)object->name, object->owner, (long)object->bytes,
+			           object->frame);
+		}
+		leaks++;
+	}
+	if (leaks > GPU_MEM_LEAKS_LOGGED) {
+		gl_log_err("WARNING: %li more leaked objects not listed\n", (long)(leaks - GPU_MEM_LEAKS_LOGGED));
+	}
+	if (leaks) {
+		gl_log_err("WARNING: %li GL objects still alive at shutdown\n", (long)leaks);
+	} else {
+		gl_log("GPU memory: no leaked GL objects\n");
+	}
+	return leaks;
+}
@@ -0,0 +1,93 @@
+#ifndef GPU_MEMORY_H
+#define GPU_MEMORY_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Registry of every live GL object: kind, size, owner tag and the frame it was created in.
+ * After gpu_mem_init(), objects are recorded as the calls that create them return, and sized where
+ * their storage is specified (glBufferData, glTexStorage*, glTexImage*, glRenderbufferStorage*) by
+ * following the buffer, texture and renderbuffer bindings. Sizes are what
+ * the application asked for; drivers may pad or compress.
+ *
+ * New objects take the current owner tag, set for a scope with GPU_MEM_OWNER("name"). Objects
+ * still alive at gpu_mem_report_leaks() are logged with their owner and creation frame. */
+
+enum gpu_mem_kind {
+	GPU_MEM_BUFFER,
+	GPU_MEM_TEXTURE,
+	GPU_MEM_RENDERBUFFER,
+	GPU_MEM_VERTEX_ARRAY,
+	GPU_MEM_FRAMEBUFFER,
+	GPU_MEM_SHADER,
+	GPU_MEM_PROGRAM,
+	GPU_MEM_QUERY,
+	GPU_MEM_SYNC,
+	GPU_MEM_KINDS,
+};
+
+/* entry points that create or delete objects, by their fixed arguments; stats.c counts the same calls */
+enum gpu_mem_object_op {
+	GPU_MEM_GEN,        /* (n, names) */
+	GPU_MEM_DELETE,     /* (n, names) */
+	GPU_MEM_CREATE,     /* returns the name */
+	GPU_MEM_DELETE_ONE, /* (name) */
+};
+
+struct gpu_mem_object_call {
+	const char* name;
+	u8 op;   /* enum gpu_mem_object_op */
+	u8 kind; /* enum gpu_mem_kind */
+};
+
+/* NULL for an entry point that neither creates nor deletes objects */
+const struct gpu_mem_object_call* gpu_mem_find_object_call(const char* name);
+
+struct gpu_mem_category {
+	isize count;
+	isize peak_count;
+	i64 bytes;
+	i64 peak_bytes;
+	isize created;
+};
+
+void gpu_mem_init(void);
+void gpu_mem_shutdown(void);
+
+/* the frame new objects are stamped with */
+void gpu_mem_set_frame(long frame);
+/* returns the previous tag; owner must outlive the registry, string literals are expected */
+const char* gpu_mem_set_owner(const char* owner);
+const char* gpu_mem_owner(void);
+
+const char* gpu_mem_kind_name(enum gpu_mem_kind kind);
+const struct gpu_mem_category* gpu_mem_category(enum gpu_mem_kind kind);
+i64 gpu_mem_total_bytes(void);
+
+/* bytes per texel of a sized internal format, 0 for block-compressed formats */
+isize gpu_mem_texel_bytes(GLenum internal_format);
+/* one image of a level, block-compressed formats included */
+i64 gpu_mem_image_bytes(GLenum internal_format, int width, int height);
+
+/* totals and high-water marks per kind and per owner, to gl.log */
+void gpu_mem_log(void);
+/* logs every object still alive and returns how many */
+isize gpu_mem_report_leaks(void);
+
+struct gpu_mem_owner_scope {
+	const char* previous;
+};
+
+static inline void
+gpu_mem_owner_end(struct gpu_mem_owner_scope* scope) {
+	gpu_mem_set_owner(scope->previous);
+}
+
+#define GPU_MEM_CONCAT_(a, b) a##b
+#define GPU_MEM_CONCAT(a, b) GPU_MEM_CONCAT_(a, b)
+#define GPU_MEM_OWNER(name)                                                                       \
+	struct gpu_mem_owner_scope GPU_MEM_CONCAT(gpu_mem_owner_, __LINE__)                           \
+	    __attribute__((cleanup(gpu_mem_owner_end))) = {gpu_mem_set_owner(name)}
+
+#endif
@@ -0,0 +1,229 @@
+#include "gl_loader.h"
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gpu_memory.h"
+#include "gpu_profiler.h"
+
+#define GPU_PROFILER_MAX_DEPTH 8
+#define GPU_PROFILER_EMA 0.1
+
+struct gpu_zone_record {
+	isize stats_index;
+	int depth;
+	b32 closed;
+};
+
+struct gpu_frame_slot {
+	/* queries[i * 2] / queries[i * 2 + 1] are the begin / end timestamps of records[i] */
+	GLuint queries[GPU_PROFILER_MAX_ZONES * 2];
+	struct gpu_zone_record records[GPU_PROFILER_MAX_ZONES];
+	isize records_len;
+	b32 pending;
+};
+
+static struct {
+	b32 ok;
+	struct gpu_frame_slot slots[GPU_PROFILER_FRAMES];
+	isize current;
+	isize frame_index;
+	isize open[GPU_PROFILER_MAX_DEPTH];
+	isize open_len;
+	isize overflow_depth; /* zones begun past the record/depth limits, ignored but kept balanced */
+	struct gpu_zone_stats stats[GPU_PROFILER_MAX_ZONES];
+	isize stats_len;
+	isize frames_resolved;
+	isize frames_dropped;
+} gpu_profiler;
+
+void
+gpu_profiler_init(void) {
+	GPU_MEM_OWNER("gpu profiler");
+	memset(&gpu_profiler, 0, sizeof(gpu_profiler));
+	GLint bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	if (bits == 0) {
+		gl_log_err("WARNING: GL_TIMESTAMP queries unsupported, GPU profiler disabled\n");
+		return;
+	}
+	for (isize i = 0; i < GPU_PROFILER_FRAMES; i++) {
+		glGenQueries(GPU_PROFILER_MAX_ZONES * 2, gpu_profiler.slots[i].queries);
+	}
+	gpu_profiler.ok = 1;
+	gl_log("gpu profiler: %i frame ring, %i timestamp bits\n", GPU_PROFILER_FRAMES, bits);
+}
+
+void
+gpu_profiler_shutdown(void) {
+	if (!gpu_profiler.ok) {
+		return;
+	}
+	for (isize i = 0; i < GPU_PROFILER_FRAMES; i++) {
+		glDeleteQueries(GPU_PROFILER_MAX_ZONES * 2, gpu_profiler.slots[i].queries);
+	}
+	gpu_profiler.ok = 0;
+}
+
+static isize
+find_stats(const char* name) {
+	for (isize i = 0; i < gpu_profiler.stats_len; i++) {
+		if (gpu_profiler.stats[i].name == name || strcmp(gpu_profiler.stats[i].name, name) == 0) {
+			return i;
+		}
+	}
+	if (gpu_profiler.stats_len == GPU_PROFILER_MAX_ZONES) {
+		return -1;
+	}
+	isize index = gpu_profiler.stats_len++;
+	gpu_profiler.stats[index] = (struct gpu_zone_stats){.name = name, .min_ms = 1e30};
+	return index;
+}
+
+static void
+resolve_slot(struct gpu_frame_slot* slot) {
+	if (!slot->pending) {
+		return;
+	}
+	slot->pending = 0;
+	if (slot->records_len == 0) {
+		return;
+	}
+	/* timestamps complete in order. Record 0 is the "frame" zone, which gpu_profiler_end_frame()
+	 * closes after every other zone, so its end query is the last one issued */
+	GLint available = 0;
+	glGetQueryObjectiv(slot->queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		gpu_profiler.frames_dropped++;
+		return;
+	}
+	for (isize i = 0; i < slot->records_len; i++) {
+		struct gpu_zone_record* record = &slot->records[i];
+		if (!record->closed || record->stats_index < 0) {
+			continue;
+		}
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(slot->queries[i * 2], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(slot->queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+		double ms = (double)(end - begin) / 1e6;
+		struct gpu_zone_stats* stats = &gpu_profiler.stats[record->stats_index];
+		stats->avg_ms = stats->count ? stats->avg_ms + (ms - stats->avg_ms) * GPU_PROFILER_EMA : ms;
+		stats->count++;
+		stats->last_ms = ms;
+		stats->total_ms += ms;
+		stats->min_ms = ms < stats->min_ms ? ms : stats->min_ms;
+		stats->max_ms = ms > stats->max_ms ? ms : stats->max_ms;
+	}
+	gpu_profiler.frames_resolved++;
+}
+
+void
+gpu_profiler_begin_frame(void) {
+	if (!gpu_profiler.ok) {
+		return;
+	}
+	gpu_profiler.current = gpu_profiler.frame_index % GPU_PROFILER_FRAMES;
+	struct gpu_frame_slot* slot = &gpu_profiler.slots[gpu_profiler.current];
+	resolve_slot(slot);
+	slot->records_len = 0;
+	gpu_profiler.open_len = 0;
+	gpu_profiler.overflow_depth = 0;
+	gpu_zone_begin("frame");
+}
+
+void
+gpu_profiler_end_frame(void) {
+	if (!gpu_profiler.ok) {
+		return;
+	}
+	gpu_profiler.overflow_depth = 0;
+	while (gpu_profiler.open_len > 0) {
+		gpu_zone_end();
+	}
+	gpu_profiler.slots[gpu_profiler.current].pending = 1;
+	gpu_profiler.frame_index++;
+}
+
+void
+gpu_zone_begin(const char* name) {
+	if (!gpu_profiler.ok) {
+		return;
+	}
+	struct gpu_frame_slot* slot = &gpu_profiler.slots[gpu_profiler.current];
+	if (slot->records_len == GPU_PROFILER_MAX_ZONES || gpu_profiler.open_len == GPU_PROFILER_MAX_DEPTH ||
+	    gpu_profiler.overflow_depth > 0) {
+		gpu_profiler.overflow_depth++;
+		return;
+	}
+	isize index = slot->records_len++;
+	slot->records[index] = (struct gpu_zone_record){
+	    .stats_index = find_stats(name),
+	    .depth = (int)gpu_profiler.open_len,
+	};
+	gpu_profiler.open[gpu_profiler.open_len++] = index;
+	glQueryCounter(slot->queries[index * 2], GL_TIMESTAMP);
+}
+
+void
+gpu_zone_end(void) {
+	if (!gpu_profiler.ok) {
+		return;
+	}
+	if (gpu_profiler.overflow_depth > 0) {
+		gpu_profiler.overflow_depth--;
+		return;
+	}
+	if (gpu_profiler.open_len == 0) {
+		return;
+	}
+	isize index = gpu_profiler.open[--gpu_profiler.open_len];
+	struct gpu_frame_slot* slot = &gpu_profiler.slots[gpu_profiler.current];
+	glQueryCounter(slot->queries[index * 2 + 1], GL_TIMESTAMP);
+	slot->records[index].closed = 1;
+}
+
+isize
+gpu_profiler_zones(const struct gpu_zone_stats** zones) {
+	*zones = gpu_profiler.stats;
+	return gpu_profiler.stats_len;
+}
+
+void
+gpu_profiler_log(void) {
+	if (!gpu_profiler.ok) {
+		return;
+	}
+	gl_log("GPU zones (%i frames, %i dropped):\n", (int)gpu_profiler.frames_resolved,
+	       (int)gpu_profiler.frames_dropped);
+	for (isize i = 0; i < gpu_profiler.stats_len; i++) {
+		struct gpu_zone_stats* z = &gpu_profiler.stats[i];
+		if (z->count == 0) {
+			continue;
+		}
+		gl_log("  %-16s avg %8.3f ms  min %8.3f  max %8.3f  last %8.3f\n", z->name, z->avg_ms, z->min_ms, z->max_ms,
+		       z->last_ms);
+	}
+	gl_log("-----------------------------\n");
+}
+
+b32
+gpu_profiler_dump(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		gl_log_err("ERROR: could not open GPU profile %s for writing\n", path);
+		return 0;
+	}
+	fprintf(file, "{\n  \"frames\": %ld,\n  \"dropped\": %ld,\n  \"zones\": [", (long)gpu_profiler.frames_resolved,
+	        (long)gpu_profiler.frames_dropped);
+	for (isize i = 0; i < gpu_profiler.stats_len; i++) {
+		struct gpu_zone_stats* z = &gpu_profiler.stats[i];
+		fprintf(file,
+		        "%s\n    {\"name\": \"%s\", \"count\": %ld, \"avg_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, "
+		        "\"total_ms\": %.6f}",
+		        i ? "," : "", z->name, (long)z->count, z->avg_ms, z->count ? z->min_ms : 0.0, z->max_ms,
+		        z->total_ms);
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+	return 1;
+}
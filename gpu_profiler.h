@@ -0,0 +1,38 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include "common.h"
+
+/* GPU pass timings from GL_TIMESTAMP queries.
+ * Each frame writes its zone queries into one slot of a GPU_PROFILER_FRAMES deep ring; a slot is
+ * read back just before it is reused, by which time the GPU has long finished it, so reading the
+ * results never stalls the pipeline. Frames whose results are somehow still pending are dropped. */
+
+#define GPU_PROFILER_FRAMES 4
+#define GPU_PROFILER_MAX_ZONES 32
+
+struct gpu_zone_stats {
+	const char* name;
+	isize count;
+	double last_ms;
+	double avg_ms; /* exponential moving average */
+	double min_ms;
+	double max_ms;
+	double total_ms;
+};
+
+void gpu_profiler_init(void);
+void gpu_profiler_shutdown(void);
+
+void gpu_profiler_begin_frame(void);
+void gpu_profiler_end_frame(void);
+
+/* name must outlive the profiler, string literals are expected; zones may nest */
+void gpu_zone_begin(const char* name);
+void gpu_zone_end(void);
+
+isize gpu_profiler_zones(const struct gpu_zone_stats** zones);
+void gpu_profiler_log(void);
+b32 gpu_profiler_dump(const char* path);
+
+#endif
@@ -0,0 +1,737 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "image.h"
+
+//////////////////////////////////////
+// deflate (fixed Huffman codes + greedy LZ77)
+#define DEFLATE_WINDOW 32768
+#define DEFLATE_HASH_BITS 15
+#define DEFLATE_MAX_MATCH 258
+
+struct bit_writer {
+	u8* data;
+	isize len;
+	isize cap;
+	u32 bits;
+	int count;
+};
+
+static void
+bw_byte(struct bit_writer* bw, u8 byte) {
+	if (bw->len == bw->cap) {
+		bw->cap = bw->cap ? bw->cap * 2 : 4096;
+		bw->data = realloc(bw->data, bw->cap);
+	}
+	bw->data[bw->len++] = byte;
+}
+
+/* deflate packs bits LSB first */
+static void
+bw_bits(struct bit_writer* bw, u32 value, int count) {
+	bw->bits |= value << bw->count;
+	bw->count += count;
+	while (bw->count >= 8) {
+		bw_byte(bw, (u8)bw->bits);
+		bw->bits >>= 8;
+		bw->count -= 8;
+	}
+}
+
+/* Huffman codes are defined MSB first */
+static void
+bw_code(struct bit_writer* bw, u32 code, int length) {
+	u32 reversed = 0;
+	for (int i = 0; i < length; i++) {
+		reversed |= ((code >> i) & 1) << (length - 1 - i);
+	}
+	bw_bits(bw, reversed, length);
+}
+
+static void
+bw_flush(struct bit_writer* bw) {
+	if (bw->count > 0) {
+		bw_byte(bw, (u8)bw->bits);
+	}
+	bw->bits = 0;
+	bw->count = 0;
+}
+
+static const u16 length_base[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const u8 length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const u16 dist_base[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                  193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const u8 dist_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static void
+write_symbol(struct bit_writer* bw, int symbol) {
+	if (symbol < 144) {
+		bw_code(bw, 0x30 + symbol, 8);
+	} else if (symbol < 256) {
+		bw_code(bw, 0x190 + symbol - 144, 9);
+	} else if (symbol < 280) {
+		bw_code(bw, symbol - 256, 7);
+	} else {
+		bw_code(bw, 0xc0 + symbol - 280, 8);
+	}
+}
+
+static void
+write_match(struct bit_writer* bw, int length, int distance) {
+	int l = 28;
+	while (length_base[l] > length) {
+		l--;
+	}
+	write_symbol(bw, 257 + l);
+	bw_bits(bw, length - length_base[l], length_extra[l]);
+	int d = 29;
+	while (dist_base[d] > distance) {
+		d--;
+	}
+	bw_code(bw, d, 5);
+	bw_bits(bw, distance - dist_base[d], dist_extra[d]);
+}
+
+static void
+deflate_fixed(struct bit_writer* bw, const u8* data, isize len) {
+	bw_bits(bw, 1, 1); /* BFINAL */
+	bw_bits(bw, 1, 2); /* BTYPE 01: fixed Huffman */
+	i32* head = malloc(sizeof(i32) << DEFLATE_HASH_BITS);
+	memset(head, 0xff, sizeof(i32) << DEFLATE_HASH_BITS);
+	isize i = 0;
+	while (i < len) {
+		int best_len = 0;
+		int best_dist = 0;
+		if (i + 3 <= len) {
+			u32 h = ((u32)data[i] << 16 | (u32)data[i + 1] << 8 | data[i + 2]) * 2654435761u;
+			h >>= 32 - DEFLATE_HASH_BITS;
+			isize candidate = head[h];
+			head[h] = (i32)i;
+			if (candidate >= 0 && i - candidate <= DEFLATE_WINDOW) {
+				isize max = len - i < DEFLATE_MAX_MATCH ? len - i : DEFLATE_MAX_MATCH;
+				int n = 0;
+				while (n < max && data[candidate + n] == data[i + n]) {
+					n++;
+				}
+				if (n >= 3) {
+					best_len = n;
+					best_dist = (int)(i - candidate);
+				}
+			}
+		}
+		if (best_len) {
+			write_match(bw, best_len, best_dist);
+			i += best_len;
+		} else {
+			write_symbol(bw, data[i]);
+			i++;
+		}
+	}
+	write_symbol(bw, 256);
+	bw_flush(bw);
+	free(head);
+}
+
+//////////////////////////////////////
+// checksums
+static u32 crc_table[256];
+
+static u32
+crc32_update(u32 crc, const u8* data, isize len) {
+	if (!crc_table[1]) {
+		for (u32 n = 0; n < 256; n++) {
+			u32 c = n;
+			for (int k = 0; k < 8; k++) {
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			crc_table[n] = c;
+		}
+	}
+	crc ^= 0xffffffffu;
+	for (isize i = 0; i < len; i++) {
+		crc = crc_table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffffu;
+}
+
+static u32
+adler32(const u8* data, isize len) {
+	u32 a = 1, b = 0;
+	for (isize i = 0; i < len; i++) {
+		a = (a + data[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	return b << 16 | a;
+}
+
+//////////////////////////////////////
+// PNG / PPM
+static void
+put_u32_be(u8* dst, u32 v) {
+	dst[0] = (u8)(v >> 24);
+	dst[1] = (u8)(v >> 16);
+	dst[2] = (u8)(v >> 8);
+	dst[3] = (u8)v;
+}
+
+static void
+write_chunk(FILE* file, const char* type, const u8* data, u32 len) {
+	u8 header[8];
+	put_u32_be(header, len);
+	memcpy(header + 4, type, 4);
+	fwrite(header, 1, 8, file);
+	if (len) {
+		fwrite(data, 1, len, file);
+	}
+	u32 crc = crc32_update(0, (const u8*)type, 4);
+	crc = crc32_update(crc, data, len);
+	u8 trailer[4];
+	put_u32_be(trailer, crc);
+	fwrite(trailer, 1, 4, file);
+}
+
+b32
+image_write_png(const char* path, const u8* rgba, int width, int height) {
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		gl_log_err("ERROR: could not open %s for writing\n", path);
+		return 0;
+	}
+	/* every scanline uses the Sub filter, which turns flat color runs into zero runs for LZ77 */
+	isize stride = (isize)width * 4;
+	isize raw_len = (stride + 1) * height;
+	u8* raw = malloc(raw_len);
+	for (int y = 0; y < height; y++) {
+		const u8* src = rgba + y * stride;
+		u8* dst = raw + y * (stride + 1);
+		dst[0] = 1;
+		for (isize x = 0; x < stride; x++) {
+			dst[1 + x] = (u8)(src[x] - (x >= 4 ? src[x - 4] : 0));
+		}
+	}
+
+	struct bit_writer bw = {0};
+	bw_byte(&bw, 0x78); /* zlib header: deflate, 32K window, no dictionary */
+	bw_byte(&bw, 0x01);
+	deflate_fixed(&bw, raw, raw_len);
+	u8 adler[4];
+	put_u32_be(adler, adler32(raw, raw_len));
+	for (int i = 0; i < 4; i++) {
+		bw_byte(&bw, adler[i]);
+	}
+
+	static const u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	fwrite(signature, 1, 8, file);
+	u8 ihdr[13] = {0};
+	put_u32_be(ihdr, (u32)width);
+	put_u32_be(ihdr + 4, (u32)height);
+	ihdr[8] = 8; /* bit depth */
+	ihdr[9] = 6; /* color type RGBA */
+	write_chunk(file, "IHDR", ihdr, sizeof(ihdr));
+	write_chunk(file, "IDAT", bw.data, (u32)bw.len);
+	write_chunk(file, "IEND", NULL, 0);
+
+	b32 ok = !ferror(file);
+	fclose(file);
+	free(bw.data);
+	free(raw);
+	return ok;
+}
+
+b32
+image_write_ppm(const char* path, const u8* rgba, int width, int height) {
+	FILE* file = fopen(path, "wb");
+	if (!file) {
+		gl_log_err("ERROR: could not open %s for writing\n", path);
+		return 0;
+	}
+	fprintf(file, "P6\n%d %d\n255\n", width, height);
+	u8* row = malloc((size_t)width * 3);
+	for (int y = 0; y < height; y++) {
+		const u8* src = rgba + (isize)y * width * 4;
+		for (int x = 0; x < width; x++) {
+			memcpy(&row[x * 3], &src[x * 4], 3);
+		}
+		fwrite(row, 3, width, file);
+	}
+	free(row);
+	b32 ok = !ferror(file);
+	fclose(file);
+	return ok;
+}
+
+b32
+image_write(const char* path, const u8* rgba, int width, int height) {
+	size_t len = strlen(path);
+	if (len >= 4 && strcmp(path + len - 4, ".ppm") == 0) {
+		return image_write_ppm(path, rgba, width, height);
+	}
+	return image_write_png(path, rgba, width, height);
+}
+
+//////////////////////////////////////
+// inflate
+struct bit_reader {
+	const u8* data;
+	isize len;
+	isize pos;
+	u32 bits;
+	int count;
+	b32 overrun;
+};
+
+static u32
+br_bits(struct bit_reader* br, int need) {
+	while (br->count < need) {
+		if (br->pos >= br->len) {
+			br->overrun = 1;
+			return 0;
+		}
+		br->bits |= (u32)br->data[br->pos++] << br->count;
+		br->count += 8;
+	}
+	u32 value = br->bits & ((1u << need) - 1);
+	br->bits >>= need;
+	br->count -= need;
+	return value;
+}
+
+/* canonical Huffman table: symbols ordered by code length, then value */
+struct huffman {
+	u16 counts[16];
+	u16 symbols[288];
+};
+
+static b32
+huffman_build(struct huffman* h, const u8* lengths, int n) {
+	memset(h->counts, 0, sizeof(h->counts));
+	for (int i = 0; i < n; i++) {
+		h->counts[lengths[i]]++;
+	}
+	h->counts[0] = 0;
+	u16 offsets[16];
+	offsets[1] = 0;
+	for (int len = 1; len < 15; len++) {
+		offsets[len + 1] = offsets[len] + h->counts[len];
+	}
+	for (int i = 0; i < n; i++) {
+		if (lengths[i]) {
+			h->symbols[offsets[lengths[i]]++] = (u16)i;
+		}
+	}
+	return 1;
+}
+
+static int
+huffman_decode(struct bit_reader* br, const struct huffman* h) {
+	int code = 0, first = 0, index = 0;
+	for (int len = 1; len < 16; len++) {
+		code |= (int)br_bits(br, 1);
+		int count = h->counts[len];
+		if (code - first < count) {
+			return h->symbols[index + code - first];
+		}
+		index += count;
+		first = (first + count) << 1;
+		code <<= 1;
+		if (br->overrun) {
+			break;
+		}
+	}
+	return -1;
+}
+
+struct byte_buffer {
+	u8* data;
+	isize len;
+	isize cap;
+	isize limit; /* 0 for none, otherwise growing past it fails: inflate output is bounded by the image */
+};
+
+static b32
+buffer_reserve(struct byte_buffer* out, isize extra) {
+	if (out->len + extra <= out->cap) {
+		return 1;
+	}
+	if (out->limit && out->len + extra > out->limit) {
+		return 0;
+	}
+	isize cap = out->cap ? out->cap : 4096;
+	while (cap < out->len + extra) {
+		cap *= 2;
+	}
+	u8* data = realloc(out->data, cap);
+	if (!data) {
+		return 0;
+	}
+	out->data = data;
+	out->cap = cap;
+	return 1;
+}
+
+static b32
+inflate_block(struct bit_reader* br, struct byte_buffer* out, const struct huffman* lit, const struct huffman* dist) {
+	for (;;) {
+		int symbol = huffman_decode(br, lit);
+		if (symbol < 0) {
+			return 0;
+		}
+		if (symbol < 256) {
+			if (!buffer_reserve(out, 1)) {
+				return 0;
+			}
+			out->data[out->len++] = (u8)symbol;
+			continue;
+		}
+		if (symbol == 256) {
+			return 1;
+		}
+		symbol -= 257;
+		if (symbol >= 29) {
+			return 0;
+		}
+		int length = length_base[symbol] + (int)br_bits(br, length_extra[symbol]);
+		int d = huffman_decode(br, dist);
+		if (d < 0 || d >= 30) {
+			return 0;
+		}
+		isize distance = dist_base[d] + (isize)br_bits(br, dist_extra[d]);
+		if (distance > out->len || br->overrun || !buffer_reserve(out, length)) {
+			return 0;
+		}
+		/* byte by byte: overlapping copies are how deflate encodes runs */
+		for (int i = 0; i < length; i++) {
+			out->data[out->len] = out->data[out->len - distance];
+			out->len++;
+		}
+	}
+}
+
+static b32
+inflate_zlib(const u8* data, isize len, struct byte_buffer* out) {
+	if (len < 2 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 != 0) {
+		return 0;
+	}
+	struct bit_reader br = {.data = data, .len = len, .pos = 2};
+	static const u8 order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+	b32 last = 0;
+	while (!last) {
+		last = (b32)br_bits(&br, 1);
+		u32 type = br_bits(&br, 2);
+		if (br.overrun) {
+			return 0;
+		}
+		if (type == 0) {
+			br.bits = 0;
+			br.count = 0;
+			if (br.pos + 4 > len) {
+				return 0;
+			}
+			u32 n = data[br.pos] | data[br.pos + 1] << 8;
+			br.pos += 4;
+			if (br.pos + n > (u32)len || !buffer_reserve(out, n)) {
+				return 0;
+			}
+			memcpy(out->data + out->len, data + br.pos, n);
+			out->len += n;
+			br.pos += n;
+			continue;
+		}
+		struct huffman lit, dist;
+		u8 lengths[320];
+		if (type == 1) {
+			int i = 0;
+			for (; i < 144; i++) lengths[i] = 8;
+			for (; i < 256; i++) lengths[i] = 9;
+			for (; i < 280; i++) lengths[i] = 7;
+			for (; i < 288; i++) lengths[i] = 8;
+			huffman_build(&lit, lengths, 288);
+			for (i = 0; i < 30; i++) lengths[i] = 5;
+			huffman_build(&dist, lengths, 30);
+		} else if (type == 2) {
+			int nlen = (int)br_bits(&br, 5) + 257;
+			int ndist = (int)br_bits(&br, 5) + 1;
+			int ncode = (int)br_bits(&br, 4) + 4;
+			memset(lengths, 0, 19);
+			for (int i = 0; i < ncode; i++) {
+				lengths[order[i]] = (u8)br_bits(&br, 3);
+			}
+			struct huffman code;
+			huffman_build(&code, lengths, 19);
+			int i = 0;
+			while (i < nlen + ndist) {
+				int symbol = huffman_decode(&br, &code);
+				int repeat = 0;
+				u8 value = 0;
+				if (symbol < 0) {
+					return 0;
+				} else if (symbol < 16) {
+					lengths[i++] = (u8)symbol;
+					continue;
+				} else if (symbol == 16) {
+					if (i == 0) {
+						return 0;
+					}
+					value = lengths[i - 1];
+					repeat = 3 + (int)br_bits(&br, 2);
+				} else if (symbol == 17) {
+					repeat = 3 + (int)br_bits(&br, 3);
+				} else {
+					repeat = 11 + (int)br_bits(&br, 7);
+				}
+				if (i + repeat > nlen + ndist) {
+					return 0;
+				}
+				while (repeat--) {
+					lengths[i++] = value;
+				}
+			}
+			huffman_build(&lit, lengths, nlen);
+			huffman_build(&dist, lengths + nlen, ndist);
+		} else {
+			return 0;
+		}
+		if (!inflate_block(&br, out, &lit, &dist)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+//////////////////////////////////////
+// PNG / TGA decoding
+static u32
+get_u32_be(const u8* p) {
+	return (u32)p[0] << 24 | (u32)p[1] << 16 | (u32)p[2] << 8 | p[3];
+}
+
+static u8
+paeth(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	return (u8)(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+}
+
+u8*
+image_decode_png(const u8* data, isize len, int* width, int* height) {
+	static const u8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	if (len < 8 || memcmp(data, signature, 8) != 0) {
+		return NULL;
+	}
+	u32 w = 0, h = 0;
+	int depth = 0, color = 0, interlace = 0;
+	u8 palette[256 * 4];
+	memset(palette, 0xff, sizeof(palette));
+	struct byte_buffer idat = {0};
+	isize pos = 8;
+	while (pos + 12 <= len) {
+		u32 n = get_u32_be(data + pos);
+		const u8* type = data + pos + 4;
+		const u8* chunk = data + pos + 8;
+		if (n > (u32)(len - pos - 12)) {
+			break;
+		}
+		if (memcmp(type, "IHDR", 4) == 0 && n >= 13) {
+			w = get_u32_be(chunk);
+			h = get_u32_be(chunk + 4);
+			depth = chunk[8];
+			color = chunk[9];
+			interlace = chunk[12];
+		} else if (memcmp(type, "PLTE", 4) == 0) {
+			for (u32 i = 0; i < n / 3 && i < 256; i++) {
+				memcpy(&palette[i * 4], chunk + i * 3, 3);
+			}
+		} else if (memcmp(type, "tRNS", 4) == 0 && color == 3) {
+			for (u32 i = 0; i < n && i < 256; i++) {
+				palette[i * 4 + 3] = chunk[i];
+			}
+		} else if (memcmp(type, "IDAT", 4) == 0) {
+			if (!buffer_reserve(&idat, n)) {
+				break;
+			}
+			memcpy(idat.data + idat.len, chunk, n);
+			idat.len += n;
+		} else if (memcmp(type, "IEND", 4) == 0) {
+			break;
+		}
+		pos += 12 + n;
+	}
+
+	static const int channels_of[7] = {1, 0, 3, 1, 2, 0, 4};
+	int channels = color <= 6 ? channels_of[color] : 0;
+	if (w == 0 || h == 0 || w > 16384 || h > 16384 || channels == 0 || interlace || (depth != 8 && depth != 16) ||
+	    (color == 3 && depth != 8)) {
+		gl_log_err("ERROR: unsupported PNG (%ux%u, depth %i, color type %i, interlace %i)\n", w, h, depth, color,
+		           interlace);
+		free(idat.data);
+		return NULL;
+	}
+
+	isize bpp = channels * depth / 8;
+	isize stride = bpp * w;
+	/* a filter byte per row; a stream that inflates to more is corrupt (or a zip bomb) and fails */
+	struct byte_buffer raw = {.limit = (stride + 1) * (isize)h};
+	buffer_reserve(&raw, raw.limit);
+	b32 ok = inflate_zlib(idat.data, idat.len, &raw) && raw.len == raw.limit;
+	for (u32 y = 0; ok && y < h; y++) {
+		ok = raw.data[y * (stride + 1)] <= 4;
+	}
+	free(idat.data);
+	if (!ok) {
+		gl_log_err("ERROR: corrupt PNG image data\n");
+		free(raw.data);
+		return NULL;
+	}
+
+	/* unfilter in place; row y - 1 is already reconstructed when row y is processed */
+	for (u32 y = 0; y < h; y++) {
+		u8* row = raw.data + y * (stride + 1);
+		u8 filter = row[0];
+		u8* cur = row + 1;
+		const u8* prev = y ? raw.data + (y - 1) * (stride + 1) + 1 : NULL;
+		for (isize x = 0; x < stride; x++) {
+			int a = x >= bpp ? cur[x - bpp] : 0;
+			int b = prev ? prev[x] : 0;
+			int c = prev && x >= bpp ? prev[x - bpp] : 0;
+			switch (filter) {
+				case 1:
+					cur[x] = (u8)(cur[x] + a);
+					break;
+				case 2:
+					cur[x] = (u8)(cur[x] + b);
+					break;
+				case 3:
+					cur[x] = (u8)(cur[x] + ((a + b) >> 1));
+					break;
+				case 4:
+					cur[x] = (u8)(cur[x] + paeth(a, b, c));
+					break;
+				default: /* 0, none; the filter types were checked above */
+					break;
+			}
+		}
+	}
+
+	u8* rgba = malloc((size_t)w * h * 4);
+	for (u32 y = 0; y < h; y++) {
+		const u8* src = raw.data + y * (stride + 1) + 1;
+		u8* dst = rgba + (isize)y * w * 4;
+		for (u32 x = 0; x < w; x++) {
+			/* 16-bit samples keep their high byte */
+			u8 s[4];
+			for (int k = 0; k < channels; k++) {
+				s[k] = src[(x * channels + k) * (depth / 8)];
+			}
+			switch (color) {
+				case 0:
+					dst[0] = dst[1] = dst[2] = s[0], dst[3] = 255;
+					break;
+				case 2:
+					dst[0] = s[0], dst[1] = s[1], dst[2] = s[2], dst[3] = 255;
+					break;
+				case 3:
+					memcpy(dst, &palette[s[0] * 4], 4);
+					break;
+				case 4:
+					dst[0] = dst[1] = dst[2] = s[0], dst[3] = s[1];
+					break;
+				default:
+					memcpy(dst, s, 4);
+					break;
+			}
+			dst += 4;
+		}
+	}
+	free(raw.data);
+	*width = (int)w;
+	*height = (int)h;
+	return rgba;
+}
+
+u8*
+image_decode_tga(const u8* data, isize len, int* width, int* height) {
+	if (len < 18) {
+		return NULL;
+	}
+	int id_len = data[0];
+	int type = data[2];
+	int w = data[12] | data[13] << 8;
+	int h = data[14] | data[15] << 8;
+	int bpp = data[16] / 8;
+	b32 top_down = (data[17] & 0x20) != 0;
+	if ((type != 2 && type != 10) || (bpp != 3 && bpp != 4) || w == 0 || h == 0 || data[1] != 0) {
+		gl_log_err("ERROR: unsupported TGA (type %i, %i bpp)\n", type, bpp * 8);
+		return NULL;
+	}
+	const u8* src = data + 18 + id_len;
+	const u8* end = data + len;
+	u8* rgba = malloc((size_t)w * h * 4);
+	isize total = (isize)w * h;
+	isize i = 0;
+	while (i < total) {
+		isize run = 1;
+		b32 repeat = 0;
+		if (type == 10) {
+			if (src >= end) {
+				break;
+			}
+			repeat = (*src & 0x80) != 0;
+			run = (*src & 0x7f) + 1;
+			src++;
+		}
+		for (isize k = 0; k < run && i < total; k++, i++) {
+			if (src + bpp > end) {
+				free(rgba);
+				return NULL;
+			}
+			/* TGA rows are bottom-up unless the descriptor says otherwise */
+			isize y = i / w, x = i % w;
+			u8* dst = rgba + ((top_down ? y : h - 1 - y) * w + x) * 4;
+			dst[0] = src[2];
+			dst[1] = src[1];
+			dst[2] = src[0];
+			dst[3] = bpp == 4 ? src[3] : 255;
+			if (!repeat || k == run - 1) {
+				src += bpp;
+			}
+		}
+	}
+	if (i < total) {
+		free(rgba);
+		return NULL;
+	}
+	*width = w;
+	*height = h;
+	return rgba;
+}
+
+u8*
+image_load(const char* path, int* width, int* height) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		gl_log_err("ERROR: could not open image %s\n", path);
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	u8* data = malloc(len > 0 ? len : 1);
+	b32 read_ok = len > 0 && fread(data, 1, len, file) == (size_t)len;
+	fclose(file);
+	u8* rgba = NULL;
+	if (read_ok) {
+		size_t n = strlen(path);
+		if (n >= 4 && (strcmp(path + n - 4, ".tga") == 0 || strcmp(path + n - 4, ".TGA") == 0)) {
+			rgba = image_decode_tga(data, len, width, height);
+		} else {
+			rgba = image_decode_png(data, len, width, height);
+		}
+	}
+	free(data);
+	if (!rgba) {
+		gl_log_err("ERROR: could not decode image %s\n", path);
+	}
+	return rgba;
+}
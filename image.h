@@ -0,0 +1,19 @@
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include "common.h"
+
+/* Image file encoding and decoding. Pixels are tightly packed 8-bit RGBA, top row first. */
+
+/* PNG (8/16-bit, any color type, non-interlaced) or TGA (true-color, raw or RLE); free() the result */
+u8* image_load(const char* path, int* width, int* height);
+u8* image_decode_png(const u8* data, isize len, int* width, int* height);
+u8* image_decode_tga(const u8* data, isize len, int* width, int* height);
+
+b32 image_write_png(const char* path, const u8* rgba, int width, int height);
+/* binary P6, alpha is dropped */
+b32 image_write_ppm(const char* path, const u8* rgba, int width, int height);
+/* picks the encoder from the file extension, PNG unless it ends in .ppm */
+b32 image_write(const char* path, const u8* rgba, int width, int height);
+
+#endif
@@ -0,0 +1,161 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdatomic.h>
+
+#include <GLFW/glfw3.h>
+
+#include "input.h"
+
+_Static_assert((INPUT_QUEUE_SIZE & (INPUT_QUEUE_SIZE - 1)) == 0, "INPUT_QUEUE_SIZE must be a power of two");
+
+struct binding {
+	u8 action;
+	u8 device;
+	i32 code;
+	b32 down; /* per binding, so an action bound twice is down while either is */
+};
+
+static struct {
+	struct input_event events[INPUT_QUEUE_SIZE];
+	atomic_uint head; /* next event to read, only the consumer stores it */
+	atomic_uint tail; /* next slot to write, only the producer stores it */
+	atomic_uint dropped;
+
+	struct binding bindings[INPUT_MAX_BINDINGS];
+	isize bindings_len;
+	struct input_action_state actions[INPUT_ACTIONS];
+	i32 held[INPUT_ACTIONS]; /* bindings of the action currently down */
+
+	u64 events_total;
+	isize max_events_per_update;
+} input;
+
+static const char* action_names[INPUT_ACTIONS] = {
+    [ACTION_QUIT] = "quit",
+    [ACTION_RELOAD_SHADERS] = "reload shaders",
+    [ACTION_SCREENSHOT] = "screenshot",
+    [ACTION_TOGGLE_OVERLAY] = "toggle overlay",
+    [ACTION_PICK] = "pick",
+};
+
+b32
+input_push(struct input_event event) {
+	unsigned tail = atomic_load_explicit(&input.tail, memory_order_relaxed);
+	unsigned head = atomic_load_explicit(&input.head, memory_order_acquire);
+	if (tail - head == INPUT_QUEUE_SIZE) {
+		atomic_fetch_add_explicit(&input.dropped, 1, memory_order_relaxed);
+		return 0;
+	}
+	input.events[tail & (INPUT_QUEUE_SIZE - 1)] = event;
+	atomic_store_explicit(&input.tail, tail + 1, memory_order_release);
+	return 1;
+}
+
+static void
+push_event(GLFWwindow* window, enum input_device device, int code, b32 pressed) {
+	double x, y;
+	glfwGetCursorPos(window, &x, &y);
+	input_push((struct input_event){
+	    .time_ns = clock_ns(),
+	    .device = (u8)device,
+	    .pressed = (u8)pressed,
+	    .code = code,
+	    .x = (float)x,
+	    .y = (float)y,
+	});
+}
+
+static void
+key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+	(void)scancode;
+	(void)mods;
+	/* repeats would retrigger actions while a key is held */
+	if (action != GLFW_REPEAT) {
+		push_event(window, INPUT_KEY, key, action == GLFW_PRESS);
+	}
+}
+
+static void
+mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+	(void)mods;
+	push_event(window, INPUT_MOUSE_BUTTON, button, action == GLFW_PRESS);
+}
+
+void
+input_install(struct GLFWwindow* window) {
+	glfwSetKeyCallback(window, key_callback);
+	glfwSetMouseButtonCallback(window, mouse_button_callback);
+}
+
+b32
+input_bind(enum input_action action, enum input_device device, i32 code) {
+	if (input.bindings_len == INPUT_MAX_BINDINGS) {
+		gl_log_err("ERROR: input: no room to bind %s\n", action_names[action]);
+		return 0;
+	}
+	input.bindings[input.bindings_len++] = (struct binding){.action = (u8)action, .device = (u8)device, .code = code};
+	return 1;
+}
+
+static void
+apply(const struct input_event* event) {
+	for (isize i = 0; i < input.bindings_len; i++) {
+		struct binding* binding = &input.bindings[i];
+		if (binding->device != event->device || binding->code != event->code || binding->down == event->pressed) {
+			continue;
+		}
+		binding->down = event->pressed;
+		struct input_action_state* state = &input.actions[binding->action];
+		i32* held = &input.held[binding->action];
+		if (event->pressed && (*held)++ == 0) {
+			state->down = 1;
+			state->presses++;
+			state->press_ns = event->time_ns;
+			state->x = event->x;
+			state->y = event->y;
+		} else if (!event->pressed && --(*held) == 0) {
+			state->down = 0;
+			state->releases++;
+		}
+	}
+}
+
+isize
+input_update(void) {
+	for (int a = 0; a < INPUT_ACTIONS; a++) {
+		input.actions[a].presses = 0;
+		input.actions[a].releases = 0;
+	}
+	unsigned head = atomic_load_explicit(&input.head, memory_order_relaxed);
+	unsigned tail = atomic_load_explicit(&input.tail, memory_order_acquire);
+	isize count = (isize)(tail - head);
+	for (; head != tail; head++) {
+		apply(&input.events[head & (INPUT_QUEUE_SIZE - 1)]);
+	}
+	atomic_store_explicit(&input.head, head, memory_order_release);
+	input.events_total += (u64)count;
+	if (count > input.max_events_per_update) {
+		input.max_events_per_update = count;
+	}
+	return count;
+}
+
+const struct input_action_state*
+input_action(enum input_action action) {
+	return &input.actions[action];
+}
+
+b32
+input_pressed(enum input_action action) {
+	return input.actions[action].presses > 0;
+}
+
+const char*
+input_action_name(enum input_action action) {
+	return action_names[action];
+}
+
+void
+input_log(void) {
+	gl_log("input: %lu events, at most %li in a frame, %u dropped\n", (unsigned long)input.events_total,
+	       (long)input.max_events_per_update, atomic_load_explicit(&input.dropped, memory_order_relaxed));
+}
@@ -0,0 +1,67 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "common.h"
+
+/* Input events and actions.
+ * The GLFW key and mouse button callbacks (input_install) timestamp every event and push it into a
+ * single-producer single-consumer lock-free ring. input_update() drains the ring on the thread that
+ * runs the simulation and folds the events into per-action state through the binding table, so a
+ * frame without input does no work and no key is polled; each event is matched against every binding
+ * (at most INPUT_MAX_BINDINGS). Presses are edges: holding a key reports one press, key repeat is
+ * ignored, and a press released within the same frame still counts. */
+
+#define INPUT_QUEUE_SIZE 256 /* power of two */
+#define INPUT_MAX_BINDINGS 32
+
+struct GLFWwindow;
+
+enum input_action {
+	ACTION_QUIT,
+	ACTION_RELOAD_SHADERS,
+	ACTION_SCREENSHOT,
+	ACTION_TOGGLE_OVERLAY,
+	ACTION_PICK,
+	INPUT_ACTIONS,
+};
+
+enum input_device {
+	INPUT_KEY,
+	INPUT_MOUSE_BUTTON,
+};
+
+struct input_event {
+	u64 time_ns; /* CLOCK_MONOTONIC */
+	u8 device;   /* enum input_device */
+	u8 pressed;  /* 0 for a release */
+	i32 code;    /* GLFW key or mouse button */
+	float x;     /* cursor in window coordinates */
+	float y;
+};
+
+struct input_action_state {
+	b32 down;
+	i32 presses; /* since the previous input_update() */
+	i32 releases;
+	u64 press_ns; /* of the last press */
+	float x;      /* cursor at the last press */
+	float y;
+};
+
+/* sets the key and mouse button callbacks of the window */
+void input_install(struct GLFWwindow* window);
+/* an action may have several bindings; returns 0 when the table is full */
+b32 input_bind(enum input_action action, enum input_device device, i32 code);
+
+/* producer side; 0 when the queue is full and the event was dropped */
+b32 input_push(struct input_event event);
+/* consumer side: applies every queued event and returns how many there were */
+isize input_update(void);
+
+const struct input_action_state* input_action(enum input_action action);
+/* pressed at least once since the previous input_update() */
+b32 input_pressed(enum input_action action);
+const char* input_action_name(enum input_action action);
+void input_log(void);
+
+#endif
@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "cpu_trace.h"
+#include "jobs.h"
+
+#define JOBS_MAX_THREADS 32
+#define JOBS_QUEUE_SIZE 4096
+
+struct job {
+	job_fn fn;
+	void* data;
+	isize index;
+	struct job_counter* counter;
+};
+
+static struct {
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct job queue[JOBS_QUEUE_SIZE];
+	isize head;
+	isize len;
+	b32 quit;
+	pthread_t threads[JOBS_MAX_THREADS];
+	isize thread_count;
+} jobs = {.mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+static void
+job_execute(struct job job) {
+	TRACE_ZONE("job");
+	job.fn(job.data, job.index);
+	if (job.counter) {
+		atomic_fetch_sub_explicit(&job.counter->pending, 1, memory_order_release);
+	}
+}
+
+/* caller holds the mutex */
+static b32
+job_pop(struct job* out) {
+	if (jobs.len == 0) {
+		return 0;
+	}
+	*out = jobs.queue[jobs.head];
+	jobs.head = (jobs.head + 1) % JOBS_QUEUE_SIZE;
+	jobs.len--;
+	return 1;
+}
+
+static void*
+job_worker(void* arg) {
+	(void)arg;
+	TRACE_THREAD_NAME("job worker");
+	pthread_mutex_lock(&jobs.mutex);
+	for (;;) {
+		struct job job;
+		while (!jobs.quit && !job_pop(&job)) {
+			pthread_cond_wait(&jobs.cond, &jobs.mutex);
+		}
+		if (jobs.quit) {
+			break;
+		}
+		pthread_mutex_unlock(&jobs.mutex);
+		job_execute(job);
+		pthread_mutex_lock(&jobs.mutex);
+	}
+	pthread_mutex_unlock(&jobs.mutex);
+	return NULL;
+}
+
+void
+jobs_init(isize thread_count) {
+	if (thread_count <= 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		thread_count = cpus > 1 ? cpus - 1 : 1;
+	}
+	if (thread_count > JOBS_MAX_THREADS) {
+		thread_count = JOBS_MAX_THREADS;
+	}
+	jobs.quit = 0;
+	for (isize i = 0; i < thread_count; i++) {
+		if (pthread_create(&jobs.threads[i], NULL, job_worker, NULL) != 0) {
+			gl_log_err("ERROR: could not start job worker %i\n", (int)i);
+			break;
+		}
+		jobs.thread_count++;
+	}
+	gl_log("job system: %i worker threads\n", (int)jobs.thread_count);
+}
+
+void
+jobs_shutdown(void) {
+	pthread_mutex_lock(&jobs.mutex);
+	jobs.quit = 1;
+	pthread_cond_broadcast(&jobs.cond);
+	pthread_mutex_unlock(&jobs.mutex);
+	for (isize i = 0; i < jobs.thread_count; i++) {
+		pthread_join(jobs.threads[i], NULL);
+	}
+	jobs.thread_count = 0;
+	jobs.head = 0;
+	jobs.len = 0;
+}
+
+isize
+jobs_thread_count(void) {
+	return jobs.thread_count;
+}
+
+void
+jobs_run(job_fn fn, void* data, isize count, struct job_counter* counter) {
+	if (counter) {
+		atomic_fetch_add_explicit(&counter->pending, (int)count, memory_order_relaxed);
+	}
+	for (isize i = 0; i < count; i++) {
+		struct job job = {fn, data, i, counter};
+		pthread_mutex_lock(&jobs.mutex);
+		/* no workers or a full queue: run inline rather than block the submitter */
+		if (jobs.thread_count == 0 || jobs.len == JOBS_QUEUE_SIZE) {
+			pthread_mutex_unlock(&jobs.mutex);
+			job_execute(job);
+			continue;
+		}
+		jobs.queue[(jobs.head + jobs.len) % JOBS_QUEUE_SIZE] = job;
+		jobs.len++;
+		pthread_cond_signal(&jobs.cond);
+		pthread_mutex_unlock(&jobs.mutex);
+	}
+}
+
+void
+jobs_wait(struct job_counter* counter) {
+	while (atomic_load_explicit(&counter->pending, memory_order_acquire) > 0) {
+		struct job job;
+		pthread_mutex_lock(&jobs.mutex);
+		b32 got = job_pop(&job);
+		pthread_mutex_unlock(&jobs.mutex);
+		if (got) {
+			job_execute(job);
+		} else {
+			sched_yield();
+		}
+	}
+}
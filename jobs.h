@@ -0,0 +1,34 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdatomic.h>
+
+#include "common.h"
+
+/* Small fixed worker pool. A job is (fn, data, index); batches of jobs share a counter that the
+ * submitter waits on. Waiting threads run queued jobs themselves, so jobs may submit and wait on
+ * nested batches without deadlocking the pool. */
+
+typedef void (*job_fn)(void* data, isize index);
+
+struct job_counter {
+	atomic_int pending;
+};
+
+/* thread_count <= 0 picks one worker per online CPU minus the main thread */
+void jobs_init(isize thread_count);
+void jobs_shutdown(void);
+isize jobs_thread_count(void);
+
+/* queue count jobs fn(data, 0..count-1); counter may be NULL for fire-and-forget work */
+void jobs_run(job_fn fn, void* data, isize count, struct job_counter* counter);
+void jobs_wait(struct job_counter* counter);
+
+static inline void
+jobs_parallel_for(job_fn fn, void* data, isize count) {
+	struct job_counter counter = {0};
+	jobs_run(fn, data, count, &counter);
+	jobs_wait(&counter);
+}
+
+#endif
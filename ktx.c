@@ -0,0 +1,270 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ktx.h"
+
+struct ktx_format {
+	u32 vk_format;   /* KTX2 vkFormat */
+	u32 dxgi_format; /* DDS DX10 header, 0 when DDS has no such format */
+	GLenum gl_format;
+	int block_bytes; /* per 4x4 block */
+};
+
+static const struct ktx_format formats[] = {
+    {131, 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8},
+    {132, 0, GL_COMPRESSED_SRGB_S3TC_DXT1_EXT, 8},
+    {133, 71, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 8},
+    {134, 72, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8},
+    {135, 74, GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 16},
+    {136, 75, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 16},
+    {137, 77, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 16},
+    {138, 78, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16},
+    {139, 80, GL_COMPRESSED_RED_RGTC1, 8},
+    {140, 81, GL_COMPRESSED_SIGNED_RED_RGTC1, 8},
+    {141, 83, GL_COMPRESSED_RG_RGTC2, 16},
+    {142, 84, GL_COMPRESSED_SIGNED_RG_RGTC2, 16},
+    {143, 95, GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 16},
+    {144, 96, GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 16},
+    {145, 98, GL_COMPRESSED_RGBA_BPTC_UNORM, 16},
+    {146, 99, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16},
+    {147, 0, GL_COMPRESSED_RGB8_ETC2, 8},
+    {148, 0, GL_COMPRESSED_SRGB8_ETC2, 8},
+    {149, 0, GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2, 8},
+    {150, 0, GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2, 8},
+    {151, 0, GL_COMPRESSED_RGBA8_ETC2_EAC, 16},
+    {152, 0, GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC, 16},
+    {153, 0, GL_COMPRESSED_R11_EAC, 8},
+    {154, 0, GL_COMPRESSED_SIGNED_R11_EAC, 8},
+    {155, 0, GL_COMPRESSED_RG11_EAC, 16},
+    {156, 0, GL_COMPRESSED_SIGNED_RG11_EAC, 16},
+};
+
+static const struct ktx_format*
+format_from_vk(u32 vk_format) {
+	for (isize i = 0; i < ARRAY_SIZE(formats); i++) {
+		if (formats[i].vk_format == vk_format) {
+			return &formats[i];
+		}
+	}
+	return NULL;
+}
+
+static const struct ktx_format*
+format_from_dxgi(u32 dxgi_format) {
+	for (isize i = 0; dxgi_format && i < ARRAY_SIZE(formats); i++) {
+		if (formats[i].dxgi_format == dxgi_format) {
+			return &formats[i];
+		}
+	}
+	return NULL;
+}
+
+isize
+ktx_format_block_bytes(GLenum gl_format) {
+	for (isize i = 0; i < ARRAY_SIZE(formats); i++) {
+		if (formats[i].gl_format == gl_format) {
+			return formats[i].block_bytes;
+		}
+	}
+	return 0;
+}
+
+static u32
+read_u32(const u8* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+static u64
+read_u64(const u8* p) {
+	return read_u32(p) | ((u64)read_u32(p + 4) << 32);
+}
+
+static isize
+level_bytes(const struct ktx_format* format, int width, int height) {
+	return (isize)((width + 3) / 4) * ((height + 3) / 4) * format->block_bytes;
+}
+
+static b32
+check_levels(struct ktx_texture* ktx, const struct ktx_format* format) {
+	if (ktx->width <= 0 || ktx->height <= 0 || ktx->levels <= 0 || ktx->levels > KTX_MAX_LEVELS) {
+		return 0;
+	}
+	ktx->format = format->gl_format;
+	ktx->size = 0;
+	for (int level = 0; level < ktx->levels; level++) {
+		int w = ktx->width >> level > 0 ? ktx->width >> level : 1;
+		int h = ktx->height >> level > 0 ? ktx->height >> level : 1;
+		if (ktx->level_size[level] < level_bytes(format, w, h)) {
+			return 0;
+		}
+		ktx->size += ktx->level_size[level];
+	}
+	return 1;
+}
+
+//////////////////////////////////////
+// KTX2
+static const u8 ktx2_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+#define KTX2_HEADER_SIZE 80
+#define KTX2_LEVEL_INDEX_SIZE 24
+
+static b32
+parse_ktx2(const u8* data, isize len, struct ktx_texture* ktx) {
+	if (len < KTX2_HEADER_SIZE || memcmp(data, ktx2_identifier, sizeof(ktx2_identifier)) != 0) {
+		return 0;
+	}
+	const struct ktx_format* format = format_from_vk(read_u32(data + 12));
+	u32 depth = read_u32(data + 28);
+	u32 layers = read_u32(data + 32);
+	u32 faces = read_u32(data + 36);
+	u32 levels = read_u32(data + 40);
+	u32 supercompression = read_u32(data + 44);
+	if (!format || depth > 1 || layers > 1 || faces != 1 || supercompression != 0) {
+		return 0;
+	}
+	ktx->width = (int)read_u32(data + 20);
+	ktx->height = (int)read_u32(data + 24);
+	ktx->levels = levels ? (int)levels : 1;
+	if (ktx->levels > KTX_MAX_LEVELS || KTX2_HEADER_SIZE + (isize)ktx->levels * KTX2_LEVEL_INDEX_SIZE > len) {
+		return 0;
+	}
+	for (int level = 0; level < ktx->levels; level++) {
+		const u8* index = data + KTX2_HEADER_SIZE + level * KTX2_LEVEL_INDEX_SIZE;
+		u64 offset = read_u64(index);
+		u64 size = read_u64(index + 8);
+		if (offset > (u64)len || size > (u64)len - offset) {
+			return 0;
+		}
+		ktx->level_data[level] = data + offset;
+		ktx->level_size[level] = (isize)size;
+	}
+	return check_levels(ktx, format);
+}
+
+//////////////////////////////////////
+// DDS
+#define DDS_HEADER_SIZE 128
+#define DDS_DX10_HEADER_SIZE 20
+#define DDS_FOURCC(a, b, c, d) ((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+
+static b32
+parse_dds(const u8* data, isize len, struct ktx_texture* ktx) {
+	if (len < DDS_HEADER_SIZE || read_u32(data) != DDS_FOURCC('D', 'D', 'S', ' ')) {
+		return 0;
+	}
+	ktx->height = (int)read_u32(data + 12);
+	ktx->width = (int)read_u32(data + 16);
+	u32 levels = read_u32(data + 28);
+	ktx->levels = levels ? (int)levels : 1;
+
+	/* legacy FourCCs map onto their DXGI equivalents */
+	u32 dxgi_format = 0;
+	isize offset = DDS_HEADER_SIZE;
+	switch (read_u32(data + 84)) {
+		case DDS_FOURCC('D', 'X', 'T', '1'):
+			dxgi_format = 71;
+			break;
+		case DDS_FOURCC('D', 'X', 'T', '3'):
+			dxgi_format = 74;
+			break;
+		case DDS_FOURCC('D', 'X', 'T', '5'):
+			dxgi_format = 77;
+			break;
+		case DDS_FOURCC('A', 'T', 'I', '1'):
+		case DDS_FOURCC('B', 'C', '4', 'U'):
+			dxgi_format = 80;
+			break;
+		case DDS_FOURCC('B', 'C', '4', 'S'):
+			dxgi_format = 81;
+			break;
+		case DDS_FOURCC('A', 'T', 'I', '2'):
+		case DDS_FOURCC('B', 'C', '5', 'U'):
+			dxgi_format = 83;
+			break;
+		case DDS_FOURCC('B', 'C', '5', 'S'):
+			dxgi_format = 84;
+			break;
+		case DDS_FOURCC('D', 'X', '1', '0'):
+			if (len < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE || read_u32(data + DDS_HEADER_SIZE + 12) > 1) {
+				return 0;
+			}
+			dxgi_format = read_u32(data + DDS_HEADER_SIZE);
+			offset += DDS_DX10_HEADER_SIZE;
+			break;
+	}
+	const struct ktx_format* format = format_from_dxgi(dxgi_format);
+	if (!format || ktx->levels > KTX_MAX_LEVELS) {
+		return 0;
+	}
+	/* levels follow each other, largest first, no padding */
+	for (int level = 0; level < ktx->levels; level++) {
+		int w = ktx->width >> level > 0 ? ktx->width >> level : 1;
+		int h = ktx->height >> level > 0 ? ktx->height >> level : 1;
+		isize size = level_bytes(format, w, h);
+		if (offset + size > len) {
+			return 0;
+		}
+		ktx->level_data[level] = data + offset;
+		ktx->level_size[level] = size;
+		offset += size;
+	}
+	return check_levels(ktx, format);
+}
+
+//////////////////////////////////////
+// ktx
+b32
+ktx_is_container(const char* path) {
+	size_t n = strlen(path);
+	return (n >= 5 && strcmp(path + n - 5, ".ktx2") == 0) || (n >= 4 && strcmp(path + n - 4, ".dds") == 0) ||
+	       (n >= 4 && strcmp(path + n - 4, ".DDS") == 0);
+}
+
+b32
+ktx_open(const char* path, struct ktx_texture* ktx) {
+	memset(ktx, 0, sizeof(*ktx));
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		gl_log_err("ERROR: could not open texture %s\n", path);
+		return 0;
+	}
+	struct stat st;
+	void* map = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size > 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (map == MAP_FAILED) {
+		gl_log_err("ERROR: could not map texture %s\n", path);
+		return 0;
+	}
+	ktx->map = map;
+	ktx->map_size = st.st_size;
+
+	const u8* data = map;
+	if (!parse_ktx2(data, ktx->map_size, ktx) && !parse_dds(data, ktx->map_size, ktx)) {
+		gl_log_err("ERROR: unsupported texture container %s\n", path);
+		ktx_close(ktx);
+		return 0;
+	}
+	volatile u8 sink = 0;
+	for (isize i = 0; i < ktx->map_size; i += 4096) {
+		sink += data[i];
+	}
+	(void)sink;
+	return 1;
+}
+
+void
+ktx_close(struct ktx_texture* ktx) {
+	if (ktx->map) {
+		munmap(ktx->map, ktx->map_size);
+	}
+	memset(ktx, 0, sizeof(*ktx));
+}
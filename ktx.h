@@ -0,0 +1,35 @@
+#ifndef KTX_H
+#define KTX_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Block-compressed texture containers.
+ * ktx_open() maps a KTX2 or DDS file read-only and points each mip level straight into the
+ * mapping, so the levels reach glCompressedTexSubImage2D without being copied or decoded.
+ * Supported: BC1-BC7 and ETC2/EAC, 2D, single layer, no supercompression. */
+
+#define KTX_MAX_LEVELS 16
+
+struct ktx_texture {
+	GLenum format; /* compressed internal format, sRGB variants included */
+	int width;
+	int height;
+	int levels;
+	const u8* level_data[KTX_MAX_LEVELS];
+	isize level_size[KTX_MAX_LEVELS];
+	isize size; /* sum of level_size */
+	void* map;
+	isize map_size;
+};
+
+/* true for *.ktx2 and *.dds */
+b32 ktx_is_container(const char* path);
+/* also touches every page so later reads on the GL thread do not fault */
+b32 ktx_open(const char* path, struct ktx_texture* ktx);
+void ktx_close(struct ktx_texture* ktx);
+/* bytes per 4x4 block of a supported compressed format, 0 for anything else */
+isize ktx_format_block_bytes(GLenum gl_format);
+
+#endif
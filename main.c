@@ -1,4 +1,4 @@
-#include <GL/glew.h>
+#include "gl_loader.h"
 #include <GLFW/glfw3.h>
 #include <stdio.h>
 #include <string.h>
@@ -10,88 +10,37 @@
 #include <time.h>
 #include <assert.h>
 
-#define GL_LOG_FILE "gl.log"
+#include "common.h"
+#include "math3d.h"
+#include "jobs.h"
+#include "bvh.h"
+#include "occlusion.h"
+#include "gpu_profiler.h"
+#include "cpu_trace.h"
+#include "capture.h"
+#include "recorder.h"
+#include "texture.h"
+#include "render_target.h"
+#include "vt.h"
+#include "framegraph.h"
+#include "gl_trace.h"
+#include "stats.h"
+#include "gpu_memory.h"
+#include "gpu_heap.h"
+#include "game_loop.h"
+#include "frame_pacing.h"
+#include "input.h"
+#include "camera.h"
+#include "shader.h"
+#include "pipeline.h"
+#include "overlay.h"
 
-typedef int32_t b32;
-typedef uint32_t u32;
-typedef int32_t i32;
-typedef ptrdiff_t isize;
-// typedef size_t usize;
-
-#define ARRAY_SIZE(arr) (isize)(sizeof(arr) / sizeof((arr)[0]))
 #define handle_error()                         \
 	({                                         \
 		printf("Error %s\n", strerror(errno)); \
 		exit(-1);                              \
 	})
 
-b32
-restart_gl_log() {
-	FILE* file = fopen(GL_LOG_FILE, "w");
-	if (!file) {
-		fprintf(stderr, "ERROR: could not open GL_LOG_FILE log file %s for writing\n", GL_LOG_FILE);
-		return 0;
-	}
-	time_t now = time(NULL);
-	char* date = ctime(&now);
-	fprintf(file, "GL_LOG_FILE log, local time %s\n", date);
-	fclose(file);
-	return 1;
-}
-
-b32
-gl_log(const char* message, ...) {
-	va_list argptr;
-
-	FILE* file = fopen(GL_LOG_FILE, "a");
-	if (!file) {
-		fprintf(stderr, "ERROR: could not open GL_LOG_FILE %s file for appending\n", GL_LOG_FILE);
-		return 0;
-	}
-
-	va_start(argptr, message);
-	vfprintf(file, message, argptr);
-	va_end(argptr);
-	fclose(file);
-	return 1;
-}
-
-b32
-gl_log_err(const char* message, ...) {
-	va_list argptr;
-
-	FILE* file = fopen(GL_LOG_FILE, "a");
-	if (!file) {
-		fprintf(stderr, "ERROR: could not open GL_LOG_FILE %s file for appending\n", GL_LOG_FILE);
-		return 0;
-	}
-
-	va_start(argptr, message);
-	vfprintf(file, message, argptr);
-	va_end(argptr);
-
-	va_start(argptr, message);
-	vfprintf(stderr, message, argptr);
-	va_end(argptr);
-
-	fclose(file);
-	return 1;
-}
-
-char*
-read_shader(char* filepath) {
-	FILE* fp = fopen(filepath, "r");
-	if (!fp) {
-		handle_error();
-	}
-
-	size_t buffer_size = 4096;
-	char* buffer = calloc(buffer_size, 1);
-	fread(buffer, buffer_size, sizeof(*buffer), fp);
-
-	return buffer;
-}
-
 void
 glfw_error_callback(int error, const char* description) {
 	gl_log_err("GLFW ERROR: code %i msg: %s\n", error, description);
@@ -143,64 +92,6 @@ log_gl_params() {
 	gl_log("-----------------------------\n");
 }
 
-/* print errors in shader compilation */
-void
-print_shader_info_log(GLuint shader_index) {
-	int max_len = 2048;
-	int actual_len = 0;
-	char log[2048];
-	glGetShaderInfoLog(shader_index, max_len, &actual_len, log);
-	printf("shader info log for GL index %i:\n%s\n", shader_index, log);
-}
-
-/* print errors if shader linking*/
-void
-print_program_info_log(GLuint sp) {
-	int max_len = 2048;
-	int actual_len = 0;
-	char log[2048];
-	glGetProgramInfoLog(sp, max_len, &actual_len, log);
-	printf("program info log for GL index %i:\n%s", sp, log);
-}
-
-b32
-validate_shader(GLuint sp) {
-	int params = -1;
-
-	glValidateProgram(sp);
-	glGetProgramiv(sp, GL_VALIDATE_STATUS, &params);
-	printf("program %i GL_VALIDATE_STATUS = %i\n", sp, params);
-	if (GL_TRUE != params) {
-		print_program_info_log(sp);
-		return 0;
-	}
-	return 1;
-}
-
-void
-print_all_about_shader(GLuint sp) {
-	// TODO
-}
-
-double previous_seconds;
-int frame_count;
-void
-update_fps_counter(GLFWwindow* window) {
-	double current_seconds;
-	double elapsed_seconds;
-	current_seconds = glfwGetTime();
-	elapsed_seconds = current_seconds - previous_seconds;
-	if (elapsed_seconds > 0.25) {
-		previous_seconds = current_seconds;
-		char tmp[128];
-		double fps = (double)frame_count / elapsed_seconds;
-		sprintf(tmp, "opengl @ fps: %.2f", fps);
-		glfwSetWindowTitle(window, tmp);
-		frame_count = 0;
-	}
-	frame_count++;
-}
-
 // Reported window size
 int g_win_width = 640;
 int g_win_height = 480;
@@ -220,113 +111,408 @@ glfw_framebuffer_resize_callback(GLFWwindow* window, int width, int height) {
 	(void)window;
 	g_fb_width = width;
 	g_fb_height = height;
-
-	/* TODO: Later update any perspective matrices used here */
+	/* pooled targets sized from the framebuffer are recreated lazily on their next use */
+	rt_pool_resize(width, height);
+	/* the projection follows the aspect ratio, it is recomputed on the next camera_update() */
+	camera_resize(width, height);
 }
 
 //////////////////////////////////////
-// shader manager
-enum {
-	UNIFORM_COLOR_0 = 0,
+// scene
+#define SCENE_HEAP_BUFFER_SIZE (4 << 20)
+#define SCENE_DEFRAGMENT_BYTES (256 << 10) /* copied per frame at most */
+
+/* picking an object kicks a damped spring that flashes it towards white */
+#define HIGHLIGHT_KICK 12.0f
+#define HIGHLIGHT_STIFFNESS 150.0f
+#define HIGHLIGHT_DAMPING 6.0f
+
+/* interleaved, every mesh lives in scene.heap: its vertices, then its 16-bit indices */
+struct scene_vertex {
+	GLfloat position[3];
+	GLfloat color[3];
 };
 
-struct shader_program {
-	GLuint handle;
-	GLint uniform_locations[10];
+struct scene_object {
+	struct aabb bounds;
+	i32 mesh; /* gpu_heap allocation, aligned to the vertex size so its offset is a base vertex */
+	isize index_offset; /* bytes from the start of the mesh */
+	GLsizei index_count;
+	GLsizei vertex_count;
+	const GLfloat* occluder_points; /* CPU copy of the positions when the object is an occluder */
 };
 
-struct shaders {
-	b32 ok;
-	isize active_index;
-	struct shader_program programs[16];
-	isize shader_programs_len;
+/* simulated per object at the fixed tick */
+struct scene_highlight {
+	float value;
+	float velocity;
 };
 
-static struct shaders shaders = {0};
+struct scene {
+	struct scene_object objects[64];
+	struct aabb object_bounds[64];
+	isize objects_len;
+	struct bvh bvh;
+	u32 visible[64];
+	isize visible_len;
+	struct gpu_heap heap;
+	GLuint vertex_arrays[GPU_HEAP_MAX_BUFFERS]; /* one per heap buffer, created on first draw */
+	struct scene_highlight highlights[64];
+	struct scene_highlight previous_highlights[64]; /* before the last tick, drawn blended by the tick alpha */
+};
 
-static void
-load_shader_program(struct shaders* shaders, isize shader_program_index, char* vs_filename, char* fs_filename) {
-	assert(shader_program_index < ARRAY_SIZE(shaders->programs));
-	assert(vs_filename);
-	assert(fs_filename);
-
-	// TODO simplify memory allocations: use arenas
-	const char* vs_text = read_shader(vs_filename);
-	GLuint vert_shader = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vert_shader, 1, &vs_text, NULL);
-	glCompileShader(vert_shader);
-	free((void*)vs_text);
-
-	int params = -1;
-	glGetShaderiv(vert_shader, GL_COMPILE_STATUS, &params);
-	if (GL_TRUE != params) {
-		fprintf(stderr, "ERROR: GL shader index %i did not compile\n", vert_shader);
-		print_shader_info_log(vert_shader);
-		exit(1);
-	}
-
-	// TODO simplify memory allocations: use arenas
-	const char* fs_text = read_shader(fs_filename);
-	GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(frag_shader, 1, &fs_text, NULL);
-	glCompileShader(frag_shader);
-	free((void*)fs_text);
-
-	glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &params);
-	if (GL_TRUE != params) {
-		fprintf(stderr, "ERROR: GL shader index %i did not compile\n", frag_shader);
-		print_shader_info_log(frag_shader);
-		exit(1);
-	}
-
-	GLuint shader_program_handle = glCreateProgram();
-	glAttachShader(shader_program_handle, frag_shader);
-	glAttachShader(shader_program_handle, vert_shader);
-	glLinkProgram(shader_program_handle);
-
-	/* check for shader linking errors - very important! */
-	glGetProgramiv(shader_program_handle, GL_LINK_STATUS, &params);
-	if (GL_TRUE != params) {
-		fprintf(stderr, "ERROR: could not link shader programme GL index %i\n", shader_program_handle);
-		print_program_info_log(shader_program_handle);
-		exit(1);
-	}
-
-	print_all_about_shader(shader_program_handle);
-	b32 result = validate_shader(shader_program_handle);
-	assert(result);
-
-	/* Init shader uniform. */
-	GLint color_loc = glGetUniformLocation(shader_program_handle, "inputColor");
-	assert(color_loc > -1);
-
-	shaders->programs[shader_program_index] = (struct shader_program){
-	    .handle = shader_program_handle,
-	    .uniform_locations =
-	        {
-	            [UNIFORM_COLOR_0] = color_loc,
-	        },
+static struct scene scene = {0};
+
+/* a triangle of height 1 at the origin fills a bit over half the view */
+static struct camera camera = {
+    .projection = CAMERA_PERSPECTIVE,
+    .position = {0.0f, 0.0f, 1.5f},
+    .fov_y = 60.0f * 3.14159265f / 180.0f,
+    .height = 2.0f,
+    .near = 0.05f,
+    .far = 100.0f,
+};
+
+static isize
+scene_add_object(struct scene* scene, const GLfloat* points, const GLfloat* colors, GLsizei vertex_count,
+                 const u16* indices, GLsizei index_count, b32 occluder) {
+	assert(scene->objects_len < ARRAY_SIZE(scene->objects));
+	struct aabb bounds = aabb_empty();
+	for (GLsizei i = 0; i < vertex_count; i++) {
+		bounds = aabb_grow(bounds, vec3_make(points[i * 3 + 0], points[i * 3 + 1], points[i * 3 + 2]));
+	}
+
+	isize vertex_bytes = vertex_count * (isize)sizeof(struct scene_vertex);
+	isize index_bytes = index_count * (isize)sizeof(u16);
+	i32 mesh = gpu_heap_alloc(&scene->heap, vertex_bytes + index_bytes, sizeof(struct scene_vertex));
+	if (mesh < 0) {
+		return -1;
+	}
+	struct scene_vertex* vertices = malloc(vertex_bytes);
+	for (GLsizei i = 0; i < vertex_count; i++) {
+		memcpy(vertices[i].position, &points[i * 3], sizeof(vertices[i].position));
+		memcpy(vertices[i].color, &colors[i * 3], sizeof(vertices[i].color));
+	}
+	gpu_heap_upload(&scene->heap, mesh, 0, vertex_bytes, vertices);
+	gpu_heap_upload(&scene->heap, mesh, vertex_bytes, index_bytes, indices);
+	free(vertices);
+
+	isize index = scene->objects_len++;
+	scene->objects[index] = (struct scene_object){
+	    .bounds = bounds,
+	    .mesh = mesh,
+	    .index_offset = vertex_bytes,
+	    .index_count = index_count,
+	    .vertex_count = vertex_count,
+	    .occluder_points = occluder ? points : NULL,
 	};
-	return;
+	scene->object_bounds[index] = bounds;
+	return index;
+}
+
+/* attributes start at offset 0 of the heap buffer, meshes are reached through the base vertex */
+static GLuint
+scene_vertex_array(struct scene* scene, struct gpu_heap_range range) {
+	GLuint* vao = &scene->vertex_arrays[range.buffer_index];
+	if (!*vao) {
+		GPU_MEM_OWNER("scene");
+		glGenVertexArrays(1, vao);
+		pipeline_bind_vertex_array(*vao);
+		glBindBuffer(GL_ARRAY_BUFFER, range.buffer);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(struct scene_vertex),
+		                      (void*)offsetof(struct scene_vertex, position));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(struct scene_vertex),
+		                      (void*)offsetof(struct scene_vertex, color));
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, range.buffer);
+	}
+	return *vao;
+}
+
+static void
+scene_tick(struct scene* scene, float dt) {
+	memcpy(scene->previous_highlights, scene->highlights, sizeof(scene->highlights[0]) * scene->objects_len);
+	for (isize i = 0; i < scene->objects_len; i++) {
+		/* semi-implicit Euler, stable for the spring at any tick rate above ~5 Hz */
+		struct scene_highlight* h = &scene->highlights[i];
+		h->velocity += (-HIGHLIGHT_STIFFNESS * h->value - HIGHLIGHT_DAMPING * h->velocity) * dt;
+		h->value += h->velocity * dt;
+	}
+}
+
+static float
+scene_highlight(const struct scene* scene, isize object, float alpha) {
+	float previous = scene->previous_highlights[object].value;
+	float value = previous + (scene->highlights[object].value - previous) * alpha;
+	return fminf(fabsf(value), 1.0f);
+}
+
+static void
+scene_shutdown(struct scene* scene) {
+	gpu_heap_log(&scene->heap);
+	for (isize i = 0; i < scene->objects_len; i++) {
+		gpu_heap_free(&scene->heap, scene->objects[i].mesh);
+	}
+	gpu_heap_shutdown(&scene->heap);
+	for (isize i = 0; i < GPU_HEAP_MAX_BUFFERS; i++) {
+		if (scene->vertex_arrays[i]) {
+			glDeleteVertexArrays(1, &scene->vertex_arrays[i]);
+		}
+	}
+	bvh_free(&scene->bvh);
+}
+
+/* cull against the view-projection frustum, then against the visible occluders; leaves the draw list in
+ * scene->visible */
+static void
+scene_cull(struct scene* scene, struct mat4 view_proj) {
+	struct frustum frustum = frustum_from_mat4(view_proj);
+	scene->visible_len = bvh_query_frustum(&scene->bvh, &frustum, scene->visible, ARRAY_SIZE(scene->visible));
+
+	occlusion_begin_frame(view_proj);
+	for (isize i = 0; i < scene->visible_len; i++) {
+		struct scene_object* object = &scene->objects[scene->visible[i]];
+		if (object->occluder_points) {
+			occlusion_add_occluder(object->occluder_points, NULL, object->vertex_count / 3);
+		}
+	}
+	occlusion_render();
+
+	isize kept = 0;
+	for (isize i = 0; i < scene->visible_len; i++) {
+		struct scene_object* object = &scene->objects[scene->visible[i]];
+		if (object->occluder_points || occlusion_test_aabb(object->bounds)) {
+			scene->visible[kept++] = scene->visible[i];
+		}
+	}
+	scene->visible_len = kept;
+}
+
+/* x and y in window coordinates */
+static void
+scene_pick(struct scene* scene, float x, float y) {
+	struct ray ray = camera_ray(&camera, x / g_win_width * 2.0f - 1.0f, 1.0f - y / g_win_height * 2.0f);
+	u32 hit_object;
+	float hit_t;
+	if (bvh_raycast(&scene->bvh, ray, FLT_MAX, NULL, NULL, &hit_object, &hit_t)) {
+		gl_log("picked scene object %u at t=%f\n", hit_object, hit_t);
+		scene->highlights[hit_object].velocity += HIGHLIGHT_KICK;
+	}
+}
+
+struct options {
+	const char* gpu_profile_path;
+	const char* trace_path;
+	const char* screenshot_path;
+	const char* record_path;
+	double record_fps; /* 0: the rate frames are produced at, see record_fps() */
+	b32 headless;
+	long frames; /* stop after this many frames, 0 runs until the window closes */
+	const char* texture_paths[16];
+	isize texture_paths_len;
+	const char* virtual_texture_path;
+	const char* framegraph_dump_path;
+	const char* gl_trace_path;
+	long gl_trace_first_frame; /* frames before it are recorded as untimed setup */
+	long gl_trace_last_frame;  /* -1: through the last frame of --frames, or 60 frames */
+	const char* stats_json_path;
+	b32 stats_overlay; /* F3 toggles it */
+	double tick_rate;  /* simulation ticks per second */
+	int vsync;         /* enum vsync_mode, -1: on, off when headless */
+	double max_fps;    /* 0: no frame limiter */
+	b32 low_latency;
+	const char* shader_defines; /* of the scene's shader variant */
+};
+
+static struct options options = {.gl_trace_last_frame = -1, .tick_rate = 60.0, .vsync = -1};
+
+static void
+parse_args(int argc, char** argv) {
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--gpu-profile") == 0 && i + 1 < argc) {
+			options.gpu_profile_path = argv[++i];
+		} else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			options.trace_path = argv[++i];
+		} else if (strcmp(argv[i], "--screenshot") == 0 && i + 1 < argc) {
+			options.screenshot_path = argv[++i];
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			options.record_path = argv[++i];
+		} else if (strcmp(argv[i], "--record-fps") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0.0) {
+			options.record_fps = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			options.frames = strtol(argv[++i], NULL, 10);
+		} else if (strcmp(argv[i], "--texture") == 0 && i + 1 < argc &&
+		           options.texture_paths_len < ARRAY_SIZE(options.texture_paths)) {
+			options.texture_paths[options.texture_paths_len++] = argv[++i];
+		} else if (strcmp(argv[i], "--virtual-texture") == 0 && i + 1 < argc) {
+			options.virtual_texture_path = argv[++i];
+		} else if (strcmp(argv[i], "--framegraph-dump") == 0 && i + 1 < argc) {
+			options.framegraph_dump_path = argv[++i];
+		} else if (strcmp(argv[i], "--gl-trace") == 0 && i + 1 < argc) {
+			options.gl_trace_path = argv[++i];
+		} else if (strcmp(argv[i], "--gl-trace-frames") == 0 && i + 1 < argc &&
+		           sscanf(argv[i + 1], "%li:%li", &options.gl_trace_first_frame, &options.gl_trace_last_frame) == 2) {
+			i++;
+		} else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+			options.stats_json_path = argv[++i];
+		} else if (strcmp(argv[i], "--stats-overlay") == 0) {
+			options.stats_overlay = 1;
+		} else if (strcmp(argv[i], "--tick-rate") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0.0) {
+			options.tick_rate = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--vsync") == 0 && i + 1 < argc &&
+		           (strcmp(argv[i + 1], "off") == 0 || strcmp(argv[i + 1], "on") == 0 ||
+		            strcmp(argv[i + 1], "adaptive") == 0)) {
+			i++;
+			options.vsync = argv[i][1] == 'f' ? VSYNC_OFF : argv[i][0] == 'o' ? VSYNC_ON : VSYNC_ADAPTIVE;
+		} else if (strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc) {
+			options.max_fps = atof(argv[++i]);
+		} else if (strcmp(argv[i], "--low-latency") == 0) {
+			options.low_latency = 1;
+		} else if (strcmp(argv[i], "--shader-defines") == 0 && i + 1 < argc) {
+			options.shader_defines = argv[++i];
+		} else if (strcmp(argv[i], "--headless") == 0) {
+			options.headless = 1;
+		} else {
+			fprintf(stderr,
+			        "usage: %s [--headless] [--frames N] [--screenshot out.png|out.ppm] [--record out.y4m] "
+			        "[--gpu-profile out.json] [--trace out.json] [--texture file.png|file.tga|file.ktx2|file.dds]... "
+			        "[--record-fps N] [--virtual-texture file.vt] [--framegraph-dump out.dot] [--gl-trace out.gltrace] "
+			        "[--gl-trace-frames first:last] [--stats-json out.json] [--stats-overlay] [--tick-rate hz] "
+			        "[--vsync off|on|adaptive] [--max-fps N] [--low-latency] "
+			        "[--shader-defines \"NAME NAME=VALUE...\"]\n",
+			        argv[0]);
+			exit(1);
+		}
+	}
+}
+
+/* what the frame's passes draw with */
+struct frame_context {
+	struct virtual_texture* vt; /* NULL without --virtual-texture */
+	GLuint vt_quad_vao;
+	i32 shader_variant;
+	i32 scene_pipeline;
+	i32 texture; /* the first --texture, drawn on the scene with the TEXTURED variant; -1 without */
+	const struct camera_matrices* camera;
+	float alpha; /* of a simulation tick past the latest state, see game_loop.h */
+};
+
+static void
+vt_feedback_pass(struct framegraph* fg, void* user) {
+	(void)fg;
+	struct frame_context* frame = user;
+	TRACE_ZONE("vt feedback");
+	vt_begin_feedback(frame->vt, mat4_identity(), g_fb_width, g_fb_height);
+	pipeline_bind_vertex_array(frame->vt_quad_vao);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	vt_end_feedback(frame->vt);
+	vt_update(frame->vt);
+}
+
+static void
+scene_pass(struct framegraph* fg, void* user) {
+	(void)fg;
+	struct frame_context* frame = user;
+	/* wipe the drawing surface clear */
+	{
+		TRACE_ZONE("glClear");
+		static const float clear_color[4] = {0.6f, 0.6f, 0.8f, 1.0f};
+		pipeline_clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, clear_color, CAMERA_CLEAR_DEPTH);
+	}
+
+	if (frame->vt) {
+		/* the quad is in clip space, vt_bind() draws it behind everything */
+		vt_bind(frame->vt, mat4_identity());
+		pipeline_bind_vertex_array(frame->vt_quad_vao);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	}
+
+	pipeline_bind(frame->scene_pipeline);
+	if (frame->texture >= 0) {
+		/* the placeholder checkerboard until the texture is resident */
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture_get(frame->texture));
+	}
+	GLint color_location = shader_uniform(frame->shader_variant, SHADER_UNIFORM_COLOR);
+
+	{
+		TRACE_ZONE("scene_cull");
+		scene_cull(&scene, frame->camera->cull_view_projection);
+	}
+	{
+		TRACE_ZONE("draw");
+		for (isize i = 0; i < scene.visible_len; i++) {
+			struct scene_object* object = &scene.objects[scene.visible[i]];
+			// @TODO Update uniform only when need it. Do not upate it on every change
+			float highlight = scene_highlight(&scene, scene.visible[i], frame->alpha);
+			glUniform4f(color_location, 1.0f, highlight, highlight, 1.0f);
+			struct gpu_heap_range range = gpu_heap_range(&scene.heap, object->mesh);
+			pipeline_bind_vertex_array(scene_vertex_array(&scene, range));
+			glDrawElementsBaseVertex(GL_TRIANGLES, object->index_count, GL_UNSIGNED_SHORT,
+			                         (void*)(range.offset + object->index_offset),
+			                         gpu_heap_base_vertex(&scene.heap, object->mesh, sizeof(struct scene_vertex)));
+		}
+	}
+}
+
+static void
+overlay_pass(struct framegraph* fg, void* user) {
+	(void)fg;
+	(void)user;
+	stats_draw_overlay(8.0f, 8.0f);
+	overlay_draw(g_fb_width, g_fb_height);
+}
+
+static void
+capture_pass(struct framegraph* fg, void* user) {
+	(void)fg;
+	(void)user;
+	capture_end_frame(g_fb_width, g_fb_height);
+	recorder_end_frame(g_fb_width, g_fb_height);
+}
+
+/* Y4M has a single frame rate, so the recording plays back in real time only at the rate frames are
+ * actually produced: one tick per frame headless, otherwise the limiter or the display refresh */
+static double
+record_fps(void) {
+	if (options.record_fps > 0.0) {
+		return options.record_fps;
+	}
+	if (options.headless) {
+		return options.tick_rate;
+	}
+	double refresh = 0.0;
+	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	if (options.vsync != VSYNC_OFF && mode && mode->refreshRate > 0) {
+		refresh = mode->refreshRate;
+	}
+	if (options.max_fps > 0.0 && (refresh == 0.0 || options.max_fps < refresh)) {
+		return options.max_fps;
+	}
+	if (refresh == 0.0) {
+		gl_log_err("WARNING: --record without vsync or --max-fps, the frame rate varies; assuming 60 fps, "
+		           "see --record-fps\n");
+		return 60.0;
+	}
+	return refresh;
 }
 
 int
-main() {
+main(int argc, char** argv) {
 	const GLubyte* renderer;
 	const GLubyte* version;
-	GLuint vao_1;
-	GLuint vao_2;
-	GLuint points_vbo;
-	GLuint colors_vbo;
-	GLuint inverted_points_vbo;
-	GLuint inverted_points_colors_vbo;
+	GLuint vt_quad_vao = 0;
+	GLuint vt_quad_vbo = 0;
 
 	/* geometry to use. these are 3 xyz points (9 floats total) to make a triangle */
 	GLfloat points[] = {0.0f, 0.5f, 0.0f, 0.5f, -0.5f, 0.0f, -0.5f, -0.5f, 0.0f};
 	GLfloat colors[] = {1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f};
+	u16 indices[] = {0, 1, 2};
 
-	GLfloat inverted_points[] = {0.0f, -0.5f, 0.0f, -0.5f, 0.5f, 0.0f, 0.5f, 0.5f, 0.0f};
-	GLfloat inverted_points_colors[] = {0.8f, 0.0f, 0.0f, 0.0f, 0.8f, 0.0f, 1.0f, 0.0f, 0.0f};
+	parse_args(argc, argv);
+	trace_init();
+	TRACE_THREAD_NAME("main");
 
 	if (!restart_gl_log()) {
 		handle_error();
@@ -347,6 +533,10 @@ main() {
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 	glfwWindowHint(GLFW_SAMPLES, 4);
+	/* headless runs still need a context; an invisible window is the portable way to get one with GLFW */
+	if (options.headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 
 	// Fullscreen
 	// GLFWmonitor* mon = glfwGetPrimaryMonitor();
@@ -360,6 +550,12 @@ main() {
 	}
 	glfwSetFramebufferSizeCallback(window, glfw_framebuffer_resize_callback);
 	glfwSetWindowSizeCallback(window, glfw_window_size_callback);
+	input_install(window);
+	input_bind(ACTION_QUIT, INPUT_KEY, GLFW_KEY_ESCAPE);
+	input_bind(ACTION_RELOAD_SHADERS, INPUT_KEY, GLFW_KEY_R);
+	input_bind(ACTION_SCREENSHOT, INPUT_KEY, GLFW_KEY_F12);
+	input_bind(ACTION_TOGGLE_OVERLAY, INPUT_KEY, GLFW_KEY_F3);
+	input_bind(ACTION_PICK, INPUT_MOUSE_BUTTON, GLFW_MOUSE_BUTTON_LEFT);
 	glfwMakeContextCurrent(window);
 
 	glfwGetWindowSize(window, &g_win_width, &g_win_height);
@@ -367,9 +563,22 @@ main() {
 	glfwGetFramebufferSize(window, &g_fb_width, &g_fb_height);
 	gl_log("initial framebuffer dims %ix%i\n", g_fb_width, g_fb_height);
 
-	/* start GLEW extension handler */
-	glewExperimental = GL_TRUE;
-	glewInit();
+	/* resolve only the GL entry points the sources use (see tools/gen_gl_loader.sh) */
+	int missing_gl_functions = gl_loader_load(glfwGetProcAddress);
+	gl_log("gl loader: %i of %i entry points resolved\n", gl_loader_count - missing_gl_functions, gl_loader_count);
+	/* before any other GL call, so the trace creates every object the recorded frames use */
+	if (options.gl_trace_path) {
+		long last_frame = options.gl_trace_last_frame;
+		if (last_frame < 0) {
+			last_frame = options.frames > 0 ? options.frames - 1 : options.gl_trace_first_frame + 59;
+		}
+		if (!gl_trace_begin(options.gl_trace_path, options.gl_trace_first_frame, last_frame, g_fb_width,
+		                    g_fb_height)) {
+			return 1;
+		}
+	}
+	stats_init();
+	gpu_mem_init();
 
 	/* get version info */
 	renderer = glGetString(GL_RENDERER); /* get renderer string */
@@ -378,70 +587,83 @@ main() {
 	printf("OpenGL version supported %s\n", version);
 	gl_log("renderer: %s\nversion: %s\n", renderer, version);
 	log_gl_params();
-
-	/* tell GL to only draw onto a pixel if the shape is closer to the viewer
-	than anything already drawn at that pixel */
-	glEnable(GL_DEPTH_TEST); /* enable depth-testing */
-	/* with LESS depth-testing interprets a smaller depth value as meaning "closer" */
-	glDepthFunc(GL_LESS);
-
-	/* a vertex buffer object (VBO) is created here. this stores an array of
-	data on the graphics adapter's memory. in our case - the vertex points */
-	glGenBuffers(1, &points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), points, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), colors, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &inverted_points_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, inverted_points_vbo);
-	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), inverted_points, GL_STATIC_DRAW);
-
-	glGenBuffers(1, &inverted_points_colors_vbo);
-	glBindBuffer(GL_ARRAY_BUFFER, inverted_points_colors_vbo);
-	glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), inverted_points_colors, GL_STATIC_DRAW);
-
-	/* the vertex array object (VAO) is a little descriptor that defines which
-	data from vertex buffer objects should be used as input variables to vertex
-	shaders. in our case - use our only VBO, and say 'every three floats is a
-	variable' */
-	glGenVertexArrays(1, &vao_1);
-	glBindVertexArray(vao_1);
-	/* "attribute #0 should be enabled when this vao_1 is bound" */
-	glEnableVertexAttribArray(0);
-	/* this VBO is already bound, but it's a good habit to explicitly specify which
-	VBO's data the following vertex attribute pointer refers to */
-	glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-	/* "attribute #0 is created from every 3 variables in the above buffer, of type
-	float (i.e. make me vec3s)" */
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, colors_vbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-
-	glGenVertexArrays(1, &vao_2);
-	glBindVertexArray(vao_2);
-	glEnableVertexAttribArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, inverted_points_vbo);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-	glEnableVertexAttribArray(1);
-	glBindBuffer(GL_ARRAY_BUFFER, inverted_points_colors_vbo);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, NULL);
-
-	// TODO Move to shader managment
-	isize shader_program_0 = 0;
-	load_shader_program(&shaders, shader_program_0, "test.vert", "test.frag");
-
-	// frag_shader_2 = glCreateShader(GL_FRAGMENT_SHADER);
-	// glShaderSource(frag_shader_2, 1, &fragment_shader_2, NULL);
-	// glCompileShader(frag_shader_2);
-	// shader_programm_2 = glCreateProgram();
-	// glAttachShader(shader_programm_2, frag_shader_2);
-	// glAttachShader(shader_programm_2, vert_shader);
-	// glLinkProgram(shader_programm_2);
+	if (options.vsync < 0) {
+		/* nobody watches a headless run, don't let it wait for vblanks */
+		options.vsync = options.headless ? VSYNC_OFF : VSYNC_ON;
+	}
+	frame_pacing_init((struct frame_pacing_config){
+	    .vsync = options.vsync,
+	    .max_fps = options.max_fps,
+	    .low_latency = options.low_latency,
+	});
+
+	/* GL state that draws depend on is only set through pipelines (pipeline.h) */
+	pipeline_init();
+	camera_system_init(g_fb_width, g_fb_height);
+
+	/* vertex and index data of every mesh is suballocated from a few large buffers (gpu_heap.h) */
+	gpu_heap_init(&scene.heap, "scene", SCENE_HEAP_BUFFER_SIZE);
+
+	jobs_init(0);
+	occlusion_init();
+	gpu_profiler_init();
+	texture_system_init();
+	rt_pool_init(g_fb_width, g_fb_height);
+	i32 scene_texture = -1;
+	for (isize i = 0; i < options.texture_paths_len; i++) {
+		i32 texture = texture_load(options.texture_paths[i], TEXTURE_SRGB);
+		scene_texture = i == 0 ? texture : scene_texture;
+	}
+	if (options.headless) {
+		/* a screenshot should not depend on how far the decode jobs got */
+		texture_system_finish();
+	}
+	capture_init();
+	overlay_init();
+	static struct virtual_texture vt;
+	b32 vt_enabled = 0;
+	if (options.virtual_texture_path) {
+		vt_enabled = vt_open(&vt, options.virtual_texture_path, 16);
+		/* full-screen quad behind the scene: xyz, uv */
+		GPU_MEM_OWNER("scene");
+		GLfloat quad[] = {-1, -1, 0.5f, 0, 0, 1, -1, 0.5f, 1, 0, -1, 1, 0.5f, 0, 1, 1, 1, 0.5f, 1, 1};
+		glGenBuffers(1, &vt_quad_vbo);
+		glBindBuffer(GL_ARRAY_BUFFER, vt_quad_vbo);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+		glGenVertexArrays(1, &vt_quad_vao);
+		glBindVertexArray(vt_quad_vao);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), NULL);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (void*)(3 * sizeof(GLfloat)));
+		pipeline_invalidate();
+	}
+	if (options.record_path && !recorder_init(options.record_path, record_fps())) {
+		return 1;
+	}
+	scene_add_object(&scene, points, colors, 3, indices, 3, 1);
+	bvh_build(&scene.bvh, scene.object_bounds, scene.objects_len);
+
+	/* the scene's permutation of test.vert and test.frag, e.g. --shader-defines VERTEX_COLOR */
+	const char* defines = options.shader_defines ? options.shader_defines : "";
+	char scene_defines[SHADER_DEFINES_MAX];
+	snprintf(scene_defines, sizeof(scene_defines), "%s%s%s", defines, defines[0] && scene_texture >= 0 ? " " : "",
+	         scene_texture >= 0 ? "TEXTURED" : "");
+	i32 scene_shader = shader_variant("test.vert", "test.frag", scene_defines);
+	if (!shader_program(scene_shader)) {
+		gl_log_err("ERROR: the scene shader did not compile\n");
+		return 1;
+	}
+	/* tell GL to only draw onto a pixel if the shape is closer to the viewer than anything already
+	drawn at that pixel. depth is reversed, GREATER interprets a larger depth value as meaning
+	"closer" (camera.h) */
+	i32 scene_pipeline = pipeline_create(&(struct pipeline_desc){
+	    .name = "scene",
+	    .shader_variant = scene_shader,
+	    .depth_test = 1,
+	    .depth_func = CAMERA_DEPTH_FUNC,
+	    .depth_write = 1,
+	});
 
 	/* this loop clears the drawing surface, then draws the geometry described
 	    by the VAO onto the drawing surface. we 'poll events' to see if the window
@@ -450,42 +672,164 @@ main() {
 	    that we have a 'currently displayed' surface, and 'currently being drawn'
 	    surface. hence the 'swap' idea. in a single-buffering system we would see
 	    stuff being drawn one-after-the-other */
+	struct frame_context frame = {
+	    .vt = vt_enabled ? &vt : NULL,
+	    .vt_quad_vao = vt_quad_vao,
+	    .shader_variant = scene_shader,
+	    .scene_pipeline = scene_pipeline,
+	    .texture = scene_texture,
+	};
+	struct game_loop loop;
+	game_loop_init(&loop, options.tick_rate, GAME_LOOP_MAX_TICKS);
+	if (options.headless) {
+		/* nothing to keep pace with: a tick per frame keeps headless screenshots reproducible */
+		loop.fixed_frame_ns = loop.tick_ns;
+	}
+	long frame_index = 0;
+	int screenshot_count = 0;
 	while (!glfwWindowShouldClose(window)) {
-		update_fps_counter(window);
-		/* wipe the drawing surface clear */
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glViewport(0, 0, g_fb_width, g_fb_height);
-		glClearColor(0.6f, 0.6f, 0.8f, 1.0f);
-
-		shaders.active_index = shader_program_0;
-		glUseProgram(shaders.programs[shaders.active_index].handle);
-		// @TODO Update uniform only when need it. Do not upate it on every change
-		b32 needUpdateColor = 1;
-		if (needUpdateColor) {
-			glUniform4f(shaders.programs[shaders.active_index].uniform_locations[UNIFORM_COLOR_0], 1.0f, 0.0f, 0.0f,
-			            1.0f);
+		TRACE_ZONE("frame");
+		/* input is sampled after the wait so it is as fresh as possible when the frame is built */
+		{
+			TRACE_ZONE("frame pacing");
+			frame_pacing_begin_frame();
+		}
+		{
+			TRACE_ZONE("glfwPollEvents");
+			glfwPollEvents();
+			input_update();
+		}
+		/* each action fires once per press, however long the key is held */
+		if (input_pressed(ACTION_QUIT)) {
+			glfwSetWindowShouldClose(window, 1);
 		}
+		if (input_pressed(ACTION_RELOAD_SHADERS)) {
+			shader_reload();
+		}
+		if (input_pressed(ACTION_SCREENSHOT)) {
+			char path[64];
+			snprintf(path, sizeof(path), "screenshot_%03i.png", screenshot_count++);
+			capture_request(path);
+		}
+		if (input_pressed(ACTION_TOGGLE_OVERLAY)) {
+			options.stats_overlay = !options.stats_overlay;
+		}
+		if (input_pressed(ACTION_PICK)) {
+			scene_pick(&scene, input_action(ACTION_PICK)->x, input_action(ACTION_PICK)->y);
+		}
+		gpu_mem_set_frame(frame_index);
+		gpu_profiler_begin_frame();
+		rt_pool_begin_frame();
+		texture_system_update(4 * 1024 * 1024);
+		gpu_heap_defragment(&scene.heap, SCENE_DEFRAGMENT_BYTES);
+		{
+			TRACE_ZONE("simulate");
+			int ticks = game_loop_begin_frame(&loop);
+			for (int i = 0; i < ticks; i++) {
+				scene_tick(&scene, (float)loop.tick_seconds);
+			}
+			frame.alpha = (float)loop.alpha;
+		}
+		frame.camera = camera_update(&camera);
 
-		glBindVertexArray(vao_1);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
+		/* with --frames, --screenshot grabs the last frame; otherwise the first one */
+		long screenshot_frame = options.frames > 0 ? options.frames - 1 : 0;
+		if (options.screenshot_path && frame_index == screenshot_frame) {
+			capture_request(options.screenshot_path);
+		}
+
+		static struct framegraph fg;
+		fg_reset(&fg);
+		i32 backbuffer = fg_import_backbuffer(&fg, "backbuffer");
+		if (vt_enabled) {
+			/* transients, so the pool can hand the targets to later offscreen passes; the readback is the
+			 * side effect that keeps the pass */
+			struct rt_desc color, depth;
+			vt_feedback_targets(g_fb_width, g_fb_height, &color, &depth);
+			i32 vt_pass_index = fg_add_pass(&fg, "vt feedback", vt_feedback_pass, &frame, 1);
+			fg_write(&fg, vt_pass_index, fg_create_texture(&fg, "vt feedback color", color), FG_ATTACHMENT);
+			fg_write(&fg, vt_pass_index, fg_create_texture(&fg, "vt feedback depth", depth), FG_ATTACHMENT);
+		}
+		i32 scene_pass_index = fg_add_pass(&fg, "scene", scene_pass, &frame, 0);
+		fg_write(&fg, scene_pass_index, backbuffer, FG_ATTACHMENT);
+		if (options.stats_overlay) {
+			i32 overlay_pass_index = fg_add_pass(&fg, "overlay", overlay_pass, &frame, 0);
+			fg_write(&fg, overlay_pass_index, backbuffer, FG_ATTACHMENT);
+		}
+		i32 capture_pass_index = fg_add_pass(&fg, "capture", capture_pass, &frame, 1);
+		fg_read(&fg, capture_pass_index, backbuffer, FG_SAMPLED);
+		fg_compile(&fg);
+		fg_execute(&fg, g_fb_width, g_fb_height);
+		if (options.framegraph_dump_path && frame_index == 0) {
+			fg_dump(&fg, options.framegraph_dump_path);
+		}
 
-		// glUseProgram(shader_programm_2);
-		// glBindVertexArray(vao_2);
-		// glDrawArrays(GL_TRIANGLES, 0, 6);
+		gpu_profiler_end_frame();
 
-		/* update other events like input handling */
-		glfwPollEvents();
+		gl_trace_end_frame(frame_index);
+		stats_end_frame();
 		/* put the stuff we've been drawing onto the display */
-		glfwSwapBuffers(window);
+		{
+			TRACE_ZONE("glfwSwapBuffers");
+			glfwSwapBuffers(window);
+		}
+		frame_pacing_end_frame();
 
-		if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_ESCAPE)) {
+		frame_index++;
+		if (options.frames > 0 && frame_index >= options.frames) {
 			glfwSetWindowShouldClose(window, 1);
 		}
-		if (GLFW_PRESS == glfwGetKey(window, GLFW_KEY_R)) {
-			load_shader_program(&shaders, shader_program_0, "test.vert", "test.frag");
-		}
 	}
 
+	gl_trace_end();
+	if (options.stats_json_path) {
+		stats_dump_json(options.stats_json_path);
+	}
+	stats_shutdown();
+	overlay_shutdown();
+	recorder_shutdown();
+	capture_shutdown();
+	gpu_profiler_log();
+	if (options.gpu_profile_path) {
+		gpu_profiler_dump(options.gpu_profile_path);
+	}
+	gpu_profiler_shutdown();
+	texture_system_shutdown();
+	if (vt_enabled) {
+		vt_close(&vt);
+	}
+	if (vt_quad_vao) {
+		glDeleteVertexArrays(1, &vt_quad_vao);
+		glDeleteBuffers(1, &vt_quad_vbo);
+	}
+	game_loop_log(&loop);
+	input_log();
+	frame_pacing_log();
+	frame_pacing_shutdown();
+	camera_log();
+	camera_system_shutdown();
+	rt_pool_log();
+	rt_pool_shutdown();
+	pipeline_log();
+	pipeline_shutdown();
+	shader_log();
+	shader_shutdown();
+	scene_shutdown(&scene);
+	occlusion_shutdown();
+	jobs_shutdown();
+	if (options.trace_path) {
+#ifdef ENABLE_TRACE
+		trace_export(options.trace_path);
+#else
+		gl_log_err("WARNING: --trace ignored, rebuild with make TRACE=1\n");
+#endif
+	}
+	trace_shutdown();
+	/* everything above has released its GL objects, whatever is left leaked */
+	gpu_mem_log();
+	gpu_mem_report_leaks();
+	gpu_mem_shutdown();
+
 	/* close GL context and any other GLFW resources */
 	glfwTerminate();
 	return 0;
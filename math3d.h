@@ -0,0 +1,206 @@
+#ifndef MATH3D_H
+#define MATH3D_H
+
+#include <float.h>
+#include <math.h>
+
+#include "common.h"
+
+struct vec3 {
+	float x, y, z;
+};
+
+struct vec4 {
+	float x, y, z, w;
+};
+
+/* column-major, m[col * 4 + row], same layout glUniformMatrix4fv expects */
+struct mat4 {
+	float m[16];
+};
+
+struct aabb {
+	struct vec3 min;
+	struct vec3 max;
+};
+
+struct ray {
+	struct vec3 origin;
+	struct vec3 dir;
+};
+
+/* planes as (n, d) with dot(n, p) + d >= 0 for points inside */
+struct frustum {
+	struct vec4 planes[6];
+};
+
+enum {
+	FRUSTUM_OUTSIDE = 0,
+	FRUSTUM_INTERSECT = 1,
+	FRUSTUM_INSIDE = 2,
+};
+
+static inline struct vec3
+vec3_make(float x, float y, float z) {
+	return (struct vec3){x, y, z};
+}
+
+static inline struct vec3
+vec3_add(struct vec3 a, struct vec3 b) {
+	return (struct vec3){a.x + b.x, a.y + b.y, a.z + b.z};
+}
+
+static inline struct vec3
+vec3_sub(struct vec3 a, struct vec3 b) {
+	return (struct vec3){a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static inline struct vec3
+vec3_scale(struct vec3 a, float s) {
+	return (struct vec3){a.x * s, a.y * s, a.z * s};
+}
+
+static inline struct vec3
+vec3_min(struct vec3 a, struct vec3 b) {
+	return (struct vec3){fminf(a.x, b.x), fminf(a.y, b.y), fminf(a.z, b.z)};
+}
+
+static inline struct vec3
+vec3_max(struct vec3 a, struct vec3 b) {
+	return (struct vec3){fmaxf(a.x, b.x), fmaxf(a.y, b.y), fmaxf(a.z, b.z)};
+}
+
+static inline float
+vec3_dot(struct vec3 a, struct vec3 b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static inline struct vec3
+vec3_cross(struct vec3 a, struct vec3 b) {
+	return (struct vec3){a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+static inline struct vec3
+vec3_normalize(struct vec3 a) {
+	float len = sqrtf(vec3_dot(a, a));
+	return len > 0.0f ? vec3_scale(a, 1.0f / len) : a;
+}
+
+static inline float
+vec3_axis(struct vec3 a, int axis) {
+	return axis == 0 ? a.x : (axis == 1 ? a.y : a.z);
+}
+
+static inline struct aabb
+aabb_empty(void) {
+	return (struct aabb){{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+}
+
+static inline struct aabb
+aabb_union(struct aabb a, struct aabb b) {
+	return (struct aabb){vec3_min(a.min, b.min), vec3_max(a.max, b.max)};
+}
+
+static inline struct aabb
+aabb_grow(struct aabb a, struct vec3 p) {
+	return (struct aabb){vec3_min(a.min, p), vec3_max(a.max, p)};
+}
+
+static inline struct vec3
+aabb_center(struct aabb a) {
+	return vec3_scale(vec3_add(a.min, a.max), 0.5f);
+}
+
+static inline float
+aabb_surface_area(struct aabb a) {
+	struct vec3 d = vec3_sub(a.max, a.min);
+	if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f) {
+		return 0.0f;
+	}
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static inline b32
+aabb_equal(struct aabb a, struct aabb b) {
+	return a.min.x == b.min.x && a.min.y == b.min.y && a.min.z == b.min.z && a.max.x == b.max.x &&
+	       a.max.y == b.max.y && a.max.z == b.max.z;
+}
+
+static inline struct mat4
+mat4_identity(void) {
+	return (struct mat4){{1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}};
+}
+
+static inline struct mat4
+mat4_mul(struct mat4 a, struct mat4 b) {
+	struct mat4 r;
+	for (int c = 0; c < 4; c++) {
+		for (int row = 0; row < 4; row++) {
+			r.m[c * 4 + row] = a.m[0 * 4 + row] * b.m[c * 4 + 0] + a.m[1 * 4 + row] * b.m[c * 4 + 1] +
+			                   a.m[2 * 4 + row] * b.m[c * 4 + 2] + a.m[3 * 4 + row] * b.m[c * 4 + 3];
+		}
+	}
+	return r;
+}
+
+static inline struct vec4
+mat4_mul_vec4(struct mat4 a, struct vec4 v) {
+	return (struct vec4){
+	    a.m[0] * v.x + a.m[4] * v.y + a.m[8] * v.z + a.m[12] * v.w,
+	    a.m[1] * v.x + a.m[5] * v.y + a.m[9] * v.z + a.m[13] * v.w,
+	    a.m[2] * v.x + a.m[6] * v.y + a.m[10] * v.z + a.m[14] * v.w,
+	    a.m[3] * v.x + a.m[7] * v.y + a.m[11] * v.z + a.m[15] * v.w,
+	};
+}
+
+/* Gribb/Hartmann plane extraction from a view-projection matrix (GL clip space, -w <= z <= w) */
+static inline struct frustum
+frustum_from_mat4(struct mat4 vp) {
+	const float* m = vp.m;
+	struct frustum f;
+	for (int i = 0; i < 3; i++) {
+		f.planes[i * 2 + 0] = (struct vec4){m[3] + m[i], m[7] + m[4 + i], m[11] + m[8 + i], m[15] + m[12 + i]};
+		f.planes[i * 2 + 1] = (struct vec4){m[3] - m[i], m[7] - m[4 + i], m[11] - m[8 + i], m[15] - m[12 + i]};
+	}
+	for (int i = 0; i < 6; i++) {
+		struct vec4 p = f.planes[i];
+		float len = sqrtf(p.x * p.x + p.y * p.y + p.z * p.z);
+		if (len > 0.0f) {
+			f.planes[i] = (struct vec4){p.x / len, p.y / len, p.z / len, p.w / len};
+		}
+	}
+	return f;
+}
+
+static inline int
+frustum_test_aabb(const struct frustum* f, struct aabb box) {
+	int result = FRUSTUM_INSIDE;
+	for (int i = 0; i < 6; i++) {
+		struct vec4 p = f->planes[i];
+		/* farthest corner along the plane normal decides "outside", nearest decides "inside" */
+		struct vec3 pos = {p.x >= 0.0f ? box.max.x : box.min.x, p.y >= 0.0f ? box.max.y : box.min.y,
+		                   p.z >= 0.0f ? box.max.z : box.min.z};
+		struct vec3 neg = {p.x >= 0.0f ? box.min.x : box.max.x, p.y >= 0.0f ? box.min.y : box.max.y,
+		                   p.z >= 0.0f ? box.min.z : box.max.z};
+		if (p.x * pos.x + p.y * pos.y + p.z * pos.z + p.w < 0.0f) {
+			return FRUSTUM_OUTSIDE;
+		}
+		if (p.x * neg.x + p.y * neg.y + p.z * neg.z + p.w < 0.0f) {
+			result = FRUSTUM_INTERSECT;
+		}
+	}
+	return result;
+}
+
+/* slab test, inv_dir = 1 / ray.dir; returns entry distance or a negative value on miss */
+static inline float
+ray_aabb(struct vec3 origin, struct vec3 inv_dir, struct aabb box, float t_max) {
+	float tx0 = (box.min.x - origin.x) * inv_dir.x, tx1 = (box.max.x - origin.x) * inv_dir.x;
+	float ty0 = (box.min.y - origin.y) * inv_dir.y, ty1 = (box.max.y - origin.y) * inv_dir.y;
+	float tz0 = (box.min.z - origin.z) * inv_dir.z, tz1 = (box.max.z - origin.z) * inv_dir.z;
+	float t_near = fmaxf(fmaxf(fminf(tx0, tx1), fminf(ty0, ty1)), fmaxf(fminf(tz0, tz1), 0.0f));
+	float t_far = fminf(fminf(fmaxf(tx0, tx1), fmaxf(ty0, ty1)), fminf(fmaxf(tz0, tz1), t_max));
+	return t_near <= t_far ? t_near : -1.0f;
+}
+
+#endif
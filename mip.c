@@ -0,0 +1,312 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+#include "cpu_trace.h"
+#include "jobs.h"
+#include "mip.h"
+
+#define MIP_ROWS_PER_JOB 16
+#define MIP_KAISER_TAPS 8 /* source pixels contributing to one destination pixel per axis */
+#define MIP_KAISER_ALPHA 4.0f
+#define MIP_LINEAR_LUT 4096
+#define MIP_PI 3.14159265358979323846
+
+static float srgb_to_linear_lut[256];
+static u8 linear_to_srgb_lut[MIP_LINEAR_LUT + 1];
+static float kaiser_weights[MIP_KAISER_TAPS];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+static double
+bessel_i0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+/* through pthread_once: mip_build() runs on job workers too, e.g. texture decodes */
+static void
+init_tables(void) {
+	for (int i = 0; i < 256; i++) {
+		double c = i / 255.0;
+		srgb_to_linear_lut[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+	}
+	for (int i = 0; i <= MIP_LINEAR_LUT; i++) {
+		double l = (double)i / MIP_LINEAR_LUT;
+		double c = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+		linear_to_srgb_lut[i] = (u8)(c * 255.0 + 0.5);
+	}
+	/* windowed sinc for 2:1 decimation: taps sit at +-0.5, +-1.5, ... source pixels from the center */
+	double total = 0.0;
+	double half = MIP_KAISER_TAPS / 2.0;
+	for (int i = 0; i < MIP_KAISER_TAPS; i++) {
+		double x = (i - half + 0.5) / 2.0; /* in destination pixels */
+		double sinc = x == 0.0 ? 1.0 : sin(MIP_PI * x) / (MIP_PI * x);
+		double r = (i - half + 0.5) / half;
+		double window = bessel_i0(MIP_KAISER_ALPHA * sqrt(fmax(0.0, 1.0 - r * r))) / bessel_i0(MIP_KAISER_ALPHA);
+		kaiser_weights[i] = (float)(sinc * window);
+		total += kaiser_weights[i];
+	}
+	for (int i = 0; i < MIP_KAISER_TAPS; i++) {
+		kaiser_weights[i] = (float)(kaiser_weights[i] / total);
+	}
+}
+
+struct mip_level_job {
+	const struct mip_options* options;
+	const __m128* src;
+	int src_w;
+	int src_h;
+	__m128* dst;
+	int dst_w;
+	int dst_h;
+	__m128* temp; /* dst_w x src_h, horizontal pass of the Kaiser filter */
+	/* quantize */
+	const __m128* levels[MIP_MAX_LEVELS];
+	float alpha_scale[MIP_MAX_LEVELS];
+	struct mip_chain* chain;
+	int level;
+	int rows;
+};
+
+static void
+to_linear_rows_job(void* data, isize index) {
+	struct mip_level_job* job = data;
+	const u8* rgba = job->chain->data;
+	int y0 = (int)index * MIP_ROWS_PER_JOB;
+	int y1 = y0 + MIP_ROWS_PER_JOB < job->dst_h ? y0 + MIP_ROWS_PER_JOB : job->dst_h;
+	for (isize i = (isize)y0 * job->dst_w; i < (isize)y1 * job->dst_w; i++) {
+		const u8* p = &rgba[i * 4];
+		if (job->options->srgb) {
+			job->dst[i] = _mm_set_ps(p[3] / 255.0f, srgb_to_linear_lut[p[2]], srgb_to_linear_lut[p[1]],
+			                         srgb_to_linear_lut[p[0]]);
+		} else {
+			job->dst[i] = _mm_mul_ps(_mm_set_ps(p[3], p[2], p[1], p[0]), _mm_set1_ps(1.0f / 255.0f));
+		}
+	}
+}
+
+static void
+box_rows_job(void* data, isize index) {
+	struct mip_level_job* job = data;
+	int y0 = (int)index * MIP_ROWS_PER_JOB;
+	int y1 = y0 + MIP_ROWS_PER_JOB < job->dst_h ? y0 + MIP_ROWS_PER_JOB : job->dst_h;
+	const __m128 quarter = _mm_set1_ps(0.25f);
+	for (int y = y0; y < y1; y++) {
+		/* once a dimension reaches 1 the second tap is clamped onto the first */
+		const __m128* r0 = job->src + (isize)(y * 2) * job->src_w;
+		const __m128* r1 = job->src + (isize)(y * 2 + 1 < job->src_h ? y * 2 + 1 : y * 2) * job->src_w;
+		__m128* dst = job->dst + (isize)y * job->dst_w;
+		for (int x = 0; x < job->dst_w; x++) {
+			int x0 = x * 2;
+			int x1 = x0 + 1 < job->src_w ? x0 + 1 : x0;
+			__m128 sum = _mm_add_ps(_mm_add_ps(r0[x0], r0[x1]), _mm_add_ps(r1[x0], r1[x1]));
+			dst[x] = _mm_mul_ps(sum, quarter);
+		}
+	}
+}
+
+static inline int
+clamp_index(int i, int n) {
+	return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+static void
+kaiser_horizontal_job(void* data, isize index) {
+	struct mip_level_job* job = data;
+	int y0 = (int)index * MIP_ROWS_PER_JOB;
+	int y1 = y0 + MIP_ROWS_PER_JOB < job->src_h ? y0 + MIP_ROWS_PER_JOB : job->src_h;
+	for (int y = y0; y < y1; y++) {
+		const __m128* src = job->src + (isize)y * job->src_w;
+		__m128* dst = job->temp + (isize)y * job->dst_w;
+		for (int x = 0; x < job->dst_w; x++) {
+			int first = x * 2 - MIP_KAISER_TAPS / 2 + 1;
+			__m128 sum = _mm_setzero_ps();
+			for (int t = 0; t < MIP_KAISER_TAPS; t++) {
+				__m128 w = _mm_set1_ps(kaiser_weights[t]);
+				sum = _mm_add_ps(sum, _mm_mul_ps(src[clamp_index(first + t, job->src_w)], w));
+			}
+			dst[x] = sum;
+		}
+	}
+}
+
+static void
+kaiser_vertical_job(void* data, isize index) {
+	struct mip_level_job* job = data;
+	int y0 = (int)index * MIP_ROWS_PER_JOB;
+	int y1 = y0 + MIP_ROWS_PER_JOB < job->dst_h ? y0 + MIP_ROWS_PER_JOB : job->dst_h;
+	const __m128 zero = _mm_setzero_ps();
+	for (int y = y0; y < y1; y++) {
+		int first = y * 2 - MIP_KAISER_TAPS / 2 + 1;
+		__m128* dst = job->dst + (isize)y * job->dst_w;
+		for (int x = 0; x < job->dst_w; x++) {
+			dst[x] = zero;
+		}
+		for (int t = 0; t < MIP_KAISER_TAPS; t++) {
+			const __m128* src = job->temp + (isize)clamp_index(first + t, job->src_h) * job->dst_w;
+			__m128 w = _mm_set1_ps(kaiser_weights[t]);
+			for (int x = 0; x < job->dst_w; x++) {
+				dst[x] = _mm_add_ps(dst[x], _mm_mul_ps(src[x], w));
+			}
+		}
+		/* negative lobes can overshoot */
+		for (int x = 0; x < job->dst_w; x++) {
+			dst[x] = _mm_min_ps(_mm_max_ps(dst[x], zero), _mm_set1_ps(1.0f));
+		}
+	}
+}
+
+static void
+quantize_rows_job(void* data, isize index) {
+	struct mip_level_job* job = data;
+	int level = job->level;
+	int w = job->chain->width[level];
+	int h = job->chain->height[level];
+	int y0 = (int)index * MIP_ROWS_PER_JOB;
+	int y1 = y0 + MIP_ROWS_PER_JOB < h ? y0 + MIP_ROWS_PER_JOB : h;
+	const __m128* src = job->levels[level];
+	u8* dst = job->chain->data + job->chain->offset[level];
+	__m128 scale = _mm_set_ps(job->alpha_scale[level], 1.0f, 1.0f, 1.0f);
+	__m128 lut_scale = _mm_set_ps(255.0f, MIP_LINEAR_LUT, MIP_LINEAR_LUT, MIP_LINEAR_LUT);
+	for (int y = y0; y < y1; y++) {
+		for (int x = 0; x < w; x++) {
+			isize i = (isize)y * w + x;
+			__m128 v = _mm_min_ps(_mm_mul_ps(src[i], scale), _mm_set1_ps(1.0f));
+			v = _mm_max_ps(v, _mm_setzero_ps());
+			float f[4], q[4];
+			_mm_storeu_ps(f, v);
+			_mm_storeu_ps(q, _mm_add_ps(_mm_mul_ps(v, lut_scale), _mm_set1_ps(0.5f)));
+			u8* p = &dst[i * 4];
+			if (job->options->srgb) {
+				p[0] = linear_to_srgb_lut[(int)q[0]];
+				p[1] = linear_to_srgb_lut[(int)q[1]];
+				p[2] = linear_to_srgb_lut[(int)q[2]];
+			} else {
+				p[0] = (u8)(f[0] * 255.0f + 0.5f);
+				p[1] = (u8)(f[1] * 255.0f + 0.5f);
+				p[2] = (u8)(f[2] * 255.0f + 0.5f);
+			}
+			p[3] = (u8)q[3];
+		}
+	}
+}
+
+static float
+alpha_coverage(const __m128* pixels, isize count, float scale, float cutoff) {
+	isize covered = 0;
+	for (isize i = 0; i < count; i++) {
+		float a[4];
+		_mm_storeu_ps(a, pixels[i]);
+		covered += a[3] * scale >= cutoff;
+	}
+	return (float)covered / (float)count;
+}
+
+/* binary search for the alpha scale that gives this level the same coverage as level 0 */
+static float
+coverage_scale(const __m128* pixels, isize count, float target, float cutoff) {
+	float lo = 0.0f, hi = 4.0f, best = 1.0f, best_error = 2.0f;
+	for (int i = 0; i < 10; i++) {
+		float mid = (lo + hi) * 0.5f;
+		float coverage = alpha_coverage(pixels, count, mid, cutoff);
+		if (fabsf(coverage - target) < best_error) {
+			best_error = fabsf(coverage - target);
+			best = mid;
+		}
+		if (coverage < target) {
+			lo = mid;
+		} else {
+			hi = mid;
+		}
+	}
+	return best;
+}
+
+b32
+mip_build(const u8* rgba, int width, int height, const struct mip_options* options, struct mip_chain* chain) {
+	TRACE_ZONE("mip_build");
+	pthread_once(&tables_once, init_tables);
+	memset(chain, 0, sizeof(*chain));
+	int w = width, h = height;
+	isize size = 0;
+	isize pixels = 0;
+	for (;;) {
+		chain->width[chain->levels] = w;
+		chain->height[chain->levels] = h;
+		chain->offset[chain->levels] = size;
+		size += (isize)w * h * 4;
+		pixels += (isize)w * h;
+		chain->levels++;
+		if ((w == 1 && h == 1) || chain->levels == MIP_MAX_LEVELS) {
+			break;
+		}
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	chain->size = size;
+	chain->data = malloc(size);
+	/* all float levels live in one block; temp is big enough for any horizontal pass */
+	__m128* linear = _mm_malloc(sizeof(__m128) * pixels, 16);
+	__m128* temp = options->filter == MIP_FILTER_KAISER ? _mm_malloc(sizeof(__m128) * (isize)width * height, 16) : NULL;
+	if (!chain->data || !linear || (options->filter == MIP_FILTER_KAISER && !temp)) {
+		free(chain->data);
+		_mm_free(linear);
+		_mm_free(temp);
+		memset(chain, 0, sizeof(*chain));
+		return 0;
+	}
+
+	isize count0 = (isize)width * height;
+	memcpy(chain->data, rgba, count0 * 4);
+
+	struct mip_level_job job = {.options = options, .chain = chain, .temp = temp};
+	job.dst = linear;
+	job.dst_w = width;
+	job.dst_h = height;
+	jobs_parallel_for(to_linear_rows_job, &job, (height + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB);
+	job.levels[0] = linear;
+	isize offset = count0;
+	for (int level = 1; level < chain->levels; level++) {
+		job.src = job.levels[level - 1];
+		job.src_w = chain->width[level - 1];
+		job.src_h = chain->height[level - 1];
+		job.dst = linear + offset;
+		job.dst_w = chain->width[level];
+		job.dst_h = chain->height[level];
+		job.levels[level] = job.dst;
+		offset += (isize)job.dst_w * job.dst_h;
+		if (options->filter == MIP_FILTER_KAISER) {
+			jobs_parallel_for(kaiser_horizontal_job, &job, (job.src_h + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB);
+			jobs_parallel_for(kaiser_vertical_job, &job, (job.dst_h + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB);
+		} else {
+			jobs_parallel_for(box_rows_job, &job, (job.dst_h + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB);
+		}
+	}
+
+	float target = options->alpha_cutoff > 0.0f ? alpha_coverage(linear, count0, 1.0f, options->alpha_cutoff) : 0.0f;
+	for (int level = 1; level < chain->levels; level++) {
+		job.alpha_scale[level] = 1.0f;
+		if (options->alpha_cutoff > 0.0f) {
+			isize count = (isize)chain->width[level] * chain->height[level];
+			job.alpha_scale[level] = coverage_scale(job.levels[level], count, target, options->alpha_cutoff);
+		}
+		job.level = level;
+		jobs_parallel_for(quantize_rows_job, &job, (chain->height[level] + MIP_ROWS_PER_JOB - 1) / MIP_ROWS_PER_JOB);
+	}
+
+	_mm_free(linear);
+	_mm_free(temp);
+	return 1;
+}
+
+void
+mip_free(struct mip_chain* chain) {
+	free(chain->data);
+	memset(chain, 0, sizeof(*chain));
+}
@@ -0,0 +1,37 @@
+#ifndef MIP_H
+#define MIP_H
+
+#include "common.h"
+
+/* CPU mip chain generation for RGBA8 images.
+ * Filtering runs in linear float (one __m128 per pixel) so sRGB images are averaged correctly,
+ * rows of each level are split across the job system, and alpha can be rescaled per level to keep
+ * the alpha-test coverage of the top level. */
+
+#define MIP_MAX_LEVELS 16
+
+enum {
+	MIP_FILTER_BOX = 0,
+	MIP_FILTER_KAISER,
+};
+
+struct mip_options {
+	int filter;
+	b32 srgb;           /* color channels are sRGB encoded */
+	float alpha_cutoff; /* > 0 preserves coverage of alpha >= cutoff on every level */
+};
+
+struct mip_chain {
+	int levels;
+	int width[MIP_MAX_LEVELS];
+	int height[MIP_MAX_LEVELS];
+	isize offset[MIP_MAX_LEVELS]; /* byte offset of each level in data, levels are tightly packed */
+	isize size;
+	u8* data;
+};
+
+/* level 0 is a copy of rgba; the chain goes down to 1x1 */
+b32 mip_build(const u8* rgba, int width, int height, const struct mip_options* options, struct mip_chain* chain);
+void mip_free(struct mip_chain* chain);
+
+#endif
@@ -0,0 +1,285 @@
+#include <assert.h>
+#include <emmintrin.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "jobs.h"
+#include "occlusion.h"
+
+#define OCC_TILE_WIDTH 64
+#define OCC_TILE_HEIGHT 32
+#define OCC_TILES_X (OCCLUSION_WIDTH / OCC_TILE_WIDTH)
+#define OCC_TILES_Y (OCCLUSION_HEIGHT / OCC_TILE_HEIGHT)
+#define OCC_LEVELS 8
+#define OCC_NEAR_W 1e-5f
+
+_Static_assert(OCCLUSION_WIDTH % OCC_TILE_WIDTH == 0 && OCCLUSION_HEIGHT % OCC_TILE_HEIGHT == 0,
+               "occlusion buffer must be a whole number of tiles");
+_Static_assert(OCC_TILE_WIDTH % 4 == 0, "tiles are rasterized 4 pixels at a time");
+
+/* screen-space triangle with edge and depth plane equations: f(x, y) = a * x + b * y + c */
+struct occ_tri {
+	float edge_a[3], edge_b[3], edge_c[3];
+	float z_a, z_b, z_c;
+	int min_x, min_y, max_x, max_y;
+};
+
+static struct {
+	struct mat4 view_proj;
+	struct occ_tri* tris;
+	isize tris_len;
+	isize tris_cap;
+	/* level 0 is the depth buffer itself, each further level halves both dimensions */
+	float* levels[OCC_LEVELS];
+	int level_width[OCC_LEVELS];
+	int level_height[OCC_LEVELS];
+} occ;
+
+void
+occlusion_init(void) {
+	int w = OCCLUSION_WIDTH;
+	int h = OCCLUSION_HEIGHT;
+	for (int i = 0; i < OCC_LEVELS; i++) {
+		occ.level_width[i] = w;
+		occ.level_height[i] = h;
+		/* rows are padded to 4 floats so the SSE reduction never reads past the end */
+		size_t size = sizeof(float) * (size_t)((w + 3) & ~3) * (size_t)h;
+		occ.levels[i] = aligned_alloc(16, (size + 15) & ~(size_t)15);
+		w = w > 1 ? w / 2 : 1;
+		h = h > 1 ? h / 2 : 1;
+	}
+	occ.view_proj = mat4_identity();
+}
+
+void
+occlusion_shutdown(void) {
+	for (int i = 0; i < OCC_LEVELS; i++) {
+		free(occ.levels[i]);
+		occ.levels[i] = NULL;
+	}
+	free(occ.tris);
+	memset(&occ, 0, sizeof(occ));
+}
+
+void
+occlusion_begin_frame(struct mat4 view_proj) {
+	occ.view_proj = view_proj;
+	occ.tris_len = 0;
+}
+
+static struct vec4
+project(struct vec3 p) {
+	return mat4_mul_vec4(occ.view_proj, (struct vec4){p.x, p.y, p.z, 1.0f});
+}
+
+static void
+setup_triangle(struct vec4 c0, struct vec4 c1, struct vec4 c2) {
+	/* triangles crossing the near plane are dropped: missing an occluder is always safe */
+	if (c0.w < OCC_NEAR_W || c1.w < OCC_NEAR_W || c2.w < OCC_NEAR_W) {
+		return;
+	}
+	float x[3], y[3], z[3];
+	struct vec4 c[3] = {c0, c1, c2};
+	for (int i = 0; i < 3; i++) {
+		float inv_w = 1.0f / c[i].w;
+		x[i] = (c[i].x * inv_w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		y[i] = (c[i].y * inv_w * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+		z[i] = c[i].z * inv_w * 0.5f + 0.5f;
+	}
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (area == 0.0f) {
+		return;
+	}
+	/* occluders are rasterized two-sided; flip clockwise triangles so inside is always positive */
+	if (area < 0.0f) {
+		float t;
+		t = x[1], x[1] = x[2], x[2] = t;
+		t = y[1], y[1] = y[2], y[2] = t;
+		t = z[1], z[1] = z[2], z[2] = t;
+		area = -area;
+	}
+	int min_x = (int)fmaxf(floorf(fminf(fminf(x[0], x[1]), x[2])), 0.0f);
+	int min_y = (int)fmaxf(floorf(fminf(fminf(y[0], y[1]), y[2])), 0.0f);
+	int max_x = (int)fminf(ceilf(fmaxf(fmaxf(x[0], x[1]), x[2])), OCCLUSION_WIDTH - 1);
+	int max_y = (int)fminf(ceilf(fmaxf(fmaxf(y[0], y[1]), y[2])), OCCLUSION_HEIGHT - 1);
+	if (min_x > max_x || min_y > max_y) {
+		return;
+	}
+
+	if (occ.tris_len == occ.tris_cap) {
+		occ.tris_cap = occ.tris_cap ? occ.tris_cap * 2 : 256;
+		occ.tris = realloc(occ.tris, sizeof(*occ.tris) * occ.tris_cap);
+	}
+	struct occ_tri* tri = &occ.tris[occ.tris_len++];
+	for (int i = 0; i < 3; i++) {
+		int j = (i + 1) % 3;
+		/* edge i runs from vertex i to vertex j, positive on the inner side */
+		tri->edge_a[i] = y[i] - y[j];
+		tri->edge_b[i] = x[j] - x[i];
+		tri->edge_c[i] = x[i] * y[j] - x[j] * y[i];
+	}
+	float inv_area = 1.0f / area;
+	tri->z_a = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) * inv_area;
+	tri->z_b = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) * inv_area;
+	tri->z_c = z[0] - tri->z_a * x[0] - tri->z_b * y[0];
+	tri->min_x = min_x;
+	tri->min_y = min_y;
+	tri->max_x = max_x;
+	tri->max_y = max_y;
+}
+
+void
+occlusion_add_occluder(const float* positions, const u32* indices, isize triangle_count) {
+	for (isize t = 0; t < triangle_count; t++) {
+		struct vec4 c[3];
+		for (int k = 0; k < 3; k++) {
+			isize v = indices ? (isize)indices[t * 3 + k] : t * 3 + k;
+			c[k] = project(vec3_make(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]));
+		}
+		setup_triangle(c[0], c[1], c[2]);
+	}
+}
+
+static void
+raster_tile_job(void* data, isize index) {
+	(void)data;
+	int tile_x0 = (int)(index % OCC_TILES_X) * OCC_TILE_WIDTH;
+	int tile_y0 = (int)(index / OCC_TILES_X) * OCC_TILE_HEIGHT;
+	int tile_x1 = tile_x0 + OCC_TILE_WIDTH - 1;
+	int tile_y1 = tile_y0 + OCC_TILE_HEIGHT - 1;
+	float* depth = occ.levels[0];
+
+	__m128 far = _mm_set1_ps(1.0f);
+	for (int y = tile_y0; y <= tile_y1; y++) {
+		for (int x = tile_x0; x <= tile_x1; x += 4) {
+			_mm_store_ps(&depth[y * OCCLUSION_WIDTH + x], far);
+		}
+	}
+
+	const __m128 lane_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	for (isize t = 0; t < occ.tris_len; t++) {
+		const struct occ_tri* tri = &occ.tris[t];
+		if (tri->max_x < tile_x0 || tri->min_x > tile_x1 || tri->max_y < tile_y0 || tri->min_y > tile_y1) {
+			continue;
+		}
+		int x0 = (tri->min_x > tile_x0 ? tri->min_x : tile_x0) & ~3;
+		int x1 = tri->max_x < tile_x1 ? tri->max_x : tile_x1;
+		int y0 = tri->min_y > tile_y0 ? tri->min_y : tile_y0;
+		int y1 = tri->max_y < tile_y1 ? tri->max_y : tile_y1;
+
+		__m128 ea0 = _mm_set1_ps(tri->edge_a[0]), eb0 = _mm_set1_ps(tri->edge_b[0]);
+		__m128 ea1 = _mm_set1_ps(tri->edge_a[1]), eb1 = _mm_set1_ps(tri->edge_b[1]);
+		__m128 ea2 = _mm_set1_ps(tri->edge_a[2]), eb2 = _mm_set1_ps(tri->edge_b[2]);
+		__m128 za = _mm_set1_ps(tri->z_a), zb = _mm_set1_ps(tri->z_b);
+		for (int y = y0; y <= y1; y++) {
+			__m128 py = _mm_set1_ps((float)y + 0.5f);
+			__m128 row0 = _mm_add_ps(_mm_mul_ps(eb0, py), _mm_set1_ps(tri->edge_c[0]));
+			__m128 row1 = _mm_add_ps(_mm_mul_ps(eb1, py), _mm_set1_ps(tri->edge_c[1]));
+			__m128 row2 = _mm_add_ps(_mm_mul_ps(eb2, py), _mm_set1_ps(tri->edge_c[2]));
+			__m128 rowz = _mm_add_ps(_mm_mul_ps(zb, py), _mm_set1_ps(tri->z_c));
+			for (int x = x0; x <= x1; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane_offsets);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(ea0, px), row0);
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(ea1, px), row1);
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(ea2, px), row2);
+				/* sign bits of the three edge values: any negative lane is outside */
+				__m128 outside = _mm_or_ps(_mm_or_ps(e0, e1), e2);
+				int mask = ~_mm_movemask_ps(outside) & 0xf;
+				if (!mask) {
+					continue;
+				}
+				__m128 z = _mm_add_ps(_mm_mul_ps(za, px), rowz);
+				float* dst = &depth[y * OCCLUSION_WIDTH + x];
+				__m128 old = _mm_load_ps(dst);
+				__m128 nearer = _mm_min_ps(old, z);
+				/* blend: keep old depth in lanes outside the triangle */
+				__m128 inside = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(outside), 31));
+				_mm_store_ps(dst, _mm_or_ps(_mm_and_ps(inside, old), _mm_andnot_ps(inside, nearer)));
+			}
+		}
+	}
+}
+
+static void
+build_hiz(void) {
+	for (int level = 1; level < OCC_LEVELS; level++) {
+		const float* src = occ.levels[level - 1];
+		float* dst = occ.levels[level];
+		int src_w = occ.level_width[level - 1];
+		int src_stride = (src_w + 3) & ~3;
+		int dst_w = occ.level_width[level];
+		int dst_stride = (dst_w + 3) & ~3;
+		for (int y = 0; y < occ.level_height[level]; y++) {
+			const float* r0 = &src[(y * 2) * src_stride];
+			const float* r1 = &src[(y * 2 + 1) * src_stride];
+			int x = 0;
+			/* 8 source columns -> 4 destination texels per step */
+			for (; x + 4 <= dst_w; x += 4) {
+				__m128 a = _mm_max_ps(_mm_load_ps(&r0[x * 2]), _mm_load_ps(&r1[x * 2]));
+				__m128 b = _mm_max_ps(_mm_load_ps(&r0[x * 2 + 4]), _mm_load_ps(&r1[x * 2 + 4]));
+				__m128 even = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 odd = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+				_mm_store_ps(&dst[y * dst_stride + x], _mm_max_ps(even, odd));
+			}
+			for (; x < dst_w; x++) {
+				dst[y * dst_stride + x] =
+				    fmaxf(fmaxf(r0[x * 2], r0[x * 2 + 1]), fmaxf(r1[x * 2], r1[x * 2 + 1]));
+			}
+		}
+	}
+}
+
+void
+occlusion_render(void) {
+	jobs_parallel_for(raster_tile_job, NULL, OCC_TILES_X * OCC_TILES_Y);
+	build_hiz();
+}
+
+b32
+occlusion_test_aabb(struct aabb box) {
+	if (occ.tris_len == 0) {
+		return 1;
+	}
+	float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+	float min_z = FLT_MAX;
+	for (int i = 0; i < 8; i++) {
+		struct vec3 corner = {i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y,
+		                      i & 4 ? box.max.z : box.min.z};
+		struct vec4 c = project(corner);
+		/* box reaches behind the camera, can't be hidden by anything in front of it */
+		if (c.w < OCC_NEAR_W) {
+			return 1;
+		}
+		float inv_w = 1.0f / c.w;
+		float x = (c.x * inv_w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		float y = (c.y * inv_w * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+		min_x = fminf(min_x, x);
+		max_x = fmaxf(max_x, x);
+		min_y = fminf(min_y, y);
+		max_y = fmaxf(max_y, y);
+		min_z = fminf(min_z, c.z * inv_w * 0.5f + 0.5f);
+	}
+	if (max_x < 0.0f || max_y < 0.0f || min_x >= OCCLUSION_WIDTH || min_y >= OCCLUSION_HEIGHT) {
+		return 1; /* off screen, that is the frustum culler's call */
+	}
+	int x0 = (int)fmaxf(min_x, 0.0f);
+	int y0 = (int)fmaxf(min_y, 0.0f);
+	int x1 = (int)fminf(max_x, OCCLUSION_WIDTH - 1);
+	int y1 = (int)fminf(max_y, OCCLUSION_HEIGHT - 1);
+
+	/* pick the level where the rect covers at most 2x2 texels */
+	int level = 0;
+	while (level < OCC_LEVELS - 1 && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) {
+		level++;
+	}
+	const float* hiz = occ.levels[level];
+	int stride = (occ.level_width[level] + 3) & ~3;
+	for (int y = y0 >> level; y <= y1 >> level && y < occ.level_height[level]; y++) {
+		for (int x = x0 >> level; x <= x1 >> level && x < occ.level_width[level]; x++) {
+			if (min_z <= hiz[y * stride + x]) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
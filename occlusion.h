@@ -0,0 +1,28 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "common.h"
+#include "math3d.h"
+
+/* Software occlusion culling.
+ * Designated occluders are rasterized into a small CPU depth buffer (SSE, 4 pixels per step, one
+ * job per screen tile), a max-depth Hi-Z pyramid is built over it, and object bounds are then
+ * rejected when their nearest projected depth is behind everything in the pyramid cells they cover.
+ * Depth follows the GL_LESS convention: 0 near, 1 far. */
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+
+void occlusion_init(void);
+void occlusion_shutdown(void);
+
+void occlusion_begin_frame(struct mat4 view_proj);
+/* xyz positions; indices may be NULL for non-indexed triangle lists */
+void occlusion_add_occluder(const float* positions, const u32* indices, isize triangle_count);
+/* rasterize all occluders added this frame and build the Hi-Z pyramid */
+void occlusion_render(void);
+
+/* 0 when the box is fully hidden behind rendered occluders */
+b32 occlusion_test_aabb(struct aabb box);
+
+#endif
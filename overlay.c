@@ -0,0 +1,294 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gl_loader.h"
+#include "gpu_memory.h"
+#include "overlay.h"
+#include "pipeline.h"
+#include "shader.h"
+
+#define ATLAS_COLUMNS 16
+#define ATLAS_ROWS 6
+#define SOLID_GLYPH 95 /* after the 95 printable characters, every texel set */
+
+/* ASCII 32..126, one byte per row from the top, bit 0 is the leftmost pixel. Rasterized from
+ * DejaVu Sans Mono (Bitstream Vera license). */
+static const u8 font[95][OVERLAY_GLYPH_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /*   */
+    {0x00, 0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x08, 0x00, 0x00, 0x00}, /* ! */
+    {0x00, 0x00, 0x14, 0x14, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* " */
+    {0x00, 0x00, 0x14, 0x14, 0x3e, 0x0a, 0x1f, 0x0a, 0x0a, 0x00, 0x00, 0x00}, /* # */
+    {0x00, 0x00, 0x08, 0x3c, 0x0a, 0x0e, 0x38, 0x28, 0x1e, 0x08, 0x00, 0x00}, /* $ */
+    {0x00, 0x00, 0x07, 0x05, 0x17, 0x0c, 0x3a, 0x28, 0x38, 0x00, 0x00, 0x00}, /* % */
+    {0x00, 0x00, 0x1c, 0x04, 0x0c, 0x2a, 0x32, 0x12, 0x2c, 0x00, 0x00, 0x00}, /* & */
+    {0x00, 0x00, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ' */
+    {0x00, 0x08, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x08, 0x00, 0x00}, /* ( */
+    {0x00, 0x04, 0x04, 0x08, 0x08, 0x08, 0x08, 0x08, 0x04, 0x04, 0x00, 0x00}, /* ) */
+    {0x00, 0x00, 0x2a, 0x1c, 0x1c, 0x2a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* * */
+    {0x00, 0x00, 0x00, 0x08, 0x08, 0x3e, 0x08, 0x08, 0x00, 0x00, 0x00, 0x00}, /* + */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x04, 0x00}, /* , */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x00}, /* - */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00}, /* . */
+    {0x00, 0x00, 0x20, 0x10, 0x10, 0x08, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00}, /* / */
+    {0x00, 0x00, 0x1c, 0x22, 0x22, 0x2a, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* 0 */
+    {0x00, 0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00}, /* 1 */
+    {0x00, 0x00, 0x1c, 0x22, 0x20, 0x30, 0x18, 0x04, 0x3e, 0x00, 0x00, 0x00}, /* 2 */
+    {0x00, 0x00, 0x1c, 0x22, 0x20, 0x1c, 0x20, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* 3 */
+    {0x00, 0x00, 0x10, 0x18, 0x14, 0x16, 0x3e, 0x10, 0x10, 0x00, 0x00, 0x00}, /* 4 */
+    {0x00, 0x00, 0x1e, 0x02, 0x1e, 0x20, 0x20, 0x20, 0x1e, 0x00, 0x00, 0x00}, /* 5 */
+    {0x00, 0x00, 0x3c, 0x06, 0x02, 0x1e, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* 6 */
+    {0x00, 0x00, 0x3e, 0x30, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00, 0x00}, /* 7 */
+    {0x00, 0x00, 0x1c, 0x22, 0x22, 0x1c, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* 8 */
+    {0x00, 0x00, 0x1c, 0x22, 0x22, 0x3c, 0x20, 0x30, 0x1e, 0x00, 0x00, 0x00}, /* 9 */
+    {0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00}, /* : */
+    {0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x04, 0x04, 0x04, 0x00}, /* ; */
+    {0x00, 0x00, 0x00, 0x20, 0x1c, 0x02, 0x1c, 0x20, 0x00, 0x00, 0x00, 0x00}, /* < */
+    {0x00, 0x00, 0x00, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x00, 0x00}, /* = */
+    {0x00, 0x00, 0x00, 0x02, 0x1c, 0x20, 0x1c, 0x02, 0x00, 0x00, 0x00, 0x00}, /* > */
+    {0x00, 0x00, 0x1e, 0x10, 0x08, 0x04, 0x04, 0x00, 0x04, 0x00, 0x00, 0x00}, /* ? */
+    {0x00, 0x00, 0x1c, 0x24, 0x3a, 0x2a, 0x2a, 0x2a, 0x3a, 0x04, 0x18, 0x00}, /* @ */
+    {0x00, 0x00, 0x08, 0x08, 0x14, 0x14, 0x1c, 0x22, 0x22, 0x00, 0x00, 0x00}, /* A */
+    {0x00, 0x00, 0x1e, 0x22, 0x22, 0x1e, 0x22, 0x22, 0x1e, 0x00, 0x00, 0x00}, /* B */
+    {0x00, 0x00, 0x3c, 0x26, 0x02, 0x02, 0x02, 0x26, 0x3c, 0x00, 0x00, 0x00}, /* C */
+    {0x00, 0x00, 0x1e, 0x32, 0x22, 0x22, 0x22, 0x32, 0x1e, 0x00, 0x00, 0x00}, /* D */
+    {0x00, 0x00, 0x3e, 0x02, 0x02, 0x3e, 0x02, 0x02, 0x3e, 0x00, 0x00, 0x00}, /* E */
+    {0x00, 0x00, 0x3e, 0x02, 0x02, 0x3e, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00}, /* F */
+    {0x00, 0x00, 0x1c, 0x26, 0x02, 0x32, 0x22, 0x26, 0x3c, 0x00, 0x00, 0x00}, /* G */
+    {0x00, 0x00, 0x22, 0x22, 0x22, 0x3e, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00}, /* H */
+    {0x00, 0x00, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00}, /* I */
+    {0x00, 0x00, 0x1c, 0x10, 0x10, 0x10, 0x10, 0x12, 0x0c, 0x00, 0x00, 0x00}, /* J */
+    {0x00, 0x00, 0x22, 0x12, 0x0a, 0x06, 0x0a, 0x12, 0x22, 0x00, 0x00, 0x00}, /* K */
+    {0x00, 0x00, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x3e, 0x00, 0x00, 0x00}, /* L */
+    {0x00, 0x00, 0x22, 0x36, 0x36, 0x2a, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00}, /* M */
+    {0x00, 0x00, 0x22, 0x26, 0x26, 0x2a, 0x32, 0x32, 0x22, 0x00, 0x00, 0x00}, /* N */
+    {0x00, 0x00, 0x1c, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* O */
+    {0x00, 0x00, 0x1e, 0x22, 0x22, 0x1e, 0x02, 0x02, 0x02, 0x00, 0x00, 0x00}, /* P */
+    {0x00, 0x00, 0x1c, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1c, 0x30, 0x00, 0x00}, /* Q */
+    {0x00, 0x00, 0x1e, 0x22, 0x22, 0x1e, 0x32, 0x22, 0x42, 0x00, 0x00, 0x00}, /* R */
+    {0x00, 0x00, 0x1c, 0x22, 0x02, 0x1c, 0x20, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* S */
+    {0x00, 0x00, 0x3e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00}, /* T */
+    {0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* U */
+    {0x00, 0x00, 0x22, 0x22, 0x14, 0x14, 0x14, 0x08, 0x08, 0x00, 0x00, 0x00}, /* V */
+    {0x00, 0x00, 0x21, 0x2d, 0x2d, 0x1e, 0x12, 0x12, 0x12, 0x00, 0x00, 0x00}, /* W */
+    {0x00, 0x00, 0x22, 0x14, 0x14, 0x08, 0x14, 0x14, 0x22, 0x00, 0x00, 0x00}, /* X */
+    {0x00, 0x00, 0x22, 0x14, 0x14, 0x08, 0x08, 0x08, 0x08, 0x00, 0x00, 0x00}, /* Y */
+    {0x00, 0x00, 0x3e, 0x10, 0x10, 0x08, 0x04, 0x04, 0x3e, 0x00, 0x00, 0x00}, /* Z */
+    {0x00, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0c, 0x00, 0x00}, /* [ */
+    {0x00, 0x00, 0x02, 0x04, 0x04, 0x08, 0x08, 0x10, 0x10, 0x20, 0x00, 0x00}, /* \ */
+    {0x00, 0x0c, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0c, 0x00, 0x00}, /* ] */
+    {0x00, 0x00, 0x04, 0x0a, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ^ */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3f, 0x00}, /* _ */
+    {0x00, 0x02, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ` */
+    {0x00, 0x00, 0x00, 0x00, 0x1e, 0x20, 0x3c, 0x22, 0x3e, 0x00, 0x00, 0x00}, /* a */
+    {0x00, 0x02, 0x02, 0x02, 0x1e, 0x22, 0x22, 0x22, 0x1e, 0x00, 0x00, 0x00}, /* b */
+    {0x00, 0x00, 0x00, 0x00, 0x1c, 0x02, 0x02, 0x02, 0x1c, 0x00, 0x00, 0x00}, /* c */
+    {0x00, 0x20, 0x20, 0x20, 0x3c, 0x22, 0x22, 0x22, 0x3c, 0x00, 0x00, 0x00}, /* d */
+    {0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x3e, 0x02, 0x3c, 0x00, 0x00, 0x00}, /* e */
+    {0x00, 0x18, 0x04, 0x04, 0x1e, 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00}, /* f */
+    {0x00, 0x00, 0x00, 0x00, 0x3c, 0x22, 0x22, 0x22, 0x3c, 0x20, 0x1c, 0x00}, /* g */
+    {0x00, 0x02, 0x02, 0x02, 0x1a, 0x26, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00}, /* h */
+    {0x00, 0x08, 0x00, 0x00, 0x0c, 0x08, 0x08, 0x08, 0x3e, 0x00, 0x00, 0x00}, /* i */
+    {0x00, 0x08, 0x00, 0x00, 0x0e, 0x08, 0x08, 0x08, 0x08, 0x08, 0x06, 0x00}, /* j */
+    {0x00, 0x02, 0x02, 0x02, 0x12, 0x0a, 0x0e, 0x12, 0x22, 0x00, 0x00, 0x00}, /* k */
+    {0x00, 0x07, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x18, 0x00, 0x00, 0x00}, /* l */
+    {0x00, 0x00, 0x00, 0x00, 0x3e, 0x2a, 0x2a, 0x2a, 0x2a, 0x00, 0x00, 0x00}, /* m */
+    {0x00, 0x00, 0x00, 0x00, 0x1a, 0x26, 0x22, 0x22, 0x22, 0x00, 0x00, 0x00}, /* n */
+    {0x00, 0x00, 0x00, 0x00, 0x1c, 0x22, 0x22, 0x22, 0x1c, 0x00, 0x00, 0x00}, /* o */
+    {0x00, 0x00, 0x00, 0x00, 0x1e, 0x22, 0x22, 0x22, 0x1e, 0x02, 0x02, 0x00}, /* p */
+    {0x00, 0x00, 0x00, 0x00, 0x3c, 0x22, 0x22, 0x22, 0x3c, 0x20, 0x20, 0x00}, /* q */
+    {0x00, 0x00, 0x00, 0x00, 0x3c, 0x24, 0x04, 0x04, 0x04, 0x00, 0x00, 0x00}, /* r */
+    {0x00, 0x00, 0x00, 0x00, 0x3c, 0x02, 0x3c, 0x20, 0x1e, 0x00, 0x00, 0x00}, /* s */
+    {0x00, 0x00, 0x04, 0x04, 0x1e, 0x04, 0x04, 0x04, 0x1c, 0x00, 0x00, 0x00}, /* t */
+    {0x00, 0x00, 0x00, 0x00, 0x22, 0x22, 0x22, 0x22, 0x3c, 0x00, 0x00, 0x00}, /* u */
+    {0x00, 0x00, 0x00, 0x00, 0x22, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00, 0x00}, /* v */
+    {0x00, 0x00, 0x00, 0x00, 0x22, 0x2a, 0x14, 0x14, 0x14, 0x00, 0x00, 0x00}, /* w */
+    {0x00, 0x00, 0x00, 0x00, 0x36, 0x14, 0x08, 0x14, 0x36, 0x00, 0x00, 0x00}, /* x */
+    {0x00, 0x00, 0x00, 0x00, 0x22, 0x14, 0x14, 0x08, 0x08, 0x08, 0x06, 0x00}, /* y */
+    {0x00, 0x00, 0x00, 0x00, 0x3e, 0x10, 0x08, 0x04, 0x3e, 0x00, 0x00, 0x00}, /* z */
+    {0x00, 0x18, 0x08, 0x08, 0x08, 0x06, 0x08, 0x08, 0x08, 0x18, 0x00, 0x00}, /* { */
+    {0x00, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x00}, /* | */
+    {0x00, 0x0c, 0x08, 0x08, 0x08, 0x30, 0x08, 0x08, 0x08, 0x0c, 0x00, 0x00}, /* } */
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00}, /* ~ */
+};
+
+static const char* overlay_vertex_shader =
+    "#version 410\n"
+    "layout(location = 0) in vec2 vertex_position;\n"
+    "layout(location = 1) in vec2 vertex_texel;\n"
+    "layout(location = 2) in vec4 vertex_color;\n"
+    "uniform vec2 pixel_to_ndc;\n"
+    "out vec2 texel;\n"
+    "out vec4 color;\n"
+    "void main() {\n"
+    "	texel = vertex_texel;\n"
+    "	color = vertex_color;\n"
+    "	gl_Position = vec4(vertex_position * pixel_to_ndc + vec2(-1.0, 1.0), 0.0, 1.0);\n"
+    "}\n";
+
+/* quads sit on whole pixels at 1:1, so the interpolated texel coordinate always falls inside the right texel */
+static const char* overlay_fragment_shader =
+    "#version 410\n"
+    "in vec2 texel;\n"
+    "in vec4 color;\n"
+    "out vec4 frag_color;\n"
+    "uniform sampler2D font;\n"
+    "void main() {\n"
+    "	frag_color = vec4(color.rgb, color.a * texelFetch(font, ivec2(texel), 0).r);\n"
+    "}\n";
+
+struct overlay_vertex {
+	float x, y;
+	float u, v; /* atlas texels */
+	u8 color[4];
+};
+
+static struct {
+	b32 ok;
+	GLuint program;
+	GLint pixel_to_ndc_loc;
+	GLuint atlas;
+	GLuint vao;
+	i32 pipeline;
+	GLuint vbo;
+	struct overlay_vertex vertices[OVERLAY_MAX_QUADS * 6];
+	isize quads_len;
+} overlay;
+
+b32
+overlay_init(void) {
+	GPU_MEM_OWNER("overlay");
+	memset(&overlay, 0, sizeof(overlay));
+	overlay.program = shader_compile_text("overlay", overlay_vertex_shader, overlay_fragment_shader);
+	if (!overlay.program) {
+		return 0;
+	}
+	overlay.pixel_to_ndc_loc = glGetUniformLocation(overlay.program, "pixel_to_ndc");
+	glUseProgram(overlay.program);
+	glUniform1i(glGetUniformLocation(overlay.program, "font"), 0);
+
+	enum { atlas_width = ATLAS_COLUMNS * OVERLAY_GLYPH_WIDTH, atlas_height = ATLAS_ROWS * OVERLAY_GLYPH_HEIGHT };
+	static u8 texels[atlas_height][atlas_width];
+	for (int glyph = 0; glyph <= SOLID_GLYPH; glyph++) {
+		int x0 = glyph % ATLAS_COLUMNS * OVERLAY_GLYPH_WIDTH, y0 = glyph / ATLAS_COLUMNS * OVERLAY_GLYPH_HEIGHT;
+		for (int y = 0; y < OVERLAY_GLYPH_HEIGHT; y++) {
+			u8 row = glyph == SOLID_GLYPH ? 0xff : font[glyph][y];
+			for (int x = 0; x < OVERLAY_GLYPH_WIDTH; x++) {
+				texels[y0 + y][x0 + x] = (row >> x & 1) ? 255 : 0;
+			}
+		}
+	}
+	glGenTextures(1, &overlay.atlas);
+	glBindTexture(GL_TEXTURE_2D, overlay.atlas);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas_width, atlas_height, 0, GL_RED, GL_UNSIGNED_BYTE, texels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+	glGenBuffers(1, &overlay.vbo);
+	glGenVertexArrays(1, &overlay.vao);
+	glBindVertexArray(overlay.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, overlay.vbo);
+	GLsizei stride = sizeof(struct overlay_vertex);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(struct overlay_vertex, x));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(struct overlay_vertex, u));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)offsetof(struct overlay_vertex, color));
+	pipeline_invalidate();
+	overlay.pipeline = pipeline_create(&(struct pipeline_desc){
+	    .name = "overlay",
+	    .program = overlay.program,
+	    .vertex_array = overlay.vao,
+	    .blend = PIPELINE_BLEND_ALPHA,
+	});
+	overlay.ok = 1;
+	return 1;
+}
+
+void
+overlay_shutdown(void) {
+	if (!overlay.ok) {
+		return;
+	}
+	glDeleteProgram(overlay.program);
+	glDeleteTextures(1, &overlay.atlas);
+	glDeleteVertexArrays(1, &overlay.vao);
+	glDeleteBuffers(1, &overlay.vbo);
+	overlay.ok = 0;
+}
+
+static void
+push_quad(float x, float y, float width, float height, float u, float v, float uv_width, float uv_height, u32 rgba) {
+	if (overlay.quads_len == OVERLAY_MAX_QUADS) {
+		return;
+	}
+	struct overlay_vertex corners[4];
+	for (int i = 0; i < 4; i++) {
+		float cx = (float)(i & 1), cy = (float)(i >> 1);
+		corners[i] = (struct overlay_vertex){
+		    x + cx * width, y + cy * height, u + cx * uv_width, v + cy * uv_height,
+		    {(u8)(rgba >> 24), (u8)(rgba >> 16), (u8)(rgba >> 8), (u8)rgba},
+		};
+	}
+	struct overlay_vertex* out = &overlay.vertices[overlay.quads_len++ * 6];
+	static const int order[6] = {0, 1, 2, 2, 1, 3};
+	for (int i = 0; i < 6; i++) {
+		out[i] = corners[order[i]];
+	}
+}
+
+void
+overlay_rect(float x, float y, float width, float height, u32 rgba) {
+	/* the middle of the solid glyph, so every fragment samples a set texel */
+	float u = SOLID_GLYPH % ATLAS_COLUMNS * OVERLAY_GLYPH_WIDTH + OVERLAY_GLYPH_WIDTH / 2;
+	float v = SOLID_GLYPH / ATLAS_COLUMNS * OVERLAY_GLYPH_HEIGHT + OVERLAY_GLYPH_HEIGHT / 2;
+	push_quad(x, y, width, height, u, v, 0.0f, 0.0f, rgba);
+}
+
+float
+overlay_text(float x, float y, u32 rgba, const char* text) {
+	for (const char* c = text; *c; c++) {
+		int glyph = *c >= 32 && *c < 127 ? *c - 32 : '?' - 32;
+		if (glyph != 0) {
+			float u = glyph % ATLAS_COLUMNS * OVERLAY_GLYPH_WIDTH;
+			float v = glyph / ATLAS_COLUMNS * OVERLAY_GLYPH_HEIGHT;
+			push_quad(x, y, OVERLAY_GLYPH_WIDTH, OVERLAY_GLYPH_HEIGHT, u, v, OVERLAY_GLYPH_WIDTH, OVERLAY_GLYPH_HEIGHT,
+			          rgba);
+		}
+		x += OVERLAY_GLYPH_WIDTH;
+	}
+	return x;
+}
+
+float
+overlay_printf(float x, float y, u32 rgba, const char* format, ...) {
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	return overlay_text(x, y, rgba, text);
+}
+
+void
+overlay_draw(int fb_width, int fb_height) {
+	if (!overlay.ok || overlay.quads_len == 0) {
+		overlay.quads_len = 0;
+		return;
+	}
+	pipeline_bind(overlay.pipeline);
+	glUniform2f(overlay.pixel_to_ndc_loc, 2.0f / fb_width, -2.0f / fb_height);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, overlay.atlas);
+	glBindBuffer(GL_ARRAY_BUFFER, overlay.vbo);
+	/* orphaned every frame, the driver hands back fresh storage instead of waiting on the last draw */
+	isize bytes = overlay.quads_len * 6 * sizeof(struct overlay_vertex);
+	glBufferData(GL_ARRAY_BUFFER, bytes, overlay.vertices, GL_STREAM_DRAW);
+	glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(overlay.quads_len * 6));
+	overlay.quads_len = 0;
+}
@@ -0,0 +1,26 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "common.h"
+
+/* Debug text and panels drawn over the frame.
+ * Calls queue quads, overlay_draw() uploads them and draws the whole queue with one glDrawArrays.
+ * Glyphs come from a built-in 8x12 bitmap font covering printable ASCII. Coordinates are framebuffer
+ * pixels with the origin at the top left; colors are 0xRRGGBBAA. */
+
+#define OVERLAY_GLYPH_WIDTH 8
+#define OVERLAY_GLYPH_HEIGHT 12
+#define OVERLAY_MAX_QUADS 4096
+
+b32 overlay_init(void);
+void overlay_shutdown(void);
+
+void overlay_rect(float x, float y, float width, float height, u32 rgba);
+/* returns x past the last character; characters outside printable ASCII draw as '?' */
+float overlay_text(float x, float y, u32 rgba, const char* text);
+float overlay_printf(float x, float y, u32 rgba, const char* format, ...);
+
+/* draws and empties the queue through its own pipeline: PIPELINE_BLEND_ALPHA, no depth test or write */
+void overlay_draw(int fb_width, int fb_height);
+
+#endif
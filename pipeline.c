@@ -0,0 +1,250 @@
+#include <string.h>
+
+#include "pipeline.h"
+#include "shader.h"
+
+/* what is hashed and compared: the description without its name, padding zeroed */
+struct pipeline_key {
+	GLuint program;
+	i32 shader_variant;
+	GLuint vertex_array;
+	b32 depth_test;
+	GLenum depth_func;
+	b32 depth_write;
+	i32 blend;
+	i32 cull;
+};
+
+struct pipeline {
+	const char* name;
+	struct pipeline_key key;
+	u64 hash;
+	i64 binds;
+	i64 skipped; /* binds of the pipeline that was already bound */
+	i64 calls;   /* GL calls its binds issued */
+};
+
+/* the GL state the module last set. The pipeline fields are valid with known, the vertex array and
+ * the clear values hold values no call can match while they are unknown */
+struct gl_state {
+	b32 known;
+	GLuint program;
+	GLuint vertex_array;
+	b32 depth_test;
+	GLenum depth_func;
+	b32 depth_write;
+	b32 blend;
+	GLenum blend_src;
+	GLenum blend_dst;
+	b32 cull;
+	GLenum cull_face;
+	float clear_color[4];
+	float clear_depth;
+};
+
+static struct {
+	struct pipeline pipelines[PIPELINE_MAX];
+	i32 pipelines_len;
+	i32 bound; /* -1 when unknown */
+	struct gl_state state;
+	i64 calls;
+	i64 clear_calls; /* clear value changes */
+} pso;
+
+void
+pipeline_init(void) {
+	memset(&pso, 0, sizeof(pso));
+	pipeline_invalidate();
+}
+
+void
+pipeline_shutdown(void) {
+	pso.pipelines_len = 0;
+	pipeline_invalidate();
+}
+
+void
+pipeline_invalidate(void) {
+	pso.state.known = 0;
+	pso.state.vertex_array = ~0u;
+	pso.state.clear_color[0] = -1.0f;
+	pso.state.clear_depth = -1.0f;
+	pso.bound = -1;
+}
+
+static u64
+hash_key(const struct pipeline_key* key) {
+	const u8* bytes = (const u8*)key;
+	u64 hash = 0xcbf29ce484222325ull;
+	for (isize i = 0; i < (isize)sizeof(*key); i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+i32
+pipeline_create(const struct pipeline_desc* desc) {
+	struct pipeline_key key;
+	memset(&key, 0, sizeof(key));
+	key.program = desc->program;
+	key.shader_variant = desc->program ? -1 : desc->shader_variant;
+	key.vertex_array = desc->vertex_array;
+	key.depth_test = desc->depth_test != 0;
+	key.depth_func = desc->depth_test ? desc->depth_func : 0;
+	key.depth_write = desc->depth_write != 0;
+	key.blend = desc->blend;
+	key.cull = desc->cull;
+	u64 hash = hash_key(&key);
+	for (i32 i = 0; i < pso.pipelines_len; i++) {
+		if (pso.pipelines[i].hash == hash && memcmp(&pso.pipelines[i].key, &key, sizeof(key)) == 0) {
+			return i;
+		}
+	}
+	if (pso.pipelines_len == PIPELINE_MAX) {
+		gl_log_err("ERROR: pipeline: no room for %s\n", desc->name ? desc->name : "?");
+		return -1;
+	}
+	i32 index = pso.pipelines_len++;
+	pso.pipelines[index] = (struct pipeline){.name = desc->name ? desc->name : "?", .key = key, .hash = hash};
+	return index;
+}
+
+static void
+set_capability(GLenum capability, b32 enabled) {
+	if (enabled) {
+		glEnable(capability);
+	} else {
+		glDisable(capability);
+	}
+}
+
+void
+pipeline_bind_vertex_array(GLuint vertex_array) {
+	if (pso.state.vertex_array != vertex_array) {
+		glBindVertexArray(vertex_array);
+		pso.state.vertex_array = vertex_array;
+		pso.calls++;
+		/* the bound pipeline no longer matches the state when it has a vertex array of its own */
+		if (pso.bound >= 0 && pso.pipelines[pso.bound].key.vertex_array) {
+			pso.bound = -1;
+		}
+	}
+}
+
+void
+pipeline_bind(i32 index) {
+	if (index < 0) {
+		return;
+	}
+	struct pipeline* pipeline = &pso.pipelines[index];
+	const struct pipeline_key* key = &pipeline->key;
+	struct gl_state* state = &pso.state;
+	GLuint program = key->program ? key->program : shader_program(key->shader_variant);
+	pipeline->binds++;
+	if (state->known && pso.bound == index && state->program == program) {
+		pipeline->skipped++;
+		return;
+	}
+	b32 known = state->known;
+	i64 calls = 0;
+
+	if (!known || state->program != program) {
+		glUseProgram(program);
+		state->program = program;
+		calls++;
+	}
+	if (key->vertex_array && state->vertex_array != key->vertex_array) {
+		glBindVertexArray(key->vertex_array);
+		state->vertex_array = key->vertex_array;
+		calls++;
+	}
+	if (!known || state->depth_test != key->depth_test) {
+		set_capability(GL_DEPTH_TEST, key->depth_test);
+		state->depth_test = key->depth_test;
+		calls++;
+	}
+	if (key->depth_test && (!known || state->depth_func != key->depth_func)) {
+		glDepthFunc(key->depth_func);
+		state->depth_func = key->depth_func;
+		calls++;
+	}
+	if (!known || state->depth_write != key->depth_write) {
+		glDepthMask(key->depth_write ? GL_TRUE : GL_FALSE);
+		state->depth_write = key->depth_write;
+		calls++;
+	}
+
+	b32 blend = key->blend != PIPELINE_BLEND_OPAQUE;
+	if (!known || state->blend != blend) {
+		set_capability(GL_BLEND, blend);
+		state->blend = blend;
+		calls++;
+	}
+	if (blend) {
+		GLenum src = key->blend == PIPELINE_BLEND_ALPHA ? GL_SRC_ALPHA : GL_ONE;
+		GLenum dst = key->blend == PIPELINE_BLEND_ALPHA ? GL_ONE_MINUS_SRC_ALPHA : GL_ONE;
+		if (!known || state->blend_src != src || state->blend_dst != dst) {
+			glBlendFunc(src, dst);
+			state->blend_src = src;
+			state->blend_dst = dst;
+			calls++;
+		}
+	}
+
+	b32 cull = key->cull != PIPELINE_CULL_NONE;
+	if (!known || state->cull != cull) {
+		set_capability(GL_CULL_FACE, cull);
+		state->cull = cull;
+		calls++;
+	}
+	if (cull) {
+		GLenum face = key->cull == PIPELINE_CULL_BACK ? GL_BACK : GL_FRONT;
+		if (!known || state->cull_face != face) {
+			glCullFace(face);
+			state->cull_face = face;
+			calls++;
+		}
+	}
+
+	state->known = 1;
+	pso.bound = index;
+	pipeline->calls += calls;
+	pso.calls += calls;
+}
+
+void
+pipeline_clear(GLbitfield mask, const float* color, float depth) {
+	struct gl_state* state = &pso.state;
+	if ((mask & GL_COLOR_BUFFER_BIT) && memcmp(state->clear_color, color, sizeof(state->clear_color)) != 0) {
+		glClearColor(color[0], color[1], color[2], color[3]);
+		memcpy(state->clear_color, color, sizeof(state->clear_color));
+		pso.clear_calls++;
+	}
+	if (mask & GL_DEPTH_BUFFER_BIT) {
+		if (state->clear_depth != depth) {
+			glClearDepth(depth);
+			state->clear_depth = depth;
+			pso.clear_calls++;
+		}
+		/* the depth mask applies to clears as well */
+		if (!state->known || !state->depth_write) {
+			glDepthMask(GL_TRUE);
+			state->depth_write = 1;
+			pso.clear_calls++;
+			pso.bound = -1;
+		}
+	}
+	glClear(mask);
+}
+
+void
+pipeline_log(void) {
+	gl_log("pipelines: %i created, %li state calls from binds, %li from clears\n", pso.pipelines_len,
+	       (long)pso.calls, (long)pso.clear_calls);
+	for (i32 i = 0; i < pso.pipelines_len; i++) {
+		const struct pipeline* pipeline = &pso.pipelines[i];
+		gl_log("  %-16s %016llx %8li binds %8li already bound %8li state calls\n", pipeline->name,
+		       (unsigned long long)pipeline->hash, (long)pipeline->binds, (long)pipeline->skipped,
+		       (long)pipeline->calls);
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Pipeline state objects.
+ * A pipeline is an immutable bundle of a program, a vertex array (the vertex format and its buffers)
+ * and the depth, blend and cull state a draw needs. pipeline_create() hashes the description and
+ * hands back the existing pipeline when an identical one was created before. pipeline_bind() diffs
+ * the pipeline against a shadow copy of the GL state and issues only the calls for what differs, so
+ * binding the same pipeline twice costs nothing and every state change is counted per pipeline.
+ *
+ * The shadow copy is only right while the state below changes through this module: code that sets it
+ * directly, like the setup of a vertex array or a program's uniforms, calls pipeline_invalidate()
+ * afterwards. */
+
+#define PIPELINE_MAX 64
+
+enum pipeline_blend {
+	PIPELINE_BLEND_OPAQUE,
+	PIPELINE_BLEND_ALPHA, /* src * a + dst * (1 - a) */
+	PIPELINE_BLEND_ADDITIVE,
+};
+
+enum pipeline_cull {
+	PIPELINE_CULL_NONE,
+	PIPELINE_CULL_BACK, /* counter-clockwise fronts */
+	PIPELINE_CULL_FRONT,
+};
+
+struct pipeline_desc {
+	const char* name; /* for the log, not part of the hash */
+	GLuint program;     /* owned by the caller; 0 uses shader_variant */
+	i32 shader_variant; /* shader.h, looked up at bind time so a shader reload takes effect */
+	GLuint vertex_array; /* 0 leaves it to pipeline_bind_vertex_array() per draw */
+	b32 depth_test;
+	GLenum depth_func; /* with depth_test */
+	b32 depth_write;
+	enum pipeline_blend blend;
+	enum pipeline_cull cull;
+};
+
+void pipeline_init(void);
+void pipeline_shutdown(void);
+/* the GL state was changed behind the module's back, the next bind sets everything */
+void pipeline_invalidate(void);
+
+/* the pipeline handle, or -1 when the table is full */
+i32 pipeline_create(const struct pipeline_desc* desc);
+/* a negative handle, from a pipeline_create() that failed, binds nothing */
+void pipeline_bind(i32 pipeline);
+/* for pipelines without a vertex array: draws that share a format but not the buffers */
+void pipeline_bind_vertex_array(GLuint vertex_array);
+/* clears the bound framebuffer, the clear values are diffed like pipeline state; color may be NULL
+ * without GL_COLOR_BUFFER_BIT. A depth clear turns depth writes on first */
+void pipeline_clear(GLbitfield mask, const float* color, float depth);
+
+void pipeline_log(void);
+
+#endif
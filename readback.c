@@ -0,0 +1,94 @@
+#include "gpu_memory.h"
+#include "readback.h"
+
+void
+readback_init(struct readback* rb) {
+	*rb = (struct readback){.owner = gpu_mem_owner()};
+	glGenBuffers(READBACK_RING, rb->pbos);
+}
+
+void
+readback_shutdown(struct readback* rb) {
+	for (isize i = 0; i < READBACK_RING; i++) {
+		if (rb->fences[i]) {
+			glDeleteSync(rb->fences[i]);
+		}
+	}
+	glDeleteBuffers(READBACK_RING, rb->pbos);
+	*rb = (struct readback){0};
+}
+
+b32
+readback_request(struct readback* rb, int x, int y, int width, int height, void* tag) {
+	if (rb->len == READBACK_RING) {
+		return 0;
+	}
+	isize slot = (rb->head + rb->len) % READBACK_RING;
+	isize size = (isize)width * height * 4;
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbos[slot]);
+	if (rb->sizes[slot] != size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		rb->sizes[slot] = size;
+	}
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	/* back to the default, later glReadPixels calls may not set it */
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	{
+		GPU_MEM_OWNER(rb->owner);
+		rb->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	rb->widths[slot] = width;
+	rb->heights[slot] = height;
+	rb->tags[slot] = tag;
+	rb->len++;
+	return 1;
+}
+
+isize
+readback_poll(struct readback* rb, readback_fn fn, void* user, b32 wait) {
+	isize delivered = 0;
+	int retries = 0;
+	while (rb->len > 0) {
+		isize slot = rb->head;
+		/* flush on the blocking path, otherwise the fence might never reach the GPU */
+		GLbitfield flags = wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+		GLuint64 timeout = wait ? 1000000000ull : 0;
+		GLenum status = glClientWaitSync(rb->fences[slot], flags, timeout);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			if (!wait) {
+				break;
+			}
+			if (++retries < READBACK_WAIT_RETRIES) {
+				continue;
+			}
+			gl_log_err("WARNING: readback: gave up on a fence after %i s\n", READBACK_WAIT_RETRIES);
+			status = GL_WAIT_FAILED;
+		}
+		retries = 0;
+		glDeleteSync(rb->fences[slot]);
+		rb->fences[slot] = 0;
+
+		b32 ok = 0;
+		if (status != GL_WAIT_FAILED) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, rb->pbos[slot]);
+			const u8* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rb->sizes[slot], GL_MAP_READ_BIT);
+			if (pixels) {
+				fn(user, rb->tags[slot], pixels, rb->widths[slot], rb->heights[slot]);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				delivered++;
+				ok = 1;
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		if (!ok) {
+			fn(user, rb->tags[slot], NULL, rb->widths[slot], rb->heights[slot]);
+		}
+		rb->head = (rb->head + 1) % READBACK_RING;
+		rb->len--;
+	}
+	return delivered;
+}
@@ -0,0 +1,42 @@
+#ifndef READBACK_H
+#define READBACK_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Asynchronous framebuffer readback.
+ * glReadPixels targets one of READBACK_RING pixel-pack buffers and a fence is inserted after it;
+ * the buffer is only mapped once its fence has signalled, typically a couple of frames later, so
+ * the CPU never waits on the GPU. Pixels handed to the callback are bottom row first. */
+
+#define READBACK_RING 3
+/* blocking polls give up on a fence after this many one second waits */
+#define READBACK_WAIT_RETRIES 5
+
+/* rgba is NULL when the readback failed (the wait failed or timed out, or the buffer would not map),
+ * so the tag can still be released */
+typedef void (*readback_fn)(void* user, void* tag, const u8* rgba, int width, int height);
+
+struct readback {
+	GLuint pbos[READBACK_RING];
+	GLsync fences[READBACK_RING];
+	isize sizes[READBACK_RING]; /* current GL_PIXEL_PACK_BUFFER storage size */
+	int widths[READBACK_RING];
+	int heights[READBACK_RING];
+	void* tags[READBACK_RING];
+	isize head;        /* oldest in-flight slot */
+	isize len;         /* slots in flight */
+	const char* owner; /* GPU_MEM_OWNER at init, the fences are tagged with it too */
+};
+
+void readback_init(struct readback* rb);
+void readback_shutdown(struct readback* rb);
+
+/* read the currently bound read framebuffer as RGBA8; 0 when every slot is still in flight */
+b32 readback_request(struct readback* rb, int x, int y, int width, int height, void* tag);
+/* deliver every completed slot in request order; with wait set, block until all are delivered or
+ * have failed. Returns the number delivered with pixels */
+isize readback_poll(struct readback* rb, readback_fn fn, void* user, b32 wait);
+
+#endif
@@ -0,0 +1,293 @@
+#define _POSIX_C_SOURCE 200809L
+#include <emmintrin.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_trace.h"
+#include "gpu_memory.h"
+#include "readback.h"
+#include "recorder.h"
+
+#define RECORDER_BUFFERS 6
+
+struct recorder_frame {
+	u8* rgba;
+	isize cap;
+};
+
+static struct {
+	b32 active;
+	FILE* file;
+	double fps;
+	int width;
+	int height;
+	struct readback readback;
+	u8* planes; /* Y, U and V back to back, owned by the writer thread */
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	struct recorder_frame frames[RECORDER_BUFFERS];
+	isize free_list[RECORDER_BUFFERS];
+	isize free_len;
+	isize queue[RECORDER_BUFFERS];
+	isize queue_head;
+	isize queue_len;
+	b32 quit;
+	b32 thread_started;
+
+	long frames_written;
+	long frames_dropped;
+} recorder = {.mutex = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+//////////////////////////////////////
+// RGBA -> BT.601 limited range YUV 4:2:0
+static inline u8
+rgb_to_y(int r, int g, int b) {
+	return (u8)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+static inline u8
+rgb_to_u(int r, int g, int b) {
+	return (u8)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+}
+
+static inline u8
+rgb_to_v(int r, int g, int b) {
+	return (u8)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+}
+
+/* split 8 RGBA pixels into 16-bit R, G, B lanes */
+static inline void
+deinterleave8(const u8* src, __m128i* r, __m128i* g, __m128i* b) {
+	__m128i p0 = _mm_loadu_si128((const __m128i*)src);
+	__m128i p1 = _mm_loadu_si128((const __m128i*)(src + 16));
+	__m128i mask = _mm_set1_epi32(0xff);
+	*r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+	*g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+	*b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+
+/* coefficients are applied in wrapping unsigned 16-bit math: every intermediate lands in 0..65535 once
+ * the bias is added, so the final logical shift is exact */
+static inline __m128i
+weighted_sum(__m128i r, __m128i g, __m128i b, short cr, short cg, short cb, unsigned short bias) {
+	__m128i sum = _mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(cr)), _mm_mullo_epi16(g, _mm_set1_epi16(cg)));
+	sum = _mm_add_epi16(sum, _mm_mullo_epi16(b, _mm_set1_epi16(cb)));
+	return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16((short)bias)), 8);
+}
+
+/* average horizontal pairs of two rows: 8 + 8 lanes in, 4 lanes out (low half) */
+static inline __m128i
+average_2x2(__m128i row0, __m128i row1) {
+	__m128i pairs = _mm_madd_epi16(_mm_add_epi16(row0, row1), _mm_set1_epi16(1));
+	pairs = _mm_srli_epi32(_mm_add_epi32(pairs, _mm_set1_epi32(2)), 2);
+	return _mm_packs_epi32(pairs, pairs);
+}
+
+void
+recorder_rgba_to_yuv420(const u8* rgba, int width, int height, u8* y_plane, u8* u_plane, u8* v_plane) {
+	isize stride = (isize)width * 4;
+	int cw = width / 2;
+	for (int y = 0; y < height; y += 2) {
+		/* readback rows are bottom-up, video rows top-down */
+		const u8* row0 = rgba + (isize)(height - 1 - y) * stride;
+		const u8* row1 = rgba + (isize)(height - 2 - y) * stride;
+		u8* y0 = y_plane + (isize)y * width;
+		u8* y1 = y0 + width;
+		u8* u = u_plane + (isize)(y / 2) * cw;
+		u8* v = v_plane + (isize)(y / 2) * cw;
+		int x = 0;
+		for (; x + 8 <= width; x += 8) {
+			__m128i r0, g0, b0, r1, g1, b1;
+			deinterleave8(row0 + x * 4, &r0, &g0, &b0);
+			deinterleave8(row1 + x * 4, &r1, &g1, &b1);
+			__m128i luma0 = _mm_add_epi16(weighted_sum(r0, g0, b0, 66, 129, 25, 128), _mm_set1_epi16(16));
+			__m128i luma1 = _mm_add_epi16(weighted_sum(r1, g1, b1, 66, 129, 25, 128), _mm_set1_epi16(16));
+			_mm_storel_epi64((__m128i*)(y0 + x), _mm_packus_epi16(luma0, luma0));
+			_mm_storel_epi64((__m128i*)(y1 + x), _mm_packus_epi16(luma1, luma1));
+
+			__m128i r = average_2x2(r0, r1);
+			__m128i g = average_2x2(g0, g1);
+			__m128i b = average_2x2(b0, b1);
+			/* +32768 keeps the signed sums positive and becomes the +128 chroma offset after >> 8 */
+			__m128i cb = weighted_sum(r, g, b, -38, -74, 112, 32768 + 128);
+			__m128i cr = weighted_sum(r, g, b, 112, -94, -18, 32768 + 128);
+			int cb4 = _mm_cvtsi128_si32(_mm_packus_epi16(cb, cb));
+			int cr4 = _mm_cvtsi128_si32(_mm_packus_epi16(cr, cr));
+			memcpy(u + x / 2, &cb4, 4);
+			memcpy(v + x / 2, &cr4, 4);
+		}
+		for (; x < width; x += 2) {
+			const u8* a = row0 + x * 4;
+			const u8* b = row1 + x * 4;
+			y0[x] = rgb_to_y(a[0], a[1], a[2]);
+			y0[x + 1] = rgb_to_y(a[4], a[5], a[6]);
+			y1[x] = rgb_to_y(b[0], b[1], b[2]);
+			y1[x + 1] = rgb_to_y(b[4], b[5], b[6]);
+			int r = (a[0] + a[4] + b[0] + b[4] + 2) >> 2;
+			int g = (a[1] + a[5] + b[1] + b[5] + 2) >> 2;
+			int bl = (a[2] + a[6] + b[2] + b[6] + 2) >> 2;
+			u[x / 2] = rgb_to_u(r, g, bl);
+			v[x / 2] = rgb_to_v(r, g, bl);
+		}
+	}
+}
+
+//////////////////////////////////////
+// writer thread
+static void*
+recorder_worker(void* arg) {
+	(void)arg;
+	TRACE_THREAD_NAME("recorder");
+	isize luma = (isize)recorder.width * recorder.height;
+	isize chroma = luma / 4;
+	pthread_mutex_lock(&recorder.mutex);
+	for (;;) {
+		while (!recorder.quit && recorder.queue_len == 0) {
+			pthread_cond_wait(&recorder.cond, &recorder.mutex);
+		}
+		if (recorder.queue_len == 0) {
+			break;
+		}
+		isize index = recorder.queue[recorder.queue_head];
+		recorder.queue_head = (recorder.queue_head + 1) % RECORDER_BUFFERS;
+		recorder.queue_len--;
+		pthread_mutex_unlock(&recorder.mutex);
+
+		{
+			TRACE_ZONE("recorder encode");
+			recorder_rgba_to_yuv420(recorder.frames[index].rgba, recorder.width, recorder.height, recorder.planes,
+			                        recorder.planes + luma, recorder.planes + luma + chroma);
+			fputs("FRAME\n", recorder.file);
+			fwrite(recorder.planes, 1, luma + chroma * 2, recorder.file);
+		}
+
+		pthread_mutex_lock(&recorder.mutex);
+		recorder.free_list[recorder.free_len++] = index;
+		recorder.frames_written++;
+	}
+	pthread_mutex_unlock(&recorder.mutex);
+	return NULL;
+}
+
+static void
+recorder_deliver(void* user, void* tag, const u8* rgba, int width, int height) {
+	(void)user;
+	(void)tag;
+	if (!rgba) {
+		recorder.frames_dropped++;
+		return;
+	}
+	/* readback covered the cropped even size, but the first frame fixes the stream size */
+	if (recorder.width == 0) {
+		recorder.width = width;
+		recorder.height = height;
+		/* F is a ratio, in thousandths it also covers NTSC style rates like 59.94 */
+		fprintf(recorder.file, "YUV4MPEG2 W%d H%d F%ld:1000 Ip A1:1 C420jpeg\n", width, height,
+		        lround(recorder.fps * 1000.0));
+		recorder.planes = malloc((size_t)width * height * 3 / 2);
+		if (pthread_create(&recorder.thread, NULL, recorder_worker, NULL) != 0) {
+			gl_log_err("ERROR: could not start recorder thread\n");
+			recorder.active = 0;
+			return;
+		}
+		recorder.thread_started = 1;
+	}
+	if (width != recorder.width || height != recorder.height) {
+		recorder.frames_dropped++;
+		return;
+	}
+
+	pthread_mutex_lock(&recorder.mutex);
+	if (recorder.free_len == 0) {
+		pthread_mutex_unlock(&recorder.mutex);
+		recorder.frames_dropped++;
+		return;
+	}
+	isize index = recorder.free_list[--recorder.free_len];
+	pthread_mutex_unlock(&recorder.mutex);
+
+	struct recorder_frame* frame = &recorder.frames[index];
+	isize size = (isize)width * height * 4;
+	if (frame->cap < size) {
+		free(frame->rgba);
+		frame->rgba = malloc(size);
+		frame->cap = size;
+	}
+	memcpy(frame->rgba, rgba, size);
+
+	pthread_mutex_lock(&recorder.mutex);
+	recorder.queue[(recorder.queue_head + recorder.queue_len) % RECORDER_BUFFERS] = index;
+	recorder.queue_len++;
+	pthread_cond_signal(&recorder.cond);
+	pthread_mutex_unlock(&recorder.mutex);
+}
+
+b32
+recorder_init(const char* path, double fps) {
+	GPU_MEM_OWNER("recorder");
+	recorder.file = fopen(path, "wb");
+	if (!recorder.file) {
+		gl_log_err("ERROR: could not open %s for recording\n", path);
+		return 0;
+	}
+	readback_init(&recorder.readback);
+	for (isize i = 0; i < RECORDER_BUFFERS; i++) {
+		recorder.free_list[i] = i;
+	}
+	recorder.free_len = RECORDER_BUFFERS;
+	recorder.fps = fps;
+	recorder.active = 1;
+	gl_log("recording to %s at %.3f fps\n", path, fps);
+	return 1;
+}
+
+b32
+recorder_active(void) {
+	return recorder.active;
+}
+
+void
+recorder_end_frame(int fb_width, int fb_height) {
+	if (!recorder.active) {
+		return;
+	}
+	TRACE_ZONE("recorder_end_frame");
+	readback_poll(&recorder.readback, recorder_deliver, NULL, 0);
+	if (!readback_request(&recorder.readback, 0, 0, fb_width & ~1, fb_height & ~1, NULL)) {
+		recorder.frames_dropped++;
+	}
+}
+
+void
+recorder_shutdown(void) {
+	if (!recorder.file) {
+		return;
+	}
+	if (recorder.active) {
+		readback_poll(&recorder.readback, recorder_deliver, NULL, 1);
+	}
+	readback_shutdown(&recorder.readback);
+	if (recorder.thread_started) {
+		pthread_mutex_lock(&recorder.mutex);
+		recorder.quit = 1;
+		pthread_cond_broadcast(&recorder.cond);
+		pthread_mutex_unlock(&recorder.mutex);
+		pthread_join(recorder.thread, NULL);
+	}
+	gl_log("recording finished: %li frames written, %li dropped\n", recorder.frames_written, recorder.frames_dropped);
+	fclose(recorder.file);
+	recorder.file = NULL;
+	recorder.active = 0;
+	recorder.thread_started = 0;
+	for (isize i = 0; i < RECORDER_BUFFERS; i++) {
+		free(recorder.frames[i].rgba);
+		recorder.frames[i] = (struct recorder_frame){0};
+	}
+	free(recorder.planes);
+	recorder.planes = NULL;
+}
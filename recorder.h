@@ -0,0 +1,23 @@
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include "common.h"
+
+/* Raw Y4M (YUV 4:2:0) video recording.
+ * Every frame goes through its own readback ring; completed frames are copied into a small pool of
+ * buffers and converted/written by a background thread. The render loop never waits: when the GPU
+ * readback or the encoder falls behind the frame is dropped and counted instead. Odd framebuffer
+ * sizes are cropped to even, and frames whose size differs from the first one are dropped. */
+
+/* fps is the rate frames are captured at, written to the stream header as the playback rate */
+b32 recorder_init(const char* path, double fps);
+void recorder_shutdown(void);
+b32 recorder_active(void);
+
+/* call after the frame is drawn and before the buffer swap */
+void recorder_end_frame(int fb_width, int fb_height);
+
+/* exposed for benchmarking; rgba is bottom row first, width and height must be even */
+void recorder_rgba_to_yuv420(const u8* rgba, int width, int height, u8* y_plane, u8* u_plane, u8* v_plane);
+
+#endif
@@ -0,0 +1,258 @@
+#include <string.h>
+
+#include "gpu_memory.h"
+#include "render_target.h"
+
+#define RT_IDLE_FRAMES 3 /* released targets nobody re-acquired for this long are deleted */
+
+struct render_target {
+	GLuint texture; /* 0 when the entry is free */
+	GLenum format;
+	int width;
+	int height;
+	b32 relative; /* sized from the window framebuffer, fb_width x fb_height at creation */
+	int fb_width;
+	int fb_height;
+	b32 in_use;
+	u32 last_used;
+	isize bytes;
+};
+
+struct rt_framebuffer {
+	GLuint fbo; /* 0 when the entry is free */
+	GLuint colors[RT_MAX_COLOR_ATTACHMENTS];
+	int color_count;
+	GLuint depth;
+	u32 last_used;
+};
+
+static struct {
+	struct render_target targets[RT_MAX_TARGETS];
+	struct rt_framebuffer framebuffers[RT_MAX_FRAMEBUFFERS];
+	int fb_width;
+	int fb_height;
+	u32 frame;
+
+	isize bytes;
+	isize peak_bytes;
+	isize acquires;
+	isize creates;
+} rt;
+
+static GLenum
+depth_attachment(GLenum format) {
+	switch (format) {
+		case GL_DEPTH_COMPONENT16:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+			return GL_DEPTH_ATTACHMENT;
+		case GL_DEPTH24_STENCIL8:
+		case GL_DEPTH32F_STENCIL8:
+			return GL_DEPTH_STENCIL_ATTACHMENT;
+		default:
+			return 0;
+	}
+}
+
+b32
+rt_is_depth_format(GLenum format) {
+	return depth_attachment(format) != 0;
+}
+
+static void
+delete_target(struct render_target* target) {
+	for (isize i = 0; i < RT_MAX_FRAMEBUFFERS; i++) {
+		struct rt_framebuffer* fb = &rt.framebuffers[i];
+		b32 uses = fb->fbo && fb->depth == target->texture;
+		for (int c = 0; fb->fbo && c < fb->color_count; c++) {
+			uses |= fb->colors[c] == target->texture;
+		}
+		if (uses) {
+			glDeleteFramebuffers(1, &fb->fbo);
+			memset(fb, 0, sizeof(*fb));
+		}
+	}
+	glDeleteTextures(1, &target->texture);
+	rt.bytes -= target->bytes;
+	memset(target, 0, sizeof(*target));
+}
+
+void
+rt_pool_init(int fb_width, int fb_height) {
+	memset(&rt, 0, sizeof(rt));
+	rt.fb_width = fb_width;
+	rt.fb_height = fb_height;
+}
+
+void
+rt_pool_shutdown(void) {
+	for (isize i = 0; i < RT_MAX_TARGETS; i++) {
+		if (rt.targets[i].texture) {
+			delete_target(&rt.targets[i]);
+		}
+	}
+}
+
+void
+rt_pool_resize(int fb_width, int fb_height) {
+	rt.fb_width = fb_width;
+	rt.fb_height = fb_height;
+}
+
+void
+rt_pool_begin_frame(void) {
+	rt.frame++;
+	for (isize i = 0; i < RT_MAX_TARGETS; i++) {
+		struct render_target* target = &rt.targets[i];
+		if (!target->texture || target->in_use) {
+			continue;
+		}
+		b32 resized = target->relative && (target->fb_width != rt.fb_width || target->fb_height != rt.fb_height);
+		if (resized || target->last_used + RT_IDLE_FRAMES < rt.frame) {
+			delete_target(target);
+		}
+	}
+}
+
+void
+rt_pool_log(void) {
+	gl_log("render targets: %li acquires served by %li textures, %.1f MB now, %.1f MB peak\n", (long)rt.acquires,
+	       (long)rt.creates, rt.bytes / (1024.0 * 1024.0), rt.peak_bytes / (1024.0 * 1024.0));
+}
+
+i32
+rt_acquire(struct rt_desc desc) {
+	GPU_MEM_OWNER("render targets");
+	b32 relative = desc.width <= 0;
+	if (relative) {
+		float scale = desc.scale > 0.0f ? desc.scale : 1.0f;
+		desc.width = (int)(rt.fb_width * scale) > 0 ? (int)(rt.fb_width * scale) : 1;
+		desc.height = (int)(rt.fb_height * scale) > 0 ? (int)(rt.fb_height * scale) : 1;
+	}
+	rt.acquires++;
+	i32 free_slot = -1;
+	for (i32 i = 0; i < RT_MAX_TARGETS; i++) {
+		struct render_target* target = &rt.targets[i];
+		if (!target->texture) {
+			free_slot = free_slot < 0 ? i : free_slot;
+			continue;
+		}
+		/* targets from before a resize no longer match, rt_pool_begin_frame() deletes them */
+		if (!target->in_use && target->format == desc.format && target->width == desc.width &&
+		    target->height == desc.height) {
+			target->in_use = 1;
+			target->last_used = rt.frame;
+			return i;
+		}
+	}
+	if (free_slot < 0) {
+		gl_log_err("ERROR: render target pool is full\n");
+		return -1;
+	}
+
+	struct render_target* target = &rt.targets[free_slot];
+	glGenTextures(1, &target->texture);
+	glBindTexture(GL_TEXTURE_2D, target->texture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, desc.format, desc.width, desc.height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	target->format = desc.format;
+	target->width = desc.width;
+	target->height = desc.height;
+	target->relative = relative;
+	target->fb_width = rt.fb_width;
+	target->fb_height = rt.fb_height;
+	target->in_use = 1;
+	target->last_used = rt.frame;
+	target->bytes = (isize)desc.width * desc.height * gpu_mem_texel_bytes(desc.format);
+	rt.bytes += target->bytes;
+	rt.peak_bytes = rt.bytes > rt.peak_bytes ? rt.bytes : rt.peak_bytes;
+	rt.creates++;
+	return free_slot;
+}
+
+void
+rt_release(i32 target) {
+	if (target < 0 || target >= RT_MAX_TARGETS) {
+		return;
+	}
+	rt.targets[target].in_use = 0;
+	rt.targets[target].last_used = rt.frame;
+}
+
+GLuint
+rt_texture(i32 target) {
+	return target >= 0 && target < RT_MAX_TARGETS ? rt.targets[target].texture : 0;
+}
+
+void
+rt_size(i32 target, int* width, int* height) {
+	*width = target >= 0 && target < RT_MAX_TARGETS ? rt.targets[target].width : 0;
+	*height = target >= 0 && target < RT_MAX_TARGETS ? rt.targets[target].height : 0;
+}
+
+static GLuint
+find_framebuffer(const GLuint* colors, int color_count, GLuint depth, GLenum depth_format) {
+	GPU_MEM_OWNER("render targets");
+	for (isize i = 0; i < RT_MAX_FRAMEBUFFERS; i++) {
+		struct rt_framebuffer* fb = &rt.framebuffers[i];
+		if (fb->fbo && fb->color_count == color_count && fb->depth == depth &&
+		    memcmp(fb->colors, colors, color_count * sizeof(*colors)) == 0) {
+			fb->last_used = rt.frame;
+			return fb->fbo;
+		}
+	}
+	/* reuse an empty entry, or the one unused the longest */
+	struct rt_framebuffer* fb = &rt.framebuffers[0];
+	for (isize i = 0; i < RT_MAX_FRAMEBUFFERS && fb->fbo; i++) {
+		if (!rt.framebuffers[i].fbo || rt.framebuffers[i].last_used < fb->last_used) {
+			fb = &rt.framebuffers[i];
+		}
+	}
+	if (fb->fbo) {
+		glDeleteFramebuffers(1, &fb->fbo);
+	}
+	memset(fb, 0, sizeof(*fb));
+	glGenFramebuffers(1, &fb->fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fb->fbo);
+	GLenum draw_buffers[RT_MAX_COLOR_ATTACHMENTS];
+	for (int c = 0; c < color_count; c++) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + c, GL_TEXTURE_2D, colors[c], 0);
+		draw_buffers[c] = GL_COLOR_ATTACHMENT0 + c;
+		fb->colors[c] = colors[c];
+	}
+	if (depth) {
+		glFramebufferTexture2D(GL_FRAMEBUFFER, depth_attachment(depth_format), GL_TEXTURE_2D, depth, 0);
+	}
+	glDrawBuffers(color_count, draw_buffers);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		gl_log_err("ERROR: render target framebuffer incomplete (0x%x)\n", status);
+	}
+	fb->color_count = color_count;
+	fb->depth = depth;
+	fb->last_used = rt.frame;
+	return fb->fbo;
+}
+
+void
+rt_bind(const i32* colors, int color_count, i32 depth) {
+	GLuint textures[RT_MAX_COLOR_ATTACHMENTS];
+	int width = 0, height = 0;
+	color_count = color_count < RT_MAX_COLOR_ATTACHMENTS ? color_count : RT_MAX_COLOR_ATTACHMENTS;
+	for (int c = 0; c < color_count; c++) {
+		textures[c] = rt_texture(colors[c]);
+		rt_size(colors[c], &width, &height);
+	}
+	GLuint depth_texture = rt_texture(depth);
+	if (depth_texture && !width) {
+		rt_size(depth, &width, &height);
+	}
+
+	GLenum depth_format = depth_texture ? rt.targets[depth].format : 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, find_framebuffer(textures, color_count, depth_texture, depth_format));
+	glViewport(0, 0, width, height);
+}
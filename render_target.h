@@ -0,0 +1,46 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Render target pool.
+ * Passes ask for a target by description with rt_acquire() and hand it back with rt_release() as
+ * soon as its contents are no longer read. A released texture goes back to the pool and is handed
+ * to the next acquire with the same format and size, so transient targets whose lifetimes do not
+ * overlap within a frame share memory. Framebuffer objects are cached per attachment set.
+ *
+ * Sizes can be given relative to the window framebuffer. rt_pool_resize() only records the new
+ * size: targets are recreated on the next acquire, and the old ones are deleted once idle. */
+
+#define RT_MAX_TARGETS 64
+#define RT_MAX_FRAMEBUFFERS 32
+#define RT_MAX_COLOR_ATTACHMENTS 4
+
+struct rt_desc {
+	GLenum format; /* sized internal format, GL_DEPTH_COMPONENT* / GL_DEPTH*_STENCIL8 for depth */
+	int width;     /* absolute size; 0 uses scale */
+	int height;
+	float scale; /* fraction of the window framebuffer when width is 0, 0 means 1 */
+};
+
+void rt_pool_init(int fb_width, int fb_height);
+void rt_pool_shutdown(void);
+void rt_pool_resize(int fb_width, int fb_height);
+/* once per frame: deletes targets left behind by a resize or idle for a few frames */
+void rt_pool_begin_frame(void);
+void rt_pool_log(void);
+
+/* -1 when the pool is full */
+i32 rt_acquire(struct rt_desc desc);
+void rt_release(i32 target);
+GLuint rt_texture(i32 target);
+void rt_size(i32 target, int* width, int* height);
+
+b32 rt_is_depth_format(GLenum format);
+
+/* binds a framebuffer with these attachments (depth may be -1) and sets the viewport to their size */
+void rt_bind(const i32* colors, int color_count, i32 depth);
+
+#endif
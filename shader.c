@@ -0,0 +1,525 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "camera.h"
+#include "gpu_memory.h"
+#include "shader.h"
+
+#define BINARY_MAGIC 0x4e425348u /* "HSBN" */
+
+/* in front of the driver's blob in a program binary file */
+struct binary_header {
+	u32 magic;
+	u32 format;
+	u32 size;
+};
+
+static const char* uniform_names[SHADER_UNIFORMS] = {
+    [SHADER_UNIFORM_COLOR] = "inputColor",
+};
+
+struct variant {
+	u64 key; /* of the paths and the define set */
+	u64 source_hash; /* of both preprocessed sources */
+	char vs_path[SHADER_PATH_MAX];
+	char fs_path[SHADER_PATH_MAX];
+	char defines[SHADER_DEFINES_MAX];
+	GLuint program;
+	GLint uniforms[SHADER_UNIFORMS];
+};
+
+static struct {
+	struct variant variants[SHADER_MAX_VARIANTS];
+	i32 variants_len;
+	i64 compiles;
+	i64 failures;
+	i64 reloads;
+	i64 binary_loads;
+	i64 stale_binaries;
+} shaders;
+
+u64
+shader_hash(const void* data, isize len, u64 hash) {
+	const u8* bytes = data;
+	for (isize i = 0; i < len; i++) {
+		hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+//////////////////////////////////////
+// preprocessor
+
+static void
+append(struct shader_source* source, isize* cap, const char* text, isize len) {
+	if (source->len + len + 1 > *cap) {
+		while (source->len + len + 1 > *cap) {
+			*cap = *cap ? *cap * 2 : 4096;
+		}
+		source->text = realloc(source->text, *cap);
+	}
+	memcpy(source->text + source->len, text, len);
+	source->len += len;
+	source->text[source->len] = '\0';
+}
+
+static void
+appendf(struct shader_source* source, isize* cap, const char* format, ...) {
+	char line[512];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	append(source, cap, line, len < (int)sizeof(line) ? len : (int)sizeof(line) - 1);
+}
+
+static char*
+read_text(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return NULL;
+	}
+	fseek(file, 0, SEEK_END);
+	long len = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* text = malloc(len > 0 ? len + 1 : 1);
+	if (len < 0 || fread(text, 1, len, file) != (size_t)len) {
+		free(text);
+		text = NULL;
+	} else {
+		text[len] = '\0';
+	}
+	fclose(file);
+	return text;
+}
+
+static void
+append_defines(struct shader_source* source, isize* cap, const char* defines) {
+	while (defines && *defines) {
+		isize len = strcspn(defines, " ,\t\n");
+		if (len > 0) {
+			const char* equals = memchr(defines, '=', len);
+			if (equals) {
+				appendf(source, cap, "#define %.*s %.*s\n", (int)(equals - defines), defines,
+				        (int)(len - (equals + 1 - defines)), equals + 1);
+			} else {
+				appendf(source, cap, "#define %.*s 1\n", (int)len, defines);
+			}
+		}
+		defines += len;
+		defines += *defines != '\0';
+	}
+}
+
+/* "#include" and "#version" with optional whitespace around the '#'; returns what follows */
+static const char*
+directive(const char* line, const char* end, const char* name) {
+	while (line < end && (*line == ' ' || *line == '\t')) {
+		line++;
+	}
+	if (line == end || *line++ != '#') {
+		return NULL;
+	}
+	while (line < end && (*line == ' ' || *line == '\t')) {
+		line++;
+	}
+	isize len = (isize)strlen(name);
+	return end - line >= len && memcmp(line, name, len) == 0 ? line + len : NULL;
+}
+
+static b32
+expand(struct shader_source* source, isize* cap, const char* path, const char* defines, int depth) {
+	for (isize i = 0; i < source->files_len; i++) {
+		if (strcmp(source->files[i], path) == 0) {
+			return 1;
+		}
+	}
+	if (depth > SHADER_MAX_INCLUDE_DEPTH || source->files_len == SHADER_MAX_FILES ||
+	    strlen(path) >= SHADER_PATH_MAX) {
+		gl_log_err("ERROR: shader: too many or too deeply nested includes at %s\n", path);
+		return 0;
+	}
+	char* text = read_text(path);
+	if (!text) {
+		gl_log_err("ERROR: shader: could not read %s\n", path);
+		return 0;
+	}
+	isize file = source->files_len++;
+	strcpy(source->files[file], path);
+	if (depth > 0) {
+		appendf(source, cap, "#line 1 %li\n", (long)file);
+	}
+
+	b32 ok = 1;
+	int line_number = 1;
+	for (const char* line = text; *line && ok; line_number++) {
+		const char* end = line + strcspn(line, "\n");
+		const char* next = *end ? end + 1 : end;
+		const char* include = directive(line, end, "include");
+		if (include) {
+			const char* open = memchr(include, '"', end - include);
+			const char* close = open ? memchr(open + 1, '"', end - open - 1) : NULL;
+			if (!close) {
+				gl_log_err("ERROR: shader: %s:%i: expected #include \"file\"\n", path, line_number);
+				ok = 0;
+				break;
+			}
+			/* relative to the including file */
+			const char* slash = strrchr(path, '/');
+			int dir_len = slash ? (int)(slash - path + 1) : 0;
+			char include_path[SHADER_PATH_MAX];
+			snprintf(include_path, sizeof(include_path), "%.*s%.*s", dir_len, path, (int)(close - open - 1), open + 1);
+			ok = expand(source, cap, include_path, NULL, depth + 1);
+			appendf(source, cap, "#line %i %li\n", line_number + 1, (long)file);
+		} else {
+			append(source, cap, line, end - line);
+			append(source, cap, "\n", 1);
+			if (depth == 0 && defines && directive(line, end, "version")) {
+				append_defines(source, cap, defines);
+				appendf(source, cap, "#line %i %li\n", line_number + 1, (long)file);
+			}
+		}
+		line = next;
+	}
+	free(text);
+	return ok;
+}
+
+b32
+shader_preprocess(struct shader_source* source, const char* path, const char* defines) {
+	memset(source, 0, sizeof(*source));
+	isize cap = 0;
+	append(source, &cap, "", 0);
+	if (!expand(source, &cap, path, defines, 0)) {
+		shader_source_free(source);
+		return 0;
+	}
+	source->hash = shader_hash(source->text, source->len, SHADER_HASH_SEED);
+	return 1;
+}
+
+void
+shader_source_free(struct shader_source* source) {
+	free(source->text);
+	source->text = NULL;
+	source->len = 0;
+}
+
+//////////////////////////////////////
+// program cache
+
+static void
+log_files(const struct shader_source* source) {
+	for (isize i = 0; i < source->files_len; i++) {
+		gl_log_err("  source %li: %s\n", (long)i, source->files[i]);
+	}
+}
+
+/* source, when there is one, lists the files the error's source string numbers refer to */
+static GLuint
+compile_stage(GLenum type, const char* text, const char* name, const struct shader_source* source) {
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &text, NULL);
+	glCompileShader(shader);
+	int params = -1;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &params);
+	if (GL_TRUE != params) {
+		char log[2048];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		gl_log_err("ERROR: shader %s did not compile:\n%s", name, log);
+		if (source) {
+			log_files(source);
+		}
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+/* takes both stages, 0 when one of them is missing or linking fails */
+static GLuint
+link_stages(GLuint vert_shader, GLuint frag_shader, b32 retrievable, const char* name) {
+	if (!vert_shader || !frag_shader) {
+		if (vert_shader) {
+			glDeleteShader(vert_shader);
+		}
+		if (frag_shader) {
+			glDeleteShader(frag_shader);
+		}
+		return 0;
+	}
+	GLuint program = glCreateProgram();
+	glAttachShader(program, frag_shader);
+	glAttachShader(program, vert_shader);
+	if (retrievable) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(program);
+	/* the program keeps what it needs, the shaders go away with it */
+	glDeleteShader(vert_shader);
+	glDeleteShader(frag_shader);
+
+	int params = -1;
+	glGetProgramiv(program, GL_LINK_STATUS, &params);
+	if (GL_TRUE != params) {
+		char log[2048];
+		glGetProgramInfoLog(program, sizeof(log), NULL, log);
+		gl_log_err("ERROR: could not link %s:\n%s", name, log);
+		glDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+/* after linking or loading a binary */
+static void
+finish_program(GLuint program) {
+	/* GLSL 410 has no layout(binding), the camera block is bound here */
+	GLuint camera_block = glGetUniformBlockIndex(program, CAMERA_UBO_NAME);
+	if (camera_block != GL_INVALID_INDEX) {
+		glUniformBlockBinding(program, camera_block, CAMERA_UBO_BINDING);
+	}
+}
+
+static GLuint
+compile_program(const struct shader_source* vs, const struct shader_source* fs, const char* defines, b32 retrievable) {
+	GPU_MEM_OWNER("shaders");
+	shaders.compiles++;
+	GLuint vert_shader = compile_stage(GL_VERTEX_SHADER, vs->text, vs->files[0], vs);
+	GLuint frag_shader = vert_shader ? compile_stage(GL_FRAGMENT_SHADER, fs->text, fs->files[0], fs) : 0;
+	char name[2 * SHADER_PATH_MAX + SHADER_DEFINES_MAX + 16];
+	snprintf(name, sizeof(name), "%s and %s [%s]", vs->files[0], fs->files[0], defines);
+	GLuint program = link_stages(vert_shader, frag_shader, retrievable, name);
+	if (!program) {
+		shaders.failures++;
+		return 0;
+	}
+	finish_program(program);
+	return program;
+}
+
+GLuint
+shader_compile_text(const char* name, const char* vs_text, const char* fs_text) {
+	GLuint vert_shader = compile_stage(GL_VERTEX_SHADER, vs_text, name, NULL);
+	GLuint frag_shader = vert_shader ? compile_stage(GL_FRAGMENT_SHADER, fs_text, name, NULL) : 0;
+	GLuint program = link_stages(vert_shader, frag_shader, 0, name);
+	if (program) {
+		finish_program(program);
+	}
+	return program;
+}
+
+static void
+binary_path(char* path, isize size, const char* dir, u64 source_hash) {
+	snprintf(path, size, "%s/%016llx.bin", dir, (unsigned long long)source_hash);
+}
+
+/* 0 without a binary, or when the driver rejects it (another GPU or driver version) */
+static GLuint
+load_binary(u64 source_hash) {
+	char path[SHADER_PATH_MAX];
+	binary_path(path, sizeof(path), SHADER_CACHE_DIR, source_hash);
+	FILE* file = fopen(path, "rb");
+	if (!file) {
+		return 0;
+	}
+	struct binary_header header;
+	void* data = NULL;
+	b32 read_ok = fread(&header, sizeof(header), 1, file) == 1 && header.magic == BINARY_MAGIC &&
+	              (data = malloc(header.size ? header.size : 1)) && fread(data, 1, header.size, file) == header.size;
+	fclose(file);
+	GLuint program = 0;
+	if (read_ok) {
+		GPU_MEM_OWNER("shaders");
+		program = glCreateProgram();
+		glProgramBinary(program, header.format, data, (GLsizei)header.size);
+		int params = -1;
+		glGetProgramiv(program, GL_LINK_STATUS, &params);
+		if (GL_TRUE != params) {
+			glDeleteProgram(program);
+			program = 0;
+		}
+	}
+	free(data);
+	if (!program) {
+		gl_log_err("WARNING: shader: stale program binary %s, compiling instead\n", path);
+		shaders.stale_binaries++;
+		return 0;
+	}
+	finish_program(program);
+	shaders.binary_loads++;
+	return program;
+}
+
+static b32
+save_binary(GLuint program, const char* dir, u64 source_hash) {
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0) {
+		return 0;
+	}
+	struct binary_header header = {.magic = BINARY_MAGIC, .size = (u32)size};
+	void* data = malloc(size);
+	GLenum format = 0;
+	glGetProgramBinary(program, size, NULL, &format, data);
+	header.format = format;
+	char path[SHADER_PATH_MAX];
+	binary_path(path, sizeof(path), dir, source_hash);
+	FILE* file = fopen(path, "wb");
+	b32 ok = file && fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(data, 1, size, file) == (size_t)size;
+	if (file && fclose(file) != 0) {
+		ok = 0;
+	}
+	free(data);
+	if (!ok) {
+		gl_log_err("ERROR: shader: could not write %s\n", path);
+	}
+	return ok;
+}
+
+u64
+shader_sources_hash(const struct shader_source* vs, const struct shader_source* fs) {
+	return shader_hash(&fs->hash, sizeof(fs->hash), vs->hash);
+}
+
+/* compiles the variant when its sources changed since the last time; 0 when they did not or it failed */
+static b32
+build(struct variant* variant) {
+	struct shader_source vs, fs;
+	if (!shader_preprocess(&vs, variant->vs_path, variant->defines)) {
+		return 0;
+	}
+	if (!shader_preprocess(&fs, variant->fs_path, variant->defines)) {
+		shader_source_free(&vs);
+		return 0;
+	}
+	u64 source_hash = shader_sources_hash(&vs, &fs);
+	b32 built = 0;
+	if (!variant->program || source_hash != variant->source_hash) {
+		GLuint program = load_binary(source_hash);
+		if (!program) {
+			program = compile_program(&vs, &fs, variant->defines, 0);
+		}
+		if (program) {
+			if (variant->program) {
+				glDeleteProgram(variant->program);
+			}
+			variant->program = program;
+			variant->source_hash = source_hash;
+			for (int i = 0; i < SHADER_UNIFORMS; i++) {
+				variant->uniforms[i] = glGetUniformLocation(program, uniform_names[i]);
+			}
+			built = 1;
+		}
+	}
+	shader_source_free(&vs);
+	shader_source_free(&fs);
+	return built;
+}
+
+i32
+shader_variant(const char* vs_path, const char* fs_path, const char* defines) {
+	defines = defines ? defines : "";
+	u64 key = shader_hash(vs_path, (isize)strlen(vs_path) + 1, SHADER_HASH_SEED);
+	key = shader_hash(fs_path, (isize)strlen(fs_path) + 1, key);
+	key = shader_hash(defines, (isize)strlen(defines), key);
+	for (i32 i = 0; i < shaders.variants_len; i++) {
+		if (shaders.variants[i].key == key) {
+			return i;
+		}
+	}
+	if (shaders.variants_len == SHADER_MAX_VARIANTS || strlen(vs_path) >= SHADER_PATH_MAX ||
+	    strlen(fs_path) >= SHADER_PATH_MAX || strlen(defines) >= SHADER_DEFINES_MAX) {
+		gl_log_err("ERROR: shader: no room for %s %s [%s]\n", vs_path, fs_path, defines);
+		return -1;
+	}
+	i32 index = shaders.variants_len++;
+	struct variant* variant = &shaders.variants[index];
+	*variant = (struct variant){.key = key};
+	strcpy(variant->vs_path, vs_path);
+	strcpy(variant->fs_path, fs_path);
+	strcpy(variant->defines, defines);
+	for (int i = 0; i < SHADER_UNIFORMS; i++) {
+		variant->uniforms[i] = -1;
+	}
+	build(variant);
+	return index;
+}
+
+b32
+shader_precompile(const char* vs_path, const char* fs_path, const char* defines, const char* dir, u64* source_hash) {
+	struct shader_source vs, fs;
+	if (!shader_preprocess(&vs, vs_path, defines)) {
+		return 0;
+	}
+	if (!shader_preprocess(&fs, fs_path, defines)) {
+		shader_source_free(&vs);
+		return 0;
+	}
+	*source_hash = shader_sources_hash(&vs, &fs);
+	GLuint program = compile_program(&vs, &fs, defines ? defines : "", 1);
+	shader_source_free(&vs);
+	shader_source_free(&fs);
+	if (!program) {
+		return 0;
+	}
+	if (dir) {
+		/* a driver without binary formats still validates, it only has nothing to save */
+		char path[SHADER_PATH_MAX];
+		binary_path(path, sizeof(path), dir, *source_hash);
+		remove(path);
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats > 0 && !save_binary(program, dir, *source_hash)) {
+			glDeleteProgram(program);
+			return 0;
+		}
+	}
+	glDeleteProgram(program);
+	return 1;
+}
+
+GLuint
+shader_program(i32 variant) {
+	return variant >= 0 && variant < shaders.variants_len ? shaders.variants[variant].program : 0;
+}
+
+GLint
+shader_uniform(i32 variant, enum shader_uniform uniform) {
+	return variant >= 0 && variant < shaders.variants_len ? shaders.variants[variant].uniforms[uniform] : -1;
+}
+
+isize
+shader_reload(void) {
+	isize rebuilt = 0;
+	for (i32 i = 0; i < shaders.variants_len; i++) {
+		rebuilt += build(&shaders.variants[i]);
+	}
+	shaders.reloads++;
+	gl_log("shaders: reload recompiled %li of %i variants\n", (long)rebuilt, shaders.variants_len);
+	return rebuilt;
+}
+
+void
+shader_shutdown(void) {
+	for (i32 i = 0; i < shaders.variants_len; i++) {
+		if (shaders.variants[i].program) {
+			glDeleteProgram(shaders.variants[i].program);
+		}
+	}
+	shaders.variants_len = 0;
+}
+
+void
+shader_log(void) {
+	gl_log("shaders: %i variants requested, %li compiles, %li failed, %li reloads, %li loaded from %s/ (%li stale)\n",
+	       shaders.variants_len, (long)shaders.compiles, (long)shaders.failures, (long)shaders.reloads,
+	       (long)shaders.binary_loads, SHADER_CACHE_DIR, (long)shaders.stale_binaries);
+	for (i32 i = 0; i < shaders.variants_len; i++) {
+		const struct variant* variant = &shaders.variants[i];
+		gl_log("  %s %s [%s] %016llx%s\n", variant->vs_path, variant->fs_path, variant->defines,
+		       (unsigned long long)variant->source_hash, variant->program ? "" : " (did not compile)");
+	}
+}
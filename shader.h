@@ -0,0 +1,74 @@
+#ifndef SHADER_H
+#define SHADER_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Shader sources, permutations and the program cache.
+ * shader_preprocess() expands #include "file" (relative to the including file; a file is included
+ * at most once per source, as with #pragma once) and injects a #define for every NAME or NAME=VALUE
+ * of a define set right after #version. #line directives keep compiler errors pointing at the
+ * original lines; their source string numbers index the files listed with the error.
+ *
+ * A variant is a vertex shader, a fragment shader and a define set. shader_variant() finds it by a
+ * hash of the three and compiles it the first time it is asked for, so only the permutations that
+ * are actually drawn with are ever compiled. Each variant keeps the hash of its preprocessed sources:
+ * shader_reload() preprocesses every variant again and recompiles only those whose hash changed.
+ *
+ * Before compiling, a variant looks for a program binary named after that hash in SHADER_CACHE_DIR.
+ * make shaders (tools/shaderc.c) validates every variant listed in shaders.txt offline and fills the
+ * directory, so a warm start only preprocesses. A binary the driver rejects is compiled instead. */
+
+#define SHADER_MAX_VARIANTS 512
+#define SHADER_MAX_FILES 16 /* per preprocessed source, the top file and everything it includes */
+#define SHADER_MAX_INCLUDE_DEPTH 8
+#define SHADER_PATH_MAX 256
+#define SHADER_DEFINES_MAX 256
+#define SHADER_CACHE_DIR "shader_cache"
+
+/* uniforms every variant looks up after linking, -1 where a variant does not use them */
+enum shader_uniform {
+	SHADER_UNIFORM_COLOR, /* "inputColor" */
+	SHADER_UNIFORMS,
+};
+
+struct shader_source {
+	char* text; /* NUL terminated */
+	isize len;
+	u64 hash;
+	char files[SHADER_MAX_FILES][SHADER_PATH_MAX]; /* by #line source string number */
+	isize files_len;
+};
+
+/* defines may be NULL, names and NAME=VALUE pairs are separated by spaces or commas; 0 when a file
+ * cannot be read, the includes nest too deep or pull in too many files */
+b32 shader_preprocess(struct shader_source* source, const char* path, const char* defines);
+void shader_source_free(struct shader_source* source);
+/* FNV-1a, chained through hash; start with SHADER_HASH_SEED */
+#define SHADER_HASH_SEED 0xcbf29ce484222325ull
+u64 shader_hash(const void* data, isize len, u64 hash);
+/* of a variant, names its program binary */
+u64 shader_sources_hash(const struct shader_source* vs, const struct shader_source* fs);
+
+/* the variant index, or -1 when the cache is full. A variant that does not compile stays in the
+ * cache with program 0, so it is not retried every frame; shader_reload() retries it */
+i32 shader_variant(const char* vs_path, const char* fs_path, const char* defines);
+GLuint shader_program(i32 variant);
+GLint shader_uniform(i32 variant, enum shader_uniform uniform);
+/* returns the number of variants recompiled; a variant that no longer compiles keeps its program */
+isize shader_reload(void);
+
+/* a program from sources built into a module (overlay, virtual texture): no preprocessing, no cache
+ * and owned by the caller. 0 when it does not compile or link, the log names it by name */
+GLuint shader_compile_text(const char* name, const char* vs_text, const char* fs_text);
+
+/* offline (tools/shaderc.c): compiles a variant outside the cache and, with dir, writes its program
+ * binary there; 0 when it does not preprocess, compile or link */
+b32 shader_precompile(const char* vs_path, const char* fs_path, const char* defines, const char* dir,
+                      u64* source_hash);
+
+void shader_shutdown(void);
+void shader_log(void);
+
+#endif
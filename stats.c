@@ -0,0 +1,401 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame_pacing.h"
+#include "gl_loader.h"
+#include "gl_trace.h"
+#include "gpu_memory.h"
+#include "gpu_profiler.h"
+#include "overlay.h"
+#include "stats.h"
+
+/* what a call does to the counters */
+enum rule_kind {
+	RULE_NONE,
+	RULE_COUNT,             /* counter += 1 */
+	RULE_DRAW,              /* args[0] vertices times args[1] instances, either may be absent */
+	RULE_BUFFER_UPLOAD,     /* args[0] bytes from client memory args[1] */
+	RULE_MAP,               /* args[0] bytes when access args[1] has GL_MAP_WRITE_BIT */
+	RULE_TEXTURE_UPLOAD,    /* width, height, format, type in args[0..3], pixels in args[4] */
+	RULE_COMPRESSED_UPLOAD, /* args[0] bytes, data in args[1] */
+	RULE_READBACK,          /* width, height, format, type in args[0..3] */
+};
+
+#define NO_ARG 0xff
+
+struct stats_rule {
+	const char* name;
+	u8 prefix; /* name matches every entry point starting with it */
+	u8 kind;
+	u8 counter; /* enum stats_counter */
+	u8 args[5];
+};
+
+/* first match wins, so exact names go before the prefixes that would also match them */
+static const struct stats_rule stats_rules[] = {
+    {"glDrawBuffers", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glDrawArraysInstanced", 0, RULE_DRAW, STATS_DRAWS, {2, 3}},
+    {"glDrawArrays", 0, RULE_DRAW, STATS_DRAWS, {2, NO_ARG}},
+    {"glDrawElementsInstanced", 1, RULE_DRAW, STATS_DRAWS, {1, 4}},
+    {"glDrawElements", 1, RULE_DRAW, STATS_DRAWS, {1, NO_ARG}},
+    {"glDrawRangeElements", 1, RULE_DRAW, STATS_DRAWS, {3, NO_ARG}},
+    {"glDraw", 1, RULE_DRAW, STATS_DRAWS, {NO_ARG, NO_ARG}},
+    {"glMultiDraw", 1, RULE_DRAW, STATS_DRAWS, {NO_ARG, NO_ARG}},
+    {"glDispatchCompute", 1, RULE_DRAW, STATS_DRAWS, {NO_ARG, NO_ARG}},
+
+    {"glUseProgram", 0, RULE_COUNT, STATS_PROGRAM_BINDS, {0}},
+    {"glBindTexture", 1, RULE_COUNT, STATS_TEXTURE_BINDS, {0}},
+    {"glBindImageTexture", 1, RULE_COUNT, STATS_TEXTURE_BINDS, {0}},
+    {"glBindBuffer", 1, RULE_COUNT, STATS_BUFFER_BINDS, {0}},
+    {"glBindVertexArray", 0, RULE_COUNT, STATS_VERTEX_ARRAY_BINDS, {0}},
+    {"glBindFramebuffer", 0, RULE_COUNT, STATS_FRAMEBUFFER_BINDS, {0}},
+    {"glUniform", 1, RULE_COUNT, STATS_UNIFORM_UPDATES, {0}},
+    {"glProgramUniform", 1, RULE_COUNT, STATS_UNIFORM_UPDATES, {0}},
+
+    {"glBufferData", 0, RULE_BUFFER_UPLOAD, STATS_BUFFER_UPLOAD_BYTES, {1, 2}},
+    {"glBufferSubData", 0, RULE_BUFFER_UPLOAD, STATS_BUFFER_UPLOAD_BYTES, {2, 3}},
+    {"glMapBufferRange", 0, RULE_MAP, STATS_BUFFER_UPLOAD_BYTES, {2, 3}},
+    {"glTexImage2D", 0, RULE_TEXTURE_UPLOAD, STATS_TEXTURE_UPLOAD_BYTES, {3, 4, 6, 7, 8}},
+    {"glTexSubImage2D", 0, RULE_TEXTURE_UPLOAD, STATS_TEXTURE_UPLOAD_BYTES, {4, 5, 6, 7, 8}},
+    {"glCompressedTexImage2D", 0, RULE_COMPRESSED_UPLOAD, STATS_TEXTURE_UPLOAD_BYTES, {6, 7}},
+    {"glCompressedTexSubImage2D", 0, RULE_COMPRESSED_UPLOAD, STATS_TEXTURE_UPLOAD_BYTES, {7, 8}},
+    {"glReadPixels", 0, RULE_READBACK, STATS_READBACK_BYTES, {2, 3, 4, 5}},
+
+    /* fixed-function and binding state that is not counted on its own */
+    {"glEnable", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glDisable", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glDepth", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glBlend", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glStencil", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glColorMask", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glCullFace", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glFrontFace", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glPolygon", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glViewport", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glScissor", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glClearColor", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glActiveTexture", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glPixelStorei", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glTexParameter", 1, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glVertexAttribPointer", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glEnableVertexAttribArray", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glDisableVertexAttribArray", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+    {"glMemoryBarrier", 0, RULE_COUNT, STATS_STATE_CHANGES, {0}},
+};
+
+static const char* counter_names[STATS_COUNTERS] = {
+    [STATS_CALLS] = "calls",
+    [STATS_DRAWS] = "draws",
+    [STATS_VERTICES] = "vertices",
+    [STATS_STATE_CHANGES] = "state_changes",
+    [STATS_PROGRAM_BINDS] = "program_binds",
+    [STATS_TEXTURE_BINDS] = "texture_binds",
+    [STATS_BUFFER_BINDS] = "buffer_binds",
+    [STATS_VERTEX_ARRAY_BINDS] = "vertex_array_binds",
+    [STATS_FRAMEBUFFER_BINDS] = "framebuffer_binds",
+    [STATS_UNIFORM_UPDATES] = "uniform_updates",
+    [STATS_BUFFER_UPLOAD_BYTES] = "buffer_upload_bytes",
+    [STATS_TEXTURE_UPLOAD_BYTES] = "texture_upload_bytes",
+    [STATS_READBACK_BYTES] = "readback_bytes",
+    [STATS_OBJECTS_CREATED] = "objects_created",
+    [STATS_OBJECTS_DELETED] = "objects_deleted",
+};
+
+static struct {
+	b32 ok;
+	const struct stats_rule** rules;                 /* per entry point, NULL when the call only counts as a call */
+	const struct gpu_mem_object_call** object_calls; /* per entry point */
+	u64 unpack_buffer;
+
+	struct stats_frame current;
+	struct stats_frame history[STATS_HISTORY];
+	isize frames; /* completed */
+	i64 totals[STATS_COUNTERS];
+	u64 frame_start_ns;
+	double total_frame_ms;
+} stats;
+
+static const struct stats_rule*
+find_rule(const char* name) {
+	for (isize i = 0; i < ARRAY_SIZE(stats_rules); i++) {
+		const struct stats_rule* rule = &stats_rules[i];
+		size_t len = strlen(rule->name);
+		if (rule->prefix ? strncmp(name, rule->name, len) == 0 : strcmp(name, rule->name) == 0) {
+			return rule;
+		}
+	}
+	return NULL;
+}
+
+/* gpu_memory.c follows the same calls to track the objects themselves */
+static void
+count_objects(const struct gpu_mem_object_call* call, const u64* args, u64 ret) {
+	i64* counters = stats.current.counters;
+	switch (call->op) {
+		case GPU_MEM_GEN:
+			counters[STATS_OBJECTS_CREATED] += (i32)args[0];
+			break;
+		case GPU_MEM_DELETE: {
+			const GLuint* names = (const GLuint*)(uintptr_t)args[1];
+			for (i32 i = 0; names && i < (i32)args[0]; i++) {
+				counters[STATS_OBJECTS_DELETED] += names[i] != 0;
+			}
+			break;
+		}
+		case GPU_MEM_CREATE:
+			counters[STATS_OBJECTS_CREATED] += ret != 0;
+			break;
+		case GPU_MEM_DELETE_ONE:
+			counters[STATS_OBJECTS_DELETED] += args[0] != 0;
+			break;
+	}
+}
+
+static void
+stats_after(int fn, const u64* args, u64 ret) {
+	i64* counters = stats.current.counters;
+	counters[STATS_CALLS]++;
+	if (stats.object_calls[fn]) {
+		count_objects(stats.object_calls[fn], args, ret);
+		return;
+	}
+	const struct stats_rule* rule = stats.rules[fn];
+	if (!rule) {
+		return;
+	}
+	const u8* a = rule->args;
+	switch (rule->kind) {
+		case RULE_COUNT:
+			counters[rule->counter]++;
+			if (rule->counter == STATS_BUFFER_BINDS && args[0] == GL_PIXEL_UNPACK_BUFFER) {
+				stats.unpack_buffer = args[1];
+			}
+			break;
+		case RULE_DRAW: {
+			counters[STATS_DRAWS]++;
+			i64 vertices = a[0] != NO_ARG ? (i32)args[a[0]] : 0;
+			i64 instances = a[1] != NO_ARG ? (i32)args[a[1]] : 1;
+			counters[STATS_VERTICES] += vertices * instances;
+			break;
+		}
+		case RULE_BUFFER_UPLOAD:
+			if (args[a[1]]) {
+				counters[rule->counter] += (i64)args[a[0]];
+			}
+			break;
+		case RULE_MAP:
+			if (ret && (args[a[1]] & GL_MAP_WRITE_BIT)) {
+				counters[rule->counter] += (i64)args[a[0]];
+			}
+			break;
+		case RULE_TEXTURE_UPLOAD:
+			/* with an unpack buffer bound the pointer is an offset and 0 is valid */
+			if (args[a[4]] || stats.unpack_buffer) {
+				counters[rule->counter] +=
+				    (i64)gl_trace_image_bytes(args[a[0]], args[a[1]], args[a[2]], args[a[3]], 4, 0);
+			}
+			break;
+		case RULE_COMPRESSED_UPLOAD:
+			if (args[a[1]] || stats.unpack_buffer) {
+				counters[rule->counter] += (i32)args[a[0]];
+			}
+			break;
+		case RULE_READBACK:
+			counters[rule->counter] += (i64)gl_trace_image_bytes(args[a[0]], args[a[1]], args[a[2]], args[a[3]], 4, 0);
+			break;
+	}
+}
+
+void
+stats_init(void) {
+	memset(&stats, 0, sizeof(stats));
+	stats.rules = calloc(gl_loader_count, sizeof(*stats.rules));
+	stats.object_calls = calloc(gl_loader_count, sizeof(*stats.object_calls));
+	for (int fn = 0; fn < gl_loader_count; fn++) {
+		stats.rules[fn] = find_rule(gl_loader_signatures[fn].name);
+		stats.object_calls[fn] = gpu_mem_find_object_call(gl_loader_signatures[fn].name);
+	}
+	if (!gl_loader_add_hooks(NULL, stats_after)) {
+		gl_log_err("ERROR: stats: no free loader hook, GL calls are not counted\n");
+		free(stats.rules);
+		free(stats.object_calls);
+		return;
+	}
+	stats.frame_start_ns = clock_ns();
+	stats.ok = 1;
+}
+
+void
+stats_shutdown(void) {
+	if (!stats.ok) {
+		return;
+	}
+	gl_loader_remove_hooks(NULL, stats_after);
+	free(stats.rules);
+	free(stats.object_calls);
+	stats.ok = 0;
+}
+
+void
+stats_end_frame(void) {
+	if (!stats.ok) {
+		return;
+	}
+	u64 now = clock_ns();
+	stats.current.frame_ms = (double)(now - stats.frame_start_ns) / 1e6;
+	stats.frame_start_ns = now;
+	for (int i = 0; i < STATS_COUNTERS; i++) {
+		stats.totals[i] += stats.current.counters[i];
+	}
+	stats.total_frame_ms += stats.current.frame_ms;
+	stats.history[stats.frames % STATS_HISTORY] = stats.current;
+	stats.frames++;
+	memset(&stats.current, 0, sizeof(stats.current));
+}
+
+const char*
+stats_counter_name(enum stats_counter counter) {
+	return counter_names[counter];
+}
+
+const struct stats_frame*
+stats_last_frame(void) {
+	static const struct stats_frame empty;
+	return stats.frames ? &stats.history[(stats.frames - 1) % STATS_HISTORY] : &empty;
+}
+
+void
+stats_summarize(struct stats_summary* summary) {
+	memset(summary, 0, sizeof(*summary));
+	summary->frames = stats.frames < STATS_HISTORY ? stats.frames : STATS_HISTORY;
+	for (isize f = 0; f < summary->frames; f++) {
+		const struct stats_frame* frame = &stats.history[f];
+		for (int i = 0; i < STATS_COUNTERS; i++) {
+			summary->avg[i] += (double)frame->counters[i];
+			summary->max[i] = frame->counters[i] > summary->max[i] ? frame->counters[i] : summary->max[i];
+		}
+		summary->avg_frame_ms += frame->frame_ms;
+		summary->max_frame_ms = frame->frame_ms > summary->max_frame_ms ? frame->frame_ms : summary->max_frame_ms;
+	}
+	if (summary->frames) {
+		for (int i = 0; i < STATS_COUNTERS; i++) {
+			summary->avg[i] /= (double)summary->frames;
+		}
+		summary->avg_frame_ms /= (double)summary->frames;
+	}
+}
+
+b32
+stats_dump_json(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (!file) {
+		gl_log_err("ERROR: could not open stats %s for writing\n", path);
+		return 0;
+	}
+	struct stats_summary summary;
+	stats_summarize(&summary);
+	fprintf(file, "{\n  \"frames\": %ld,\n  \"window\": %ld,\n", (long)stats.frames, (long)summary.frames);
+	fprintf(file, "  \"frame_ms\": {\"avg\": %.6f, \"max\": %.6f, \"total\": %.6f},\n", summary.avg_frame_ms,
+	        summary.max_frame_ms, stats.total_frame_ms);
+	fprintf(file, "  \"counters\": {");
+	for (int i = 0; i < STATS_COUNTERS; i++) {
+		fprintf(file, "%s\n    \"%s\": {\"avg\": %.3f, \"max\": %ld, \"total\": %ld}", i ? "," : "", counter_names[i],
+		        summary.avg[i], (long)summary.max[i], (long)stats.totals[i]);
+	}
+	fprintf(file, "\n  },\n  \"gpu_memory\": {");
+	for (int k = 0; k < GPU_MEM_KINDS; k++) {
+		const struct gpu_mem_category* category = gpu_mem_category(k);
+		fprintf(file, "%s\n    \"%s\": {\"count\": %ld, \"peak_count\": %ld, \"bytes\": %ld, \"peak_bytes\": %ld}",
+		        k ? "," : "", gpu_mem_kind_name(k), (long)category->count, (long)category->peak_count,
+		        (long)category->bytes, (long)category->peak_bytes);
+	}
+	fprintf(file, "\n  ");
+	/* the window, oldest first */
+	fprintf(file, "},\n  \"history\": [");
+	isize first = stats.frames - summary.frames;
+	for (isize f = first; f < stats.frames; f++) {
+		const struct stats_frame* frame = &stats.history[f % STATS_HISTORY];
+		fprintf(file, "%s\n    {\"frame\": %ld, \"frame_ms\": %.4f", f > first ? "," : "", (long)f, frame->frame_ms);
+		for (int i = 0; i < STATS_COUNTERS; i++) {
+			fprintf(file, ", \"%s\": %ld", counter_names[i], (long)frame->counters[i]);
+		}
+		fprintf(file, "}");
+	}
+	fprintf(file, "\n  ]\n}\n");
+	fclose(file);
+	return 1;
+}
+
+static void
+format_count(char* out, size_t size, enum stats_counter counter, double value) {
+	b32 bytes = counter == STATS_BUFFER_UPLOAD_BYTES || counter == STATS_TEXTURE_UPLOAD_BYTES ||
+	            counter == STATS_READBACK_BYTES;
+	if (bytes && value >= 1024.0 * 1024.0) {
+		snprintf(out, size, "%.1fM", value / (1024.0 * 1024.0));
+	} else if (bytes && value >= 1024.0) {
+		snprintf(out, size, "%.1fK", value / 1024.0);
+	} else if (value != (double)(i64)value) {
+		snprintf(out, size, "%.1f", value);
+	} else {
+		snprintf(out, size, "%.0f", value);
+	}
+}
+
+void
+stats_draw_overlay(float x, float y) {
+	enum { columns = 48 };
+	const u32 background = 0x000000b0, text = 0xe0e0e0ff, heading = 0xffd060ff;
+	struct stats_summary summary;
+	stats_summarize(&summary);
+	const struct stats_frame* last = stats_last_frame();
+	const struct gpu_zone_stats* zones;
+	isize zones_len = gpu_profiler_zones(&zones);
+	struct frame_pacing_summary pacing;
+	frame_pacing_summarize(&pacing);
+	isize lines = 4 + STATS_COUNTERS + 2 + zones_len + 1;
+	for (int k = 0; k < GPU_MEM_KINDS; k++) {
+		lines += gpu_mem_category(k)->count != 0;
+	}
+	float line = OVERLAY_GLYPH_HEIGHT + 1;
+	overlay_rect(x, y, columns * OVERLAY_GLYPH_WIDTH + 8, lines * line + 8, background);
+	x += 4;
+	y += 4;
+
+	double fps = summary.avg_frame_ms > 0.0 ? 1000.0 / summary.avg_frame_ms : 0.0;
+	overlay_printf(x, y, heading, "%.1f fps  frame %.2f ms  avg %.2f  max %.2f", fps, last->frame_ms,
+	               summary.avg_frame_ms, summary.max_frame_ms);
+	y += line;
+	overlay_printf(x, y, text, "present %.2f ms  jitter %.2f  waited %.2f", pacing.mean_ms, pacing.stddev_ms,
+	               pacing.wait_ms);
+	y += 2 * line;
+	overlay_printf(x, y, heading, "%-20s %7s %7s %7s", "per frame", "last", "avg", "max");
+	y += line;
+	for (int i = 0; i < STATS_COUNTERS; i++) {
+		char values[3][16];
+		format_count(values[0], sizeof(values[0]), i, (double)last->counters[i]);
+		format_count(values[1], sizeof(values[1]), i, summary.avg[i]);
+		format_count(values[2], sizeof(values[2]), i, (double)summary.max[i]);
+		overlay_printf(x, y, text, "%-20s %7s %7s %7s", counter_names[i], values[0], values[1], values[2]);
+		y += line;
+	}
+	overlay_printf(x, y, heading, "gpu memory %.2f MB", gpu_mem_total_bytes() / (1024.0 * 1024.0));
+	y += line;
+	for (int k = 0; k < GPU_MEM_KINDS; k++) {
+		const struct gpu_mem_category* category = gpu_mem_category(k);
+		if (category->count) {
+			char bytes[16];
+			format_count(bytes, sizeof(bytes), STATS_BUFFER_UPLOAD_BYTES, (double)category->bytes);
+			overlay_printf(x, y, text, "%-20s %7ld %7s", gpu_mem_kind_name(k), (long)category->count, bytes);
+			y += line;
+		}
+	}
+	y += line;
+	overlay_text(x, y, heading, "gpu ms");
+	y += line;
+	for (isize i = 0; i < zones_len; i++) {
+		overlay_printf(x, y, text, "%-20s %7.3f %7.3f %7.3f", zones[i].name, zones[i].last_ms, zones[i].avg_ms,
+		               zones[i].max_ms);
+		y += line;
+	}
+}
@@ -0,0 +1,62 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include "common.h"
+
+/* Per-frame GL call and resource counters.
+ * From stats_init() on every GL call the application makes is counted as it returns. Entry points
+ * are classified once by name; upload sizes come from the call arguments (texture uploads assume the
+ * default unpack alignment). The last STATS_HISTORY frames are kept for the rolling averages and
+ * maxima the overlay and --stats-json report. */
+
+#define STATS_HISTORY 120
+
+enum stats_counter {
+	STATS_CALLS,
+	STATS_DRAWS,
+	STATS_VERTICES,
+	STATS_STATE_CHANGES,
+	STATS_PROGRAM_BINDS,
+	STATS_TEXTURE_BINDS,
+	STATS_BUFFER_BINDS,
+	STATS_VERTEX_ARRAY_BINDS,
+	STATS_FRAMEBUFFER_BINDS,
+	STATS_UNIFORM_UPDATES,
+	STATS_BUFFER_UPLOAD_BYTES,
+	STATS_TEXTURE_UPLOAD_BYTES,
+	STATS_READBACK_BYTES,
+	STATS_OBJECTS_CREATED,
+	STATS_OBJECTS_DELETED,
+	STATS_COUNTERS,
+};
+
+struct stats_frame {
+	i64 counters[STATS_COUNTERS];
+	double frame_ms; /* since the previous stats_end_frame() */
+};
+
+struct stats_summary {
+	isize frames; /* in the window, at most STATS_HISTORY */
+	double avg[STATS_COUNTERS];
+	i64 max[STATS_COUNTERS];
+	double avg_frame_ms;
+	double max_frame_ms;
+};
+
+void stats_init(void);
+void stats_shutdown(void);
+
+/* closes the current frame and starts counting the next */
+void stats_end_frame(void);
+
+const char* stats_counter_name(enum stats_counter counter);
+/* the last completed frame */
+const struct stats_frame* stats_last_frame(void);
+void stats_summarize(struct stats_summary* summary);
+
+b32 stats_dump_json(const char* path);
+/* queues a panel with the last frame, present timing, the rolling window, GPU memory and the GPU zones
+ * (overlay.h) */
+void stats_draw_overlay(float x, float y);
+
+#endif
@@ -1,11 +1,30 @@
 #version 410
 
 in vec3 color;
-uniform vec4 inputColor;
 out vec4 frag_color;
 
+#ifdef VERTEX_COLOR
+// the interpolated vertex color, scaled
+#ifndef COLOR_SCALE
+#define COLOR_SCALE 0.2
+#endif
+
 void main () {
-  // frag_color = vec4(color, 1.0);
-  frag_color = inputColor;
+  frag_color = vec4(color * COLOR_SCALE, 1.0);
 }
+#elif defined(TEXTURED)
+// the first --texture on texture unit 0, tinted by inputColor so highlights still show
+in vec2 uv;
+uniform sampler2D diffuse;
+uniform vec4 inputColor;
 
+void main () {
+  frag_color = mix(texture(diffuse, uv), inputColor, 0.25);
+}
+#else
+uniform vec4 inputColor;
+
+void main () {
+  frag_color = inputColor;
+}
+#endif
@@ -1,11 +1,20 @@
 #version 410
 
+#include "camera.glsl"
+
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec3 vertex_color;
 
 out vec3 color;
+#ifdef TEXTURED
+// the triangle spans [-0.5, 0.5] in x and y
+out vec2 uv;
+#endif
 
 void main () {
     color = vertex_color;
-    gl_Position = vec4(vertex_position, 1.0);
+#ifdef TEXTURED
+    uv = vertex_position.xy + 0.5;
+#endif
+    gl_Position = view_projection * vec4(vertex_position, 1.0);
 }
@@ -0,0 +1,149 @@
+/* Transient lifetime checks for framegraph.c that need no GL context: the entry points it and the
+ * render target pool call are replaced with stubs, so only the scheduling and pooling run.
+ * usage: framegraph_test, make test runs it before the golden images. Exit status: 0 pass, 1 fail. */
+#include <stdio.h>
+
+#include "common.h"
+#include "framegraph.h"
+
+static GLuint next_name = 1;
+
+static void GLAPIENTRY
+stub_gen(GLsizei n, GLuint* names) {
+	for (GLsizei i = 0; i < n; i++) {
+		names[i] = next_name++;
+	}
+}
+
+static void GLAPIENTRY
+stub_delete(GLsizei n, const GLuint* names) {
+	(void)n;
+	(void)names;
+}
+
+static void GLAPIENTRY
+stub_bind(GLenum target, GLuint name) {
+	(void)target;
+	(void)name;
+}
+
+static void GLAPIENTRY
+stub_tex_parameter(GLenum target, GLenum pname, GLint param) {
+	(void)target;
+	(void)pname;
+	(void)param;
+}
+
+static void GLAPIENTRY
+stub_tex_storage(GLenum target, GLsizei levels, GLenum format, GLsizei width, GLsizei height) {
+	(void)target;
+	(void)levels;
+	(void)format;
+	(void)width;
+	(void)height;
+}
+
+static void GLAPIENTRY
+stub_framebuffer_texture(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
+	(void)target;
+	(void)attachment;
+	(void)textarget;
+	(void)texture;
+	(void)level;
+}
+
+static void GLAPIENTRY
+stub_draw_buffers(GLsizei n, const GLenum* buffers) {
+	(void)n;
+	(void)buffers;
+}
+
+static GLenum GLAPIENTRY
+stub_check_framebuffer(GLenum target) {
+	(void)target;
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void GLAPIENTRY
+stub_viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	(void)x;
+	(void)y;
+	(void)width;
+	(void)height;
+}
+
+static void
+pass_fn(struct framegraph* fg, void* user) {
+	(void)fg;
+	(void)user;
+}
+
+static int failures;
+
+static void
+check(b32 ok, const char* what) {
+	printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+	failures += !ok;
+}
+
+int
+main(void) {
+	gll_glGenTextures = stub_gen;
+	gll_glGenFramebuffers = stub_gen;
+	gll_glDeleteTextures = stub_delete;
+	gll_glDeleteFramebuffers = stub_delete;
+	gll_glBindTexture = stub_bind;
+	gll_glBindFramebuffer = stub_bind;
+	gll_glTexParameteri = stub_tex_parameter;
+	gll_glTexStorage2D = stub_tex_storage;
+	gll_glFramebufferTexture2D = stub_framebuffer_texture;
+	gll_glDrawBuffers = stub_draw_buffers;
+	gll_glCheckFramebufferStatus = stub_check_framebuffer;
+	gll_glViewport = stub_viewport;
+	rt_pool_init(640, 480);
+
+	/* a renders first, b composites it; c renders second, d composites that: first lives #0-#1 and
+	 * second #2-#3, so both can use one texture */
+	static struct framegraph fg;
+	fg_reset(&fg);
+	struct rt_desc desc = {.format = GL_RGBA8, .scale = 0.5f};
+	i32 backbuffer = fg_import_backbuffer(&fg, "backbuffer");
+	i32 first = fg_create_texture(&fg, "first", desc);
+	i32 second = fg_create_texture(&fg, "second", desc);
+	i32 a = fg_add_pass(&fg, "a", pass_fn, NULL, 0);
+	fg_write(&fg, a, first, FG_ATTACHMENT);
+	i32 b = fg_add_pass(&fg, "b", pass_fn, NULL, 0);
+	fg_read(&fg, b, first, FG_SAMPLED);
+	fg_write(&fg, b, backbuffer, FG_ATTACHMENT);
+	i32 c = fg_add_pass(&fg, "c", pass_fn, NULL, 0);
+	fg_write(&fg, c, second, FG_ATTACHMENT);
+	i32 d = fg_add_pass(&fg, "d", pass_fn, NULL, 0);
+	fg_read(&fg, d, second, FG_SAMPLED);
+	fg_write(&fg, d, backbuffer, FG_ATTACHMENT);
+	check(fg_compile(&fg) && fg.order_len == 4, "the four passes compile in declaration order");
+	fg_execute(&fg, 640, 480);
+	check(fg.resources[first].last_use < fg.resources[second].first_use, "the transient lifetimes do not overlap");
+	check(fg.resources[first].target >= 0 && fg.resources[first].target == fg.resources[second].target,
+	      "transients with disjoint lifetimes share one render target");
+
+	/* both written by one pass: alive together, so they need two */
+	fg_reset(&fg);
+	backbuffer = fg_import_backbuffer(&fg, "backbuffer");
+	first = fg_create_texture(&fg, "first", desc);
+	second = fg_create_texture(&fg, "second", desc);
+	a = fg_add_pass(&fg, "a", pass_fn, NULL, 0);
+	fg_write(&fg, a, first, FG_ATTACHMENT);
+	fg_write(&fg, a, second, FG_ATTACHMENT);
+	b = fg_add_pass(&fg, "b", pass_fn, NULL, 0);
+	fg_read(&fg, b, first, FG_SAMPLED);
+	fg_read(&fg, b, second, FG_SAMPLED);
+	fg_write(&fg, b, backbuffer, FG_ATTACHMENT);
+	fg_compile(&fg);
+	fg_execute(&fg, 640, 480);
+	check(fg.resources[first].target >= 0 && fg.resources[second].target >= 0 &&
+	          fg.resources[first].target != fg.resources[second].target,
+	      "transients alive at once get separate render targets");
+
+	rt_pool_shutdown();
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,67 @@
+#!/bin/sh
+# Golden-image regression tests: renders every scene in tests/scenes.txt headlessly on Mesa's
+# llvmpipe, compares the screenshot with tests/golden/<name>.png (tools/img_compare.c) and reports
+# the wall time per scene next to the blessed one.
+# usage: sh tests/golden.sh [--bless]   (run from the repository root, after make run img_compare vtpack)
+# --bless replaces the references and timings with this run's; a scene without a reference fails.
+# Without a display the scenes run under xvfb-run when it is installed.
+
+bless=0
+[ "$1" = "--bless" ] && bless=1
+out=tests/out
+golden=tests/golden
+mkdir -p "$out" "$golden"
+
+# software rendering keeps the images identical across machines
+export LIBGL_ALWAYS_SOFTWARE=1
+export GALLIUM_DRIVER=llvmpipe
+wrap=
+if [ -z "$DISPLAY" ] && [ -z "$WAYLAND_DISPLAY" ] && command -v xvfb-run >/dev/null; then
+	wrap="xvfb-run -a -s -screen\ 0\ 1024x768x24"
+fi
+
+./vtpack --page-size 128 tests/data/pattern.png "$out/pattern.vt" >/dev/null || exit 1
+
+now() {
+	date +%s.%N
+}
+
+rm -f "$out/failed"
+: >"$out/timings.txt"
+grep -v '^#' tests/scenes.txt | while read -r name frames args; do
+	[ -z "$name" ] && continue
+	rm -f "$out/$name.png"
+	start=$(now)
+	eval $wrap ./run --headless --frames "$frames" --screenshot "$out/$name.png" $args >"$out/$name.log" 2>&1
+	status=$?
+	seconds=$(echo "$start $(now)" | awk '{ printf "%.3f", $2 - $1 }')
+	echo "$name $seconds" >>"$out/timings.txt"
+	baseline=$(awk -v name="$name" '$1 == name { print $2 }' "$golden/timings.txt" 2>/dev/null)
+	timing="${seconds}s"
+	if [ -n "$baseline" ]; then
+		timing="$timing (blessed ${baseline}s$(echo "$seconds $baseline" | awk '$1 > 1.5 * $2 { printf ", SLOWER" }'))"
+	fi
+
+	if [ $status -ne 0 ] || [ ! -f "$out/$name.png" ]; then
+		echo "FAIL  $name: ./run exited with $status, see $out/$name.log"
+		echo "$name" >>"$out/failed"
+	elif [ $bless -eq 1 ]; then
+		cp "$out/$name.png" "$golden/$name.png"
+		echo "bless $name $timing"
+	elif [ ! -f "$golden/$name.png" ]; then
+		echo "FAIL  $name: no reference $golden/$name.png, run make bless and commit it"
+		echo "$name" >>"$out/failed"
+	elif result=$(./img_compare --diff "$out/$name.diff.png" "$golden/$name.png" "$out/$name.png"); then
+		echo "ok    $name $timing: $result"
+	else
+		echo "FAIL  $name $timing: $result, diff in $out/$name.diff.png"
+		echo "$name" >>"$out/failed"
+	fi
+done
+
+[ $bless -eq 1 ] && cp "$out/timings.txt" "$golden/timings.txt"
+if [ -f "$out/failed" ]; then
+	echo "$(wc -l <"$out/failed") scene(s) failed"
+	rm -f "$out/failed"
+	exit 1
+fi
@@ -0,0 +1,85 @@
+/* Allocator checks for gpu_heap.c that need no GL context: the buffer entry points it calls are
+ * replaced with stubs, so only the block bookkeeping runs.
+ * usage: gpu_heap_test, make test runs it before the golden images. Exit status: 0 pass, 1 fail. */
+#include <stdio.h>
+
+#include "common.h"
+#include "gpu_heap.h"
+
+static GLuint next_buffer = 1;
+
+static void GLAPIENTRY
+stub_gen_buffers(GLsizei n, GLuint* buffers) {
+	for (GLsizei i = 0; i < n; i++) {
+		buffers[i] = next_buffer++;
+	}
+}
+
+static void GLAPIENTRY
+stub_delete_buffers(GLsizei n, const GLuint* buffers) {
+	(void)n;
+	(void)buffers;
+}
+
+static void GLAPIENTRY
+stub_bind_buffer(GLenum target, GLuint buffer) {
+	(void)target;
+	(void)buffer;
+}
+
+static void GLAPIENTRY
+stub_buffer_data(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+	(void)target;
+	(void)size;
+	(void)data;
+	(void)usage;
+}
+
+static int failures;
+
+static void
+check(b32 ok, const char* what) {
+	printf("%s  %s\n", ok ? "ok  " : "FAIL", what);
+	failures += !ok;
+}
+
+int
+main(void) {
+	gll_glGenBuffers = stub_gen_buffers;
+	gll_glDeleteBuffers = stub_delete_buffers;
+	gll_glBindBuffer = stub_bind_buffer;
+	gll_glBufferData = stub_buffer_data;
+
+	/* larger than a buffer and between two size classes, so a search rounded up to the next class
+	 * would miss the one block of the buffer made for it */
+	struct gpu_heap heap;
+	gpu_heap_init(&heap, "test", 1024);
+	static const isize sizes[] = {1040, 5000, 70001};
+	i32 allocations[ARRAY_SIZE(sizes)];
+	b32 placed = 1;
+	for (isize i = 0; i < ARRAY_SIZE(sizes); i++) {
+		allocations[i] = gpu_heap_alloc(&heap, sizes[i], 24);
+		if (allocations[i] < 0) {
+			placed = 0;
+			continue;
+		}
+		struct gpu_heap_range range = gpu_heap_range(&heap, allocations[i]);
+		placed &= range.buffer_index == i + 1 && range.size == sizes[i] && range.offset % 24 == 0 &&
+		          range.offset + range.size <= heap.buffers[range.buffer_index].size;
+	}
+	check(placed, "allocations larger than buffer_size get a buffer of their own");
+	i32 small = gpu_heap_alloc(&heap, 100, 16);
+	check(small >= 0 && gpu_heap_range(&heap, small).buffer_index == 0, "small allocations still use the first buffer");
+
+	for (isize i = 0; i < ARRAY_SIZE(sizes); i++) {
+		if (allocations[i] >= 0) {
+			gpu_heap_free(&heap, allocations[i]);
+		}
+	}
+	if (small >= 0) {
+		gpu_heap_free(&heap, small);
+	}
+	check(heap.live == 0 && heap.used == 0, "freeing everything leaves the heap empty");
+	gpu_heap_shutdown(&heap);
+	return failures ? 1 : 0;
+}
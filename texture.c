@@ -0,0 +1,309 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu_trace.h"
+#include "gpu_memory.h"
+#include "image.h"
+#include "jobs.h"
+#include "ktx.h"
+#include "mip.h"
+#include "texture.h"
+
+#define TEXTURE_STAGING_BUFFERS 4
+#define TEXTURE_PLACEHOLDER_SIZE 8
+
+enum {
+	TEXTURE_FREE = 0,
+	TEXTURE_DECODING,
+	TEXTURE_DECODED,
+	TEXTURE_RESIDENT,
+	TEXTURE_FAILED,
+};
+
+struct texture {
+	char path[256];
+	atomic_int state;
+	GLuint handle;
+	u32 flags;
+	struct mip_chain chain; /* decoded RGBA levels, owned by the entry until uploaded */
+	struct ktx_texture ktx; /* or the mapped compressed levels of a .ktx2/.dds file */
+};
+
+struct texture_staging {
+	GLuint pbo;
+	isize size;
+	GLsync fence; /* set while the GPU may still be reading the buffer */
+};
+
+static struct {
+	struct texture textures[TEXTURE_MAX];
+	isize textures_len;
+	GLuint placeholder;
+	struct texture_staging staging[TEXTURE_STAGING_BUFFERS];
+	isize staging_next;
+	struct job_counter decode_jobs;
+
+	/* decoded entries waiting for upload, filled by workers and drained by the GL thread */
+	pthread_mutex_t mutex;
+	i32 decoded[TEXTURE_MAX];
+	isize decoded_head;
+	isize decoded_len;
+} textures = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+/* hands a decoded entry to the GL thread */
+static void
+texture_decoded(struct texture* texture, b32 ok) {
+	if (!ok) {
+		atomic_store(&texture->state, TEXTURE_FAILED);
+		return;
+	}
+	atomic_store(&texture->state, TEXTURE_DECODED);
+	pthread_mutex_lock(&textures.mutex);
+	textures.decoded[(textures.decoded_head + textures.decoded_len) % TEXTURE_MAX] = (i32)(texture - textures.textures);
+	textures.decoded_len++;
+	pthread_mutex_unlock(&textures.mutex);
+}
+
+static void
+texture_decode_job(void* data, isize index) {
+	(void)index;
+	TRACE_ZONE("texture decode");
+	struct texture* texture = data;
+	if (ktx_is_container(texture->path)) {
+		b32 opened = ktx_open(texture->path, &texture->ktx);
+		texture_decoded(texture, opened);
+		return;
+	}
+	int width, height;
+	u8* pixels = image_load(texture->path, &width, &height);
+	if (!pixels) {
+		atomic_store(&texture->state, TEXTURE_FAILED);
+		return;
+	}
+	struct mip_options options = {
+	    .filter = MIP_FILTER_KAISER,
+	    .srgb = (texture->flags & TEXTURE_SRGB) != 0,
+	    .alpha_cutoff = (texture->flags & TEXTURE_ALPHA_TEST) ? 0.5f : 0.0f,
+	};
+	b32 built = mip_build(pixels, width, height, &options, &texture->chain);
+	free(pixels);
+	texture_decoded(texture, built);
+}
+
+void
+texture_system_init(void) {
+	GPU_MEM_OWNER("textures");
+	u8 pixels[TEXTURE_PLACEHOLDER_SIZE * TEXTURE_PLACEHOLDER_SIZE * 4];
+	for (int y = 0; y < TEXTURE_PLACEHOLDER_SIZE; y++) {
+		for (int x = 0; x < TEXTURE_PLACEHOLDER_SIZE; x++) {
+			u8* p = &pixels[(y * TEXTURE_PLACEHOLDER_SIZE + x) * 4];
+			b32 odd = ((x / 2) ^ (y / 2)) & 1;
+			p[0] = odd ? 255 : 0;
+			p[1] = 0;
+			p[2] = odd ? 255 : 0;
+			p[3] = 255;
+		}
+	}
+	glGenTextures(1, &textures.placeholder);
+	glBindTexture(GL_TEXTURE_2D, textures.placeholder);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, TEXTURE_PLACEHOLDER_SIZE, TEXTURE_PLACEHOLDER_SIZE, 0, GL_RGBA,
+	             GL_UNSIGNED_BYTE, pixels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	for (isize i = 0; i < TEXTURE_STAGING_BUFFERS; i++) {
+		glGenBuffers(1, &textures.staging[i].pbo);
+	}
+}
+
+void
+texture_system_shutdown(void) {
+	jobs_wait(&textures.decode_jobs);
+	for (isize i = 0; i < textures.textures_len; i++) {
+		struct texture* texture = &textures.textures[i];
+		mip_free(&texture->chain);
+		ktx_close(&texture->ktx);
+		if (texture->handle) {
+			glDeleteTextures(1, &texture->handle);
+		}
+	}
+	for (isize i = 0; i < TEXTURE_STAGING_BUFFERS; i++) {
+		if (textures.staging[i].fence) {
+			glDeleteSync(textures.staging[i].fence);
+		}
+		glDeleteBuffers(1, &textures.staging[i].pbo);
+	}
+	glDeleteTextures(1, &textures.placeholder);
+	textures.textures_len = 0;
+	textures.decoded_head = 0;
+	textures.decoded_len = 0;
+	memset(textures.staging, 0, sizeof(textures.staging));
+}
+
+i32
+texture_load(const char* path, u32 flags) {
+	for (isize i = 0; i < textures.textures_len; i++) {
+		if (strcmp(textures.textures[i].path, path) == 0) {
+			return (i32)i;
+		}
+	}
+	if (textures.textures_len == TEXTURE_MAX || strlen(path) >= sizeof(textures.textures[0].path)) {
+		gl_log_err("ERROR: could not register texture %s\n", path);
+		return -1;
+	}
+	isize index = textures.textures_len++;
+	struct texture* texture = &textures.textures[index];
+	strcpy(texture->path, path);
+	texture->flags = flags;
+	atomic_store(&texture->state, TEXTURE_DECODING);
+	jobs_run(texture_decode_job, texture, 1, &textures.decode_jobs);
+	return (i32)index;
+}
+
+GLuint
+texture_get(i32 handle) {
+	if (handle < 0 || handle >= textures.textures_len ||
+	    atomic_load_explicit(&textures.textures[handle].state, memory_order_acquire) != TEXTURE_RESIDENT) {
+		return textures.placeholder;
+	}
+	return textures.textures[handle].handle;
+}
+
+b32
+texture_is_resident(i32 handle) {
+	return texture_get(handle) != textures.placeholder;
+}
+
+/* next staging buffer the GPU is done with, or NULL when all are still in use */
+static struct texture_staging*
+acquire_staging(void) {
+	for (isize n = 0; n < TEXTURE_STAGING_BUFFERS; n++) {
+		struct texture_staging* staging = &textures.staging[(textures.staging_next + n) % TEXTURE_STAGING_BUFFERS];
+		if (staging->fence) {
+			GLenum status = glClientWaitSync(staging->fence, 0, 0);
+			if (status == GL_TIMEOUT_EXPIRED) {
+				continue;
+			}
+			glDeleteSync(staging->fence);
+			staging->fence = 0;
+		}
+		textures.staging_next = (textures.staging_next + n + 1) % TEXTURE_STAGING_BUFFERS;
+		return staging;
+	}
+	return NULL;
+}
+
+/* RGBA chains go through a staging buffer */
+static void
+upload_chain(struct texture* texture, struct texture_staging* staging) {
+	struct mip_chain* chain = &texture->chain;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging->pbo);
+	/* orphan instead of waiting for the previous contents to be consumed */
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, chain->size, NULL, GL_STREAM_DRAW);
+	staging->size = chain->size;
+	void* dst =
+	    glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, chain->size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+	const u8* src = NULL; /* offsets into the pixel-unpack buffer */
+	if (dst) {
+		memcpy(dst, chain->data, chain->size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+	} else {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		src = chain->data;
+	}
+
+	/* the whole chain was filtered on the CPU, so no glGenerateMipmap here */
+	GLenum format = (texture->flags & TEXTURE_SRGB) ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+	glTexStorage2D(GL_TEXTURE_2D, chain->levels, format, chain->width[0], chain->height[0]);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int level = 0; level < chain->levels; level++) {
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, chain->width[level], chain->height[level], GL_RGBA,
+		                GL_UNSIGNED_BYTE, src + chain->offset[level]);
+	}
+	/* back to the default the other uploads (overlay, stats) assume */
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	staging->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/* compressed levels are passed straight from the file mapping, the driver's copy is the only one */
+static void
+upload_compressed(struct texture* texture) {
+	struct ktx_texture* ktx = &texture->ktx;
+	glTexStorage2D(GL_TEXTURE_2D, ktx->levels, ktx->format, ktx->width, ktx->height);
+	for (int level = 0; level < ktx->levels; level++) {
+		int w = ktx->width >> level > 0 ? ktx->width >> level : 1;
+		int h = ktx->height >> level > 0 ? ktx->height >> level : 1;
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, ktx->format, (GLsizei)ktx->level_size[level],
+		                          ktx->level_data[level]);
+	}
+}
+
+void
+texture_system_update(isize budget_bytes) {
+	GPU_MEM_OWNER("textures");
+	TRACE_ZONE("texture upload");
+	isize uploaded = 0;
+	for (;;) {
+		pthread_mutex_lock(&textures.mutex);
+		i32 index = textures.decoded_len ? textures.decoded[textures.decoded_head] : -1;
+		pthread_mutex_unlock(&textures.mutex);
+		if (index < 0) {
+			break;
+		}
+		struct texture* texture = &textures.textures[index];
+		b32 compressed = texture->ktx.map != NULL;
+		isize size = compressed ? texture->ktx.size : texture->chain.size;
+		if (uploaded > 0 && uploaded + size > budget_bytes) {
+			break;
+		}
+		struct texture_staging* staging = compressed ? NULL : acquire_staging();
+		if (!compressed && !staging) {
+			break;
+		}
+
+		pthread_mutex_lock(&textures.mutex);
+		textures.decoded_head = (textures.decoded_head + 1) % TEXTURE_MAX;
+		textures.decoded_len--;
+		pthread_mutex_unlock(&textures.mutex);
+
+		glGenTextures(1, &texture->handle);
+		glBindTexture(GL_TEXTURE_2D, texture->handle);
+		int width, height, levels;
+		if (compressed) {
+			upload_compressed(texture);
+			width = texture->ktx.width, height = texture->ktx.height, levels = texture->ktx.levels;
+			ktx_close(&texture->ktx);
+		} else {
+			upload_chain(texture, staging);
+			width = texture->chain.width[0], height = texture->chain.height[0], levels = texture->chain.levels;
+			mip_free(&texture->chain);
+		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		atomic_store_explicit(&texture->state, TEXTURE_RESIDENT, memory_order_release);
+		uploaded += size;
+		gl_log("texture %s resident (%ix%i, %i levels)\n", texture->path, width, height, levels);
+	}
+}
+
+void
+texture_system_finish(void) {
+	jobs_wait(&textures.decode_jobs);
+	for (;;) {
+		texture_system_update(PTRDIFF_MAX);
+		pthread_mutex_lock(&textures.mutex);
+		isize pending = textures.decoded_len;
+		pthread_mutex_unlock(&textures.mutex);
+		if (pending == 0) {
+			break;
+		}
+		/* every staging buffer is still in flight, let their fences signal */
+		glFinish();
+	}
+}
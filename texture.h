@@ -0,0 +1,38 @@
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "gl_loader.h"
+
+#include "common.h"
+
+/* Texture streaming.
+ * texture_load() returns a handle at once and decodes the file on the job system. Each frame,
+ * texture_system_update() moves decoded images into pixel-unpack buffers and issues
+ * glTexSubImage2D from them, limited by a byte budget so a burst of loads never hitches a frame.
+ * Mip levels are filtered on the worker as part of decoding (see mip.h), so the GL thread only
+ * copies them; .ktx2/.dds files are mapped instead and their block-compressed levels uploaded as
+ * they are (see ktx.h). Until then texture_get() returns a checkerboard placeholder. */
+
+#define TEXTURE_MAX 1024
+
+void texture_system_init(void);
+void texture_system_shutdown(void);
+
+enum {
+	TEXTURE_SRGB = 1 << 0,       /* color data: filter in linear space, sample as GL_SRGB8_ALPHA8 */
+	TEXTURE_ALPHA_TEST = 1 << 1, /* keep alpha-tested coverage at 0.5 constant across mip levels */
+};
+
+/* loading the same path twice returns the same handle (the first flags win); -1 when the table is full.
+ * flags only apply to PNG/TGA, compressed containers already name their sRGB-ness in the format */
+i32 texture_load(const char* path, u32 flags);
+GLuint texture_get(i32 handle);
+b32 texture_is_resident(i32 handle);
+
+/* call once per frame on the GL thread; budget_bytes bounds the pixel data staged this frame
+ * (at least one texture is always uploaded so big images still make progress) */
+void texture_system_update(isize budget_bytes);
+/* blocks until every texture loaded so far is resident (or failed), for reproducible headless runs */
+void texture_system_finish(void);
+
+#endif
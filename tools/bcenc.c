@@ -0,0 +1,390 @@
+/* Offline block compressor: PNG/TGA in, KTX2 out with a full BC1, BC3 or BC5 mip chain.
+ * usage: bcenc [-f bc1|bc3|bc5] [--linear] [--no-mips] [-j threads] input.png output.ktx2
+ * Color formats are tagged sRGB unless --linear; BC5 (two-channel normal maps) is always linear. */
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "image.h"
+#include "jobs.h"
+#include "mip.h"
+
+enum {
+	BC1,
+	BC3,
+	BC5,
+};
+
+/* vkFormat, KHR data format descriptor model and block size per format; sRGB vkFormat is linear + 1 */
+static const struct {
+	const char* name;
+	u32 vk_format;
+	u32 dfd_model;
+	int block_bytes;
+} formats[] = {
+    [BC1] = {"bc1", 131, 128, 8},
+    [BC3] = {"bc3", 137, 130, 16},
+    [BC5] = {"bc5", 141, 132, 16},
+};
+
+//////////////////////////////////////
+// block encoders
+static u16
+pack_565(const float c[3]) {
+	int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+	int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+	int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+	return (u16)((r << 11) | (g << 5) | b);
+}
+
+static void
+unpack_565(u16 c, int out[3]) {
+	int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+	out[0] = (r << 3) | (r >> 2);
+	out[1] = (g << 2) | (g >> 4);
+	out[2] = (b << 3) | (b >> 2);
+}
+
+/* endpoints along the principal axis of the block's colors, then the nearest of the four palette
+ * entries for every pixel */
+static void
+encode_bc1(const u8 block[16][4], u8 out[8]) {
+	float mean[3] = {0};
+	for (int i = 0; i < 16; i++) {
+		for (int c = 0; c < 3; c++) {
+			mean[c] += block[i][c] / 16.0f;
+		}
+	}
+	float cov[6] = {0}; /* rr rg rb gg gb bb */
+	for (int i = 0; i < 16; i++) {
+		float d[3] = {block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2]};
+		cov[0] += d[0] * d[0], cov[1] += d[0] * d[1], cov[2] += d[0] * d[2];
+		cov[3] += d[1] * d[1], cov[4] += d[1] * d[2], cov[5] += d[2] * d[2];
+	}
+	float axis[3] = {1.0f, 1.0f, 1.0f};
+	for (int iter = 0; iter < 8; iter++) {
+		float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+		float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+		float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+		float len = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+		if (len < 1e-6f) {
+			break;
+		}
+		axis[0] = x / len, axis[1] = y / len, axis[2] = z / len;
+	}
+	float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float t_min = 1e30f, t_max = -1e30f;
+	for (int i = 0; i < 16; i++) {
+		float t = ((block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] +
+		           (block[i][2] - mean[2]) * axis[2]) /
+		          len2;
+		t_min = fminf(t_min, t);
+		t_max = fmaxf(t_max, t);
+	}
+	/* pull the endpoints in slightly, the extremes are rarely worth a whole palette entry */
+	float inset = (t_max - t_min) / 16.0f;
+	t_min += inset, t_max -= inset;
+	float e0[3], e1[3];
+	for (int c = 0; c < 3; c++) {
+		e0[c] = fminf(fmaxf(mean[c] + axis[c] * t_max, 0.0f), 255.0f);
+		e1[c] = fminf(fmaxf(mean[c] + axis[c] * t_min, 0.0f), 255.0f);
+	}
+	u16 c0 = pack_565(e0), c1 = pack_565(e1);
+	/* c0 > c1 selects the four color mode */
+	if (c0 < c1) {
+		u16 t = c0;
+		c0 = c1, c1 = t;
+	}
+	int palette[4][3];
+	unpack_565(c0, palette[0]);
+	unpack_565(c1, palette[1]);
+	for (int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+	u32 indices = 0;
+	for (int i = 0; c0 != c1 && i < 16; i++) {
+		int best = 0, best_error = 1 << 30;
+		for (int p = 0; p < 4; p++) {
+			int dr = block[i][0] - palette[p][0], dg = block[i][1] - palette[p][1], db = block[i][2] - palette[p][2];
+			int error = dr * dr + dg * dg + db * db;
+			if (error < best_error) {
+				best = p, best_error = error;
+			}
+		}
+		indices |= (u32)best << (2 * i);
+	}
+	out[0] = (u8)c0, out[1] = (u8)(c0 >> 8);
+	out[2] = (u8)c1, out[3] = (u8)(c1 >> 8);
+	for (int i = 0; i < 4; i++) {
+		out[4 + i] = (u8)(indices >> (8 * i));
+	}
+}
+
+/* one channel: max and min endpoints with six interpolated values between them */
+static void
+encode_bc4(const u8 block[16][4], int channel, u8 out[8]) {
+	int hi = 0, lo = 255;
+	for (int i = 0; i < 16; i++) {
+		hi = block[i][channel] > hi ? block[i][channel] : hi;
+		lo = block[i][channel] < lo ? block[i][channel] : lo;
+	}
+	int palette[8] = {hi, lo};
+	for (int p = 2; p < 8; p++) {
+		palette[p] = ((8 - p) * hi + (p - 1) * lo) / 7;
+	}
+	u64 indices = 0;
+	for (int i = 0; hi != lo && i < 16; i++) {
+		int best = 0, best_error = 256;
+		for (int p = 0; p < 8; p++) {
+			int error = abs(block[i][channel] - palette[p]);
+			if (error < best_error) {
+				best = p, best_error = error;
+			}
+		}
+		indices |= (u64)best << (3 * i);
+	}
+	out[0] = (u8)hi, out[1] = (u8)lo;
+	for (int i = 0; i < 6; i++) {
+		out[2 + i] = (u8)(indices >> (8 * i));
+	}
+}
+
+struct encode_job {
+	int format;
+	const u8* rgba;
+	int width;
+	int height;
+	int blocks_x;
+	u8* out;
+};
+
+/* one row of blocks; edge blocks repeat the last row and column */
+static void
+encode_row_job(void* data, isize index) {
+	struct encode_job* job = data;
+	int by = (int)index;
+	int block_bytes = formats[job->format].block_bytes;
+	for (int bx = 0; bx < job->blocks_x; bx++) {
+		u8 block[16][4];
+		for (int y = 0; y < 4; y++) {
+			int sy = by * 4 + y < job->height ? by * 4 + y : job->height - 1;
+			for (int x = 0; x < 4; x++) {
+				int sx = bx * 4 + x < job->width ? bx * 4 + x : job->width - 1;
+				memcpy(block[y * 4 + x], &job->rgba[((isize)sy * job->width + sx) * 4], 4);
+			}
+		}
+		u8* out = &job->out[((isize)by * job->blocks_x + bx) * block_bytes];
+		switch (job->format) {
+			case BC1:
+				encode_bc1(block, out);
+				break;
+			case BC3:
+				encode_bc4(block, 3, out);
+				encode_bc1(block, out + 8);
+				break;
+			case BC5:
+				encode_bc4(block, 0, out);
+				encode_bc4(block, 1, out + 8);
+				break;
+		}
+	}
+}
+
+//////////////////////////////////////
+// KTX2 writer
+static void
+put_u32(u8* p, u32 v) {
+	p[0] = (u8)v, p[1] = (u8)(v >> 8), p[2] = (u8)(v >> 16), p[3] = (u8)(v >> 24);
+}
+
+static void
+put_u64(u8* p, u64 v) {
+	put_u32(p, (u32)v);
+	put_u32(p + 4, (u32)(v >> 32));
+}
+
+/* basic data format descriptor: one 64-bit sample per BC1/BC4 half of the block */
+static isize
+write_dfd(u8* p, int format, b32 srgb) {
+	int samples = formats[format].block_bytes / 8;
+	isize block_size = 24 + 16 * samples;
+	put_u32(p, (u32)(4 + block_size));
+	put_u32(p + 4, 0);                             /* vendor Khronos, basic descriptor */
+	put_u32(p + 8, 2 | ((u32)block_size << 16));   /* version 2 */
+	put_u32(p + 12, formats[format].dfd_model | (1 << 8) | ((srgb ? 2u : 1u) << 16)); /* BT.709 primaries */
+	put_u32(p + 16, 3 | (3 << 8));                 /* 4x4 texel blocks */
+	put_u32(p + 20, (u32)formats[format].block_bytes);
+	put_u32(p + 24, 0);
+	/* channel ids: BC1 color 0, BC3 alpha 15 then color 0, BC5 red 0 then green 1 */
+	static const u32 channels[][2] = {[BC1] = {0, 0}, [BC3] = {15, 0}, [BC5] = {0, 1}};
+	for (int s = 0; s < samples; s++) {
+		u8* sample = p + 28 + 16 * s;
+		put_u32(sample, (u32)(64 * s) | (63 << 16) | (channels[format][s] << 24));
+		put_u32(sample + 4, 0);
+		put_u32(sample + 8, 0);
+		put_u32(sample + 12, 0xFFFFFFFF);
+	}
+	return 4 + block_size;
+}
+
+static b32
+write_ktx2(const char* path, int format, b32 srgb, const struct mip_chain* chain, u8* const* levels,
+           const isize* level_sizes) {
+	static const u8 identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+	u8 dfd[128];
+	isize dfd_len = write_dfd(dfd, format, srgb);
+	isize header_len = 80 + 24 * chain->levels;
+
+	/* level data goes smallest first, each level aligned to the block size */
+	u64 offsets[MIP_MAX_LEVELS];
+	isize align = formats[format].block_bytes;
+	isize end = header_len + dfd_len;
+	for (int level = chain->levels - 1; level >= 0; level--) {
+		end = (end + align - 1) / align * align;
+		offsets[level] = (u64)end;
+		end += level_sizes[level];
+	}
+
+	u8* file = calloc(1, end);
+	memcpy(file, identifier, sizeof(identifier));
+	put_u32(file + 12, formats[format].vk_format + (srgb ? 1 : 0));
+	put_u32(file + 16, 1); /* typeSize */
+	put_u32(file + 20, (u32)chain->width[0]);
+	put_u32(file + 24, (u32)chain->height[0]);
+	put_u32(file + 36, 1); /* faceCount */
+	put_u32(file + 40, (u32)chain->levels);
+	put_u32(file + 44, 0); /* no supercompression */
+	put_u32(file + 48, (u32)header_len);
+	put_u32(file + 52, (u32)dfd_len);
+	for (int level = 0; level < chain->levels; level++) {
+		u8* index = file + 80 + 24 * level;
+		put_u64(index, offsets[level]);
+		put_u64(index + 8, (u64)level_sizes[level]);
+		put_u64(index + 16, (u64)level_sizes[level]);
+		memcpy(file + offsets[level], levels[level], level_sizes[level]);
+	}
+	memcpy(file + header_len, dfd, dfd_len);
+
+	FILE* out = fopen(path, "wb");
+	b32 ok = out && fwrite(file, 1, end, out) == (size_t)end;
+	if (out) {
+		ok = fclose(out) == 0 && ok;
+	}
+	free(file);
+	return ok;
+}
+
+//////////////////////////////////////
+// main
+static double
+now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+usage(void) {
+	fprintf(stderr, "usage: bcenc [-f bc1|bc3|bc5] [--linear] [--no-mips] [-j threads] input output.ktx2\n");
+	exit(1);
+}
+
+int
+main(int argc, char** argv) {
+	int format = BC1;
+	b32 srgb = 1, mips = 1;
+	int threads = 0;
+	const char* input = NULL;
+	const char* output = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+			i++;
+			format = -1;
+			for (int f = 0; f < (int)ARRAY_SIZE(formats); f++) {
+				if (strcmp(argv[i], formats[f].name) == 0) {
+					format = f;
+				}
+			}
+			if (format < 0) {
+				usage();
+			}
+		} else if (strcmp(argv[i], "--linear") == 0) {
+			srgb = 0;
+		} else if (strcmp(argv[i], "--no-mips") == 0) {
+			mips = 0;
+		} else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (!input) {
+			input = argv[i];
+		} else if (!output) {
+			output = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (!input || !output) {
+		usage();
+	}
+	if (format == BC5) {
+		srgb = 0;
+	}
+
+	restart_gl_log();
+	jobs_init(threads);
+	int width, height;
+	u8* rgba = image_load(input, &width, &height);
+	if (!rgba) {
+		fprintf(stderr, "bcenc: could not load %s\n", input);
+		return 1;
+	}
+
+	double t0 = now_s();
+	struct mip_chain chain;
+	struct mip_options options = {.filter = MIP_FILTER_KAISER, .srgb = srgb};
+	if (!mip_build(rgba, width, height, &options, &chain)) {
+		fprintf(stderr, "bcenc: could not build mips for %s\n", input);
+		return 1;
+	}
+	if (!mips) {
+		chain.levels = 1;
+	}
+	double t1 = now_s();
+
+	u8* levels[MIP_MAX_LEVELS];
+	isize level_sizes[MIP_MAX_LEVELS];
+	for (int level = 0; level < chain.levels; level++) {
+		struct encode_job job = {
+		    .format = format,
+		    .rgba = chain.data + chain.offset[level],
+		    .width = chain.width[level],
+		    .height = chain.height[level],
+		    .blocks_x = (chain.width[level] + 3) / 4,
+		};
+		int blocks_y = (chain.height[level] + 3) / 4;
+		level_sizes[level] = (isize)job.blocks_x * blocks_y * formats[format].block_bytes;
+		levels[level] = job.out = malloc(level_sizes[level]);
+		jobs_parallel_for(encode_row_job, &job, blocks_y);
+	}
+	double t2 = now_s();
+
+	b32 ok = write_ktx2(output, format, srgb, &chain, levels, level_sizes);
+	if (ok) {
+		printf("%s: %dx%d %s%s, %d levels, mips %.1f ms, encode %.1f ms (%d threads)\n", output, width, height,
+		       formats[format].name, srgb ? " srgb" : "", chain.levels, (t1 - t0) * 1e3, (t2 - t1) * 1e3,
+		       (int)jobs_thread_count());
+	} else {
+		fprintf(stderr, "bcenc: could not write %s\n", output);
+	}
+	for (int level = 0; level < chain.levels; level++) {
+		free(levels[level]);
+	}
+	mip_free(&chain);
+	free(rgba);
+	jobs_shutdown();
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+/* Startup cost of the generated loader against a full glewInit().
+ * Both resolve function pointers into their own variables, so they can run side by side. Whichever
+ * runs first also pays for the driver's symbol lookup warm-up, so both are called once untimed and
+ * the timed runs alternate which one goes first. */
+#define GL_LOADER_NO_REMAP
+#include "gl_loader.h"
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+
+#include "common.h"
+
+#define BENCH_RUNS 20
+
+static double
+time_loader(int* missing) {
+	u64 start = clock_ns();
+	*missing = gl_loader_load(glfwGetProcAddress);
+	return (double)(clock_ns() - start) / 1e6;
+}
+
+static double
+time_glew(void) {
+	u64 start = clock_ns();
+	glewExperimental = GL_TRUE;
+	glewInit();
+	return (double)(clock_ns() - start) / 1e6;
+}
+
+int
+main(void) {
+	restart_gl_log();
+	if (!glfwInit()) {
+		fprintf(stderr, "ERROR: could not start GLFW3\n");
+		return 1;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "bench_loader", NULL, NULL);
+	if (!window) {
+		fprintf(stderr, "ERROR: could not open window with GLFW3\n");
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+
+	int missing = 0;
+	time_loader(&missing);
+	time_glew();
+	double glew_total = 0, glew_best = 1e30, loader_total = 0, loader_best = 1e30;
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		double loader_ms, glew_ms;
+		if (i % 2 == 0) {
+			loader_ms = time_loader(&missing);
+			glew_ms = time_glew();
+		} else {
+			glew_ms = time_glew();
+			loader_ms = time_loader(&missing);
+		}
+		loader_total += loader_ms;
+		glew_total += glew_ms;
+		loader_best = loader_ms < loader_best ? loader_ms : loader_best;
+		glew_best = glew_ms < glew_best ? glew_ms : glew_best;
+	}
+
+	printf("renderer: %s\n", glGetString(GL_RENDERER));
+	printf("%-12s %8s %12s %12s\n", "loader", "symbols", "mean ms", "best ms");
+	printf("%-12s %8d %12.3f %12.3f\n", "gl_loader", gl_loader_count - missing, loader_total / BENCH_RUNS,
+	       loader_best);
+	printf("%-12s %8s %12.3f %12.3f\n", "glewInit", "all", glew_total / BENCH_RUNS, glew_best);
+
+	glfwTerminate();
+	return 0;
+}
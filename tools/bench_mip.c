@@ -0,0 +1,54 @@
+/* Throughput of the CPU mip chain builder in source megapixels per second. */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "common.h"
+#include "jobs.h"
+#include "mip.h"
+
+#define BENCH_SIZE 2048
+#define BENCH_RUNS 5
+
+static double
+now_s(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench(const char* name, const u8* rgba, const struct mip_options* options) {
+	double best = 1e30;
+	for (int i = 0; i < BENCH_RUNS; i++) {
+		struct mip_chain chain;
+		double t0 = now_s();
+		mip_build(rgba, BENCH_SIZE, BENCH_SIZE, options, &chain);
+		double t1 = now_s();
+		mip_free(&chain);
+		best = t1 - t0 < best ? t1 - t0 : best;
+	}
+	double megapixels = (double)BENCH_SIZE * BENCH_SIZE / 1e6;
+	printf("%-24s %8.2f ms %10.1f MP/s\n", name, best * 1e3, megapixels / best);
+}
+
+int
+main(void) {
+	restart_gl_log();
+	jobs_init(0);
+	u8* rgba = malloc((size_t)BENCH_SIZE * BENCH_SIZE * 4);
+	srand(1);
+	for (isize i = 0; i < (isize)BENCH_SIZE * BENCH_SIZE * 4; i++) {
+		rgba[i] = (u8)(rand() >> 7);
+	}
+	printf("%dx%d RGBA8, %d worker threads\n", BENCH_SIZE, BENCH_SIZE, (int)jobs_thread_count());
+	bench("box linear", rgba, &(struct mip_options){.filter = MIP_FILTER_BOX});
+	bench("box srgb", rgba, &(struct mip_options){.filter = MIP_FILTER_BOX, .srgb = 1});
+	bench("kaiser srgb", rgba, &(struct mip_options){.filter = MIP_FILTER_KAISER, .srgb = 1});
+	bench("kaiser srgb coverage", rgba,
+	      &(struct mip_options){.filter = MIP_FILTER_KAISER, .srgb = 1, .alpha_cutoff = 0.5f});
+	free(rgba);
+	jobs_shutdown();
+	return 0;
+}
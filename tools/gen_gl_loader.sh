@@ -0,0 +1,414 @@
+#!/bin/sh
+# Generates gl_loader.h / gl_loader.c: function pointers and a one-shot loader for exactly the GL
+# entry points the given sources call, instead of the ~2600 glewInit() resolves. Also generates the
+# call wrappers and the dispatcher gl_trace.c captures and replays through.
+#
+# usage: gen_gl_loader.sh <glew.h> <out_dir> <sources...>
+set -e
+
+GLEW_H=$1
+OUT=$2
+shift 2
+
+# every identifier of the form glXxx( in the sources; glfw*, glew* and gl_* don't match
+NAMES=$(cat "$@" | grep -o 'gl[A-Z][A-Za-z0-9_]*[[:space:]]*(' | sed 's/[[:space:]]*($//' | sort -u | tr '\n' ' ')
+
+tr -d '\r' < "$GLEW_H" | awk -v names="$NAMES" -v out="$OUT" '
+# argument encoding for tracing: i integer or enum, f float, d double, p pointer, s GLsync, v void
+function kind_of(type) {
+	if (type ~ /\*/) {
+		return "p"
+	}
+	if (type ~ /GLsync/) {
+		return "s"
+	}
+	if (type ~ /^(const )?(GLfloat|GLclampf)$/) {
+		return "f"
+	}
+	if (type ~ /^(const )?(GLdouble|GLclampd)$/) {
+		return "d"
+	}
+	return type == "void" ? "v" : "i"
+}
+# fills ptype[1..n] and pkind[1..n] from "(GLenum target, const GLfloat* v)", returns n
+function parse_params(params,    body, parts, n, i, p, type) {
+	body = params
+	sub(/^\(/, "", body)
+	sub(/\)$/, "", body)
+	gsub(/^ +| +$/, "", body)
+	if (body == "" || body == "void") {
+		return 0
+	}
+	n = split(body, parts, ",")
+	for (i = 1; i <= n; i++) {
+		p = parts[i]
+		gsub(/^ +| +$/, "", p)
+		type = p
+		if (type ~ /\]$/) {
+			sub(/ *[A-Za-z_][A-Za-z0-9_]*\[[0-9]*\]$/, "", type)
+			type = type " *"
+		} else {
+			sub(/[A-Za-z_][A-Za-z0-9_]*$/, "", type)
+		}
+		gsub(/ +$/, "", type)
+		if (type == "" || type == "const") {
+			type = p # unnamed parameter
+		}
+		ptype[i] = type
+		pkind[i] = kind_of(type)
+	}
+	return n
+}
+BEGIN {
+	count = split(names, order, " ")
+	for (i = 1; i <= count; i++) {
+		wanted[order[i]] = 1
+	}
+}
+# GL 1.1 entry points are plain prototypes: GLAPI <ret> GLAPIENTRY glXxx (<params>);
+/^GLAPI .* GLAPIENTRY gl[A-Za-z0-9_]+ \(.*\);$/ {
+	line = $0
+	sub(/^GLAPI /, "", line)
+	ret = line
+	sub(/ GLAPIENTRY .*/, "", ret)
+	name = line
+	sub(/.* GLAPIENTRY /, "", name)
+	sub(/ \(.*/, "", name)
+	params = line
+	sub(/^[^(]*\(/, "(", params)
+	sub(/;$/, "", params)
+	if (name in wanted) {
+		kind[name] = "core"
+		core_ret[name] = ret
+		core_params[name] = params
+	}
+	next
+}
+# everything glewInit() resolves: #define glXxx GLEW_GET_FUN(__glewXxx)
+/^#define gl[A-Za-z0-9_]+ GLEW_GET_FUN\(__glew[A-Za-z0-9_]+\)$/ {
+	name = $2
+	var = $3
+	sub(/^GLEW_GET_FUN\(/, "", var)
+	sub(/\)$/, "", var)
+	if (name in wanted) {
+		kind[name] = "ext"
+		var_of[name] = var
+		ext_name[var] = name
+	}
+	next
+}
+/^typedef .* \(GLAPIENTRY \* PFN[A-Z0-9_]+\) \(.*\);$/ {
+	type = $0
+	sub(/^.*\(GLAPIENTRY \* /, "", type)
+	sub(/\).*$/, "", type)
+	ret = $0
+	sub(/^typedef /, "", ret)
+	sub(/ \(GLAPIENTRY.*$/, "", ret)
+	params = $0
+	sub(/^.*\) \(/, "(", params)
+	sub(/;$/, "", params)
+	pfn_ret[type] = ret
+	pfn_params[type] = params
+	next
+}
+/^GLEW_FUN_EXPORT PFN[A-Z0-9_]+ __glew[A-Za-z0-9_]+;$/ {
+	var = $3
+	sub(/;$/, "", var)
+	if (var in ext_name) {
+		pfn[ext_name[var]] = $2
+	}
+	next
+}
+END {
+	header = out "/gl_loader.h"
+	source = out "/gl_loader.c"
+	banner = "/* Generated by tools/gen_gl_loader.sh from the GL calls in the sources. Do not edit. */"
+
+	print banner > header
+	print "#ifndef GL_LOADER_H" > header
+	print "#define GL_LOADER_H" > header
+	print "" > header
+	print "#include <stdint.h>" > header
+	print "#include <GL/glew.h>" > header
+	print "" > header
+	print "typedef void (*gl_loader_fn)(void);" > header
+	print "typedef gl_loader_fn (*gl_loader_get_proc)(const char* name);" > header
+	print "" > header
+	print "/* resolves every entry point below in one batch, returns how many were not found */" > header
+	print "int gl_loader_load(gl_loader_get_proc get_proc);" > header
+	print "extern const int gl_loader_count;" > header
+	print "" > header
+
+	print banner > source
+	print "#include \"common.h\"" > source
+	print "#define GL_LOADER_NO_REMAP" > source
+	print "#include \"gl_loader.h\"" > source
+	print "" > source
+
+	loaded = 0
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (!(name in kind)) {
+			printf("gen_gl_loader: %s not found in %s, skipped\n", name, FILENAME) > "/dev/stderr"
+			continue
+		}
+		if (kind[name] == "core") {
+			type = "PFNGLL_" toupper(substr(name, 3)) "PROC"
+			printf("typedef %s (GLAPIENTRY * %s) %s;\n", core_ret[name], type, core_params[name]) > header
+			ret_of[name] = core_ret[name]
+			params_of[name] = core_params[name]
+		} else {
+			type = pfn[name]
+			ret_of[name] = pfn_ret[type]
+			params_of[name] = pfn_params[type]
+		}
+		type_of[name] = type
+		id_of[name] = loaded
+		printf("extern %s gll_%s;\n", type, name) > header
+		printf("%s gll_%s;\n", type, name) > source
+		loaded++
+	}
+
+	print "" > header
+	print "/* Call tracing (gl_trace.h). Arguments travel as uint64_t: integers and pointers by value, floats" > header
+	print " * and doubles by bit pattern. Entry points are numbered in the order of gl_loader_signatures. */" > header
+	print "struct gl_loader_signature {" > header
+	print "\tconst char* name;" > header
+	print "\tconst char* params; /* one letter per parameter: i integer, f float, d double, p pointer, s GLsync */" > header
+	print "\tchar ret;           /* v for void */" > header
+	print "};" > header
+	print "extern const struct gl_loader_signature gl_loader_signatures[];" > header
+	print "typedef void (*gl_loader_hook)(int fn, const uint64_t* args, uint64_t ret);" > header
+	print "/* Hooks watch every GL call with no changes at the call sites (gl_trace.c, stats.c, gpu_memory.c)." > header
+	print " * While any are installed every pointer above goes through a wrapper that calls each before hook" > header
+	print " * (ret 0) and each after hook around the call, in installation order. Either may be NULL; adding" > header
+	print " * returns 0 once GL_LOADER_MAX_HOOKS pairs are installed. */" > header
+	print "#define GL_LOADER_MAX_HOOKS 4" > header
+	print "int gl_loader_add_hooks(gl_loader_hook before, gl_loader_hook after);" > header
+	print "void gl_loader_remove_hooks(gl_loader_hook before, gl_loader_hook after);" > header
+	print "/* calls entry point fn with encoded arguments, returns the encoded result */" > header
+	print "uint64_t gl_loader_dispatch(int fn, const uint64_t* args);" > header
+	print "" > header
+	print "/* route calls through the loaded pointers; the loader itself and benchmarks opt out */" > header
+	print "#ifndef GL_LOADER_NO_REMAP" > header
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (name in type_of) {
+			printf("#undef %s\n#define %s gll_%s\n", name, name, name) > header
+		}
+	}
+	print "#endif" > header
+	print "" > header
+	print "#endif" > header
+
+	print "" > source
+	printf("const int gl_loader_count = %d;\n", loaded) > source
+	print "" > source
+	print "int" > source
+	print "gl_loader_load(gl_loader_get_proc get_proc) {" > source
+	print "\tint missing = 0;" > source
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (!(name in type_of)) {
+			continue
+		}
+		printf("\tgll_%s = (%s)get_proc(\"%s\");\n", name, type_of[name], name) > source
+		printf("\tif (!gll_%s) {\n\t\tgl_log(\"gl loader: %s not available\\n\");\n\t\tmissing++;\n\t}\n", name, name) > source
+	}
+	print "\treturn missing;" > source
+	print "}" > source
+
+	print "" > source
+	print "static uint64_t" > source
+	print "float_bits(float f) {" > source
+	print "\tunion {\n\t\tfloat f;\n\t\tuint32_t u;\n\t} bits = {.f = f};" > source
+	print "\treturn bits.u;" > source
+	print "}" > source
+	print "" > source
+	print "static float" > source
+	print "bits_float(uint64_t u) {" > source
+	print "\tunion {\n\t\tuint32_t u;\n\t\tfloat f;\n\t} bits = {.u = (uint32_t)u};" > source
+	print "\treturn bits.f;" > source
+	print "}" > source
+	print "" > source
+	print "static uint64_t" > source
+	print "double_bits(double d) {" > source
+	print "\tunion {\n\t\tdouble d;\n\t\tuint64_t u;\n\t} bits = {.d = d};" > source
+	print "\treturn bits.u;" > source
+	print "}" > source
+	print "" > source
+	print "static double" > source
+	print "bits_double(uint64_t u) {" > source
+	print "\tunion {\n\t\tuint64_t u;\n\t\tdouble d;\n\t} bits = {.u = u};" > source
+	print "\treturn bits.d;" > source
+	print "}" > source
+	print "" > source
+	print "static struct {\n\tgl_loader_hook before;\n\tgl_loader_hook after;\n} hooks[GL_LOADER_MAX_HOOKS];" > source
+	print "static int hooks_len;" > source
+	print "" > source
+	print "static void" > source
+	print "hook_before(int fn, const uint64_t* args, uint64_t ret) {" > source
+	print "\tfor (int i = 0; i < hooks_len; i++) {" > source
+	print "\t\tif (hooks[i].before) {\n\t\t\thooks[i].before(fn, args, ret);\n\t\t}" > source
+	print "\t}" > source
+	print "}" > source
+	print "" > source
+	print "static void" > source
+	print "hook_after(int fn, const uint64_t* args, uint64_t ret) {" > source
+	print "\tfor (int i = 0; i < hooks_len; i++) {" > source
+	print "\t\tif (hooks[i].after) {\n\t\t\thooks[i].after(fn, args, ret);\n\t\t}" > source
+	print "\t}" > source
+	print "}" > source
+
+	print "" > source
+	print "const struct gl_loader_signature gl_loader_signatures[] = {" > source
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (!(name in type_of)) {
+			continue
+		}
+		n = parse_params(params_of[name])
+		sig = ""
+		for (k = 1; k <= n; k++) {
+			sig = sig pkind[k]
+		}
+		printf("\t{\"%s\", \"%s\", \x27%s\x27},\n", name, sig, kind_of(ret_of[name])) > source
+	}
+	print "};" > source
+
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (!(name in type_of)) {
+			continue
+		}
+		n = parse_params(params_of[name])
+		ret_kind = kind_of(ret_of[name])
+		decl = ""
+		call = ""
+		encode = ""
+		for (k = 1; k <= n; k++) {
+			decl = decl (k > 1 ? ", " : "") ptype[k] " a" k
+			call = call (k > 1 ? ", " : "") "a" k
+			if (pkind[k] == "f") {
+				encode = encode (k > 1 ? ", " : "") "float_bits(a" k ")"
+			} else if (pkind[k] == "d") {
+				encode = encode (k > 1 ? ", " : "") "double_bits(a" k ")"
+			} else if (pkind[k] == "p" || pkind[k] == "s") {
+				encode = encode (k > 1 ? ", " : "") "(uint64_t)(uintptr_t)a" k
+			} else {
+				encode = encode (k > 1 ? ", " : "") "(uint64_t)a" k
+			}
+		}
+		print "" > source
+		printf("static %s real_%s;\n", type_of[name], name) > source
+		print "" > source
+		printf("static %s GLAPIENTRY\nwrap_%s(%s) {\n", ret_of[name], name, n ? decl : "void") > source
+		printf("\tuint64_t args[%d] = {%s};\n", n ? n : 1, n ? encode : "0") > source
+		printf("\thook_before(%d, args, 0);\n", id_of[name]) > source
+		if (ret_kind == "v") {
+			printf("\treal_%s(%s);\n", name, call) > source
+			printf("\thook_after(%d, args, 0);\n", id_of[name]) > source
+		} else {
+			printf("\t%s ret = real_%s(%s);\n", ret_of[name], name, call) > source
+			if (ret_kind == "p" || ret_kind == "s") {
+				printf("\thook_after(%d, args, (uint64_t)(uintptr_t)ret);\n", id_of[name]) > source
+			} else if (ret_kind == "f") {
+				printf("\thook_after(%d, args, float_bits(ret));\n", id_of[name]) > source
+			} else if (ret_kind == "d") {
+				printf("\thook_after(%d, args, double_bits(ret));\n", id_of[name]) > source
+			} else {
+				printf("\thook_after(%d, args, (uint64_t)ret);\n", id_of[name]) > source
+			}
+			print "\treturn ret;" > source
+		}
+		print "}" > source
+	}
+
+	print "" > source
+	print "static void" > source
+	print "wrap_all(void) {" > source
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (name in type_of) {
+			printf("\treal_%s = gll_%s;\n\tgll_%s = real_%s ? wrap_%s : NULL;\n", name, name, name, name, name) > source
+		}
+	}
+	print "}" > source
+	print "" > source
+	print "static void" > source
+	print "unwrap_all(void) {" > source
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (name in type_of) {
+			printf("\tgll_%s = real_%s;\n", name, name) > source
+		}
+	}
+	print "}" > source
+	print "" > source
+	print "int" > source
+	print "gl_loader_add_hooks(gl_loader_hook before, gl_loader_hook after) {" > source
+	print "\tif (hooks_len == GL_LOADER_MAX_HOOKS) {\n\t\treturn 0;\n\t}" > source
+	print "\tif (hooks_len == 0) {\n\t\twrap_all();\n\t}" > source
+	print "\thooks[hooks_len].before = before;" > source
+	print "\thooks[hooks_len].after = after;" > source
+	print "\thooks_len++;" > source
+	print "\treturn 1;" > source
+	print "}" > source
+	print "" > source
+	print "void" > source
+	print "gl_loader_remove_hooks(gl_loader_hook before, gl_loader_hook after) {" > source
+	print "\tfor (int i = 0; i < hooks_len; i++) {" > source
+	print "\t\tif (hooks[i].before == before && hooks[i].after == after) {" > source
+	print "\t\t\tfor (hooks_len--; i < hooks_len; i++) {\n\t\t\t\thooks[i] = hooks[i + 1];\n\t\t\t}" > source
+	print "\t\t\tif (hooks_len == 0) {\n\t\t\t\tunwrap_all();\n\t\t\t}" > source
+	print "\t\t\treturn;" > source
+	print "\t\t}" > source
+	print "\t}" > source
+	print "}" > source
+
+	print "" > source
+	print "uint64_t" > source
+	print "gl_loader_dispatch(int fn, const uint64_t* args) {" > source
+	print "\t(void)bits_float;" > source
+	print "\t(void)bits_double;" > source
+	print "\t(void)double_bits;" > source
+	print "\tswitch (fn) {" > source
+	for (i = 1; i <= count; i++) {
+		name = order[i]
+		if (!(name in type_of)) {
+			continue
+		}
+		n = parse_params(params_of[name])
+		ret_kind = kind_of(ret_of[name])
+		call = ""
+		for (k = 1; k <= n; k++) {
+			if (pkind[k] == "f") {
+				arg = "bits_float(args[" k - 1 "])"
+			} else if (pkind[k] == "d") {
+				arg = "bits_double(args[" k - 1 "])"
+			} else if (pkind[k] == "p" || pkind[k] == "s") {
+				arg = "(" ptype[k] ")(uintptr_t)args[" k - 1 "]"
+			} else {
+				arg = "(" ptype[k] ")args[" k - 1 "]"
+			}
+			call = call (k > 1 ? ", " : "") arg
+		}
+		printf("\t\tcase %d:\n", id_of[name]) > source
+		if (ret_kind == "v") {
+			printf("\t\t\tgll_%s(%s);\n\t\t\treturn 0;\n", name, call) > source
+		} else if (ret_kind == "p" || ret_kind == "s") {
+			printf("\t\t\treturn (uint64_t)(uintptr_t)gll_%s(%s);\n", name, call) > source
+		} else if (ret_kind == "f") {
+			printf("\t\t\treturn float_bits(gll_%s(%s));\n", name, call) > source
+		} else if (ret_kind == "d") {
+			printf("\t\t\treturn double_bits(gll_%s(%s));\n", name, call) > source
+		} else {
+			printf("\t\t\treturn (uint64_t)gll_%s(%s);\n", name, call) > source
+		}
+	}
+	print "\t\tdefault:" > source
+	print "\t\t\treturn 0;" > source
+	print "\t}" > source
+	print "}" > source
+}
+'
@@ -0,0 +1,360 @@
+/* Replays a GL trace recorded with run --gl-trace (gl_trace.h) as fast as possible and reports the
+ * time per frame. Frames before the recorded range run untimed as setup.
+ * usage: gl_replay [--no-finish] trace.gltrace
+ * By default glFinish() ends every frame so the times include the GPU; --no-finish measures
+ * submission only. glGet* calls are skipped: they have no effect on rendering and the trace
+ * already holds what the application did with their results. */
+#define _POSIX_C_SOURCE 200809L
+#include "gl_loader.h"
+#include <GLFW/glfw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "gl_trace.h"
+
+#define REPLAY_MAX_SYNCS 64
+#define REPLAY_MAX_MAPS 8
+
+enum replay_special {
+	REPLAY_PLAIN,
+	REPLAY_SKIP,
+	REPLAY_GEN,    /* compare the names GL hands out with the recorded ones */
+	REPLAY_CREATE, /* same, through the return value */
+	REPLAY_SHADER_SOURCE,
+	REPLAY_FENCE,
+	REPLAY_DELETE_SYNC,
+	REPLAY_MAP,
+	REPLAY_UNMAP,
+};
+
+struct replay_function {
+	int local; /* index into gl_loader_signatures, -1 when this build does not load it */
+	enum replay_special special;
+};
+
+static struct {
+	struct replay_function* functions;
+	struct {
+		u64 recorded;
+		GLsync sync;
+	} syncs[REPLAY_MAX_SYNCS];
+	struct replay_map {
+		GLenum target;
+		u8* pointer;
+		u64 length; /* of the mapped range, recorded writes must stay inside it */
+	} maps[REPLAY_MAX_MAPS];
+	u8* scratch;
+	u64 scratch_size;
+	isize calls;
+	isize missing;
+	isize diverged;
+} replay;
+
+static double
+now_ms(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static int
+compare_doubles(const void* a, const void* b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : x > y;
+}
+
+static u8*
+scratch(u64 size) {
+	size = size < 65536 ? 65536 : size;
+	if (size > replay.scratch_size) {
+		free(replay.scratch);
+		replay.scratch = malloc(size);
+		replay.scratch_size = size;
+	}
+	return replay.scratch;
+}
+
+static GLsync
+find_sync(u64 recorded) {
+	for (int i = 0; i < REPLAY_MAX_SYNCS; i++) {
+		if (replay.syncs[i].recorded == recorded) {
+			return replay.syncs[i].sync;
+		}
+	}
+	return NULL;
+}
+
+/* a NULL sync forgets the recorded one */
+static void
+set_sync(u64 recorded, GLsync sync) {
+	for (int i = 0; i < REPLAY_MAX_SYNCS; i++) {
+		if (replay.syncs[i].recorded == recorded) {
+			replay.syncs[i].recorded = sync ? recorded : 0;
+			replay.syncs[i].sync = sync;
+			return;
+		}
+	}
+	for (int i = 0; i < REPLAY_MAX_SYNCS && sync; i++) {
+		if (!replay.syncs[i].recorded) {
+			replay.syncs[i].recorded = recorded;
+			replay.syncs[i].sync = sync;
+			return;
+		}
+	}
+}
+
+static struct replay_map*
+find_map(GLenum target) {
+	for (int i = 0; i < REPLAY_MAX_MAPS; i++) {
+		if (replay.maps[i].target == target) {
+			return &replay.maps[i];
+		}
+	}
+	for (int i = 0; i < REPLAY_MAX_MAPS; i++) {
+		if (!replay.maps[i].target) {
+			replay.maps[i].target = target;
+			return &replay.maps[i];
+		}
+	}
+	return NULL;
+}
+
+static void
+resolve_functions(const struct gl_trace_reader* reader) {
+	replay.functions = calloc(reader->functions_len, sizeof(*replay.functions));
+	for (int fn = 0; fn < reader->functions_len; fn++) {
+		const struct gl_trace_function* function = &reader->functions[fn];
+		struct replay_function* out = &replay.functions[fn];
+		out->local = -1;
+		for (int i = 0; i < gl_loader_count; i++) {
+			if (strcmp(gl_loader_signatures[i].name, function->name) == 0 &&
+			    strcmp(gl_loader_signatures[i].params, function->params) == 0 &&
+			    gl_loader_signatures[i].ret == function->ret) {
+				out->local = i;
+			}
+		}
+		const char* name = function->name;
+		if (strncmp(name, "glGet", 5) == 0) {
+			out->special = REPLAY_SKIP;
+		} else if (strncmp(name, "glGen", 5) == 0 && strcmp(function->params, "ip") == 0) {
+			out->special = REPLAY_GEN;
+		} else if (strcmp(name, "glCreateProgram") == 0 || strcmp(name, "glCreateShader") == 0) {
+			out->special = REPLAY_CREATE;
+		} else if (strcmp(name, "glShaderSource") == 0) {
+			out->special = REPLAY_SHADER_SOURCE;
+		} else if (strcmp(name, "glFenceSync") == 0) {
+			out->special = REPLAY_FENCE;
+		} else if (strcmp(name, "glDeleteSync") == 0) {
+			out->special = REPLAY_DELETE_SYNC;
+		} else if (strcmp(name, "glMapBufferRange") == 0) {
+			out->special = REPLAY_MAP;
+		} else if (strcmp(name, "glUnmapBuffer") == 0) {
+			out->special = REPLAY_UNMAP;
+		}
+	}
+}
+
+static void
+replay_call(const struct gl_trace_reader* reader, const struct gl_trace_record* record) {
+	const struct gl_trace_function* function = &reader->functions[record->function];
+	const struct replay_function* fn = &replay.functions[record->function];
+	if (fn->special == REPLAY_SKIP) {
+		return;
+	}
+	if (fn->local < 0) {
+		if (replay.missing++ == 0) {
+			fprintf(stderr, "gl_replay: %s is not loaded by this build, skipping it\n", function->name);
+		}
+		return;
+	}
+
+	u64 args[GL_TRACE_MAX_PARAMS];
+	memcpy(args, record->args, sizeof(args));
+	for (int i = 0; function->params[i]; i++) {
+		if (function->params[i] == 's') {
+			args[i] = (u64)(uintptr_t)find_sync(record->args[i]);
+		} else if (record->payload_kind[i] == GL_TRACE_INPUT) {
+			args[i] = (u64)(uintptr_t)record->payload[i];
+		} else if (record->payload_kind[i] == GL_TRACE_OUTPUT) {
+			args[i] = (u64)(uintptr_t)scratch(record->payload_size[i]);
+		}
+	}
+	const GLchar* source;
+	switch (fn->special) {
+		case REPLAY_GEN:
+			args[1] = (u64)(uintptr_t)scratch(record->payload_size[1]);
+			break;
+		case REPLAY_SHADER_SOURCE:
+			/* the recorded strings were joined into one */
+			source = (const GLchar*)record->payload[2];
+			args[1] = 1;
+			args[2] = (u64)(uintptr_t)&source;
+			args[3] = 0;
+			break;
+		default:
+			break;
+	}
+
+	u64 ret = gl_loader_dispatch(fn->local, args);
+	replay.calls++;
+
+	switch (fn->special) {
+		case REPLAY_GEN:
+			if (record->payload[1] && memcmp(replay.scratch, record->payload[1], record->payload_size[1]) != 0) {
+				replay.diverged++;
+			}
+			break;
+		case REPLAY_CREATE:
+			replay.diverged += ret != record->ret;
+			break;
+		case REPLAY_FENCE:
+			set_sync(record->ret, (GLsync)(uintptr_t)ret);
+			break;
+		case REPLAY_DELETE_SYNC:
+			set_sync(record->args[0], NULL);
+			break;
+		case REPLAY_MAP: {
+			/* (target, offset, length, access) */
+			struct replay_map* map = find_map((GLenum)record->args[0]);
+			if (map) {
+				map->pointer = (u8*)(uintptr_t)ret;
+				map->length = ret ? record->args[2] : 0;
+			}
+			break;
+		}
+		case REPLAY_UNMAP: {
+			struct replay_map* map = find_map((GLenum)record->args[0]);
+			if (map) {
+				map->pointer = NULL;
+				map->length = 0;
+			}
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+static void
+usage(void) {
+	fprintf(stderr, "usage: gl_replay [--no-finish] trace.gltrace\n");
+	exit(1);
+}
+
+int
+main(int argc, char** argv) {
+	b32 finish = 1;
+	const char* path = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--no-finish") == 0) {
+			finish = 0;
+		} else if (!path) {
+			path = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (!path) {
+		usage();
+	}
+
+	restart_gl_log();
+	struct gl_trace_reader reader;
+	if (!gl_trace_open(&reader, path)) {
+		fprintf(stderr, "gl_replay: could not read %s\n", path);
+		return 1;
+	}
+	if (!glfwInit()) {
+		fprintf(stderr, "gl_replay: could not start GLFW3\n");
+		return 1;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_SAMPLES, 4);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(reader.fb_width, reader.fb_height, "gl_replay", NULL, NULL);
+	if (!window) {
+		fprintf(stderr, "gl_replay: could not open window with GLFW3\n");
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	gl_loader_load(glfwGetProcAddress);
+	resolve_functions(&reader);
+
+	isize frames_cap = 1024, frames_len = 0;
+	double* frame_ms = malloc(frames_cap * sizeof(*frame_ms));
+	isize setup_calls = 0;
+	double start = now_ms(), frame_start = start, setup_ms = 0.0;
+	struct gl_trace_record record;
+	int kind;
+	while ((kind = gl_trace_next(&reader, &record)) != GL_TRACE_EOF && kind != GL_TRACE_ERROR) {
+		if (kind == GL_TRACE_CALL) {
+			replay_call(&reader, &record);
+		} else if (kind == GL_TRACE_MAPPED_WRITE) {
+			struct replay_map* map = find_map(record.target);
+			if (map && map->pointer) {
+				if (record.offset > map->length || record.size > map->length - record.offset) {
+					fprintf(stderr, "gl_replay: a write of %llu bytes at %llu overruns the %llu byte mapping\n",
+					        (unsigned long long)record.size, (unsigned long long)record.offset,
+					        (unsigned long long)map->length);
+					kind = GL_TRACE_ERROR;
+					break;
+				}
+				memcpy(map->pointer + record.offset, record.data, record.size);
+			}
+		} else if (kind == GL_TRACE_FRAME_END) {
+			if (finish) {
+				glFinish();
+			}
+			double now = now_ms();
+			if (record.frame < reader.first_frame) {
+				setup_ms = now - start;
+				setup_calls = replay.calls;
+			} else {
+				if (frames_len == frames_cap) {
+					frames_cap *= 2;
+					frame_ms = realloc(frame_ms, frames_cap * sizeof(*frame_ms));
+				}
+				frame_ms[frames_len++] = now - frame_start;
+			}
+			frame_start = now;
+		}
+	}
+	if (kind == GL_TRACE_ERROR) {
+		fprintf(stderr, "gl_replay: %s is truncated or corrupt, stopped at byte %li\n", path, (long)reader.cursor);
+	}
+
+	printf("%s: %dx%d, frames %li-%li, %s\n", path, reader.fb_width, reader.fb_height, reader.first_frame,
+	       reader.last_frame, finish ? "glFinish per frame" : "submission only");
+	printf("setup: %li calls in %.2f ms\n", (long)setup_calls, setup_ms);
+	if (frames_len > 0) {
+		double total = 0.0;
+		for (isize i = 0; i < frames_len; i++) {
+			total += frame_ms[i];
+		}
+		qsort(frame_ms, frames_len, sizeof(*frame_ms), compare_doubles);
+		printf("%li frames, %li calls: mean %.3f ms, median %.3f ms, min %.3f ms, max %.3f ms (%.0f fps)\n",
+		       (long)frames_len, (long)(replay.calls - setup_calls), total / frames_len, frame_ms[frames_len / 2],
+		       frame_ms[0], frame_ms[frames_len - 1], frames_len * 1000.0 / total);
+	}
+	if (replay.missing) {
+		printf("warning: %li calls to entry points this build does not load were skipped\n", (long)replay.missing);
+	}
+	if (replay.diverged) {
+		printf("warning: GL handed out %li different object names than when recording, the replay may be wrong\n",
+		       (long)replay.diverged);
+	}
+
+	free(frame_ms);
+	free(replay.scratch);
+	free(replay.functions);
+	gl_trace_close(&reader);
+	glfwTerminate();
+	return kind == GL_TRACE_ERROR;
+}
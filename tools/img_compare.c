@@ -0,0 +1,124 @@
+/* Compares a rendered image against a reference with a perceptual tolerance.
+ * usage: img_compare [--threshold 2.3] [--max-fraction 0.001] [--diff diff.png] reference.png image.png
+ * Pixels are compared as CIE76 delta E in L*a*b* (2.3 is about one just noticeable difference); the
+ * images match when at most max-fraction of the pixels are over the threshold. The diff image shows
+ * the reference in gray with failing pixels in red. Exit status: 0 match, 1 mismatch, 2 error. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "image.h"
+
+struct lab {
+	float l, a, b;
+};
+
+static float srgb_to_linear_lut[256];
+
+static float
+lab_f(float t) {
+	return t > 0.008856f ? cbrtf(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+/* sRGB, D65 white */
+static struct lab
+to_lab(const u8* rgb) {
+	float r = srgb_to_linear_lut[rgb[0]], g = srgb_to_linear_lut[rgb[1]], b = srgb_to_linear_lut[rgb[2]];
+	float x = (0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f;
+	float y = 0.2126f * r + 0.7152f * g + 0.0722f * b;
+	float z = (0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f;
+	float fx = lab_f(x), fy = lab_f(y), fz = lab_f(z);
+	return (struct lab){116.0f * fy - 16.0f, 500.0f * (fx - fy), 200.0f * (fy - fz)};
+}
+
+static void
+usage(void) {
+	fprintf(stderr, "usage: img_compare [--threshold 2.3] [--max-fraction 0.001] [--diff diff.png] reference image\n");
+	exit(2);
+}
+
+int
+main(int argc, char** argv) {
+	float threshold = 2.3f, max_fraction = 0.001f;
+	const char* diff_path = NULL;
+	const char* paths[2] = {NULL, NULL};
+	int paths_len = 0;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+			threshold = strtof(argv[++i], NULL);
+		} else if (strcmp(argv[i], "--max-fraction") == 0 && i + 1 < argc) {
+			max_fraction = strtof(argv[++i], NULL);
+		} else if (strcmp(argv[i], "--diff") == 0 && i + 1 < argc) {
+			diff_path = argv[++i];
+		} else if (paths_len < 2) {
+			paths[paths_len++] = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (paths_len != 2) {
+		usage();
+	}
+
+	restart_gl_log();
+	int width[2], height[2];
+	u8* images[2];
+	for (int i = 0; i < 2; i++) {
+		images[i] = image_load(paths[i], &width[i], &height[i]);
+		if (!images[i]) {
+			fprintf(stderr, "img_compare: could not load %s\n", paths[i]);
+			return 2;
+		}
+	}
+	if (width[0] != width[1] || height[0] != height[1]) {
+		printf("size mismatch: %dx%d vs %dx%d\n", width[0], height[0], width[1], height[1]);
+		return 1;
+	}
+
+	for (int i = 0; i < 256; i++) {
+		float c = i / 255.0f;
+		srgb_to_linear_lut[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+	isize pixels = (isize)width[0] * height[0];
+	u8* diff = diff_path ? malloc(pixels * 4) : NULL;
+	isize over = 0;
+	double sum_delta = 0.0, sum_squared = 0.0;
+	float max_delta = 0.0f;
+	for (isize p = 0; p < pixels; p++) {
+		const u8* a = &images[0][p * 4];
+		const u8* b = &images[1][p * 4];
+		float delta = 0.0f;
+		if (memcmp(a, b, 3) != 0) {
+			struct lab la = to_lab(a), lb = to_lab(b);
+			delta = sqrtf((la.l - lb.l) * (la.l - lb.l) + (la.a - lb.a) * (la.a - lb.a) + (la.b - lb.b) * (la.b - lb.b));
+			for (int c = 0; c < 3; c++) {
+				sum_squared += (double)(a[c] - b[c]) * (a[c] - b[c]);
+			}
+		}
+		sum_delta += delta;
+		max_delta = delta > max_delta ? delta : max_delta;
+		over += delta > threshold;
+		if (diff) {
+			u8 gray = (u8)((a[0] + a[1] + a[2]) / 12); /* dimmed so the red stands out */
+			u8* out = &diff[p * 4];
+			out[0] = delta > threshold ? 255 : gray;
+			out[1] = delta > threshold ? 0 : gray;
+			out[2] = delta > threshold ? 0 : gray;
+			out[3] = 255;
+		}
+	}
+	double mse = sum_squared / (pixels * 3.0);
+	double psnr = mse > 0.0 ? 10.0 * log10(255.0 * 255.0 / mse) : INFINITY;
+	b32 match = over <= max_fraction * pixels;
+	printf("%s: max dE %.2f, mean dE %.3f, %li of %li pixels over %.1f, PSNR %.1f dB\n", match ? "match" : "MISMATCH",
+	       max_delta, sum_delta / pixels, (long)over, (long)pixels, threshold, psnr);
+	if (diff && !image_write_png(diff_path, diff, width[0], height[0])) {
+		fprintf(stderr, "img_compare: could not write %s\n", diff_path);
+	}
+	free(diff);
+	free(images[0]);
+	free(images[1]);
+	return match ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+/* Validates and precompiles every shader variant listed in a manifest (make shaders).
+ * usage: shaderc [--jobs N] shaders.txt out_dir
+ * Each line of shaders.txt names a vertex shader, a fragment shader and optionally a define set, the
+ * rest of the line. The variants are preprocessed here (shader.h), then split across N processes,
+ * each with its own hidden GL context, that compile and link them and save the program binaries to
+ * out_dir named by source hash, where ./run looks for them (SHADER_CACHE_DIR). Program binaries only
+ * load on the driver that made them, so the cache is built on the machine that runs it.
+ * out_dir/manifest.txt lists every variant with its hash and result. Exit status 1 when any variant
+ * failed, so make stops. */
+#define _POSIX_C_SOURCE 200809L
+#include "gl_loader.h"
+#include <GLFW/glfw3.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "shader.h"
+
+struct variant {
+	char vs_path[SHADER_PATH_MAX];
+	char fs_path[SHADER_PATH_MAX];
+	char defines[SHADER_DEFINES_MAX];
+	u64 source_hash;
+	b32 preprocessed;
+	b32 ok;
+};
+
+/* what a worker sends back per variant */
+struct result {
+	i32 index;
+	i32 ok;
+};
+
+static struct variant variants[SHADER_MAX_VARIANTS];
+static isize variants_len;
+
+static void
+usage(void) {
+	fprintf(stderr, "usage: shaderc [--jobs N] shaders.txt out_dir\n");
+	exit(2);
+}
+
+static b32
+read_list(const char* path) {
+	FILE* file = fopen(path, "r");
+	if (!file) {
+		fprintf(stderr, "shaderc: could not read %s\n", path);
+		return 0;
+	}
+	char line[1024];
+	int line_number = 0;
+	while (fgets(line, sizeof(line), file)) {
+		line_number++;
+		line[strcspn(line, "\r\n")] = '\0';
+		char vs[SHADER_PATH_MAX], fs[SHADER_PATH_MAX];
+		int rest = 0;
+		if (line[strspn(line, " \t")] == '#' || sscanf(line, "%255s %255s %n", vs, fs, &rest) < 2) {
+			continue;
+		}
+		if (variants_len == SHADER_MAX_VARIANTS || strlen(line + rest) >= SHADER_DEFINES_MAX) {
+			fprintf(stderr, "shaderc: %s:%i: too many variants or defines\n", path, line_number);
+			fclose(file);
+			return 0;
+		}
+		struct variant* variant = &variants[variants_len++];
+		strcpy(variant->vs_path, vs);
+		strcpy(variant->fs_path, fs);
+		strcpy(variant->defines, line + rest);
+	}
+	fclose(file);
+	return 1;
+}
+
+/* in a forked process: compiles every jobs-th variant starting at job, reports each through fd */
+static int
+worker(int job, int jobs, const char* out_dir, int fd) {
+	if (!glfwInit()) {
+		fprintf(stderr, "shaderc: could not start GLFW3\n");
+		return 1;
+	}
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "shaderc", NULL, NULL);
+	if (!window) {
+		fprintf(stderr, "shaderc: could not open window with GLFW3\n");
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	gl_loader_load(glfwGetProcAddress);
+
+	int failed = 0;
+	for (isize i = job; i < variants_len; i += jobs) {
+		struct variant* variant = &variants[i];
+		u64 source_hash;
+		struct result result = {.index = (i32)i};
+		result.ok = variant->preprocessed &&
+		            shader_precompile(variant->vs_path, variant->fs_path, variant->defines, out_dir, &source_hash);
+		failed += !result.ok;
+		/* smaller than PIPE_BUF, so the workers' writes never interleave */
+		if (write(fd, &result, sizeof(result)) != sizeof(result)) {
+			failed++;
+		}
+	}
+	glfwTerminate();
+	return failed > 0;
+}
+
+int
+main(int argc, char** argv) {
+	const char* list_path = NULL;
+	const char* out_dir = NULL;
+	long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+			jobs = strtol(argv[++i], NULL, 10);
+		} else if (!list_path) {
+			list_path = argv[i];
+		} else if (!out_dir) {
+			out_dir = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (!list_path || !out_dir) {
+		usage();
+	}
+
+	restart_gl_log();
+	if (!read_list(list_path)) {
+		return 1;
+	}
+	if (mkdir(out_dir, 0755) != 0 && errno != EEXIST) {
+		fprintf(stderr, "shaderc: could not create %s: %s\n", out_dir, strerror(errno));
+		return 1;
+	}
+	/* preprocessing needs no GL: the hashes are known before any worker starts */
+	for (isize i = 0; i < variants_len; i++) {
+		struct variant* variant = &variants[i];
+		struct shader_source vs, fs;
+		if (shader_preprocess(&vs, variant->vs_path, variant->defines)) {
+			if (shader_preprocess(&fs, variant->fs_path, variant->defines)) {
+				variant->source_hash = shader_sources_hash(&vs, &fs);
+				variant->preprocessed = 1;
+				shader_source_free(&fs);
+			}
+			shader_source_free(&vs);
+		}
+	}
+
+	jobs = jobs < 1 ? 1 : jobs > variants_len ? (long)variants_len : jobs;
+	int fds[2];
+	if (variants_len && pipe(fds) != 0) {
+		fprintf(stderr, "shaderc: pipe: %s\n", strerror(errno));
+		return 1;
+	}
+	for (int job = 0; job < jobs; job++) {
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(fds[0]);
+			_exit(worker(job, (int)jobs, out_dir, fds[1]));
+		} else if (pid < 0) {
+			fprintf(stderr, "shaderc: fork: %s\n", strerror(errno));
+			jobs = job;
+			break;
+		}
+	}
+	if (variants_len) {
+		close(fds[1]);
+		struct result result;
+		while (read(fds[0], &result, sizeof(result)) == sizeof(result)) {
+			if (result.index >= 0 && result.index < variants_len) {
+				variants[result.index].ok = result.ok;
+			}
+		}
+		close(fds[0]);
+	}
+	while (wait(NULL) > 0) {
+	}
+
+	/* a variant a worker never reported on (it crashed, or had no context) counts as failed */
+	isize failed = 0;
+	for (isize i = 0; i < variants_len; i++) {
+		failed += !variants[i].ok;
+	}
+	char manifest_path[SHADER_PATH_MAX + 16];
+	snprintf(manifest_path, sizeof(manifest_path), "%s/manifest.txt", out_dir);
+	FILE* manifest = fopen(manifest_path, "w");
+	if (!manifest) {
+		fprintf(stderr, "shaderc: could not write %s\n", manifest_path);
+		return 1;
+	}
+	fprintf(manifest, "# shaderc %s: %li variants, %li failed\n", list_path, (long)variants_len, (long)failed);
+	fprintf(manifest, "# source hash, result, vertex shader, fragment shader, defines\n");
+	for (isize i = 0; i < variants_len; i++) {
+		const struct variant* variant = &variants[i];
+		fprintf(manifest, "%016llx %s %s %s%s%s\n", (unsigned long long)variant->source_hash,
+		        variant->ok ? "ok" : "failed", variant->vs_path, variant->fs_path, variant->defines[0] ? " " : "",
+		        variant->defines);
+		if (!variant->ok) {
+			fprintf(stderr, "shaderc: FAIL %s %s [%s], see gl.log\n", variant->vs_path, variant->fs_path,
+			        variant->defines);
+		}
+	}
+	fclose(manifest);
+	printf("shaderc: %li variants in %li processes, %li failed, binaries in %s\n", (long)variants_len, jobs,
+	       (long)failed, out_dir);
+	return failed > 0;
+}
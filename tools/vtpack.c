@@ -0,0 +1,136 @@
+/* Packs a square power-of-two image into a virtual texture page file for vt.h.
+ * usage: vtpack [--page-size 128] [--border 4] [--linear] input.png output.vt
+ * Layout: a 32-byte header ("VTEX", version, size, page size, border, levels, srgb, reserved), then
+ * every page as (page_size + 2 * border)^2 RGBA8 texels, level 0 first, pages row-major. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "image.h"
+#include "jobs.h"
+#include "mip.h"
+
+struct pack_job {
+	const u8* level; /* level image, size x size */
+	int size;
+	int page_size;
+	int border;
+	int pages; /* per side at this level */
+	u8* out;   /* pages * pages tiles */
+};
+
+/* one row of pages; border texels repeat the level's edge */
+static void
+pack_row_job(void* data, isize index) {
+	struct pack_job* job = data;
+	int stride = job->page_size + 2 * job->border;
+	int py = (int)index;
+	for (int px = 0; px < job->pages; px++) {
+		u8* tile = &job->out[((isize)py * job->pages + px) * stride * stride * 4];
+		for (int y = 0; y < stride; y++) {
+			int sy = py * job->page_size + y - job->border;
+			sy = sy < 0 ? 0 : sy >= job->size ? job->size - 1 : sy;
+			for (int x = 0; x < stride; x++) {
+				int sx = px * job->page_size + x - job->border;
+				sx = sx < 0 ? 0 : sx >= job->size ? job->size - 1 : sx;
+				memcpy(&tile[(y * stride + x) * 4], &job->level[((isize)sy * job->size + sx) * 4], 4);
+			}
+		}
+	}
+}
+
+static void
+usage(void) {
+	fprintf(stderr, "usage: vtpack [--page-size 128] [--border 4] [--linear] input output.vt\n");
+	exit(1);
+}
+
+int
+main(int argc, char** argv) {
+	int page_size = 128, border = 4;
+	b32 srgb = 1;
+	const char* input = NULL;
+	const char* output = NULL;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc) {
+			page_size = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--border") == 0 && i + 1 < argc) {
+			border = atoi(argv[++i]);
+		} else if (strcmp(argv[i], "--linear") == 0) {
+			srgb = 0;
+		} else if (!input) {
+			input = argv[i];
+		} else if (!output) {
+			output = argv[i];
+		} else {
+			usage();
+		}
+	}
+	if (!input || !output || page_size <= 0 || border < 0) {
+		usage();
+	}
+
+	restart_gl_log();
+	jobs_init(0);
+	int width, height;
+	u8* rgba = image_load(input, &width, &height);
+	if (!rgba) {
+		fprintf(stderr, "vtpack: could not load %s\n", input);
+		return 1;
+	}
+	int pages = width / page_size;
+	if (width != height || pages * page_size != width || (pages & (pages - 1)) != 0 || pages > 256) {
+		fprintf(stderr, "vtpack: %s is %dx%d, need a square power-of-two multiple of %d, at most 256 pages wide\n",
+		        input, width, height, page_size);
+		return 1;
+	}
+	int levels = 1;
+	while ((pages >> (levels - 1)) > 1) {
+		levels++;
+	}
+
+	struct mip_chain chain;
+	struct mip_options options = {.filter = MIP_FILTER_KAISER, .srgb = srgb};
+	if (!mip_build(rgba, width, height, &options, &chain)) {
+		fprintf(stderr, "vtpack: could not build mips for %s\n", input);
+		return 1;
+	}
+	FILE* out = fopen(output, "wb");
+	if (!out) {
+		fprintf(stderr, "vtpack: could not write %s\n", output);
+		return 1;
+	}
+	u32 header[8] = {0, 1, (u32)width, (u32)page_size, (u32)border, (u32)levels, (u32)srgb, 0};
+	memcpy(header, "VTEX", 4);
+	b32 ok = fwrite(header, sizeof(header), 1, out) == 1;
+
+	int stride = page_size + 2 * border;
+	isize tiles = 0;
+	for (int level = 0; level < levels && ok; level++) {
+		struct pack_job job = {
+		    .level = chain.data + chain.offset[level],
+		    .size = chain.width[level],
+		    .page_size = page_size,
+		    .border = border,
+		    .pages = pages >> level,
+		};
+		isize bytes = (isize)job.pages * job.pages * stride * stride * 4;
+		job.out = malloc(bytes);
+		jobs_parallel_for(pack_row_job, &job, job.pages);
+		ok = fwrite(job.out, 1, bytes, out) == (size_t)bytes;
+		free(job.out);
+		tiles += (isize)job.pages * job.pages;
+	}
+	ok = fclose(out) == 0 && ok;
+	if (ok) {
+		printf("%s: %dx%d, %d levels, %li pages of %dx%d (+%d border)\n", output, width, height, levels,
+		       (long)tiles, page_size, page_size, border);
+	} else {
+		fprintf(stderr, "vtpack: could not write %s\n", output);
+	}
+	mip_free(&chain);
+	free(rgba);
+	jobs_shutdown();
+	return ok ? 0 : 1;
+}
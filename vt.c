@@ -0,0 +1,537 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpu_trace.h"
+#include "camera.h"
+#include "gpu_memory.h"
+#include "pipeline.h"
+#include "render_target.h"
+#include "shader.h"
+#include "vt.h"
+
+#define VT_HEADER_SIZE 32
+#define VT_VERSION 1
+#define VT_UPLOADS_PER_FRAME 8
+#define VT_WANTED_MAX 256
+#define VT_PINNED_SLOT 0 /* holds the coarsest page, never on the LRU list */
+
+/* page_slot values besides a slot index */
+#define VT_NOT_RESIDENT -1
+#define VT_LOADING -2
+
+enum {
+	VT_LOAD_QUEUED = 1,
+	VT_LOAD_READING,
+	VT_LOAD_DONE,
+	VT_LOAD_FAILED,
+};
+
+//////////////////////////////////////
+// shaders
+static const char* vt_vertex_shader =
+    "#version 410\n"
+    "layout(location = 0) in vec3 vertex_position;\n"
+    "layout(location = 1) in vec2 vertex_uv;\n"
+    "uniform mat4 mvp;\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "	uv = vertex_uv;\n"
+    "	gl_Position = mvp * vec4(vertex_position, 1.0);\n"
+    "}\n";
+
+/* shared by both fragment shaders: the page level the screen-space footprint asks for */
+#define VT_GLSL_COMMON                                                       \
+	"#version 410\n"                                                         \
+	"in vec2 uv;\n"                                                          \
+	"out vec4 frag_color;\n"                                                 \
+	"uniform int vt_pages;\n"                                                \
+	"uniform int vt_levels;\n"                                               \
+	"uniform float vt_page_size;\n"                                          \
+	"int vt_level(vec2 uv, float bias) {\n"                                  \
+	"	vec2 texels = uv * float(vt_pages) * vt_page_size;\n"               \
+	"	vec2 dx = dFdx(texels), dy = dFdy(texels);\n"                        \
+	"	float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + bias;\n"    \
+	"	return int(clamp(lod, 0.0, float(vt_levels - 1)));\n"               \
+	"}\n"
+
+/* one RGBA8 texel per pixel: page x, page y, level, alpha 1 marks a written pixel */
+static const char* vt_feedback_shader = VT_GLSL_COMMON
+    "uniform float vt_bias;\n"
+    "void main() {\n"
+    "	int level = vt_level(uv, vt_bias);\n"
+    "	int pages = vt_pages >> level;\n"
+    "	ivec2 page = clamp(ivec2(uv * float(pages)), ivec2(0), ivec2(pages - 1));\n"
+    "	frag_color = vec4(vec3(page, level) / 255.0, 1.0);\n"
+    "}\n";
+
+/* the page table entry names the cache slot and level of the page actually resident */
+static const char* vt_draw_shader = VT_GLSL_COMMON
+    "uniform usampler2D vt_page_table;\n"
+    "uniform sampler2D vt_cache;\n"
+    "uniform float vt_border;\n"
+    "uniform float vt_cache_size;\n"
+    "void main() {\n"
+    "	int level = vt_level(uv, 0.0);\n"
+    "	vec2 c = clamp(uv, 0.0, 1.0);\n"
+    "	int pages = vt_pages >> level;\n"
+    "	uvec4 entry = texelFetch(vt_page_table, min(ivec2(c * float(pages)), ivec2(pages - 1)), level);\n"
+    "	float mapped_pages = float(vt_pages >> int(entry.z));\n"
+    "	vec2 p = c * mapped_pages;\n"
+    "	vec2 in_page = p - min(floor(p), vec2(mapped_pages - 1.0));\n"
+    "	vec2 texel = vec2(entry.xy) * (vt_page_size + 2.0 * vt_border) + vt_border + in_page * vt_page_size;\n"
+    "	frag_color = textureLod(vt_cache, texel / vt_cache_size, 0.0);\n"
+    "}\n";
+
+static void
+set_common_uniforms(struct virtual_texture* vt, GLuint program) {
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "vt_pages"), vt->size / vt->page_size);
+	glUniform1i(glGetUniformLocation(program, "vt_levels"), vt->levels);
+	glUniform1f(glGetUniformLocation(program, "vt_page_size"), (float)vt->page_size);
+}
+
+//////////////////////////////////////
+// pages
+static int
+pages_per_side(struct virtual_texture* vt, int level) {
+	return (vt->size / vt->page_size) >> level;
+}
+
+static b32
+read_tile(struct virtual_texture* vt, i32 page, u8* pixels) {
+	off_t offset = vt->data_offset + (off_t)page * vt->tile_bytes;
+	isize done = 0;
+	while (done < vt->tile_bytes) {
+		ssize_t n = pread(vt->fd, pixels + done, vt->tile_bytes - done, offset + done);
+		if (n <= 0) {
+			return 0;
+		}
+		done += n;
+	}
+	return 1;
+}
+
+static void
+upload_tile(struct virtual_texture* vt, i32 slot, const u8* pixels) {
+	int stride = vt->page_size + 2 * vt->border;
+	glBindTexture(GL_TEXTURE_2D, vt->cache);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % vt->cache_pages) * stride, (slot / vt->cache_pages) * stride, stride,
+	                stride, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void
+lru_unlink(struct virtual_texture* vt, i32 slot) {
+	struct vt_slot* s = &vt->slots[slot];
+	if (s->prev >= 0) {
+		vt->slots[s->prev].next = s->next;
+	} else {
+		vt->lru_head = s->next;
+	}
+	if (s->next >= 0) {
+		vt->slots[s->next].prev = s->prev;
+	} else {
+		vt->lru_tail = s->prev;
+	}
+	s->prev = s->next = -1;
+}
+
+static void
+lru_push_tail(struct virtual_texture* vt, i32 slot) {
+	struct vt_slot* s = &vt->slots[slot];
+	s->prev = vt->lru_tail;
+	s->next = -1;
+	if (vt->lru_tail >= 0) {
+		vt->slots[vt->lru_tail].next = slot;
+	} else {
+		vt->lru_head = slot;
+	}
+	vt->lru_tail = slot;
+}
+
+static void
+touch_slot(struct virtual_texture* vt, i32 slot) {
+	vt->slots[slot].last_used = vt->frame;
+	if (slot != VT_PINNED_SLOT) {
+		lru_unlink(vt, slot);
+		lru_push_tail(vt, slot);
+	}
+}
+
+/* every level entry points at its own slot when resident, otherwise inherits its parent's */
+static void
+rebuild_page_table(struct virtual_texture* vt) {
+	isize level_offset[VT_MAX_LEVELS];
+	isize offset = 0;
+	for (int level = 0; level < vt->levels; level++) {
+		level_offset[level] = offset;
+		offset += (isize)pages_per_side(vt, level) * pages_per_side(vt, level) * 4;
+	}
+	glBindTexture(GL_TEXTURE_2D, vt->page_table);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for (int level = vt->levels - 1; level >= 0; level--) {
+		int pages = pages_per_side(vt, level);
+		u8* entries = &vt->table[level_offset[level]];
+		for (int y = 0; y < pages; y++) {
+			for (int x = 0; x < pages; x++) {
+				u8* entry = &entries[(y * pages + x) * 4];
+				i32 slot = vt->page_slot[vt->level_first_page[level] + y * pages + x];
+				if (slot >= 0) {
+					entry[0] = (u8)(slot % vt->cache_pages);
+					entry[1] = (u8)(slot / vt->cache_pages);
+					entry[2] = (u8)level;
+					entry[3] = 255;
+				} else {
+					int parent_pages = pages_per_side(vt, level + 1);
+					memcpy(entry, &vt->table[level_offset[level + 1] + ((y / 2) * parent_pages + x / 2) * 4], 4);
+				}
+			}
+		}
+		glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, pages, pages, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entries);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	vt->table_dirty = 0;
+}
+
+//////////////////////////////////////
+// loader thread
+static void*
+loader_main(void* data) {
+	struct virtual_texture* vt = data;
+	TRACE_THREAD_NAME("vt loader");
+	pthread_mutex_lock(&vt->mutex);
+	for (;;) {
+		struct vt_load* load = NULL;
+		for (isize i = 0; i < VT_MAX_INFLIGHT && !load; i++) {
+			if (vt->loads[i].state == VT_LOAD_QUEUED) {
+				load = &vt->loads[i];
+			}
+		}
+		if (!load) {
+			if (vt->quit) {
+				break;
+			}
+			pthread_cond_wait(&vt->cond, &vt->mutex);
+			continue;
+		}
+		load->state = VT_LOAD_READING;
+		pthread_mutex_unlock(&vt->mutex);
+		b32 ok;
+		{
+			TRACE_ZONE("vt read tile");
+			ok = read_tile(vt, load->page, load->pixels);
+		}
+		pthread_mutex_lock(&vt->mutex);
+		load->state = ok ? VT_LOAD_DONE : VT_LOAD_FAILED;
+	}
+	pthread_mutex_unlock(&vt->mutex);
+	return NULL;
+}
+
+//////////////////////////////////////
+// vt
+b32
+vt_open(struct virtual_texture* vt, const char* path, int cache_pages) {
+	GPU_MEM_OWNER("virtual texture");
+	memset(vt, 0, sizeof(*vt));
+	vt->fd = open(path, O_RDONLY);
+	if (vt->fd < 0) {
+		gl_log_err("ERROR: could not open virtual texture %s\n", path);
+		return 0;
+	}
+	u8 header[VT_HEADER_SIZE] = {0}; /* a short read leaves it failing the magic check */
+	u32 fields[7] = {0};
+	if (pread(vt->fd, header, sizeof(header), 0) == sizeof(header)) {
+		memcpy(fields, header, sizeof(fields));
+	}
+	vt->size = (int)fields[2];
+	vt->page_size = (int)fields[3];
+	vt->border = (int)fields[4];
+	vt->levels = (int)fields[5];
+	vt->srgb = fields[6] != 0;
+	int pages = vt->page_size > 0 ? vt->size / vt->page_size : 0;
+	if (memcmp(header, "VTEX", 4) != 0 || fields[1] != VT_VERSION || pages <= 0 || pages > 256 ||
+	    (pages & (pages - 1)) != 0 || pages * vt->page_size != vt->size || vt->levels < 1 ||
+	    vt->levels > VT_MAX_LEVELS || (pages >> (vt->levels - 1)) != 1) {
+		gl_log_err("ERROR: %s is not a virtual texture\n", path);
+		close(vt->fd);
+		return 0;
+	}
+	for (int level = 0; level < vt->levels; level++) {
+		vt->level_first_page[level] = vt->pages_len;
+		vt->pages_len += pages_per_side(vt, level) * pages_per_side(vt, level);
+	}
+	int stride = vt->page_size + 2 * vt->border;
+	vt->tile_bytes = (isize)stride * stride * 4;
+	vt->data_offset = VT_HEADER_SIZE;
+
+	vt->page_slot = malloc(vt->pages_len * sizeof(*vt->page_slot));
+	vt->page_frame = calloc(vt->pages_len, sizeof(*vt->page_frame));
+	vt->table = malloc(vt->pages_len * 4);
+	for (int i = 0; i < vt->pages_len; i++) {
+		vt->page_slot[i] = VT_NOT_RESIDENT;
+	}
+
+	/* slot coordinates are stored in 8 bits of the page table */
+	vt->cache_pages = cache_pages < 2 ? 2 : cache_pages > 256 ? 256 : cache_pages;
+	int slots = vt->cache_pages * vt->cache_pages;
+	vt->slots = malloc(slots * sizeof(*vt->slots));
+	vt->lru_head = vt->lru_tail = -1;
+	for (i32 i = 0; i < slots; i++) {
+		vt->slots[i] = (struct vt_slot){.page = -1, .prev = -1, .next = -1};
+		if (i != VT_PINNED_SLOT) {
+			lru_push_tail(vt, i);
+		}
+	}
+
+	glGenTextures(1, &vt->page_table);
+	glBindTexture(GL_TEXTURE_2D, vt->page_table);
+	glTexStorage2D(GL_TEXTURE_2D, vt->levels, GL_RGBA8UI, pages, pages);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glGenTextures(1, &vt->cache);
+	glBindTexture(GL_TEXTURE_2D, vt->cache);
+	glTexStorage2D(GL_TEXTURE_2D, 1, vt->srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, vt->cache_pages * stride,
+	               vt->cache_pages * stride);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	/* the single page of the coarsest level is loaded up front and never evicted */
+	u8* pixels = malloc(vt->tile_bytes);
+	i32 root = vt->pages_len - 1;
+	if (!read_tile(vt, root, pixels)) {
+		gl_log_err("ERROR: could not read %s\n", path);
+		free(pixels);
+		vt_close(vt);
+		return 0;
+	}
+	upload_tile(vt, VT_PINNED_SLOT, pixels);
+	free(pixels);
+	vt->page_slot[root] = VT_PINNED_SLOT;
+	vt->slots[VT_PINNED_SLOT].page = root;
+	rebuild_page_table(vt);
+
+	vt->feedback_program = shader_compile_text("virtual texture feedback", vt_vertex_shader, vt_feedback_shader);
+	vt->draw_program = shader_compile_text("virtual texture draw", vt_vertex_shader, vt_draw_shader);
+	if (!vt->feedback_program || !vt->draw_program) {
+		vt_close(vt);
+		return 0;
+	}
+	set_common_uniforms(vt, vt->feedback_program);
+	/* feedback is rendered at 1/VT_FEEDBACK_SCALE resolution, so its derivatives are that much larger */
+	glUniform1f(glGetUniformLocation(vt->feedback_program, "vt_bias"), -3.0f);
+	vt->feedback_mvp = glGetUniformLocation(vt->feedback_program, "mvp");
+	set_common_uniforms(vt, vt->draw_program);
+	glUniform1i(glGetUniformLocation(vt->draw_program, "vt_page_table"), 0);
+	glUniform1i(glGetUniformLocation(vt->draw_program, "vt_cache"), 1);
+	glUniform1f(glGetUniformLocation(vt->draw_program, "vt_border"), (float)vt->border);
+	glUniform1f(glGetUniformLocation(vt->draw_program, "vt_cache_size"), (float)(vt->cache_pages * stride));
+	vt->draw_mvp = glGetUniformLocation(vt->draw_program, "mvp");
+	glUseProgram(0);
+	pipeline_invalidate();
+	vt->feedback_pipeline = pipeline_create(&(struct pipeline_desc){
+	    .name = "vt feedback",
+	    .program = vt->feedback_program,
+	    .depth_test = 1,
+	    .depth_func = CAMERA_DEPTH_FUNC,
+	    .depth_write = 1,
+	});
+	vt->draw_pipeline = pipeline_create(&(struct pipeline_desc){.name = "vt draw", .program = vt->draw_program});
+	readback_init(&vt->feedback_readback);
+
+	for (isize i = 0; i < VT_MAX_INFLIGHT; i++) {
+		vt->loads[i].page = -1;
+		vt->loads[i].pixels = malloc(vt->tile_bytes);
+	}
+	pthread_mutex_init(&vt->mutex, NULL);
+	pthread_cond_init(&vt->cond, NULL);
+	pthread_create(&vt->loader, NULL, loader_main, vt);
+	vt->frame = 1;
+	gl_log("virtual texture %s: %ix%i, %i levels of %i-texel pages, %i cache slots\n", path, vt->size, vt->size,
+	       vt->levels, vt->page_size, slots);
+	return 1;
+}
+
+void
+vt_close(struct virtual_texture* vt) {
+	if (vt->loads[0].pixels) {
+		pthread_mutex_lock(&vt->mutex);
+		vt->quit = 1;
+		pthread_cond_broadcast(&vt->cond);
+		pthread_mutex_unlock(&vt->mutex);
+		pthread_join(vt->loader, NULL);
+		pthread_mutex_destroy(&vt->mutex);
+		pthread_cond_destroy(&vt->cond);
+		for (isize i = 0; i < VT_MAX_INFLIGHT; i++) {
+			free(vt->loads[i].pixels);
+		}
+		readback_shutdown(&vt->feedback_readback);
+		gl_log("virtual texture: %li pages loaded, %li evicted\n", (long)vt->pages_loaded, (long)vt->pages_evicted);
+	}
+	glDeleteProgram(vt->feedback_program);
+	glDeleteProgram(vt->draw_program);
+	glDeleteTextures(1, &vt->page_table);
+	glDeleteTextures(1, &vt->cache);
+	free(vt->page_slot);
+	free(vt->page_frame);
+	free(vt->table);
+	free(vt->slots);
+	close(vt->fd);
+	memset(vt, 0, sizeof(*vt));
+}
+
+void
+vt_feedback_targets(int fb_width, int fb_height, struct rt_desc* color, struct rt_desc* depth) {
+	int width = fb_width / VT_FEEDBACK_SCALE > 0 ? fb_width / VT_FEEDBACK_SCALE : 1;
+	int height = fb_height / VT_FEEDBACK_SCALE > 0 ? fb_height / VT_FEEDBACK_SCALE : 1;
+	*color = (struct rt_desc){.format = GL_RGBA8, .width = width, .height = height};
+	*depth = (struct rt_desc){.format = GL_DEPTH_COMPONENT24, .width = width, .height = height};
+}
+
+void
+vt_begin_feedback(struct virtual_texture* vt, struct mat4 mvp, int fb_width, int fb_height) {
+	struct rt_desc color, depth;
+	vt_feedback_targets(fb_width, fb_height, &color, &depth);
+	vt->feedback_width = color.width;
+	vt->feedback_height = color.height;
+	static const float clear[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+	pipeline_clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, clear, CAMERA_CLEAR_DEPTH);
+	pipeline_bind(vt->feedback_pipeline);
+	glUniformMatrix4fv(vt->feedback_mvp, 1, GL_FALSE, mvp.m);
+}
+
+void
+vt_end_feedback(struct virtual_texture* vt) {
+	/* a full ring just skips this frame's feedback, the next one asks for the same pages */
+	/* GL orders the readback before anything a later pass draws into the recycled targets */
+	readback_request(&vt->feedback_readback, 0, 0, vt->feedback_width, vt->feedback_height, NULL);
+}
+
+struct vt_wanted {
+	i32 page;
+	int level;
+};
+
+struct vt_feedback {
+	struct virtual_texture* vt;
+	struct vt_wanted wanted[VT_WANTED_MAX];
+	isize wanted_len;
+};
+
+/* marks a requested page and its ancestors up to the first resident one, which is what the
+ * page table falls back to meanwhile */
+static void
+request_page(struct vt_feedback* feedback, int level, int x, int y) {
+	struct virtual_texture* vt = feedback->vt;
+	for (; level < vt->levels; level++, x /= 2, y /= 2) {
+		i32 page = vt->level_first_page[level] + y * pages_per_side(vt, level) + x;
+		if (vt->page_frame[page] == vt->frame) {
+			return;
+		}
+		vt->page_frame[page] = vt->frame;
+		i32 slot = vt->page_slot[page];
+		if (slot >= 0) {
+			touch_slot(vt, slot);
+			return;
+		}
+		if (slot == VT_NOT_RESIDENT && feedback->wanted_len < VT_WANTED_MAX) {
+			feedback->wanted[feedback->wanted_len++] = (struct vt_wanted){page, level};
+		}
+	}
+}
+
+static void
+feedback_fn(void* user, void* tag, const u8* rgba, int width, int height) {
+	(void)tag;
+	if (!rgba) {
+		return;
+	}
+	struct vt_feedback* feedback = user;
+	struct virtual_texture* vt = feedback->vt;
+	for (isize i = 0; i < (isize)width * height; i++) {
+		const u8* p = &rgba[i * 4];
+		if (p[3] != 255 || p[2] >= vt->levels || p[0] >= pages_per_side(vt, p[2]) ||
+		    p[1] >= pages_per_side(vt, p[2])) {
+			continue;
+		}
+		request_page(feedback, p[2], p[0], p[1]);
+	}
+}
+
+/* coarse pages first: they cover the most screen and unblock the finer levels' fallbacks */
+static int
+wanted_compare(const void* a, const void* b) {
+	return ((const struct vt_wanted*)b)->level - ((const struct vt_wanted*)a)->level;
+}
+
+void
+vt_update(struct virtual_texture* vt) {
+	TRACE_ZONE("vt update");
+	vt->frame++;
+	struct vt_feedback feedback = {.vt = vt};
+	readback_poll(&vt->feedback_readback, feedback_fn, &feedback, 0);
+	qsort(feedback.wanted, feedback.wanted_len, sizeof(feedback.wanted[0]), wanted_compare);
+
+	pthread_mutex_lock(&vt->mutex);
+	isize next_wanted = 0;
+	int uploads = 0;
+	for (isize i = 0; i < VT_MAX_INFLIGHT; i++) {
+		struct vt_load* load = &vt->loads[i];
+		if (load->state == VT_LOAD_DONE && uploads < VT_UPLOADS_PER_FRAME) {
+			/* the least recently used slot, unless even that one was needed this frame */
+			i32 slot = vt->lru_head;
+			if (vt->slots[slot].page >= 0 && vt->slots[slot].last_used == vt->frame) {
+				vt->page_slot[load->page] = VT_NOT_RESIDENT;
+			} else {
+				if (vt->slots[slot].page >= 0) {
+					vt->page_slot[vt->slots[slot].page] = VT_NOT_RESIDENT;
+					vt->pages_evicted++;
+				}
+				upload_tile(vt, slot, load->pixels);
+				vt->slots[slot].page = load->page;
+				vt->page_slot[load->page] = slot;
+				touch_slot(vt, slot);
+				vt->pages_loaded++;
+				vt->table_dirty = 1;
+				uploads++;
+			}
+			load->state = 0;
+			load->page = -1;
+		} else if (load->state == VT_LOAD_FAILED) {
+			gl_log_err("ERROR: could not read virtual texture page %i\n", load->page);
+			vt->page_slot[load->page] = VT_NOT_RESIDENT;
+			load->state = 0;
+			load->page = -1;
+		}
+		if (load->page < 0 && next_wanted < feedback.wanted_len) {
+			load->page = feedback.wanted[next_wanted++].page;
+			load->state = VT_LOAD_QUEUED;
+			vt->page_slot[load->page] = VT_LOADING;
+		}
+	}
+	pthread_cond_signal(&vt->cond);
+	pthread_mutex_unlock(&vt->mutex);
+
+	if (vt->table_dirty) {
+		rebuild_page_table(vt);
+	}
+}
+
+void
+vt_bind(struct virtual_texture* vt, struct mat4 mvp) {
+	pipeline_bind(vt->draw_pipeline);
+	glUniformMatrix4fv(vt->draw_mvp, 1, GL_FALSE, mvp.m);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, vt->page_table);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, vt->cache);
+	glActiveTexture(GL_TEXTURE0);
+}
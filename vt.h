@@ -0,0 +1,109 @@
+#ifndef VT_H
+#define VT_H
+
+#include <pthread.h>
+
+#include "gl_loader.h"
+
+#include "common.h"
+#include "math3d.h"
+#include "readback.h"
+#include "render_target.h"
+
+/* Virtual texturing.
+ * A square, power-of-two texture is split into pages (tools/vtpack.c writes them to a .vt file,
+ * every page padded with a border so bilinear filtering never reads a neighbour). Only pages that
+ * were actually seen are kept in a physical cache texture; a page table texture with one mip level
+ * per page level maps each virtual page to its cache slot, or to the closest resident coarser page.
+ *
+ * Each frame the geometry is drawn once more into a small feedback target that stores the page
+ * each pixel needs; the caller provides the target (vt_feedback_targets()), normally as a frame graph
+ * transient. It is read back asynchronously (readback.h); vt_update() turns it into load requests
+ * for a loader thread reading tiles from the file and uploads finished tiles into slots freed by
+ * least-recently-used eviction. The coarsest page is pinned so lookups never miss.
+ *
+ * Geometry drawn between vt_begin_feedback()/vt_end_feedback() and after vt_bind() uses attribute
+ * 0 for the vec3 position and attribute 1 for the vec2 texture coordinate. */
+
+#define VT_MAX_LEVELS 9     /* feedback stores page coordinates in 8 bits: up to 256x256 pages */
+#define VT_MAX_INFLIGHT 32  /* tiles requested from the loader thread at once */
+#define VT_FEEDBACK_SCALE 8 /* feedback target is 1/8 of the framebuffer per axis */
+
+struct vt_slot {
+	i32 page; /* virtual page in the slot, -1 when free */
+	i32 prev; /* LRU list, least recently used at the head */
+	i32 next;
+	u32 last_used; /* frame the page was last requested by feedback */
+};
+
+struct vt_load {
+	i32 page; /* -1 when the entry is unused */
+	int state;
+	u8* pixels;
+};
+
+struct virtual_texture {
+	int fd;
+	int size;      /* level 0 width and height in texels */
+	int page_size; /* texels per page side, without border */
+	int border;
+	int levels;
+	b32 srgb;
+	int pages_len;
+	int level_first_page[VT_MAX_LEVELS]; /* pages are numbered level by level, row-major */
+	isize tile_bytes;
+	isize data_offset;
+
+	i32* page_slot;   /* per page: cache slot or -1 */
+	u32* page_frame;  /* per page: frame it was last requested, dedupes feedback */
+	u8* table;        /* CPU copy of every page table level, RGBA8UI */
+	b32 table_dirty;
+
+	GLuint page_table;
+	GLuint cache;
+	int cache_pages; /* slots per cache side */
+	struct vt_slot* slots;
+	i32 lru_head;
+	i32 lru_tail;
+
+	int feedback_width; /* of the bound feedback target, what vt_end_feedback() reads back */
+	int feedback_height;
+	struct readback feedback_readback;
+	GLuint feedback_program;
+	GLuint draw_program;
+	GLint feedback_mvp;
+	GLint draw_mvp;
+	i32 feedback_pipeline; /* pipeline.h */
+	i32 draw_pipeline;
+	u32 frame;
+
+	pthread_t loader;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	b32 quit;
+	struct vt_load loads[VT_MAX_INFLIGHT];
+
+	isize pages_loaded;
+	isize pages_evicted;
+};
+
+/* cache_pages slots per side, so cache_pages^2 pages can be resident */
+b32 vt_open(struct virtual_texture* vt, const char* path, int cache_pages);
+void vt_close(struct virtual_texture* vt);
+
+/* the color and depth targets the feedback is drawn into for a framebuffer of this size */
+void vt_feedback_targets(int fb_width, int fb_height, struct rt_desc* color, struct rt_desc* depth);
+/* with those targets bound: clears them and binds the feedback program; draw the geometry, then call
+ * vt_end_feedback */
+void vt_begin_feedback(struct virtual_texture* vt, struct mat4 mvp, int fb_width, int fb_height);
+/* queues the async readback of the bound color target; the targets stay bound */
+void vt_end_feedback(struct virtual_texture* vt);
+
+/* once per frame on the GL thread: consume feedback, request pages, upload finished tiles */
+void vt_update(struct virtual_texture* vt);
+
+/* pipeline sampling the virtual texture, textures on units 0 and 1; it draws behind everything, without
+ * depth testing */
+void vt_bind(struct virtual_texture* vt, struct mat4 mvp);
+
+#endif